@@ -0,0 +1,162 @@
+#include <string.h>
+
+#include "asteroids.h"
+#include "command_parser.h"
+#include "utils.h"
+
+// Address decoding. A15 isn't connected, so the vectors at 0xFFFA read from 0x7FFA
+#define ADDR_MASK   0x7FFF
+#define IN0_BASE    0x2000
+#define IN1_BASE    0x2400
+#define DSW_BASE    0x2800
+#define DVG_GO      0x3000
+#define BANK_SELECT 0x3200
+#define VRAM_BASE   0x4000
+#define VROM_BASE   0x5000
+#define PROG_BASE   0x6800
+
+#define IN0_CLOCK 0x02 // 3 kHz clock
+#define IN0_BUSY  0x04 // DVG running. Never set, the list is decoded as soon as it starts
+#define RAM_SWAP  0x04 // Bank select bit that swaps pages 2 and 3
+
+#define CLOCK_3K_HALF (AST_CPU_HZ / 6000) // Cycles per half period of the 3 kHz clock
+
+// Pages 2 and 3 trade places for the second player
+static inline uint16_t ramAddr(const Asteroids* game, uint16_t addr) {
+    return (game->ram_swap && addr >= 0x200) ? addr ^ 0x100 : addr;
+}
+
+// Each switch reads in bit 7
+static uint8_t readIn0(const Asteroids* game, uint8_t bit) {
+    uint8_t in0 = (game->inputs >> 8) & ~IN0_BUSY;
+    if ((game->cpu.cycles / CLOCK_3K_HALF) & 0x01) in0 |= IN0_CLOCK;
+    return (in0 & (1 << bit)) ? 0x80 : 0x7F;
+}
+
+static uint8_t boardRead(void* board, uint16_t addr) {
+    const Asteroids* game = (const Asteroids*)board;
+    addr &= ADDR_MASK;
+    if (addr < AST_RAM_SIZE) {
+        return game->ram[ramAddr(game, addr)];
+    }
+    if (addr >= PROG_BASE) {
+        return game->program[addr - PROG_BASE];
+    }
+    if (addr >= VRAM_BASE && addr < VRAM_BASE + AST_VRAM_SIZE) {
+        return game->vram[addr - VRAM_BASE];
+    }
+    if (addr >= VROM_BASE && addr < VROM_BASE + AST_VROM_SIZE) {
+        return game->vector_rom[addr - VROM_BASE];
+    }
+    if (addr >= IN0_BASE && addr < IN0_BASE + 8) {
+        return readIn0(game, addr - IN0_BASE);
+    }
+    if (addr >= IN1_BASE && addr < IN1_BASE + 8) {
+        return (game->inputs & (1 << (addr - IN1_BASE))) ? 0x80 : 0x7F;
+    }
+    if (addr >= DSW_BASE && addr < DSW_BASE + 4) {
+        // Two switches at a time, in the low bits
+        return 0xFC | ((game->dsw >> (2 * (3 - (addr - DSW_BASE)))) & 0x03);
+    }
+    return 0;
+}
+
+static void boardWrite(void* board, uint16_t addr, uint8_t value) {
+    Asteroids* game = (Asteroids*)board;
+    addr &= ADDR_MASK;
+    if (addr < AST_RAM_SIZE) {
+        game->ram[ramAddr(game, addr)] = value;
+    }
+    else if (addr >= VRAM_BASE && addr < VRAM_BASE + AST_VRAM_SIZE) {
+        game->vram[addr - VRAM_BASE] = value;
+    }
+    else if (addr == DVG_GO) {
+        game->frame_ready = true;
+        game->frames++;
+    }
+    else if (addr == BANK_SELECT) {
+        game->ram_swap = (value & RAM_SWAP) != 0;
+    }
+    // The watchdog, sounds, and lamps are ignored
+}
+
+void asteroids_init(Asteroids* game, const uint8_t* program, const uint8_t* vector_rom) {
+    memset(game, '\0', sizeof(Asteroids));
+    game->program    = program;
+    game->vector_rom = vector_rom;
+    game->dsw        = AST_DSW_DEFAULT;
+    cpu_init(&game->cpu, game, boardRead, boardWrite);
+    asteroids_reset(game);
+}
+
+void asteroids_reset(Asteroids* game) {
+    game->ram_swap    = false;
+    game->frame_ready = false;
+    cpu_reset(&game->cpu);
+    game->next_nmi = AST_NMI_CYCLES;
+}
+
+bool asteroids_run_frame(Asteroids* game, uint32_t max_cycles) {
+    uint32_t end = game->cpu.cycles + max_cycles;
+    game->frame_ready = false;
+    while (!game->frame_ready && (int32_t)(end - game->cpu.cycles) > 0) {
+        cpu_step(&game->cpu);
+        if ((int32_t)(game->cpu.cycles - game->next_nmi) >= 0) {
+            game->next_nmi += AST_NMI_CYCLES;
+            cpu_nmi(&game->cpu);
+        }
+    }
+    return game->frame_ready;
+}
+
+void asteroids_screen(ScreenState* screen) {
+    screen->x_size_pow = log2ceil(DVG_SIZE / 2);
+    screen->y_size_pow = log2ceil(DVG_SIZE / 2);
+    screen->x_centered = true;
+    screen->y_centered = true;
+}
+
+typedef struct FrameSink {
+    const ScreenState* screen;
+    RingMemPool* pool;
+    AstFrameStats* stats;
+} FrameSink;
+
+// The DVG's screen has 0 at the bottom left. The device is centred on 0
+static void pushSegment(void* ctx, const DvgSegment* segment) {
+    FrameSink* sink = (FrameSink*)ctx;
+    if (sink->stats->dropped > 0) {
+        // Once full, the rest of the frame is dropped so the frame isn't drawn out of order
+        sink->stats->dropped++;
+        return;
+    }
+
+    void* motion;
+    if (segment->x1 == segment->x2 && segment->y1 == segment->y2) {
+        // Dots, like shots and stars
+        PointCmd cmd;
+        cmd.x  = segment->x1 - DVG_SIZE / 2;
+        cmd.y  = segment->y1 - DVG_SIZE / 2;
+        motion = screen_push_point(sink->screen, sink->pool, &cmd);
+        if (motion != NULL) sink->stats->points++;
+    }
+    else {
+        LineCmd cmd;
+        cmd.x1 = segment->x1 - DVG_SIZE / 2;
+        cmd.y1 = segment->y1 - DVG_SIZE / 2;
+        cmd.x2 = segment->x2 - DVG_SIZE / 2;
+        cmd.y2 = segment->y2 - DVG_SIZE / 2;
+        motion = screen_push_line(sink->screen, sink->pool, &cmd);
+        if (motion != NULL) sink->stats->lines++;
+    }
+    if (motion == NULL && sink->pool->last_err == RING_OUT_OF_MEM) {
+        sink->stats->dropped++;
+    }
+}
+
+void asteroids_push_frame(const Asteroids* game, const ScreenState* screen, RingMemPool* pool, AstFrameStats* stats) {
+    memset(stats, '\0', sizeof(AstFrameStats));
+    DvgMemory mem = {game->vram, AST_VRAM_SIZE, game->vector_rom, AST_VROM_SIZE};
+    FrameSink sink = {screen, pool, stats};
+    stats->ops = dvg_run(&mem, pushSegment, &sink);
+}
@@ -0,0 +1,69 @@
+// Asteroids
+// The Asteroids board: a 6502 building display lists for the DVG
+// Each display list the game starts is decoded into motions on the ring, like frames from a host
+// Sound and the self test aren't emulated. The DVG finishes as soon as it's started
+
+#ifndef ASTEROIDS_H
+#define ASTEROIDS_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "cpu6502.h"
+#include "dvg.h"
+#include "ring_mem_pool.h"
+#include "screen_controller.h"
+
+#define AST_CPU_HZ       1512000
+#define AST_NMI_CYCLES   6048   // NMIs come at 250 Hz, from the 3 kHz clock
+#define AST_FRAME_CYCLES 100000 // Most a game frame takes. Four NMIs, with plenty to spare
+#define AST_RAM_SIZE     0x400
+#define AST_VRAM_SIZE    0x800
+#define AST_PROGRAM_SIZE 0x1800 // 035145, 035144, 035143 at 0x6800
+#define AST_VROM_SIZE    0x800  // 035127 at 0x5000
+
+// Controls, as bits of the inputs
+#define AST_COIN     0x0001
+#define AST_START1   0x0008
+#define AST_START2   0x0010
+#define AST_THRUST   0x0020
+#define AST_RIGHT    0x0040
+#define AST_LEFT     0x0080
+#define AST_HYPER    0x0800
+#define AST_FIRE     0x1000
+
+// Switches. Free play, four ships, English
+#define AST_DSW_DEFAULT 0x00
+
+typedef struct Asteroids {
+    Cpu6502 cpu;
+    uint8_t ram[AST_RAM_SIZE];
+    uint8_t vram[AST_VRAM_SIZE];
+    const uint8_t* program;
+    const uint8_t* vector_rom;
+    uint16_t inputs;      // IN1 in the low byte, IN0 in the high byte
+    uint8_t dsw;
+    bool ram_swap;        // Second player's pages swapped in
+    uint32_t next_nmi;    // Cycle count of the next NMI
+    bool frame_ready;     // The DVG was started
+    uint32_t frames;      // Display lists started
+} Asteroids;
+
+// Converts the DVG's screen to the ring, with the device scaled to the same size
+typedef struct AstFrameStats {
+    uint16_t ops;     // DVG instructions run
+    uint16_t lines;
+    uint16_t points;
+    uint16_t dropped; // Didn't fit in the pool
+} AstFrameStats;
+
+void asteroids_init(Asteroids* game, const uint8_t* program, const uint8_t* vector_rom);
+void asteroids_reset(Asteroids* game);
+// Run the game until it starts the DVG on a new display list. False if max_cycles pass first
+bool asteroids_run_frame(Asteroids* game, uint32_t max_cycles);
+// Scale and centre the screen for the DVG's 1024 by 1024
+void asteroids_screen(ScreenState* screen);
+// Decode the display list and push what it draws onto the pool
+void asteroids_push_frame(const Asteroids* game, const ScreenState* screen, RingMemPool* pool, AstFrameStats* stats);
+
+#endif // ASTEROIDS_H
@@ -0,0 +1,107 @@
+// asteroids_bench.cpp
+// Asteroids from the ROMs, through the motion engine, as fast as the host goes
+// Attract mode, then a game with random controls. Each frame's display list is decoded onto the ring and drawn out
+// make bench, or ./asteroidsbench <rom directory>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+
+extern "C" {
+#include "asteroids.h"
+#include "rom_files.h"
+}
+
+#define FRAMES        3000
+#define ATTRACT       300  // Frames before the start button
+#define POOL_SIZE     8192
+#define SPEED         1000 // Millipoints per microsecond
+#define TIME_STEP     20   // Microseconds between screen updates
+
+typedef std::chrono::steady_clock Clock;
+
+static double since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Coin free, so start just needs pressing. Then steer and shoot at random, changing every few frames
+static uint16_t controls(uint32_t frame) {
+    if (frame < ATTRACT) return 0;
+    if (frame < ATTRACT + 10) return AST_START1;
+    if (frame % 8 != 0) return 0xFFFF;
+    uint16_t inputs = 0;
+    if (rand() % 2) inputs |= AST_FIRE;
+    if (rand() % 3 == 0) inputs |= AST_THRUST;
+    switch (rand() % 3) {
+    case 0: inputs |= AST_LEFT; break;
+    case 1: inputs |= AST_RIGHT; break;
+    }
+    if (rand() % 64 == 0) inputs |= AST_HYPER;
+    return inputs;
+}
+
+int main(int argc, char** argv) {
+    const char* dir = (argc > 1) ? argv[1] : "roms";
+    static uint8_t program[AST_PROGRAM_SIZE];
+    static uint8_t vector_rom[AST_VROM_SIZE];
+    if (!rom_load_asteroids(dir, program, vector_rom)) {
+        fprintf(stderr, "Can't load the Asteroids ROMs from %s\n", dir);
+        return 1;
+    }
+
+    static Asteroids game;
+    asteroids_init(&game, program, vector_rom);
+    ScreenState screen;
+    screen_init(&screen);
+    asteroids_screen(&screen);
+    screen.speed = SPEED;
+    static uint8_t memory[POOL_SIZE];
+    RingMemPool pool;
+    ring_init(&pool, memory, POOL_SIZE);
+
+    double cpu_secs    = 0;
+    double decode_secs = 0;
+    double draw_secs   = 0;
+    uint64_t motions   = 0;
+    uint64_t dropped   = 0;
+    uint32_t time      = 0;
+    srand(7);
+    Clock::time_point start = Clock::now();
+    for (uint32_t frame = 0; frame < FRAMES; frame++) {
+        uint16_t inputs = controls(frame);
+        if (inputs != 0xFFFF) game.inputs = inputs;
+
+        Clock::time_point step = Clock::now();
+        if (!asteroids_run_frame(&game, AST_FRAME_CYCLES)) {
+            fprintf(stderr, "No display list by frame %u\n", frame);
+            return 1;
+        }
+        cpu_secs += since(step);
+
+        step = Clock::now();
+        AstFrameStats stats;
+        ring_reset(&pool);
+        asteroids_push_frame(&game, &screen, &pool, &stats);
+        decode_secs += since(step);
+        motions += stats.lines + stats.points;
+        dropped += stats.dropped;
+
+        // Draw it out on virtual time
+        step = Clock::now();
+        while (pool.count > 0 || screen.motion_active) {
+            time += TIME_STEP;
+            update_screen(time, &screen, &pool);
+        }
+        draw_secs += since(step);
+    }
+    double total = since(start);
+
+    printf("%u frames, %u game cycles\n", FRAMES, game.cpu.cycles);
+    printf("6502    %9.0f frames/s\n", FRAMES / cpu_secs);
+    printf("DVG     %9.0f frames/s\n", FRAMES / decode_secs);
+    printf("engine  %9.0f frames/s\n", FRAMES / draw_secs);
+    printf("overall %9.0f frames/s | %.1f motions per frame, %llu dropped | %.2f ms of beam per frame\n",
+           FRAMES / total, (double)motions / FRAMES, (unsigned long long)dropped, time / 1000.0 / FRAMES);
+    return 0;
+}
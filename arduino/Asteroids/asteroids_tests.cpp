@@ -0,0 +1,118 @@
+// asteroids_tests.cpp
+
+#include <string.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "asteroids.h"
+#include "rom_files.h"
+}
+
+#define ROM_DIR "roms"
+
+static void collect(void* ctx, const DvgSegment* segment) {
+    ((std::vector<DvgSegment>*)ctx)->push_back(*segment);
+}
+
+// Little endian words into vector memory
+static size_t put(uint8_t* mem, size_t word, uint16_t value) {
+    mem[2 * word]     = value & 0xFF;
+    mem[2 * word + 1] = value >> 8;
+    return word + 1;
+}
+
+TEST(Dvg, displayList) {
+    uint8_t ram[64];
+    uint8_t rom[16];
+    memset(ram, 0, sizeof(ram));
+    memset(rom, 0, sizeof(rom));
+    size_t pc = 0;
+    pc = put(ram, pc, 0xA000 | 100);         // LABS 200, 100, scale 0
+    pc = put(ram, pc, 0x0000 | 200);
+    pc = put(ram, pc, 0x9000 | 0x0400 | 10); // VCTR scale 9, dy -10, dx 20, z 7
+    pc = put(ram, pc, 0x7000 | 20);
+    pc = put(ram, pc, 0x8000 | 4);           // VCTR scale 8, dy 4, z 0. A move
+    pc = put(ram, pc, 0x0000);
+    pc = put(ram, pc, 0xC800);               // JSRL into the ROM
+    pc = put(ram, pc, 0xF000 | 0x00F0 | 0x0004 | 0x0001); // SVEC dx -1 (scaled), z 15
+    pc = put(ram, pc, 0xB000);               // HALT
+    put(rom, 0, 0xF000 | 0x00C0 | 0x0100);   // SVEC dy 1 (scaled), z 12
+    put(rom, 1, 0xD000);                     // RTSL
+
+    DvgMemory mem = {ram, sizeof(ram), rom, sizeof(rom)};
+    std::vector<DvgSegment> segments;
+    EXPECT_EQ(8, dvg_run(&mem, collect, &segments));
+    ASSERT_EQ(3u, segments.size());
+
+    // Scale 9 draws at full length
+    EXPECT_EQ(200, segments[0].x1);
+    EXPECT_EQ(100, segments[0].y1);
+    EXPECT_EQ(220, segments[0].x2);
+    EXPECT_EQ(90,  segments[0].y2);
+    EXPECT_EQ(7,   segments[0].z);
+
+    // The move was half length. SVEC is 256 shifted down by 9 - 2
+    EXPECT_EQ(220, segments[1].x1);
+    EXPECT_EQ(92,  segments[1].y1);
+    EXPECT_EQ(220, segments[1].x2);
+    EXPECT_EQ(94,  segments[1].y2);
+    EXPECT_EQ(12,  segments[1].z);
+
+    EXPECT_EQ(218, segments[2].x2);
+    EXPECT_EQ(94,  segments[2].y2);
+    EXPECT_EQ(15,  segments[2].z);
+}
+
+TEST(Dvg, runaway) {
+    // A list that jumps to itself is cut off
+    uint8_t ram[4];
+    put(ram, 0, 0xE000);
+    put(ram, 1, 0xB000);
+    DvgMemory mem = {ram, sizeof(ram), NULL, 0};
+    std::vector<DvgSegment> segments;
+    EXPECT_EQ(DVG_MAX_OPS, dvg_run(&mem, collect, &segments));
+
+    // Calls deeper than the stack stop the list
+    put(ram, 0, 0xC000);
+    EXPECT_EQ(DVG_STACK_SIZE + 1, dvg_run(&mem, collect, &segments));
+    EXPECT_TRUE(segments.empty());
+}
+
+// Attract mode from the real ROMs, when they've been unzipped
+TEST(Asteroids, attract) {
+    static uint8_t program[AST_PROGRAM_SIZE];
+    static uint8_t vector_rom[AST_VROM_SIZE];
+    if (!rom_load_asteroids(ROM_DIR, program, vector_rom)) {
+        printf("No ROMs in " ROM_DIR ", skipped\n");
+        return;
+    }
+
+    static Asteroids game;
+    asteroids_init(&game, program, vector_rom);
+    ScreenState screen;
+    screen_init(&screen);
+    asteroids_screen(&screen);
+    static uint8_t memory[8192];
+    RingMemPool pool;
+    ring_init(&pool, memory, sizeof(memory));
+
+    AstFrameStats stats;
+    uint32_t most_lines = 0;
+    for (int i = 0; i < 120; i++) {
+        ASSERT_TRUE(asteroids_run_frame(&game, AST_FRAME_CYCLES)) << "frame " << i;
+        ring_reset(&pool);
+        asteroids_push_frame(&game, &screen, &pool, &stats);
+        EXPECT_LT(stats.ops, DVG_MAX_OPS);
+        EXPECT_EQ(0, stats.dropped);
+        if (stats.lines > most_lines) most_lines = stats.lines;
+    }
+    EXPECT_EQ(120u, game.frames);
+    // Rocks, the score, and the copyright
+    EXPECT_GT(most_lines, 50u);
+    // Frames come with every fourth NMI or so
+    EXPECT_GT(game.cpu.cycles, 120u * 3 * AST_NMI_CYCLES);
+    EXPECT_LT(game.cpu.cycles, 120u * 5 * AST_NMI_CYCLES);
+}
@@ -0,0 +1,441 @@
+#include <string.h>
+
+#include "cpu6502.h"
+
+#define STACK_BASE 0x0100
+#define NMI_VECTOR 0xFFFA
+#define RST_VECTOR 0xFFFC
+#define IRQ_VECTOR 0xFFFE
+
+// Base cycles for each opcode. Page crossings are added as they happen
+static const uint8_t opcode_cycles[256] = {
+//  0  1  2  3  4  5  6  7  8  9  A  B  C  D  E  F
+    7, 6, 2, 8, 3, 3, 5, 5, 3, 2, 2, 2, 4, 4, 6, 6, // 0
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // 1
+    6, 6, 2, 8, 3, 3, 5, 5, 4, 2, 2, 2, 4, 4, 6, 6, // 2
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // 3
+    6, 6, 2, 8, 3, 3, 5, 5, 3, 2, 2, 2, 3, 4, 6, 6, // 4
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // 5
+    6, 6, 2, 8, 3, 3, 5, 5, 4, 2, 2, 2, 5, 4, 6, 6, // 6
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // 7
+    2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4, // 8
+    2, 6, 2, 6, 4, 4, 4, 4, 2, 5, 2, 5, 5, 5, 5, 5, // 9
+    2, 6, 2, 6, 3, 3, 3, 3, 2, 2, 2, 2, 4, 4, 4, 4, // A
+    2, 5, 2, 5, 4, 4, 4, 4, 2, 4, 2, 4, 4, 4, 4, 4, // B
+    2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6, // C
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // D
+    2, 6, 2, 8, 3, 3, 5, 5, 2, 2, 2, 2, 4, 4, 6, 6, // E
+    2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7, // F
+};
+
+static inline uint8_t rd(Cpu6502* cpu, uint16_t addr) {
+    return cpu->read(cpu->board, addr);
+}
+
+static inline void wr(Cpu6502* cpu, uint16_t addr, uint8_t value) {
+    cpu->write(cpu->board, addr, value);
+}
+
+static inline uint16_t rd16(Cpu6502* cpu, uint16_t addr) {
+    return rd(cpu, addr) | ((uint16_t)rd(cpu, addr + 1) << 8);
+}
+
+static inline void push(Cpu6502* cpu, uint8_t value) {
+    wr(cpu, STACK_BASE | cpu->sp--, value);
+}
+
+static inline uint8_t pull(Cpu6502* cpu) {
+    return rd(cpu, STACK_BASE | ++cpu->sp);
+}
+
+static inline void setNZ(Cpu6502* cpu, uint8_t value) {
+    cpu->p = (cpu->p & ~(CPU_N | CPU_Z)) | (value & CPU_N) | ((value == 0) ? CPU_Z : 0);
+}
+
+static inline void setFlag(Cpu6502* cpu, uint8_t flag, bool on) {
+    cpu->p = (on) ? (cpu->p | flag) : (cpu->p & ~flag);
+}
+
+// Addressing modes. Each returns the effective address and moves past the operand
+
+static inline uint16_t amZp(Cpu6502* cpu) {
+    return rd(cpu, cpu->pc++);
+}
+
+static inline uint16_t amZpIdx(Cpu6502* cpu, uint8_t idx) {
+    return (uint8_t)(rd(cpu, cpu->pc++) + idx);
+}
+
+static inline uint16_t amAbs(Cpu6502* cpu) {
+    uint16_t addr = rd16(cpu, cpu->pc);
+    cpu->pc += 2;
+    return addr;
+}
+
+// Reads take a cycle longer when the index crosses a page
+static inline uint16_t amAbsIdx(Cpu6502* cpu, uint8_t idx, uint8_t* cycles) {
+    uint16_t base = amAbs(cpu);
+    uint16_t addr = base + idx;
+    if ((base ^ addr) & 0xFF00) (*cycles)++;
+    return addr;
+}
+
+static inline uint16_t amIndX(Cpu6502* cpu) {
+    uint8_t zp = rd(cpu, cpu->pc++) + cpu->x;
+    return rd(cpu, zp) | ((uint16_t)rd(cpu, (uint8_t)(zp + 1)) << 8);
+}
+
+static inline uint16_t amIndY(Cpu6502* cpu, uint8_t* cycles) {
+    uint8_t zp = rd(cpu, cpu->pc++);
+    uint16_t base = rd(cpu, zp) | ((uint16_t)rd(cpu, (uint8_t)(zp + 1)) << 8);
+    uint16_t addr = base + cpu->y;
+    if ((base ^ addr) & 0xFF00) (*cycles)++;
+    return addr;
+}
+
+// Operations
+
+static void adc(Cpu6502* cpu, uint8_t value) {
+    uint8_t carry = cpu->p & CPU_C;
+    uint16_t sum  = cpu->a + value + carry;
+    setFlag(cpu, CPU_V, (~(cpu->a ^ value) & (cpu->a ^ sum) & 0x80) != 0);
+    if (!(cpu->p & CPU_D)) {
+        setFlag(cpu, CPU_C, sum > 0xFF);
+        cpu->a = sum;
+        setNZ(cpu, cpu->a);
+        return;
+    }
+
+    // Decimal. Z comes from the binary sum, as on the NMOS part
+    setFlag(cpu, CPU_Z, (uint8_t)sum == 0);
+    uint16_t lo = (cpu->a & 0x0F) + (value & 0x0F) + carry;
+    if (lo > 0x09) lo = ((lo + 0x06) & 0x0F) + 0x10;
+    uint16_t dec = (cpu->a & 0xF0) + (value & 0xF0) + lo;
+    setFlag(cpu, CPU_N, (dec & 0x80) != 0);
+    setFlag(cpu, CPU_V, (~(cpu->a ^ value) & (cpu->a ^ dec) & 0x80) != 0);
+    if (dec >= 0xA0) dec += 0x60;
+    setFlag(cpu, CPU_C, dec > 0xFF);
+    cpu->a = dec;
+}
+
+static void sbc(Cpu6502* cpu, uint8_t value) {
+    uint8_t borrow = (cpu->p & CPU_C) ? 0 : 1;
+    uint16_t diff  = cpu->a - value - borrow;
+    setFlag(cpu, CPU_V, ((cpu->a ^ value) & (cpu->a ^ diff) & 0x80) != 0);
+    setFlag(cpu, CPU_C, diff < 0x100);
+    if (!(cpu->p & CPU_D)) {
+        cpu->a = diff;
+        setNZ(cpu, cpu->a);
+        return;
+    }
+
+    // Decimal. Flags come from the binary difference
+    setNZ(cpu, diff);
+    int16_t lo = (cpu->a & 0x0F) - (value & 0x0F) - borrow;
+    if (lo < 0) lo = ((lo - 0x06) & 0x0F) - 0x10;
+    int16_t dec = (cpu->a & 0xF0) - (value & 0xF0) + lo;
+    if (dec < 0) dec -= 0x60;
+    cpu->a = dec;
+}
+
+static void compare(Cpu6502* cpu, uint8_t reg, uint8_t value) {
+    setFlag(cpu, CPU_C, reg >= value);
+    setNZ(cpu, reg - value);
+}
+
+static uint8_t asl(Cpu6502* cpu, uint8_t value) {
+    setFlag(cpu, CPU_C, value & 0x80);
+    value <<= 1;
+    setNZ(cpu, value);
+    return value;
+}
+
+static uint8_t lsr(Cpu6502* cpu, uint8_t value) {
+    setFlag(cpu, CPU_C, value & 0x01);
+    value >>= 1;
+    setNZ(cpu, value);
+    return value;
+}
+
+static uint8_t rol(Cpu6502* cpu, uint8_t value) {
+    uint8_t carry = cpu->p & CPU_C;
+    setFlag(cpu, CPU_C, value & 0x80);
+    value = (value << 1) | carry;
+    setNZ(cpu, value);
+    return value;
+}
+
+static uint8_t ror(Cpu6502* cpu, uint8_t value) {
+    uint8_t carry = (cpu->p & CPU_C) ? 0x80 : 0;
+    setFlag(cpu, CPU_C, value & 0x01);
+    value = (value >> 1) | carry;
+    setNZ(cpu, value);
+    return value;
+}
+
+static void branch(Cpu6502* cpu, bool taken, uint8_t* cycles) {
+    int8_t offset = rd(cpu, cpu->pc++);
+    if (!taken) return;
+    uint16_t target = cpu->pc + offset;
+    *cycles += ((cpu->pc ^ target) & 0xFF00) ? 2 : 1;
+    cpu->pc = target;
+}
+
+static void interrupt(Cpu6502* cpu, uint16_t vector, bool brk) {
+    push(cpu, cpu->pc >> 8);
+    push(cpu, cpu->pc & 0xFF);
+    push(cpu, cpu->p | CPU_U | ((brk) ? CPU_B : 0));
+    cpu->p |= CPU_I;
+    cpu->pc = rd16(cpu, vector);
+}
+
+// Read-modify-write on memory
+#define RMW(op, addr) do { uint16_t _a = (addr); wr(cpu, _a, op(cpu, rd(cpu, _a))); } while (0)
+
+void cpu_init(Cpu6502* cpu, void* board, CpuRead read, CpuWrite write) {
+    memset(cpu, '\0', sizeof(Cpu6502));
+    cpu->board = board;
+    cpu->read  = read;
+    cpu->write = write;
+}
+
+void cpu_reset(Cpu6502* cpu) {
+    cpu->a      = 0;
+    cpu->x      = 0;
+    cpu->y      = 0;
+    cpu->sp     = 0xFD;
+    cpu->p      = CPU_U | CPU_I;
+    cpu->nmi    = false;
+    cpu->cycles = 0;
+    cpu->pc     = rd16(cpu, RST_VECTOR);
+}
+
+void cpu_nmi(Cpu6502* cpu) {
+    cpu->nmi = true;
+}
+
+uint8_t cpu_step(Cpu6502* cpu) {
+    if (cpu->nmi) {
+        cpu->nmi = false;
+        interrupt(cpu, NMI_VECTOR, false);
+        cpu->cycles += 7;
+        return 7;
+    }
+
+    uint8_t opcode = rd(cpu, cpu->pc++);
+    uint8_t cycles = opcode_cycles[opcode];
+    uint8_t value;
+    uint16_t addr;
+    switch (opcode) {
+    // Loads and stores
+    case 0xA9: cpu->a = rd(cpu, cpu->pc++);                      setNZ(cpu, cpu->a); break;
+    case 0xA5: cpu->a = rd(cpu, amZp(cpu));                      setNZ(cpu, cpu->a); break;
+    case 0xB5: cpu->a = rd(cpu, amZpIdx(cpu, cpu->x));           setNZ(cpu, cpu->a); break;
+    case 0xAD: cpu->a = rd(cpu, amAbs(cpu));                     setNZ(cpu, cpu->a); break;
+    case 0xBD: cpu->a = rd(cpu, amAbsIdx(cpu, cpu->x, &cycles)); setNZ(cpu, cpu->a); break;
+    case 0xB9: cpu->a = rd(cpu, amAbsIdx(cpu, cpu->y, &cycles)); setNZ(cpu, cpu->a); break;
+    case 0xA1: cpu->a = rd(cpu, amIndX(cpu));                    setNZ(cpu, cpu->a); break;
+    case 0xB1: cpu->a = rd(cpu, amIndY(cpu, &cycles));           setNZ(cpu, cpu->a); break;
+    case 0xA2: cpu->x = rd(cpu, cpu->pc++);                      setNZ(cpu, cpu->x); break;
+    case 0xA6: cpu->x = rd(cpu, amZp(cpu));                      setNZ(cpu, cpu->x); break;
+    case 0xB6: cpu->x = rd(cpu, amZpIdx(cpu, cpu->y));           setNZ(cpu, cpu->x); break;
+    case 0xAE: cpu->x = rd(cpu, amAbs(cpu));                     setNZ(cpu, cpu->x); break;
+    case 0xBE: cpu->x = rd(cpu, amAbsIdx(cpu, cpu->y, &cycles)); setNZ(cpu, cpu->x); break;
+    case 0xA0: cpu->y = rd(cpu, cpu->pc++);                      setNZ(cpu, cpu->y); break;
+    case 0xA4: cpu->y = rd(cpu, amZp(cpu));                      setNZ(cpu, cpu->y); break;
+    case 0xB4: cpu->y = rd(cpu, amZpIdx(cpu, cpu->x));           setNZ(cpu, cpu->y); break;
+    case 0xAC: cpu->y = rd(cpu, amAbs(cpu));                     setNZ(cpu, cpu->y); break;
+    case 0xBC: cpu->y = rd(cpu, amAbsIdx(cpu, cpu->x, &cycles)); setNZ(cpu, cpu->y); break;
+    // Stores never take the page crossing cycle, it's in the base count
+    case 0x85: wr(cpu, amZp(cpu), cpu->a);                       break;
+    case 0x95: wr(cpu, amZpIdx(cpu, cpu->x), cpu->a);            break;
+    case 0x8D: wr(cpu, amAbs(cpu), cpu->a);                      break;
+    case 0x9D: wr(cpu, amAbs(cpu) + cpu->x, cpu->a);             break;
+    case 0x99: wr(cpu, amAbs(cpu) + cpu->y, cpu->a);             break;
+    case 0x81: wr(cpu, amIndX(cpu), cpu->a);                     break;
+    case 0x91: value = 0; wr(cpu, amIndY(cpu, &value), cpu->a);  break; // Penalty ignored
+    case 0x86: wr(cpu, amZp(cpu), cpu->x);                       break;
+    case 0x96: wr(cpu, amZpIdx(cpu, cpu->y), cpu->x);            break;
+    case 0x8E: wr(cpu, amAbs(cpu), cpu->x);                      break;
+    case 0x84: wr(cpu, amZp(cpu), cpu->y);                       break;
+    case 0x94: wr(cpu, amZpIdx(cpu, cpu->x), cpu->y);            break;
+    case 0x8C: wr(cpu, amAbs(cpu), cpu->y);                      break;
+
+    // Transfers
+    case 0xAA: cpu->x = cpu->a;  setNZ(cpu, cpu->x); break;
+    case 0xA8: cpu->y = cpu->a;  setNZ(cpu, cpu->y); break;
+    case 0x8A: cpu->a = cpu->x;  setNZ(cpu, cpu->a); break;
+    case 0x98: cpu->a = cpu->y;  setNZ(cpu, cpu->a); break;
+    case 0xBA: cpu->x = cpu->sp; setNZ(cpu, cpu->x); break;
+    case 0x9A: cpu->sp = cpu->x;                     break;
+
+    // Stack
+    case 0x48: push(cpu, cpu->a);                            break;
+    case 0x08: push(cpu, cpu->p | CPU_B | CPU_U);            break;
+    case 0x68: cpu->a = pull(cpu); setNZ(cpu, cpu->a);       break;
+    case 0x28: cpu->p = (pull(cpu) & ~CPU_B) | CPU_U;        break;
+
+    // Arithmetic
+    case 0x69: adc(cpu, rd(cpu, cpu->pc++));                      break;
+    case 0x65: adc(cpu, rd(cpu, amZp(cpu)));                      break;
+    case 0x75: adc(cpu, rd(cpu, amZpIdx(cpu, cpu->x)));           break;
+    case 0x6D: adc(cpu, rd(cpu, amAbs(cpu)));                     break;
+    case 0x7D: adc(cpu, rd(cpu, amAbsIdx(cpu, cpu->x, &cycles))); break;
+    case 0x79: adc(cpu, rd(cpu, amAbsIdx(cpu, cpu->y, &cycles))); break;
+    case 0x61: adc(cpu, rd(cpu, amIndX(cpu)));                    break;
+    case 0x71: adc(cpu, rd(cpu, amIndY(cpu, &cycles)));           break;
+    case 0xE9: sbc(cpu, rd(cpu, cpu->pc++));                      break;
+    case 0xE5: sbc(cpu, rd(cpu, amZp(cpu)));                      break;
+    case 0xF5: sbc(cpu, rd(cpu, amZpIdx(cpu, cpu->x)));           break;
+    case 0xED: sbc(cpu, rd(cpu, amAbs(cpu)));                     break;
+    case 0xFD: sbc(cpu, rd(cpu, amAbsIdx(cpu, cpu->x, &cycles))); break;
+    case 0xF9: sbc(cpu, rd(cpu, amAbsIdx(cpu, cpu->y, &cycles))); break;
+    case 0xE1: sbc(cpu, rd(cpu, amIndX(cpu)));                    break;
+    case 0xF1: sbc(cpu, rd(cpu, amIndY(cpu, &cycles)));           break;
+
+    // Logic
+    case 0x29: cpu->a &= rd(cpu, cpu->pc++);                      setNZ(cpu, cpu->a); break;
+    case 0x25: cpu->a &= rd(cpu, amZp(cpu));                      setNZ(cpu, cpu->a); break;
+    case 0x35: cpu->a &= rd(cpu, amZpIdx(cpu, cpu->x));           setNZ(cpu, cpu->a); break;
+    case 0x2D: cpu->a &= rd(cpu, amAbs(cpu));                     setNZ(cpu, cpu->a); break;
+    case 0x3D: cpu->a &= rd(cpu, amAbsIdx(cpu, cpu->x, &cycles)); setNZ(cpu, cpu->a); break;
+    case 0x39: cpu->a &= rd(cpu, amAbsIdx(cpu, cpu->y, &cycles)); setNZ(cpu, cpu->a); break;
+    case 0x21: cpu->a &= rd(cpu, amIndX(cpu));                    setNZ(cpu, cpu->a); break;
+    case 0x31: cpu->a &= rd(cpu, amIndY(cpu, &cycles));           setNZ(cpu, cpu->a); break;
+    case 0x09: cpu->a |= rd(cpu, cpu->pc++);                      setNZ(cpu, cpu->a); break;
+    case 0x05: cpu->a |= rd(cpu, amZp(cpu));                      setNZ(cpu, cpu->a); break;
+    case 0x15: cpu->a |= rd(cpu, amZpIdx(cpu, cpu->x));           setNZ(cpu, cpu->a); break;
+    case 0x0D: cpu->a |= rd(cpu, amAbs(cpu));                     setNZ(cpu, cpu->a); break;
+    case 0x1D: cpu->a |= rd(cpu, amAbsIdx(cpu, cpu->x, &cycles)); setNZ(cpu, cpu->a); break;
+    case 0x19: cpu->a |= rd(cpu, amAbsIdx(cpu, cpu->y, &cycles)); setNZ(cpu, cpu->a); break;
+    case 0x01: cpu->a |= rd(cpu, amIndX(cpu));                    setNZ(cpu, cpu->a); break;
+    case 0x11: cpu->a |= rd(cpu, amIndY(cpu, &cycles));           setNZ(cpu, cpu->a); break;
+    case 0x49: cpu->a ^= rd(cpu, cpu->pc++);                      setNZ(cpu, cpu->a); break;
+    case 0x45: cpu->a ^= rd(cpu, amZp(cpu));                      setNZ(cpu, cpu->a); break;
+    case 0x55: cpu->a ^= rd(cpu, amZpIdx(cpu, cpu->x));           setNZ(cpu, cpu->a); break;
+    case 0x4D: cpu->a ^= rd(cpu, amAbs(cpu));                     setNZ(cpu, cpu->a); break;
+    case 0x5D: cpu->a ^= rd(cpu, amAbsIdx(cpu, cpu->x, &cycles)); setNZ(cpu, cpu->a); break;
+    case 0x59: cpu->a ^= rd(cpu, amAbsIdx(cpu, cpu->y, &cycles)); setNZ(cpu, cpu->a); break;
+    case 0x41: cpu->a ^= rd(cpu, amIndX(cpu));                    setNZ(cpu, cpu->a); break;
+    case 0x51: cpu->a ^= rd(cpu, amIndY(cpu, &cycles));           setNZ(cpu, cpu->a); break;
+    case 0x24:
+    case 0x2C:
+        value = rd(cpu, (opcode == 0x24) ? amZp(cpu) : amAbs(cpu));
+        cpu->p = (cpu->p & ~(CPU_N | CPU_V | CPU_Z)) | (value & (CPU_N | CPU_V)) | ((cpu->a & value) ? 0 : CPU_Z);
+        break;
+
+    // Compares
+    case 0xC9: compare(cpu, cpu->a, rd(cpu, cpu->pc++));                      break;
+    case 0xC5: compare(cpu, cpu->a, rd(cpu, amZp(cpu)));                      break;
+    case 0xD5: compare(cpu, cpu->a, rd(cpu, amZpIdx(cpu, cpu->x)));           break;
+    case 0xCD: compare(cpu, cpu->a, rd(cpu, amAbs(cpu)));                     break;
+    case 0xDD: compare(cpu, cpu->a, rd(cpu, amAbsIdx(cpu, cpu->x, &cycles))); break;
+    case 0xD9: compare(cpu, cpu->a, rd(cpu, amAbsIdx(cpu, cpu->y, &cycles))); break;
+    case 0xC1: compare(cpu, cpu->a, rd(cpu, amIndX(cpu)));                    break;
+    case 0xD1: compare(cpu, cpu->a, rd(cpu, amIndY(cpu, &cycles)));           break;
+    case 0xE0: compare(cpu, cpu->x, rd(cpu, cpu->pc++));                      break;
+    case 0xE4: compare(cpu, cpu->x, rd(cpu, amZp(cpu)));                      break;
+    case 0xEC: compare(cpu, cpu->x, rd(cpu, amAbs(cpu)));                     break;
+    case 0xC0: compare(cpu, cpu->y, rd(cpu, cpu->pc++));                      break;
+    case 0xC4: compare(cpu, cpu->y, rd(cpu, amZp(cpu)));                      break;
+    case 0xCC: compare(cpu, cpu->y, rd(cpu, amAbs(cpu)));                     break;
+
+    // Increments
+    case 0xE6: addr = amZp(cpu);              value = rd(cpu, addr) + 1; wr(cpu, addr, value); setNZ(cpu, value); break;
+    case 0xF6: addr = amZpIdx(cpu, cpu->x);   value = rd(cpu, addr) + 1; wr(cpu, addr, value); setNZ(cpu, value); break;
+    case 0xEE: addr = amAbs(cpu);             value = rd(cpu, addr) + 1; wr(cpu, addr, value); setNZ(cpu, value); break;
+    case 0xFE: addr = amAbs(cpu) + cpu->x;    value = rd(cpu, addr) + 1; wr(cpu, addr, value); setNZ(cpu, value); break;
+    case 0xC6: addr = amZp(cpu);              value = rd(cpu, addr) - 1; wr(cpu, addr, value); setNZ(cpu, value); break;
+    case 0xD6: addr = amZpIdx(cpu, cpu->x);   value = rd(cpu, addr) - 1; wr(cpu, addr, value); setNZ(cpu, value); break;
+    case 0xCE: addr = amAbs(cpu);             value = rd(cpu, addr) - 1; wr(cpu, addr, value); setNZ(cpu, value); break;
+    case 0xDE: addr = amAbs(cpu) + cpu->x;    value = rd(cpu, addr) - 1; wr(cpu, addr, value); setNZ(cpu, value); break;
+    case 0xE8: cpu->x++; setNZ(cpu, cpu->x); break;
+    case 0xC8: cpu->y++; setNZ(cpu, cpu->y); break;
+    case 0xCA: cpu->x--; setNZ(cpu, cpu->x); break;
+    case 0x88: cpu->y--; setNZ(cpu, cpu->y); break;
+
+    // Shifts
+    case 0x0A: cpu->a = asl(cpu, cpu->a);     break;
+    case 0x06: RMW(asl, amZp(cpu));           break;
+    case 0x16: RMW(asl, amZpIdx(cpu, cpu->x)); break;
+    case 0x0E: RMW(asl, amAbs(cpu));          break;
+    case 0x1E: RMW(asl, amAbs(cpu) + cpu->x); break;
+    case 0x4A: cpu->a = lsr(cpu, cpu->a);     break;
+    case 0x46: RMW(lsr, amZp(cpu));           break;
+    case 0x56: RMW(lsr, amZpIdx(cpu, cpu->x)); break;
+    case 0x4E: RMW(lsr, amAbs(cpu));          break;
+    case 0x5E: RMW(lsr, amAbs(cpu) + cpu->x); break;
+    case 0x2A: cpu->a = rol(cpu, cpu->a);     break;
+    case 0x26: RMW(rol, amZp(cpu));           break;
+    case 0x36: RMW(rol, amZpIdx(cpu, cpu->x)); break;
+    case 0x2E: RMW(rol, amAbs(cpu));          break;
+    case 0x3E: RMW(rol, amAbs(cpu) + cpu->x); break;
+    case 0x6A: cpu->a = ror(cpu, cpu->a);     break;
+    case 0x66: RMW(ror, amZp(cpu));           break;
+    case 0x76: RMW(ror, amZpIdx(cpu, cpu->x)); break;
+    case 0x6E: RMW(ror, amAbs(cpu));          break;
+    case 0x7E: RMW(ror, amAbs(cpu) + cpu->x); break;
+
+    // Jumps
+    case 0x4C: cpu->pc = amAbs(cpu); break;
+    case 0x6C:
+        // The pointer's high byte doesn't carry into the next page
+        addr    = amAbs(cpu);
+        cpu->pc = rd(cpu, addr) | ((uint16_t)rd(cpu, (addr & 0xFF00) | (uint8_t)(addr + 1)) << 8);
+        break;
+    case 0x20:
+        addr = amAbs(cpu);
+        cpu->pc--;
+        push(cpu, cpu->pc >> 8);
+        push(cpu, cpu->pc & 0xFF);
+        cpu->pc = addr;
+        break;
+    case 0x60:
+        cpu->pc  = pull(cpu);
+        cpu->pc |= (uint16_t)pull(cpu) << 8;
+        cpu->pc++;
+        break;
+    case 0x40:
+        cpu->p   = (pull(cpu) & ~CPU_B) | CPU_U;
+        cpu->pc  = pull(cpu);
+        cpu->pc |= (uint16_t)pull(cpu) << 8;
+        break;
+    case 0x00:
+        cpu->pc++;
+        interrupt(cpu, IRQ_VECTOR, true);
+        break;
+
+    // Branches
+    case 0x10: branch(cpu, !(cpu->p & CPU_N), &cycles); break;
+    case 0x30: branch(cpu,  (cpu->p & CPU_N), &cycles); break;
+    case 0x50: branch(cpu, !(cpu->p & CPU_V), &cycles); break;
+    case 0x70: branch(cpu,  (cpu->p & CPU_V), &cycles); break;
+    case 0x90: branch(cpu, !(cpu->p & CPU_C), &cycles); break;
+    case 0xB0: branch(cpu,  (cpu->p & CPU_C), &cycles); break;
+    case 0xD0: branch(cpu, !(cpu->p & CPU_Z), &cycles); break;
+    case 0xF0: branch(cpu,  (cpu->p & CPU_Z), &cycles); break;
+
+    // Flags
+    case 0x18: cpu->p &= ~CPU_C; break;
+    case 0x38: cpu->p |=  CPU_C; break;
+    case 0x58: cpu->p &= ~CPU_I; break;
+    case 0x78: cpu->p |=  CPU_I; break;
+    case 0xB8: cpu->p &= ~CPU_V; break;
+    case 0xD8: cpu->p &= ~CPU_D; break;
+    case 0xF8: cpu->p |=  CPU_D; break;
+
+    case 0xEA:
+    default:
+        break;
+    }
+    cpu->cycles += cycles;
+    return cycles;
+}
+
+uint32_t cpu_run(Cpu6502* cpu, uint32_t cycles) {
+    uint32_t done = 0;
+    while (done < cycles) {
+        done += cpu_step(cpu);
+    }
+    return done;
+}
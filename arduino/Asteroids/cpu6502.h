@@ -0,0 +1,48 @@
+// Cpu6502
+// NMOS 6502 core, enough for 1970s arcade boards
+// All documented opcodes, including decimal mode. Undocumented opcodes run as a one byte NOP
+// Memory goes through the read and write functions so the board decides what's mapped where
+
+#ifndef CPU6502_H
+#define CPU6502_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+// Status flags
+#define CPU_C 0x01
+#define CPU_Z 0x02
+#define CPU_I 0x04
+#define CPU_D 0x08
+#define CPU_B 0x10
+#define CPU_U 0x20
+#define CPU_V 0x40
+#define CPU_N 0x80
+
+typedef uint8_t (*CpuRead)(void* board, uint16_t addr);
+typedef void (*CpuWrite)(void* board, uint16_t addr, uint8_t value);
+
+typedef struct Cpu6502 {
+    uint16_t pc;
+    uint8_t a;
+    uint8_t x;
+    uint8_t y;
+    uint8_t sp;
+    uint8_t p;
+    uint32_t cycles; // Since reset
+    bool nmi;        // Taken before the next instruction
+    void* board;
+    CpuRead read;
+    CpuWrite write;
+} Cpu6502;
+
+void cpu_init(Cpu6502* cpu, void* board, CpuRead read, CpuWrite write);
+// Load the program counter from the reset vector
+void cpu_reset(Cpu6502* cpu);
+void cpu_nmi(Cpu6502* cpu);
+// Run one instruction and return the cycles it took
+uint8_t cpu_step(Cpu6502* cpu);
+// Run until at least the given number of cycles have passed
+uint32_t cpu_run(Cpu6502* cpu, uint32_t cycles);
+
+#endif // CPU6502_H
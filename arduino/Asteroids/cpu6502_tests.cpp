@@ -0,0 +1,190 @@
+// cpu6502_tests.cpp
+
+#include <string.h>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "cpu6502.h"
+}
+
+// 64K of RAM
+class Cpu6502Test : public testing::Test {
+protected:
+    virtual void SetUp() {
+        memset(this->mem, 0, sizeof(this->mem));
+        cpu_init(&this->cpu, this->mem, memRead, memWrite);
+    }
+
+    static uint8_t memRead(void* board, uint16_t addr) {
+        return ((uint8_t*)board)[addr];
+    }
+
+    static void memWrite(void* board, uint16_t addr, uint8_t value) {
+        ((uint8_t*)board)[addr] = value;
+    }
+
+    // Load a program at 0x0200 and point the reset vector at it
+    void load(const uint8_t* program, size_t len) {
+        memcpy(this->mem + 0x0200, program, len);
+        this->mem[0xFFFC] = 0x00;
+        this->mem[0xFFFD] = 0x02;
+        cpu_reset(&this->cpu);
+    }
+
+    // Run until the program reaches its last byte, a JMP to itself
+    uint32_t runToEnd(uint16_t end) {
+        uint32_t cycles = 0;
+        for (int i = 0; i < 100000 && this->cpu.pc != end; i++) cycles += cpu_step(&this->cpu);
+        return cycles;
+    }
+
+    Cpu6502 cpu;
+    uint8_t mem[0x10000];
+};
+
+TEST_F(Cpu6502Test, loadStore) {
+    const uint8_t program[] = {
+        0xA9, 0x42,       // LDA #$42
+        0x85, 0x10,       // STA $10
+        0xA2, 0x03,       // LDX #3
+        0x95, 0x20,       // STA $20,X
+        0xA0, 0x80,       // LDY #$80
+        0x8C, 0x00, 0x30, // STY $3000
+        0xAD, 0x00, 0x30, // LDA $3000
+        0x4C, 0x10, 0x02, // JMP * (0x0210)
+    };
+    this->load(program, sizeof(program));
+    this->runToEnd(0x0210);
+    EXPECT_EQ(0x42, this->mem[0x10]);
+    EXPECT_EQ(0x42, this->mem[0x23]);
+    EXPECT_EQ(0x80, this->mem[0x3000]);
+    EXPECT_EQ(0x80, this->cpu.a);
+    EXPECT_TRUE(this->cpu.p & CPU_N);
+    EXPECT_FALSE(this->cpu.p & CPU_Z);
+}
+
+TEST_F(Cpu6502Test, loopSum) {
+    // Add 10 down to 1
+    const uint8_t program[] = {
+        0xA9, 0x00,       // LDA #0
+        0xA2, 0x0A,       // LDX #10
+        0x18,             // loop: CLC
+        0x86, 0x00,       // STX $00
+        0x65, 0x00,       // ADC $00
+        0xCA,             // DEX
+        0xD0, 0xF8,       // BNE loop
+        0x4C, 0x0C, 0x02, // JMP *
+    };
+    this->load(program, sizeof(program));
+    this->runToEnd(0x020C);
+    EXPECT_EQ(55, this->cpu.a);
+    EXPECT_EQ(0, this->cpu.x);
+    EXPECT_TRUE(this->cpu.p & CPU_Z);
+}
+
+TEST_F(Cpu6502Test, binaryFlags) {
+    const uint8_t program[] = {
+        0x18, 0xA9, 0x7F, 0x69, 0x01, // CLC, LDA #$7F, ADC #1   -> $80, V N
+        0x85, 0x00, 0x08, 0x68, 0x85, 0x01, // STA $00, PHP, PLA, STA $01
+        0x38, 0xA9, 0x00, 0xE9, 0x01, // SEC, LDA #0, SBC #1      -> $FF, borrow
+        0x85, 0x02, 0x08, 0x68, 0x85, 0x03,
+        0xA9, 0x40, 0xC9, 0x40,       // LDA #$40, CMP #$40      -> Z C
+        0x08, 0x68, 0x85, 0x04,
+        0x4C, 0x1E, 0x02,             // JMP *
+    };
+    this->load(program, sizeof(program));
+    this->runToEnd(0x021E);
+    EXPECT_EQ(0x80, this->mem[0x00]);
+    EXPECT_EQ(CPU_N | CPU_V, this->mem[0x01] & (CPU_N | CPU_V | CPU_Z | CPU_C));
+    EXPECT_EQ(0xFF, this->mem[0x02]);
+    EXPECT_EQ(CPU_N, this->mem[0x03] & (CPU_N | CPU_V | CPU_Z | CPU_C));
+    EXPECT_EQ(CPU_Z | CPU_C, this->mem[0x04] & (CPU_N | CPU_V | CPU_Z | CPU_C));
+}
+
+TEST_F(Cpu6502Test, decimal) {
+    // Scores are kept in BCD
+    const uint8_t program[] = {
+        0xF8,                         // SED
+        0x18, 0xA9, 0x19, 0x69, 0x28, // CLC, LDA #$19, ADC #$28 -> $47
+        0x85, 0x00,
+        0x18, 0xA9, 0x99, 0x69, 0x01, // CLC, LDA #$99, ADC #$01 -> $00 carry
+        0x85, 0x01, 0x08, 0x68, 0x85, 0x02,
+        0x38, 0xA9, 0x50, 0xE9, 0x01, // SEC, LDA #$50, SBC #$01 -> $49
+        0x85, 0x03,
+        0x38, 0xA9, 0x00, 0xE9, 0x01, // SEC, LDA #$00, SBC #$01 -> $99 borrow
+        0x85, 0x04, 0x08, 0x68, 0x85, 0x05,
+        0xD8,                         // CLD
+        0x4C, 0x27, 0x02,             // JMP *
+    };
+    this->load(program, sizeof(program));
+    this->runToEnd(0x0227);
+    EXPECT_EQ(0x47, this->mem[0x00]);
+    EXPECT_EQ(0x00, this->mem[0x01]);
+    EXPECT_TRUE(this->mem[0x02] & CPU_C);
+    EXPECT_EQ(0x49, this->mem[0x03]);
+    EXPECT_EQ(0x99, this->mem[0x04]);
+    EXPECT_FALSE(this->mem[0x05] & CPU_C);
+}
+
+TEST_F(Cpu6502Test, subroutines) {
+    const uint8_t program[] = {
+        0x20, 0x09, 0x02, // JSR sub
+        0xE8,             // INX
+        0x6C, 0xFF, 0x02, // JMP ($02FF). The high byte comes from $0200, not $0300
+        0xEA, 0xEA,
+        0xA2, 0x05,       // sub: LDX #5
+        0x60,             // RTS
+    };
+    this->load(program, sizeof(program));
+    this->mem[0x02FF] = 0x40;
+    this->mem[0x0300] = 0x99;
+    // $0200 holds the JSR opcode, $20. Park at $2040
+    this->mem[0x2040] = 0x4C;
+    this->mem[0x2041] = 0x40;
+    this->mem[0x2042] = 0x20;
+    this->runToEnd(0x2040);
+    EXPECT_EQ(0x2040, this->cpu.pc);
+    EXPECT_EQ(6, this->cpu.x);
+    EXPECT_EQ(0xFD, this->cpu.sp);
+}
+
+TEST_F(Cpu6502Test, nmi) {
+    const uint8_t program[] = {
+        0xA9, 0x01,       // LDA #1
+        0x4C, 0x02, 0x02, // JMP *
+        0xE6, 0x10,       // nmi: INC $10
+        0xA9, 0x07,       // LDA #7
+        0x40,             // RTI
+    };
+    this->load(program, sizeof(program));
+    this->mem[0xFFFA] = 0x05;
+    this->mem[0xFFFB] = 0x02;
+    this->runToEnd(0x0202);
+
+    cpu_nmi(&this->cpu);
+    EXPECT_EQ(7, cpu_step(&this->cpu));
+    EXPECT_EQ(0x0205, this->cpu.pc);
+    EXPECT_TRUE(this->cpu.p & CPU_I);
+    this->runToEnd(0x0202);
+    EXPECT_EQ(1, this->mem[0x10]);
+    EXPECT_EQ(7, this->cpu.a);
+    // RTI puts back the flags from before, I set since reset
+    EXPECT_TRUE(this->cpu.p & CPU_I);
+    EXPECT_FALSE(this->cpu.p & CPU_B);
+    EXPECT_EQ(0xFD, this->cpu.sp);
+}
+
+TEST_F(Cpu6502Test, cycles) {
+    const uint8_t program[] = {
+        0xA2, 0x01,       // LDX #1          2
+        0xBD, 0xFF, 0x02, // LDA $02FF,X     4 + 1 for the page
+        0xBD, 0x00, 0x03, // LDA $0300,X     4
+        0xD0, 0x00,       // BNE +0          2 + 1 taken
+        0x4C, 0x0A, 0x02, // JMP *           3
+    };
+    this->load(program, sizeof(program));
+    this->mem[0x0301] = 1;
+    EXPECT_EQ(2u + 5u + 4u + 3u, this->runToEnd(0x020A));
+    EXPECT_EQ(3, cpu_step(&this->cpu));
+}
@@ -0,0 +1,101 @@
+#include <stddef.h>
+
+#include "dvg.h"
+
+#define DVG_ROM_WORD 0x800
+
+static uint16_t readWord(const DvgMemory* mem, uint16_t word) {
+    uint16_t offset = (word & 0xFFF) << 1;
+    const uint8_t* bytes = NULL;
+    if (offset + 1 < mem->ram_size) {
+        bytes = mem->ram + offset;
+    }
+    else if (word >= DVG_ROM_WORD && offset - (DVG_ROM_WORD << 1) + 1 < mem->rom_size) {
+        bytes = mem->rom + offset - (DVG_ROM_WORD << 1);
+    }
+    // Nothing mapped reads as a halt
+    return (bytes != NULL) ? (bytes[0] | ((uint16_t)bytes[1] << 8)) : (DVG_HALT << 12);
+}
+
+// 12 bit two's complement
+static inline int16_t signExtend12(uint16_t value) {
+    return (int16_t)(value << 4) >> 4;
+}
+
+// Vector lengths are shifted down by 9 - scale. Scales above 9 wrap to nearly nothing
+static inline int32_t scaleDelta(int32_t delta, uint8_t scale) {
+    int8_t shift = (scale > 9) ? 10 : 9 - scale;
+    return (delta << 16) >> shift;
+}
+
+// Positions are 16.16 fixed point so short vectors add up like they do on the hardware
+static void drawTo(int32_t* x, int32_t* y, int32_t dx, int32_t dy, uint8_t z, DvgEmit emit, void* ctx) {
+    int32_t x2 = *x + dx;
+    int32_t y2 = *y + dy;
+    if (z > 0) {
+        DvgSegment segment = {(int16_t)(*x >> 16), (int16_t)(*y >> 16), (int16_t)(x2 >> 16), (int16_t)(y2 >> 16), z};
+        emit(ctx, &segment);
+    }
+    *x = x2;
+    *y = y2;
+}
+
+uint16_t dvg_run(const DvgMemory* mem, DvgEmit emit, void* ctx) {
+    uint16_t stack[DVG_STACK_SIZE];
+    uint8_t sp    = 0;
+    uint16_t pc   = 0;
+    uint8_t scale = 0; // Global scale from LABS
+    int32_t x     = 0;
+    int32_t y     = 0;
+
+    uint16_t ops;
+    for (ops = 1; ops <= DVG_MAX_OPS; ops++) {
+        uint16_t word0 = readWord(mem, pc++);
+        uint8_t opcode = word0 >> 12;
+        uint16_t word1;
+        int32_t dx, dy;
+        switch (opcode) {
+        case DVG_LABS:
+            word1 = readWord(mem, pc++);
+            x     = (int32_t)signExtend12(word1 & 0xFFF) << 16;
+            y     = (int32_t)signExtend12(word0 & 0xFFF) << 16;
+            scale = word1 >> 12;
+            break;
+        case DVG_HALT:
+            return ops;
+        case DVG_JSRL:
+            if (sp >= DVG_STACK_SIZE) return ops;
+            stack[sp++] = pc;
+            pc = word0 & 0xFFF;
+            break;
+        case DVG_RTSL:
+            if (sp == 0) return ops;
+            pc = stack[--sp];
+            break;
+        case DVG_JMPL:
+            pc = word0 & 0xFFF;
+            break;
+        case DVG_SVEC:
+            // Two bits of length and two of scale, starting from scale 2
+            dx = (word0 & 0x0003) << 8;
+            dy = word0 & 0x0300;
+            if (word0 & 0x0004) dx = -dx;
+            if (word0 & 0x0400) dy = -dy;
+            opcode = 2 + ((word0 >> 2) & 0x02) + ((word0 >> 11) & 0x01);
+            drawTo(&x, &y, scaleDelta(dx, (scale + opcode) & 0x0F), scaleDelta(dy, (scale + opcode) & 0x0F),
+                   (word0 >> 4) & 0x0F, emit, ctx);
+            break;
+        default:
+            // VCTR. The opcode is the scale
+            word1 = readWord(mem, pc++);
+            dx = word1 & 0x03FF;
+            dy = word0 & 0x03FF;
+            if (word1 & 0x0400) dx = -dx;
+            if (word0 & 0x0400) dy = -dy;
+            drawTo(&x, &y, scaleDelta(dx, (scale + opcode) & 0x0F), scaleDelta(dy, (scale + opcode) & 0x0F),
+                   word1 >> 12, emit, ctx);
+            break;
+        }
+    }
+    return ops - 1;
+}
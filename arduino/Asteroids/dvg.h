@@ -0,0 +1,44 @@
+// Dvg
+// Atari's Digital Vector Generator, as used in Asteroids
+// Runs the display list in vector memory and hands over each segment drawn with the beam on
+
+#ifndef DVG_H
+#define DVG_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#define DVG_STACK_SIZE 4    // Subroutine depth
+#define DVG_MAX_OPS    4096 // A list that never halts is cut off here
+#define DVG_SIZE       1024 // Width and height of the DVG's screen, 0 at the bottom left
+
+// Instructions, from the top four bits of the first word
+#define DVG_LABS 0xA
+#define DVG_HALT 0xB
+#define DVG_JSRL 0xC
+#define DVG_RTSL 0xD
+#define DVG_JMPL 0xE
+#define DVG_SVEC 0xF
+
+typedef struct DvgSegment {
+    int16_t x1;
+    int16_t y1;
+    int16_t x2;
+    int16_t y2;
+    uint8_t z; // Brightness, never 0
+} DvgSegment;
+
+// The DVG sees vector RAM at word 0 and vector ROM at word 0x800
+typedef struct DvgMemory {
+    const uint8_t* ram;
+    uint16_t ram_size; // Bytes
+    const uint8_t* rom;
+    uint16_t rom_size;
+} DvgMemory;
+
+typedef void (*DvgEmit)(void* ctx, const DvgSegment* segment);
+
+// Run the list from word 0 until HALT. Returns the number of instructions run
+uint16_t dvg_run(const DvgMemory* mem, DvgEmit emit, void* ctx);
+
+#endif // DVG_H
@@ -0,0 +1,22 @@
+#include <stdio.h>
+
+#include "rom_files.h"
+
+#define ROM_SIZE 0x800
+
+static bool loadRom(const char* dir, const char* name, uint8_t* dest) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return false;
+    size_t count = fread(dest, 1, ROM_SIZE, file);
+    fclose(file);
+    return count == ROM_SIZE;
+}
+
+bool rom_load_asteroids(const char* dir, uint8_t* program, uint8_t* vector_rom) {
+    return loadRom(dir, "035145.02", program)
+        && loadRom(dir, "035144.02", program + ROM_SIZE)
+        && loadRom(dir, "035143.02", program + 2 * ROM_SIZE)
+        && loadRom(dir, "035127.02", vector_rom);
+}
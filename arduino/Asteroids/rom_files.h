@@ -0,0 +1,16 @@
+// RomFiles
+// Loads the Asteroids ROM images on the host. A device would keep them in flash instead
+
+#ifndef ROM_FILES_H
+#define ROM_FILES_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "asteroids.h"
+
+// Reads 035145.02, 035144.02, 035143.02, and 035127.02 from a directory
+// program holds AST_PROGRAM_SIZE bytes and vector_rom AST_VROM_SIZE
+bool rom_load_asteroids(const char* dir, uint8_t* program, uint8_t* vector_rom);
+
+#endif // ROM_FILES_H
@@ -0,0 +1,918 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "host_client.h"
+
+extern "C" {
+#include "baud_switch.h"
+#include "command_parser.h"
+#include "frame_link.h"
+#include "lz_pack.h"
+#include "ring_mem_pool.h"
+#include "screen_controller.h"
+}
+
+// Serial
+
+SerialTransport::SerialTransport(): fd(-1), rate(0) {}
+
+SerialTransport::~SerialTransport() {
+    this->close();
+}
+
+static speed_t baudToSpeed(uint32_t baud) {
+    switch (baud) {
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 115200:  return B115200;
+    case 230400:  return B230400;
+#ifdef B460800
+    case 460800:  return B460800;
+#endif
+#ifdef B500000
+    case 500000:  return B500000;
+#endif
+#ifdef B1000000
+    case 1000000: return B1000000;
+#endif
+#ifdef B2000000
+    case 2000000: return B2000000;
+#endif
+    default:      return B0;
+    }
+}
+
+bool SerialTransport::open(const char* path, uint32_t baud) {
+    this->close();
+    this->fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (this->fd < 0) return false;
+
+    struct termios tty;
+    if (tcgetattr(this->fd, &tty) != 0) {
+        this->close();
+        return false;
+    }
+    cfmakeraw(&tty);
+    tty.c_cflag |= CLOCAL | CREAD;
+    speed_t speed = baudToSpeed(baud);
+    if (speed != B0) {
+        cfsetispeed(&tty, speed);
+        cfsetospeed(&tty, speed);
+    }
+    if (tcsetattr(this->fd, TCSANOW, &tty) != 0) {
+        this->close();
+        return false;
+    }
+    this->rate = baud;
+    return true;
+}
+
+bool SerialTransport::setBaud(uint32_t baud) {
+    speed_t speed = baudToSpeed(baud);
+    struct termios tty;
+    if (this->fd < 0 || speed == B0 || tcgetattr(this->fd, &tty) != 0) return false;
+    cfsetispeed(&tty, speed);
+    cfsetospeed(&tty, speed);
+    if (tcsetattr(this->fd, TCSADRAIN, &tty) != 0) return false;
+    this->rate = baud;
+    return true;
+}
+
+void SerialTransport::close() {
+    if (this->fd >= 0) ::close(this->fd);
+    this->fd = -1;
+}
+
+bool SerialTransport::write(const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t count = ::write(this->fd, data, len);
+        if (count < 0) {
+            if (errno != EAGAIN && errno != EINTR) return false;
+            // Wait for room
+            struct pollfd pfd = {this->fd, POLLOUT, 0};
+            poll(&pfd, 1, 100);
+            continue;
+        }
+        data += count;
+        len  -= count;
+    }
+    return true;
+}
+
+size_t SerialTransport::read(char* buf, size_t len, int timeout_ms) {
+    struct pollfd pfd = {this->fd, POLLIN, 0};
+    if (poll(&pfd, 1, timeout_ms) <= 0) return 0;
+    ssize_t count = ::read(this->fd, buf, len);
+    return (count > 0) ? count : 0;
+}
+
+// Encoder
+
+FrameEncoder::FrameEncoder(Encoding encoding): encoding(encoding), pen_known(false), pen_x(0), pen_y(0) {}
+
+std::string FrameEncoder::point(int16_t x, int16_t y) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "point %d %d\n", x, y);
+    return buf;
+}
+
+std::string FrameEncoder::line(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "line %d %d %d %d\n", x1, y1, x2, y2);
+    return buf;
+}
+
+std::string FrameEncoder::rline(int16_t dx, int16_t dy) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "rline %d %d\n", dx, dy);
+    return buf;
+}
+
+std::string FrameEncoder::rmove(int16_t dx, int16_t dy) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "rmove %d %d\n", dx, dy);
+    return buf;
+}
+
+static void appendInt16(std::string* out, int16_t value) {
+    out->push_back((char)(value & 0xFF));
+    out->push_back((char)((uint16_t)value >> 8));
+}
+
+std::string FrameEncoder::binaryPoint(int16_t x, int16_t y) {
+    std::string out(1, (char)CMD_BIN_POINT);
+    appendInt16(&out, x);
+    appendInt16(&out, y);
+    return out;
+}
+
+std::string FrameEncoder::binaryLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+    std::string out(1, (char)CMD_BIN_LINE);
+    appendInt16(&out, x1);
+    appendInt16(&out, y1);
+    appendInt16(&out, x2);
+    appendInt16(&out, y2);
+    return out;
+}
+
+std::string FrameEncoder::binaryRel(bool draw, int16_t dx, int16_t dy) {
+    std::string out;
+    if (dx >= INT8_MIN && dx <= INT8_MAX && dy >= INT8_MIN && dy <= INT8_MAX) {
+        out.push_back((char)((draw) ? CMD_BIN_RLINE8 : CMD_BIN_RMOVE8));
+        out.push_back((char)dx);
+        out.push_back((char)dy);
+        return out;
+    }
+    out.push_back((char)((draw) ? CMD_BIN_RLINE : CMD_BIN_RMOVE));
+    appendInt16(&out, dx);
+    appendInt16(&out, dy);
+    return out;
+}
+
+static inline bool fitsInt16(int32_t value) {
+    return value >= INT16_MIN && value <= INT16_MAX;
+}
+
+// A line from the pen, with a move first when it doesn't start there
+// False when it can't be done relative, because the pen is unknown or a step is too far
+bool FrameEncoder::relLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2, std::vector<std::string>* out) const {
+    int32_t move_x = (int32_t)x1 - this->pen_x;
+    int32_t move_y = (int32_t)y1 - this->pen_y;
+    int32_t dx     = (int32_t)x2 - x1;
+    int32_t dy     = (int32_t)y2 - y1;
+    if (!this->pen_known || !fitsInt16(move_x) || !fitsInt16(move_y) || !fitsInt16(dx) || !fitsInt16(dy)) {
+        return false;
+    }
+
+    bool binary = (this->encoding == ENCODE_BINARY);
+    if (move_x != 0 || move_y != 0) {
+        out->push_back((binary) ? binaryRel(false, move_x, move_y) : rmove(move_x, move_y));
+    }
+    out->push_back((binary) ? binaryRel(true, dx, dy) : rline(dx, dy));
+    return true;
+}
+
+void FrameEncoder::addPoint(int16_t x, int16_t y) {
+    this->commands.push_back((this->encoding == ENCODE_BINARY) ? binaryPoint(x, y) : point(x, y));
+    this->pen_known = true;
+    this->pen_x     = x;
+    this->pen_y     = y;
+}
+
+void FrameEncoder::addLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+    if (this->encoding == ENCODE_TEXT) {
+        this->commands.push_back(line(x1, y1, x2, y2));
+        return;
+    }
+
+    std::string absolute = (this->encoding == ENCODE_BINARY) ? binaryLine(x1, y1, x2, y2) : line(x1, y1, x2, y2);
+    std::vector<std::string> relative;
+    size_t relative_size = 0;
+    if (this->relLine(x1, y1, x2, y2, &relative)) {
+        for (size_t i = 0; i < relative.size(); i++) relative_size += relative[i].size();
+    }
+    if (relative.empty() || relative_size >= absolute.size()) {
+        this->commands.push_back(absolute);
+    }
+    else {
+        this->commands.insert(this->commands.end(), relative.begin(), relative.end());
+    }
+    this->pen_known = true;
+    this->pen_x     = x2;
+    this->pen_y     = y2;
+}
+
+void FrameEncoder::addPolyline(const std::vector<int16_t>& xy, bool closed) {
+    size_t vertices = xy.size() / 2;
+    if (vertices < 2) return;
+    for (size_t i = 1; i < vertices; i++) {
+        this->addLine(xy[2 * i - 2], xy[2 * i - 1], xy[2 * i], xy[2 * i + 1]);
+    }
+    if (closed && vertices > 2) {
+        this->addLine(xy[2 * vertices - 2], xy[2 * vertices - 1], xy[0], xy[1]);
+    }
+}
+
+size_t FrameEncoder::bytes() const {
+    size_t total = 0;
+    for (size_t i = 0; i < this->commands.size(); i++) total += this->commands[i].size();
+    return total;
+}
+
+std::vector<std::string> FrameEncoder::sequence() const {
+    std::vector<std::string> out;
+    out.reserve(this->commands.size() + 3);
+    out.push_back("sequence clear\n");
+    out.push_back("sequence start\n");
+    out.insert(out.end(), this->commands.begin(), this->commands.end());
+    out.push_back("sequence end\n");
+    return out;
+}
+
+std::vector<std::string> FrameEncoder::sequenceFrom(const FrameEncoder& previous) const {
+    std::vector<std::string> load = this->sequence();
+    const std::vector<std::string>& before = previous.commands;
+    const std::vector<std::string>& after  = this->commands;
+    // Relative commands don't each make an entry. A running sequence can't be emptied
+    if (this->encoding != ENCODE_TEXT || previous.encoding != ENCODE_TEXT || after.empty()) return load;
+
+    std::vector<std::string> edits;
+    size_t common = std::min(before.size(), after.size());
+    for (size_t i = 0; i < common; i++) {
+        if (before[i] != after[i]) edits.push_back("sequence set " + std::to_string(i) + " " + after[i]);
+    }
+    for (size_t i = common; i < after.size(); i++) {
+        edits.push_back("sequence insert " + std::to_string(i) + " " + after[i]);
+    }
+    for (size_t i = before.size(); i > common; i--) {
+        edits.push_back("sequence delete " + std::to_string(i - 1) + "\n");
+    }
+
+    size_t edit_bytes = 0;
+    size_t load_bytes = 0;
+    for (size_t i = 0; i < edits.size(); i++) edit_bytes += edits[i].size();
+    for (size_t i = 0; i < load.size(); i++) load_bytes += load[i].size();
+    return (edit_bytes < load_bytes) ? edits : load;
+}
+
+// A run of binary motions as one packed record, or empty when it won't fit in one
+// Copies reach back into the history, the runs packed before it since chain zero
+static std::string packRun(const std::string& history, const std::string& run, uint8_t chain) {
+    std::string data = history + run;
+    uint8_t out[CMD_PACKED_MAX - 1];
+    uint16_t len = lz_pack_from((const uint8_t*)data.data(), history.size(), data.size(), out, sizeof(out));
+    if (len == 0) return std::string();
+    std::string record(1, (char)CMD_BIN_PACKED);
+    record.push_back((char)(len + 1));
+    record.push_back((char)chain);
+    record.append((const char*)out, len);
+    return record;
+}
+
+std::vector<std::string> FrameEncoder::packedMotions() const {
+    if (this->encoding != ENCODE_BINARY) return this->commands;
+
+    std::vector<std::string> out;
+    size_t out_bytes = 0;
+    int16_t pen_x    = 0;
+    int16_t pen_y    = 0;
+    size_t next      = 0;
+    std::string history; // The last LZ_WINDOW bytes of the runs packed so far
+    uint8_t chain = 0;
+    while (next < this->commands.size()) {
+        // Grow the run while it still packs into one record
+        std::string run;
+        std::string record;
+        size_t end    = next;
+        size_t raw    = 0;
+        int motions   = 0;
+        int16_t run_x = pen_x;
+        int16_t run_y = pen_y;
+        while (end < this->commands.size()) {
+            CommandUnion cmd;
+            const std::string& text = this->commands[end];
+            if (cmdDecodeBinary(&cmd, (const uint8_t*)text.data(), text.size()) != CMD_OK) break;
+            if (cmd.base.type != Cmd_RMove && motions == CMD_PACKED_MOTIONS) break;
+
+            // The frame's first run starts absolute. Those after it carry on from it, like relative motions
+            std::string step = text;
+            if (chain == 0 && motions == 0 && cmd.base.type == Cmd_RMove) {
+                step.clear();
+            }
+            else if (chain == 0 && motions == 0 && cmd.base.type == Cmd_RLine) {
+                step = binaryLine(run_x, run_y, run_x + cmd.rel.dx, run_y + cmd.rel.dy);
+            }
+            if (!step.empty()) {
+                std::string packed = packRun(history, run + step, chain);
+                if (packed.empty()) break;
+                record = packed;
+            }
+
+            switch (cmd.base.type) {
+            case Cmd_Point:
+                run_x = cmd.point.x;
+                run_y = cmd.point.y;
+                break;
+            case Cmd_Line:
+                run_x = cmd.line.x2;
+                run_y = cmd.line.y2;
+                break;
+            default:
+                run_x += cmd.rel.dx;
+                run_y += cmd.rel.dy;
+                break;
+            }
+            run += step;
+            raw += text.size();
+            motions += (cmd.base.type != Cmd_RMove);
+            end++;
+        }
+
+        if (end == next) {
+            // Not a motion record, it goes as it is
+            out.push_back(this->commands[next]);
+            out_bytes += this->commands[next].size();
+            next++;
+            continue;
+        }
+        if (!record.empty() && record.size() < raw) {
+            out.push_back(record);
+            out_bytes += record.size();
+            history += run;
+            if (history.size() > LZ_WINDOW) history.erase(0, history.size() - LZ_WINDOW);
+            // Past 255 the next starts afresh
+            if (++chain == 0) history.clear();
+        }
+        else {
+            out.insert(out.end(), this->commands.begin() + next, this->commands.begin() + end);
+            out_bytes += raw;
+        }
+        pen_x = run_x;
+        pen_y = run_y;
+        next  = end;
+    }
+    return (out_bytes < this->bytes()) ? out : this->commands;
+}
+
+// Client
+
+VectorClient::VectorClient(Transport* transport, const ClientOptions& options):
+    transport(transport),
+    options(options),
+    in_flight(0),
+    framed(false),
+    frame_seq(0),
+    backoff_ms(options.backoff_ms),
+    hold_set(false),
+    pool_size(0),
+    pool_used(0),
+    pool_in_flight(0),
+    pool_polling(false),
+    pool_wait_ms(options.backoff_ms)
+{
+    memset(&this->counters, 0, sizeof(this->counters));
+}
+
+bool VectorClient::handshake() {
+    // Drop the banner and anything left over
+    char buf[256];
+    while (this->transport->read(buf, sizeof(buf), 50) > 0) {}
+    this->rx.clear();
+
+    // The reply is an ACK once the prompt is off
+    const char cmd[] = "unset prompt\n";
+    if (!this->transport->write(cmd, sizeof(cmd) - 1)) return false;
+    for (;;) {
+        size_t count = this->transport->read(buf, sizeof(buf), this->options.timeout_ms);
+        if (count == 0) return false;
+        this->rx.append(buf, count);
+        size_t end;
+        while ((end = this->rx.find('\n')) != std::string::npos) {
+            std::string line = this->rx.substr(0, end);
+            this->rx.erase(0, end + 1);
+            if (line == "ACK" || line == "ACK\r") return true;
+        }
+    }
+}
+
+bool VectorClient::setBinary(bool enable) {
+    uint32_t id = this->send((enable) ? "set binary\n" : "unset binary\n");
+    return this->flush() && this->reply(id) == REPLY_ACK;
+}
+
+bool VectorClient::setFramed(bool enable) {
+    // Turned on in the clear, and off from inside a frame
+    uint32_t id = this->send((enable) ? "set framed\n" : "unset framed\n");
+    if (!this->flush() || this->reply(id) != REPLY_ACK) return false;
+    this->framed    = enable;
+    this->frame_seq = 0;
+    this->sent_frames.clear();
+    return true;
+}
+
+bool VectorClient::exchange(const std::string& line, const std::string& expected, int timeout_ms) {
+    this->rx.clear();
+    if (!this->transport->write(line.data(), line.size())) return false;
+    char buf[256];
+    for (;;) {
+        size_t count = this->transport->read(buf, sizeof(buf), timeout_ms);
+        if (count == 0) return false;
+        this->rx.append(buf, count);
+        size_t end;
+        while ((end = this->rx.find('\n')) != std::string::npos) {
+            std::string reply = this->rx.substr(0, end + 1);
+            this->rx.erase(0, end + 1);
+            if (reply == expected) return true;
+        }
+    }
+}
+
+bool VectorClient::setBaud(uint32_t rate) {
+    uint32_t old_rate = this->transport->baud();
+    if (this->framed || this->waiting() > 0) return false;
+
+    // Answered at the old rate
+    uint32_t id = this->send("set baud " + std::to_string(rate));
+    if (!this->flush() || this->reply(id) != REPLY_ACK) return false;
+
+    // Probe, and keep the rate once the echo is back
+    int wait_ms = BAUD_TIMEOUT / 1000;
+    if (this->transport->setBaud(rate) && this->exchange(BAUD_PROBE_LINE, BAUD_PROBE_LINE, wait_ms)
+        && this->exchange(BAUD_COMMIT_LINE, "ACK\n", wait_ms)) {
+        return true;
+    }
+
+    // The device goes back once it's done waiting. Unless it was only the last ACK that was lost
+    this->transport->setBaud(old_rate);
+    char buf[256];
+    while (this->transport->read(buf, sizeof(buf), 2 * wait_ms) > 0) {}
+    if (this->exchange("noop\n", "ACK\n", wait_ms)) return false;
+    this->transport->setBaud(rate);
+    if (this->exchange("noop\n", "ACK\n", wait_ms)) return true;
+    this->transport->setBaud(old_rate);
+    return false;
+}
+
+// Id of the commands the client sends for itself
+#define CONTROL_ID UINT32_MAX
+
+// Motions, which can be sent again once the device holds back those behind a refused one
+// Relative ones too, since the pen only moves for motions that were taken
+static inline bool motionCommand(const std::string& text) {
+    return (text.compare(0, 5, "line ") == 0 || text.compare(0, 6, "point ") == 0
+            || text.compare(0, 6, "curve ") == 0 || text.compare(0, 4, "arc ") == 0
+            || text.compare(0, 6, "rline ") == 0 || text.compare(0, 6, "rmove ") == 0
+            || ((uint8_t)text[0] >= CMD_BIN_POINT && (uint8_t)text[0] <= CMD_BIN_PACKED));
+}
+
+// Binary records have no line end
+static inline bool binaryCommand(const std::string& text) {
+    return !text.empty() && ((uint8_t)text[0] & CMD_BIN_FLAG);
+}
+
+// Bytes a command's motion takes in the device's pool, header included. Packed records are counted as full
+static size_t poolCost(const std::string& text) {
+    const size_t point = sizeof(PointMotion) + sizeof(RingEntryHdr);
+    const size_t line  = sizeof(LineMotion) + sizeof(RingEntryHdr);
+    if (binaryCommand(text)) {
+        switch ((uint8_t)text[0]) {
+        case CMD_BIN_POINT:  return point;
+        case CMD_BIN_RMOVE:
+        case CMD_BIN_RMOVE8: return 0;
+        case CMD_BIN_PACKED: return CMD_PACKED_MOTIONS * line;
+        default:             return line;
+        }
+    }
+    if (text.compare(0, 6, "point ") == 0) return point;
+    if (text.compare(0, 5, "line ") == 0 || text.compare(0, 6, "rline ") == 0) return line;
+    if (text.compare(0, 6, "curve ") == 0) return CUBIC_MOTION_SIZE + sizeof(RingEntryHdr);
+    if (text.compare(0, 4, "arc ") == 0) return sizeof(ArcMotion) + sizeof(RingEntryHdr);
+    return 0;
+}
+
+bool VectorClient::writeCommand(uint32_t id, const std::string& text, uint8_t tries,
+                                const std::vector<std::string>& parts) {
+    // The priority lane has its own buffer on the device, outside the window
+    if (text[0] == '!') {
+        Pending entry = {id, text, tries, parts, this->frame_seq, 0};
+        this->prio_pending.push_back(entry);
+        return this->writeRaw(text);
+    }
+
+    // Refused motions keep their place ahead of anything new
+    this->sendRefused();
+    if (this->options.retries > 0 && !this->hold_set) {
+        this->hold_set = true;
+        this->sendControl("set hold\n");
+    }
+    Pending entry = {id, text, tries, parts, this->frame_seq, 0};
+    return this->queueCommand(entry);
+}
+
+bool VectorClient::queueCommand(Pending entry) {
+    entry.cost = 0;
+    if (entry.parts.empty()) {
+        entry.cost = poolCost(entry.text);
+    }
+    for (size_t i = 0; i < entry.parts.size(); i++) {
+        entry.cost += poolCost(entry.parts[i] + '\n');
+    }
+    this->waitForRoom(entry.cost);
+
+    // Wait for room in the window
+    while (!this->pending.empty() && this->in_flight + entry.text.size() > this->options.window) {
+        if (!this->pump(this->options.timeout_ms)) break;
+    }
+
+    entry.frame = this->frame_seq;
+    this->pending.push_back(entry);
+    this->in_flight += entry.text.size();
+    this->pool_in_flight += entry.cost;
+    if (this->in_flight > this->counters.max_in_flight) this->counters.max_in_flight = this->in_flight;
+    return this->writeRaw(entry.text);
+}
+
+bool VectorClient::sendControl(const std::string& text) {
+    Pending entry = {CONTROL_ID, text, 0, std::vector<std::string>(), this->frame_seq, 0};
+    return this->queueCommand(entry);
+}
+
+// Room for cost more bytes on top of what's in the pool and on the way. A motion always fits an empty pool
+// Entries don't wrap, so up to one less than one of them can be left unused at the end of the memory
+bool VectorClient::poolHasRoom(size_t cost) const {
+    if (this->pool_size == 0) return false;
+    size_t limit = this->pool_size;
+    if (this->options.pool_fill > 0 && this->options.pool_fill < limit) limit = this->options.pool_fill;
+    size_t ahead = this->pool_used + this->pool_in_flight;
+    return ahead == 0 || ahead + 2 * cost - 1 <= limit;
+}
+
+// Answered out of turn, ahead of anything waiting in the device's normal buffer
+void VectorClient::pollPool() {
+    this->pool_polling = true;
+    this->counters.polls++;
+    this->writeCommand(CONTROL_ID, "!pool\n", 0);
+}
+
+// What was reported only goes down as the device draws, so a fresh report is asked for once it looks full
+// It's asked for ahead of time past half, so the stream doesn't stop for it
+void VectorClient::waitForRoom(size_t cost) {
+    if (!this->options.pace || cost == 0) return;
+    // Wait about as long as room took last time before asking, rather than asking over and over
+    int wait_ms = (this->pool_size > 0) ? this->pool_wait_ms : 0;
+    bool waited = false;
+    int asked = 0;
+    while (!this->poolHasRoom(cost)) {
+        if (!this->pool_polling) {
+            if (wait_ms > 0) {
+                this->idle(wait_ms);
+                waited = true;
+                if (this->poolHasRoom(cost)) break;
+            }
+            wait_ms = (wait_ms > 0) ? std::min(wait_ms * 2, CLIENT_BACKOFF_MAX_MS) : this->options.backoff_ms;
+            this->pollPool();
+            asked++;
+        }
+        if (!this->pump(this->options.timeout_ms)) return;
+        if (!this->pool_polling && this->pool_size == 0) {
+            // No report comes back. Leave it to the device to refuse what doesn't fit
+            this->options.pace = false;
+            return;
+        }
+    }
+    if (waited) {
+        // One ask was enough: try sooner next time. Otherwise wait longer
+        this->pool_wait_ms = (asked <= 1) ? std::max(this->options.backoff_ms, this->pool_wait_ms / 2)
+                                          : std::min(this->pool_wait_ms * 2, CLIENT_BACKOFF_MAX_MS);
+    }
+    if (!this->pool_polling && 2 * (this->pool_used + this->pool_in_flight + cost) > this->pool_size) {
+        this->pollPool();
+    }
+}
+
+// Sent straight back, a refused motion would land behind everything sent since and spin while the pool is full
+// Wait until all of those are answered, give the pool time to drain, then send the refused ones in their order
+bool VectorClient::sendRefused() {
+    if (this->refused.empty()) {
+        this->backoff_ms = this->options.backoff_ms;
+        return false;
+    }
+    while (!this->pending.empty()) {
+        if (!this->pump(this->options.timeout_ms)) break;
+    }
+    this->idle(this->backoff_ms);
+    this->backoff_ms = std::min(this->backoff_ms * 2, CLIENT_BACKOFF_MAX_MS);
+
+    // Ids follow the order they were first sent. The device takes motions again once it has "set hold"
+    std::deque<Pending> round;
+    round.swap(this->refused);
+    std::sort(round.begin(), round.end());
+    if (this->hold_set) this->sendControl("set hold\n");
+    while (!round.empty()) {
+        // One turned away again holds back the rest
+        if (!this->refused.empty()) {
+            this->refused.insert(this->refused.end(), round.begin(), round.end());
+            break;
+        }
+        Pending entry = round.front();
+        round.pop_front();
+        entry.tries++;
+        this->counters.retried++;
+        this->queueCommand(entry);
+    }
+    return true;
+}
+
+bool VectorClient::writeRaw(const std::string& text) {
+    if (!this->framed) {
+        this->counters.bytes += text.size();
+        return this->transport->write(text.data(), text.size());
+    }
+
+    // The device puts the payloads back together, so commands can span frames
+    std::string wire;
+    for (size_t pos = 0; pos < text.size(); pos += LINK_PAYLOAD_MAX) {
+        uint8_t frame[LINK_FRAME_SIZE + 1];
+        size_t len = std::min(text.size() - pos, (size_t)LINK_PAYLOAD_MAX);
+        uint8_t size = link_encode(this->frame_seq, (const uint8_t*)text.data() + pos, len, frame);
+        this->sent_frames.push_back(std::make_pair(this->frame_seq, std::string((const char*)frame, size)));
+        if (this->sent_frames.size() > CLIENT_FRAME_HISTORY) this->sent_frames.pop_front();
+        this->frame_seq++;
+        wire.append((const char*)frame, size);
+    }
+    this->counters.bytes += wire.size();
+    return this->transport->write(wire.data(), wire.size());
+}
+
+uint32_t VectorClient::send(const std::string& command) {
+    std::string text = command;
+    if (!binaryCommand(text) && (text.empty() || text[text.size() - 1] != '\n')) text += '\n';
+
+    uint32_t id = this->replies.size();
+    this->replies.push_back(REPLY_PENDING);
+    this->counters.sent++;
+    if (!this->writeCommand(id, text, 0)) {
+        this->replies[id] = REPLY_TIMEOUT;
+    }
+    return id;
+}
+
+void VectorClient::sendAll(const std::vector<std::string>& commands) {
+    for (size_t i = 0; i < commands.size(); i++) {
+        this->send(commands[i]);
+    }
+}
+
+// One line of a batch. The commands are already stripped of their line ends
+uint32_t VectorClient::sendLine(const std::vector<std::string>& parts) {
+    uint32_t id = this->replies.size();
+    std::string text;
+    for (size_t i = 0; i < parts.size(); i++) {
+        text += parts[i];
+        text += (i + 1 < parts.size()) ? CMD_BATCH_SEP : '\n';
+        this->replies.push_back(REPLY_PENDING);
+    }
+    this->counters.sent += parts.size();
+
+    // A line of one is an ordinary command
+    bool written = (parts.size() == 1) ? this->writeCommand(id, text, 0) : this->writeCommand(id, text, 0, parts);
+    if (!written) {
+        for (size_t i = 0; i < parts.size(); i++) this->replies[id + i] = REPLY_TIMEOUT;
+    }
+    return id;
+}
+
+uint32_t VectorClient::sendBatch(const std::vector<std::string>& commands) {
+    uint32_t first = this->replies.size();
+    std::vector<std::string> parts;
+    size_t line_size = 0;
+    for (size_t i = 0; i < commands.size(); i++) {
+        std::string text = commands[i];
+        if (binaryCommand(text) || text.empty() || text[0] == '!') {
+            if (!parts.empty()) this->sendLine(parts);
+            parts.clear();
+            line_size = 0;
+            this->send(text);
+            continue;
+        }
+        if (text[text.size() - 1] == '\n') text.erase(text.size() - 1);
+
+        if (!parts.empty() && (parts.size() >= CMD_BATCH_MAX || line_size + text.size() + 1 > this->options.window)) {
+            this->sendLine(parts);
+            parts.clear();
+            line_size = 0;
+        }
+        parts.push_back(text);
+        line_size += text.size() + 1;
+    }
+    if (!parts.empty()) this->sendLine(parts);
+    return first;
+}
+
+bool VectorClient::flush() {
+    do {
+        while (this->waiting() > 0) {
+            if (!this->pump(this->options.timeout_ms)) return false;
+        }
+    } while (this->sendRefused());
+    return true;
+}
+
+Reply VectorClient::reply(uint32_t id) const {
+    return (id < this->replies.size()) ? this->replies[id] : REPLY_TIMEOUT;
+}
+
+// A frame lost with nothing after it to show the gap is never asked for
+// Send everything from the oldest unanswered frame on. The device drops any it already has
+bool VectorClient::resendUnanswered() {
+    if (!this->framed || this->waiting() == 0) return false;
+    uint8_t oldest = (this->pending.empty()) ? this->prio_pending.front().frame : this->pending.front().frame;
+    if (!this->prio_pending.empty() && (int8_t)(this->prio_pending.front().frame - oldest) < 0) {
+        oldest = this->prio_pending.front().frame;
+    }
+
+    bool found = false;
+    for (size_t i = 0; i < this->sent_frames.size(); i++) {
+        found = found || this->sent_frames[i].first == oldest;
+        if (!found) continue;
+        const std::string& frame = this->sent_frames[i].second;
+        this->counters.resent++;
+        this->counters.bytes += frame.size();
+        this->transport->write(frame.data(), frame.size());
+    }
+    return found;
+}
+
+bool VectorClient::pump(int timeout_ms) {
+    size_t before = this->waiting();
+    char buf[256];
+    bool resent = false;
+    while (this->waiting() == before) {
+        size_t count = this->transport->read(buf, sizeof(buf), timeout_ms);
+        if (count == 0 && !resent && this->resendUnanswered()) {
+            resent = true;
+            continue;
+        }
+        if (count == 0) {
+            // Lost. The device dropped them, or it isn't there
+            while (!this->pending.empty()) {
+                this->replies[this->pending.front().id] = REPLY_TIMEOUT;
+                this->pending.pop_front();
+                this->counters.timeouts++;
+            }
+            while (!this->prio_pending.empty()) {
+                this->replies[this->prio_pending.front().id] = REPLY_TIMEOUT;
+                this->prio_pending.pop_front();
+                this->counters.timeouts++;
+            }
+            while (!this->refused.empty()) {
+                this->replies[this->refused.front().id] = REPLY_TIMEOUT;
+                this->refused.pop_front();
+                this->counters.timeouts++;
+            }
+            this->in_flight      = 0;
+            this->pool_in_flight = 0;
+            this->pool_polling   = false;
+            return false;
+        }
+        this->takeReplies(buf, count);
+    }
+    return true;
+}
+
+void VectorClient::idle(int timeout_ms) {
+    char buf[256];
+    this->takeReplies(buf, this->transport->read(buf, sizeof(buf), timeout_ms));
+}
+
+void VectorClient::takeReplies(const char* buf, size_t count) {
+    this->rx.append(buf, count);
+    this->counters.reply_bytes += count;
+    size_t end;
+    while ((end = this->rx.find('\n')) != std::string::npos) {
+        std::string line = this->rx.substr(0, end);
+        this->rx.erase(0, end + 1);
+        this->handleLine(line);
+    }
+}
+
+void VectorClient::handleLine(const std::string& line) {
+    std::string reply = line;
+    if (!reply.empty() && reply[reply.size() - 1] == '\r') reply.erase(reply.size() - 1);
+
+    // A frame was lost. The commands in it are still waiting for their answers
+    if (reply.compare(0, 7, "RESEND ") == 0) {
+        uint8_t seq = atoi(reply.c_str() + 7);
+        for (size_t i = 0; i < this->sent_frames.size(); i++) {
+            if (this->sent_frames[i].first != seq) continue;
+            const std::string& frame = this->sent_frames[i].second;
+            this->counters.resent++;
+            this->counters.bytes += frame.size();
+            this->transport->write(frame.data(), frame.size());
+            break;
+        }
+        return;
+    }
+
+    // How full the pool is. What's answered after this was taken after it too
+    size_t size, used;
+    if (sscanf(reply.c_str(), "PoolStats size: %zu used: %zu", &size, &used) == 2) {
+        this->pool_size = size;
+        this->pool_used = used;
+        return;
+    }
+
+    // Priority answers are marked, and come in their own order
+    bool priority = (!reply.empty() && reply[0] == '!');
+    if (priority) reply.erase(0, 1);
+    std::deque<Pending>& queue = (priority) ? this->prio_pending : this->pending;
+
+    // Anything else is a report, like pool stats
+    // A batch is answered "ACK n", or "NAK " and a 1 or 0 for each command
+    bool ack = (reply.compare(0, 3, "ACK") == 0);
+    if (!ack && reply.compare(0, 3, "NAK") != 0) return;
+    if (reply.size() > 3 && reply[3] != ' ') return;
+    if (queue.empty()) return;
+
+    Pending entry = queue.front();
+    queue.pop_front();
+    if (!priority) {
+        this->in_flight      -= entry.text.size();
+        this->pool_in_flight -= entry.cost;
+    }
+    if (entry.id == CONTROL_ID) {
+        // The client's only priority command is the pool report
+        if (priority) this->pool_polling = false;
+        return;
+    }
+    if (!entry.parts.empty()) {
+        this->handleBatch(entry, ack, (reply.size() > 4) ? reply.substr(4) : std::string());
+        return;
+    }
+    if (ack) {
+        this->replies[entry.id] = REPLY_ACK;
+        this->counters.acked++;
+        this->pool_used += entry.cost;
+        return;
+    }
+
+    // Motions are refused when the pool is full. They go again once it has drained a little
+    if (motionCommand(entry.text) && entry.tries < this->options.retries) {
+        this->refused.push_back(entry);
+        return;
+    }
+    this->replies[entry.id] = REPLY_NAK;
+    this->counters.naked++;
+}
+
+void VectorClient::handleBatch(const Pending& entry, bool ack, const std::string& map) {
+    for (size_t i = 0; i < entry.parts.size(); i++) {
+        uint32_t id = entry.id + i;
+        std::string text = entry.parts[i] + '\n';
+        if (ack || (i < map.size() && map[i] == '1')) {
+            this->replies[id] = REPLY_ACK;
+            this->counters.acked++;
+            this->pool_used += poolCost(text);
+            continue;
+        }
+
+        // Refused motions go again on their own
+        if (motionCommand(text) && entry.tries < this->options.retries) {
+            Pending part = {id, text, entry.tries, std::vector<std::string>(), entry.frame, 0};
+            this->refused.push_back(part);
+            continue;
+        }
+        this->replies[id] = REPLY_NAK;
+        this->counters.naked++;
+    }
+}
@@ -0,0 +1,234 @@
+// HostClient
+// Streams drawing commands to a SerialVectorGenerator
+// Commands are pipelined so the device never waits on the host, and every ACK or NAK is matched to its command
+
+#ifndef HOST_CLIENT_H
+#define HOST_CLIENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+// Where the bytes go. A serial port, a pty, or a simulated device
+class Transport {
+public:
+    virtual ~Transport() {}
+    virtual bool write(const char* data, size_t len) = 0;
+    // Read what's available, waiting up to timeout_ms for the first byte
+    virtual size_t read(char* buf, size_t len, int timeout_ms) = 0;
+    // Move to another rate once what's written is out. False when it can't
+    virtual bool setBaud(uint32_t baud) { (void)baud; return false; }
+    virtual uint32_t baud() const { return 0; }
+};
+
+// A serial device or pty
+class SerialTransport: public Transport {
+public:
+    SerialTransport();
+    ~SerialTransport();
+    // Opens the port raw at the given baud rate. Ptys ignore the rate
+    bool open(const char* path, uint32_t baud);
+    void close();
+    bool isOpen() const { return this->fd >= 0; }
+    bool write(const char* data, size_t len);
+    size_t read(char* buf, size_t len, int timeout_ms);
+    bool setBaud(uint32_t baud);
+    uint32_t baud() const { return this->rate; }
+
+private:
+    int fd;
+    uint32_t rate;
+};
+
+// How a frame's motions are written
+enum Encoding {
+    ENCODE_TEXT = 0, // Absolute lines
+    ENCODE_RELATIVE, // Lines that carry on from the last one are sent as rline
+    ENCODE_BINARY,   // Binary records, relative where that's shorter. The device needs "set binary" first
+};
+
+// Builds the commands for a frame
+// Relative commands follow the device's pen, so they can only be sent again in order, as VectorClient does
+class FrameEncoder {
+public:
+    FrameEncoder(Encoding encoding = ENCODE_TEXT);
+
+    static std::string point(int16_t x, int16_t y);
+    static std::string line(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+    static std::string rline(int16_t dx, int16_t dy);
+    static std::string rmove(int16_t dx, int16_t dy);
+    static std::string binaryPoint(int16_t x, int16_t y);
+    static std::string binaryLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+    // Byte sized when both fit
+    static std::string binaryRel(bool draw, int16_t dx, int16_t dy);
+
+    // Forgets the pen too, so the next frame starts with an absolute motion
+    void clear() { this->commands.clear(); this->pen_known = false; }
+    void addPoint(int16_t x, int16_t y);
+    void addLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+    // Connected lines through each vertex. Closed shapes join the last vertex to the first
+    void addPolyline(const std::vector<int16_t>& xy, bool closed);
+    // Commands drawn once, in order
+    const std::vector<std::string>& motions() const { return this->commands; }
+    // Binary motions packed into records of up to CMD_PACKED_MOTIONS. The first starts absolute and the LZ window afresh,
+    // and the rest carry on from those before them, so they're sent again in order
+    // The motions as they are when packing doesn't make them smaller
+    std::vector<std::string> packedMotions() const;
+    // Commands that load the frame as a sequence the device redraws on its own
+    std::vector<std::string> sequence() const;
+    // Commands that turn the sequence loaded from previous into this frame, entry by entry, without blanking
+    // Loads it again instead when that's shorter, or when either frame isn't absolute text
+    std::vector<std::string> sequenceFrom(const FrameEncoder& previous) const;
+
+    // Total bytes of the motions
+    size_t bytes() const;
+
+private:
+    bool relLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2, std::vector<std::string>* out) const;
+
+    Encoding encoding;
+    std::vector<std::string> commands;
+    bool pen_known; // Where the device's pen is after the commands so far
+    int16_t pen_x;
+    int16_t pen_y;
+};
+
+enum Reply {
+    REPLY_PENDING = 0,
+    REPLY_ACK,
+    REPLY_NAK,
+    REPLY_TIMEOUT,
+};
+
+struct ClientOptions {
+    // Unanswered bytes allowed on the wire
+    // Keep it under the device's command buffer (CMD_BUF_SIZE) so nothing is dropped
+    size_t window;
+    int timeout_ms;  // Longest wait for a reply
+    // Times a NAKed motion is sent again. Nothing new goes out until they're back on
+    // The device is "set hold" for them, so it turns away the motions behind a refused one and they stay in order
+    uint8_t retries;
+    int backoff_ms;  // First wait for the pool to drain before they go. Doubles while they keep being refused
+    // Hold motions back until the device's pool has room for them, so they aren't refused in the first place
+    // Its free space comes from "pool" reports asked for on the priority lane, less what was sent since
+    bool pace;
+    // Bytes of the pool kept filled at most while pacing, or zero for all of it
+    // Motions start sooner with fewer waiting ahead of them. Keep it a few motions, so the pool outlasts a report
+    size_t pool_fill;
+
+    ClientOptions(): window(192), timeout_ms(1000), retries(0), backoff_ms(1), pace(true), pool_fill(0) {}
+};
+
+// Frames kept for the device to ask for again. Well past what the window lets be unanswered
+#define CLIENT_FRAME_HISTORY 128
+// Longest wait for the pool to drain
+#define CLIENT_BACKOFF_MAX_MS 64
+
+struct ClientStats {
+    uint32_t sent;
+    uint32_t acked;
+    uint32_t naked;
+    uint32_t retried;
+    uint32_t timeouts;
+    uint32_t resent;      // Frames the device asked for again
+    uint32_t polls;       // Pool reports asked for
+    uint64_t bytes;       // Written
+    uint64_t reply_bytes; // Read
+    size_t max_in_flight; // Most bytes ever unanswered
+};
+
+class VectorClient {
+public:
+    VectorClient(Transport* transport, const ClientOptions& options = ClientOptions());
+
+    // Turn the prompt off so every command is answered with ACK or NAK
+    bool handshake();
+    // Switch the device to taking binary records. Waits for the answer, since records sent before it are misread
+    bool setBinary(bool enable);
+    // Wrap everything sent in checked frames, so noise costs only the frame it hit. Waits for the answer too
+    // Frames the device asks for again are sent again from the ones kept
+    bool setFramed(bool enable);
+    // Move the link to another rate. The transport follows once the device has answered, and the rate is kept
+    // only once the probe has come back through it. Otherwise both ends fall back, and this returns false
+    // Nothing can be waiting, and the link can't be framed
+    bool setBaud(uint32_t rate);
+    // Queue a command and return its id. Blocks while the window is full
+    // Commands starting with '!' go on the device's priority lane and are answered out of turn
+    uint32_t send(const std::string& command);
+    void sendAll(const std::vector<std::string>& commands);
+    // Send text commands several to a line, so each line is answered once
+    // Lines hold up to CMD_BATCH_MAX commands and fit the window. Ids follow on from the returned one
+    // Binary records and priority commands go on their own
+    uint32_t sendBatch(const std::vector<std::string>& commands);
+    // Wait for every reply
+    bool flush();
+
+    Reply reply(uint32_t id) const;
+    const ClientStats& stats() const { return this->counters; }
+    size_t inFlight() const { return this->in_flight; }
+
+private:
+    struct Pending {
+        uint32_t id;
+        std::string text;
+        uint8_t tries;
+        std::vector<std::string> parts; // Commands of a batch, with ids from id on
+        uint8_t frame;                  // First frame it went out in, when framed
+        size_t cost;                    // Bytes its motions take in the device's pool
+        // Ids are in the order commands were first sent
+        bool operator<(const Pending& other) const { return this->id < other.id; }
+    };
+
+    bool writeCommand(uint32_t id, const std::string& text, uint8_t tries,
+                      const std::vector<std::string>& parts = std::vector<std::string>());
+    // Put a command in the window, waiting for room
+    bool queueCommand(Pending entry);
+    // A command the client sends for itself. Its answer isn't counted
+    bool sendControl(const std::string& text);
+    // Send refused motions again, in order, once what's ahead of them is answered. False when there were none
+    bool sendRefused();
+    // Wait until the device's pool has room for cost more bytes, asking how full it is when it looks full
+    void waitForRoom(size_t cost);
+    bool poolHasRoom(size_t cost) const;
+    void pollPool();
+    uint32_t sendLine(const std::vector<std::string>& parts);
+    void handleBatch(const Pending& entry, bool ack, const std::string& map);
+    // Put bytes on the wire, framed when that's on
+    bool writeRaw(const std::string& text);
+    bool resendUnanswered();
+    // Write a line and wait for one that matches, skipping any junk
+    bool exchange(const std::string& line, const std::string& expected, int timeout_ms);
+    size_t waiting() const { return this->pending.size() + this->prio_pending.size(); }
+    // Read replies until at least one arrives. False on a timeout
+    bool pump(int timeout_ms);
+    // Wait with nothing to send, taking in whatever arrives
+    void idle(int timeout_ms);
+    void takeReplies(const char* buf, size_t count);
+    void handleLine(const std::string& line);
+
+    Transport* transport;
+    ClientOptions options;
+    ClientStats counters;
+    std::deque<Pending> pending;
+    std::deque<Pending> prio_pending;
+    std::vector<Reply> replies;
+    std::string rx;
+    size_t in_flight;
+    bool framed;
+    uint8_t frame_seq;                                 // Of the next frame
+    std::deque<std::pair<uint8_t, std::string> > sent_frames; // Newest last
+    std::deque<Pending> refused; // Motions turned away by a full pool, in the order they were sent
+    int backoff_ms;
+    bool hold_set; // "set hold" sent
+    // What's known of the device's pool, for pacing
+    size_t pool_size;      // Zero until it has been reported
+    size_t pool_used;      // Bytes in use when last reported, and taken since
+    size_t pool_in_flight; // Bytes the unanswered motions will take
+    bool pool_polling;     // A report has been asked for and not answered
+    int pool_wait_ms;      // Wait before asking again when it looks full. Learnt from how long room took to come
+};
+
+#endif // HOST_CLIENT_H
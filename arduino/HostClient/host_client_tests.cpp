@@ -0,0 +1,574 @@
+// host_client_tests.cpp
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "host_client.h"
+#include "sim_device.h"
+
+TEST(FrameEncoder, commands) {
+    EXPECT_EQ("point -5 7\n", FrameEncoder::point(-5, 7));
+    EXPECT_EQ("line 1 -2 300 4\n", FrameEncoder::line(1, -2, 300, 4));
+
+    // Closed square
+    FrameEncoder frame;
+    frame.addPolyline({0, 0, 10, 0, 10, 10, 0, 10}, true);
+    const std::vector<std::string>& motions = frame.motions();
+    ASSERT_EQ(4u, motions.size());
+    EXPECT_EQ("line 0 0 10 0\n",  motions[0]);
+    EXPECT_EQ("line 0 10 0 0\n",  motions[3]);
+
+    // Loaded as a sequence
+    frame.addPoint(3, 3);
+    std::vector<std::string> sequence = frame.sequence();
+    ASSERT_EQ(8u, sequence.size());
+    EXPECT_EQ("sequence clear\n", sequence[0]);
+    EXPECT_EQ("sequence start\n", sequence[1]);
+    EXPECT_EQ("point 3 3\n",      sequence[6]);
+    EXPECT_EQ("sequence end\n",   sequence[7]);
+}
+
+TEST(FrameEncoder, relative) {
+    FrameEncoder frame(ENCODE_RELATIVE);
+    frame.addPolyline({0, 0, 10, 0, 10, 10}, false);
+    // Far enough that a move and a line is longer than the line
+    frame.addLine(-1000, -1000, -1000, 1000);
+    // Close enough that it isn't
+    frame.addLine(-990, 1000, -990, 990);
+    const std::vector<std::string>& motions = frame.motions();
+    ASSERT_EQ(5u, motions.size());
+    EXPECT_EQ("line 0 0 10 0\n",         motions[0]);
+    EXPECT_EQ("rline 0 10\n",            motions[1]);
+    EXPECT_EQ("line -1000 -1000 -1000 1000\n", motions[2]);
+    EXPECT_EQ("rmove 10 0\n",            motions[3]);
+    EXPECT_EQ("rline 0 -10\n",           motions[4]);
+
+    // A new frame starts from scratch
+    frame.clear();
+    frame.addLine(-990, 990, 0, 0);
+    EXPECT_EQ("line -990 990 0 0\n", frame.motions()[0]);
+}
+
+TEST(FrameEncoder, binary) {
+    EXPECT_EQ(std::string("\x80\x05\x00\xFE\xFF", 5), FrameEncoder::binaryPoint(5, -2));
+    EXPECT_EQ(std::string("\x84\x7F\x80", 3), FrameEncoder::binaryRel(true, 127, -128));
+    EXPECT_EQ(std::string("\x83\x80\x00\x00\x00", 5), FrameEncoder::binaryRel(false, 128, 0));
+
+    // An outline of short edges, like a glyph or a rock
+    FrameEncoder text;
+    FrameEncoder binary(ENCODE_BINARY);
+    std::vector<int16_t> outline;
+    for (int i = 0; i < 24; i++) {
+        outline.push_back(400 + 100 * cos(i * M_PI / 12));
+        outline.push_back(-300 + 100 * sin(i * M_PI / 12));
+    }
+    text.addPolyline(outline, true);
+    binary.addPolyline(outline, true);
+    ASSERT_EQ(24u, binary.motions().size());
+    EXPECT_EQ(9u, binary.motions()[0].size());
+    EXPECT_EQ(3u, binary.motions()[1].size());
+    // Less than half the bytes per edge
+    EXPECT_LT(2 * binary.bytes(), text.bytes());
+    EXPECT_LT(binary.bytes(), 24u * 4);
+}
+
+TEST(FrameEncoder, packed) {
+    // A row of the same glyph repeats the same relative records
+    FrameEncoder frame(ENCODE_BINARY);
+    for (int i = 0; i < 10; i++) {
+        frame.addPolyline({(int16_t)(i * 50), 0, (int16_t)(i * 50 + 20), 0, (int16_t)(i * 50 + 20), 30}, true);
+    }
+    std::vector<std::string> packed = frame.packedMotions();
+    size_t bytes = 0;
+    for (size_t i = 0; i < packed.size(); i++) {
+        bytes += packed[i].size();
+        if ((uint8_t)packed[i][0] != CMD_BIN_PACKED) continue;
+        EXPECT_EQ(packed[i].size(), 2u + (uint8_t)packed[i][1]);
+        EXPECT_LE(packed[i].size(), 2u + CMD_PACKED_MAX);
+    }
+    EXPECT_EQ(0x86, (uint8_t)packed[0][0]);
+    EXPECT_LT(packed.size(), frame.motions().size() / 2);
+    // Later glyphs copy from the window the records before them left
+    EXPECT_LT(bytes, frame.bytes() / 2);
+    for (size_t i = 0; i < packed.size(); i++) EXPECT_EQ(i, (uint8_t)packed[i][2]);
+
+    // Nothing to gain from packing text, or a single motion
+    FrameEncoder text;
+    text.addLine(0, 0, 10, 10);
+    EXPECT_EQ(text.motions(), text.packedMotions());
+    FrameEncoder single(ENCODE_BINARY);
+    single.addLine(0, 0, 10, 10);
+    EXPECT_EQ(single.motions(), single.packedMotions());
+}
+
+TEST(VectorClient, repliesInOrder) {
+    SimDevice device;
+    LoopbackTransport loopback(&device);
+    VectorClient client(&loopback);
+    ASSERT_TRUE(client.handshake());
+
+    uint32_t line  = client.send("line 1 2 3 4");
+    uint32_t bogus = client.send("bogus 1 2");
+    uint32_t point = client.send("point 5 6\n");
+    uint32_t prio  = client.send("!line 1 1 2 2");
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(REPLY_ACK, client.reply(line));
+    EXPECT_EQ(REPLY_NAK, client.reply(bogus));
+    EXPECT_EQ(REPLY_ACK, client.reply(point));
+    EXPECT_EQ(REPLY_NAK, client.reply(prio));
+    EXPECT_EQ(2u, client.stats().acked);
+    EXPECT_EQ(2u, client.stats().naked);
+    EXPECT_EQ(0u, client.inFlight());
+}
+
+TEST(VectorClient, streamFrames) {
+    // Many more lines than the pool holds, sent without waiting on each one
+    // Short lines are drawn faster than the serial port brings them in
+    SimDevice device;
+    LoopbackTransport loopback(&device);
+    VectorClient client(&loopback);
+    ASSERT_TRUE(client.handshake());
+
+    srand(7);
+    FrameEncoder frame;
+    for (int i = 0; i < 300; i++) {
+        int16_t x = rand() % 400 - 200;
+        int16_t y = rand() % 400 - 200;
+        frame.addLine(x, y, x + rand() % 20, y + rand() % 20);
+    }
+    client.sendAll(frame.motions());
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(300u, client.stats().acked);
+    EXPECT_EQ(0u, client.stats().naked);
+
+    // Several commands were on the wire at once, but never more than the device can buffer
+    EXPECT_GT(client.stats().max_in_flight, 100u);
+    EXPECT_LE(client.stats().max_in_flight, 192u);
+
+    // Everything is drawn
+    device.run(2000000);
+    EXPECT_EQ(0, device.pool().count);
+    EXPECT_EQ(300u, device.pool().stats.pops);
+}
+
+TEST(VectorClient, poolFull) {
+    // A small pool fills faster than it's drawn
+    SimDevice device(48);
+    LoopbackTransport loopback(&device);
+    ClientOptions options;
+    options.retries = 0;
+    options.pace    = false;
+    VectorClient refused(&loopback, options);
+    ASSERT_TRUE(refused.handshake());
+    for (int i = 0; i < 20; i++) refused.send(FrameEncoder::line(-500, -500, 500, 500));
+    ASSERT_TRUE(refused.flush());
+    EXPECT_GT(refused.stats().naked, 0u);
+    EXPECT_EQ(20u, refused.stats().acked + refused.stats().naked);
+
+    // Trying again gets them all in
+    device.run(10000000);
+    options.retries = 255;
+    VectorClient retried(&loopback, options);
+    for (int i = 0; i < 20; i++) retried.send(FrameEncoder::line(-500, -500, 500, 500));
+    ASSERT_TRUE(retried.flush());
+    EXPECT_EQ(20u, retried.stats().acked);
+    EXPECT_GT(retried.stats().retried, 0u);
+}
+
+// Runs the device in short steps and notes where each motion it draws starts
+class DrawnTransport: public Transport {
+public:
+    DrawnTransport(SimDevice* device): device(device), last_start(UINT32_MAX) {}
+    bool write(const char* data, size_t len) {
+        this->device->receive(data, len);
+        return true;
+    }
+    size_t read(char* buf, size_t len, int timeout_ms) {
+        for (uint32_t waited = 0; this->out.empty() && waited <= (uint32_t)timeout_ms * 1000; waited += 20) {
+            this->run(20);
+        }
+        size_t count = std::min(this->out.size(), len);
+        memcpy(buf, this->out.data(), count);
+        this->out.erase(0, count);
+        return count;
+    }
+    void run(uint32_t micros) {
+        for (uint32_t t = 0; t < micros; t += 20) {
+            this->device->run(20);
+            this->out += this->device->takeOutput();
+            const ScreenState& screen = this->device->screen();
+            if (screen.motion_active && screen.motion_start != this->last_start) {
+                this->last_start = screen.motion_start;
+                this->starts.push_back(screen.line.mx1 / 1000);
+            }
+        }
+    }
+
+    std::vector<int> starts; // X of each line drawn
+
+private:
+    SimDevice* device;
+    std::string out;
+    uint32_t last_start;
+};
+
+TEST(VectorClient, poolFullInOrder) {
+    // Refused lines go again ahead of those sent after them, and are drawn in the order they were sent
+    SimDevice device(48, 40, 1000000);
+    DrawnTransport drawn(&device);
+    ClientOptions options;
+    options.retries = 255;
+    options.pace    = false;
+    VectorClient client(&drawn, options);
+    ASSERT_TRUE(client.handshake());
+    for (int i = 0; i < 40; i++) client.send(FrameEncoder::line(i * 20 - 400, -500, i * 20 - 400, 500));
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(40u, client.stats().acked);
+    EXPECT_GT(client.stats().retried, 0u);
+
+    drawn.run(1000000);
+    ASSERT_EQ(40u, drawn.starts.size());
+    for (int i = 0; i < 40; i++) EXPECT_EQ(i * 20 - 400, drawn.starts[i]) << "Line " << i;
+}
+
+TEST(VectorClient, poolFullRelative) {
+    // A stream of rlines fills the pool. Those refused go again in order, so each starts where the last ended
+    SimDevice device(48, 40, 1000000);
+    DrawnTransport drawn(&device);
+    ClientOptions options;
+    options.retries = 255;
+    options.pace    = false;
+    VectorClient client(&drawn, options);
+    ASSERT_TRUE(client.handshake());
+    FrameEncoder frame(ENCODE_RELATIVE);
+    std::vector<int16_t> xy;
+    for (int i = 0; i <= 30; i++) {
+        xy.push_back(i * 20 - 300);
+        xy.push_back((i % 2) ? 400 : -400);
+    }
+    frame.addPolyline(xy, false);
+    ASSERT_EQ(0, frame.motions()[1].compare(0, 6, "rline "));
+    client.sendAll(frame.motions());
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(frame.motions().size(), client.stats().acked);
+    EXPECT_GT(client.stats().retried, 0u);
+
+    drawn.run(1000000);
+    ASSERT_EQ(30u, drawn.starts.size());
+    for (int i = 0; i < 30; i++) EXPECT_EQ(i * 20 - 300, drawn.starts[i]) << "Line " << i;
+    EXPECT_EQ(300, device.screen().pen_x);
+    EXPECT_EQ(-400, device.screen().pen_y);
+}
+
+TEST(VectorClient, paced) {
+    // Lines wait for room in the pool instead of being refused, and are drawn in the order they were sent
+    SimDevice device(48, 40, 1000000);
+    DrawnTransport drawn(&device);
+    ClientOptions options;
+    options.retries = 255;
+    VectorClient client(&drawn, options);
+    ASSERT_TRUE(client.handshake());
+    for (int i = 0; i < 40; i++) client.send(FrameEncoder::line(i * 20 - 400, -500, i * 20 - 400, 500));
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(40u, client.stats().acked);
+    EXPECT_EQ(0u, client.stats().retried);
+    EXPECT_EQ(0u, device.pool().stats.out_of_mem);
+    EXPECT_GT(client.stats().polls, 0u);
+
+    drawn.run(1000000);
+    ASSERT_EQ(40u, drawn.starts.size());
+    for (int i = 0; i < 40; i++) EXPECT_EQ(i * 20 - 400, drawn.starts[i]) << "Line " << i;
+
+    // Kept to part of a larger pool
+    SimDevice large(256, 40, 1000000);
+    DrawnTransport large_drawn(&large);
+    options.pool_fill = 3 * (sizeof(LineMotion) + 1);
+    VectorClient filled(&large_drawn, options);
+    ASSERT_TRUE(filled.handshake());
+    for (int i = 0; i < 40; i++) filled.send(FrameEncoder::line(i * 20 - 400, -500, i * 20 - 400, 500));
+    ASSERT_TRUE(filled.flush());
+    EXPECT_EQ(40u, filled.stats().acked);
+    EXPECT_LE(large.pool().stats.high_bytes, options.pool_fill);
+}
+
+TEST(VectorClient, binary) {
+    SimDevice device;
+    LoopbackTransport loopback(&device);
+    VectorClient client(&loopback);
+    ASSERT_TRUE(client.handshake());
+    ASSERT_TRUE(client.setBinary(true));
+
+    // Records go out with no line ends, and relative lines land where the text ones would
+    FrameEncoder frame(ENCODE_BINARY);
+    frame.addPolyline({-100, -100, 100, -100, 100, 100, -100, 100}, true);
+    frame.addPoint(7, 10);
+    frame.addLine(7, 10, 7, 60);
+    client.sendAll(frame.motions());
+    uint32_t text = client.send("point 0 0");
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(8u, client.stats().acked);
+    EXPECT_EQ(REPLY_ACK, client.reply(text));
+    EXPECT_EQ(0, device.screen().pen_x);
+    EXPECT_EQ(0, device.screen().pen_y);
+    device.run(1000000);
+    EXPECT_EQ(7u, device.pool().stats.pops);
+
+    ASSERT_TRUE(client.setBinary(false));
+    EXPECT_EQ(0u, client.stats().naked);
+}
+
+TEST(VectorClient, packed) {
+    // A small pool turns some packed records away whole, and they're sent again
+    SimDevice device(128);
+    LoopbackTransport loopback(&device);
+    ClientOptions options;
+    options.retries = 255;
+    options.pace    = false;
+    VectorClient client(&loopback, options);
+    ASSERT_TRUE(client.handshake());
+    ASSERT_TRUE(client.setBinary(true));
+
+    FrameEncoder frame(ENCODE_BINARY);
+    for (int i = 0; i < 16; i++) {
+        frame.addPolyline({(int16_t)(i * 50 - 500), 0, (int16_t)(i * 50 - 480), 0, (int16_t)(i * 50 - 480), 30}, true);
+    }
+    std::vector<std::string> packed = frame.packedMotions();
+    for (size_t i = 0; i < packed.size(); i++) {
+        ASSERT_EQ(CMD_BIN_PACKED, (uint8_t)packed[i][0]);
+    }
+    client.sendAll(packed);
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(packed.size() + 1, client.stats().acked);
+    EXPECT_GT(client.stats().retried, 0u);
+
+    // Every line lands once, and the pen ends where the last shape closed
+    device.run(10000000);
+    EXPECT_EQ(48u, device.pool().stats.pops);
+    EXPECT_EQ(0, device.pool().count);
+    EXPECT_EQ(250, device.screen().pen_x);
+    EXPECT_EQ(0,   device.screen().pen_y);
+    ASSERT_TRUE(client.setBinary(false));
+}
+
+TEST(VectorClient, batch) {
+    SimDevice device;
+    LoopbackTransport loopback(&device);
+    // No pool reports among the answers
+    ClientOptions quiet;
+    quiet.pace = false;
+    VectorClient client(&loopback, quiet);
+    ASSERT_TRUE(client.handshake());
+
+    // One answer per line instead of one per command
+    FrameEncoder frame;
+    frame.addPolyline({-100, -100, 100, -100, 100, 100, -100, 100}, true);
+    std::vector<std::string> commands = frame.sequence();
+    commands.push_back("bogus");
+    commands.push_back("!noop");
+    uint64_t replied = client.stats().reply_bytes;
+    uint32_t first = client.sendBatch(commands);
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(8u, client.stats().acked);
+    EXPECT_EQ(REPLY_NAK, client.reply(first + 7));
+    EXPECT_EQ(REPLY_ACK, client.reply(first + 8));
+    EXPECT_EQ(4, device.screen().sequence_size);
+    // "NAK 11111110\n" and "!ACK\n"
+    EXPECT_EQ(18u, client.stats().reply_bytes - replied);
+
+    // Refused motions go again on their own
+    SimDevice small(48);
+    LoopbackTransport small_loopback(&small);
+    ClientOptions options;
+    options.retries = 255;
+    VectorClient retried(&small_loopback, options);
+    ASSERT_TRUE(retried.handshake());
+    std::vector<std::string> lines(20, FrameEncoder::line(-500, -500, 500, 500));
+    first = retried.sendBatch(lines);
+    ASSERT_TRUE(retried.flush());
+    EXPECT_EQ(20u, retried.stats().acked);
+    EXPECT_GT(retried.stats().retried, 0u);
+    for (uint32_t i = 0; i < 20; i++) EXPECT_EQ(REPLY_ACK, retried.reply(first + i));
+}
+
+// Flips a bit every so many bytes, like noise on a long cable
+class NoisyTransport: public Transport {
+public:
+    NoisyTransport(Transport* inner, size_t period): inner(inner), period(period), count(0) {}
+    bool write(const char* data, size_t len) {
+        std::string bytes(data, len);
+        for (size_t i = 0; i < len; i++) {
+            if (++this->count % this->period == 0) bytes[i] ^= 0x10;
+        }
+        return this->inner->write(bytes.data(), len);
+    }
+    size_t read(char* buf, size_t len, int timeout_ms) { return this->inner->read(buf, len, timeout_ms); }
+
+private:
+    Transport* inner;
+    size_t period;
+    size_t count;
+};
+
+TEST(VectorClient, framed) {
+    SimDevice device;
+    LoopbackTransport loopback(&device);
+    NoisyTransport noisy(&loopback, 97);
+    VectorClient client(&noisy);
+    ASSERT_TRUE(client.handshake());
+    ASSERT_TRUE(client.setFramed(true));
+
+    // Each command is answered once, in order, even though some frames had to come again
+    FrameEncoder frame(ENCODE_RELATIVE);
+    for (int i = 0; i < 30; i++) frame.addLine(i, 0, i, 10);
+    std::vector<std::string> commands = frame.motions();
+    commands.push_back("line -5 -5 5 5;line 5 5 -5 -5");
+    uint32_t acked = client.stats().acked;
+    client.sendAll(commands);
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(commands.size(), client.stats().acked - acked);
+    EXPECT_EQ(0u, client.stats().naked);
+    EXPECT_GT(client.stats().resent, 0u);
+    EXPECT_GT(device.core().link.stats.bad, 0u);
+    EXPECT_EQ(-5, device.screen().pen_x);
+    device.run(1000000);
+    EXPECT_EQ(frame.motions().size() + 2, device.pool().stats.pops);
+
+    // Long commands are split over frames
+    std::string text;
+    for (int i = 0; i < 14; i++) text += "point 1 1;";
+    ASSERT_GT(text.size(), 2u * LINK_PAYLOAD_MAX);
+    uint32_t id = client.send(text + "point 2 2");
+    ASSERT_TRUE(client.setFramed(false));
+    EXPECT_EQ(REPLY_ACK, client.reply(id));
+    EXPECT_FALSE(device.core().link.enabled);
+}
+
+TEST(VectorClient, baud) {
+    SimDevice device;
+    LoopbackTransport loopback(&device);
+    VectorClient client(&loopback);
+    ASSERT_TRUE(client.handshake());
+    EXPECT_EQ(115200u, loopback.baud());
+
+    ASSERT_TRUE(client.setBaud(1000000));
+    EXPECT_EQ(1000000u, device.rate());
+    EXPECT_EQ(1000000u, loopback.baud());
+    uint32_t id = client.send("line 0 0 10 10");
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(REPLY_ACK, client.reply(id));
+
+    // A 16 MHz UART can't make it close enough. Refused at the rate it's at
+    EXPECT_FALSE(client.setBaud(230400));
+    EXPECT_EQ(1000000u, device.rate());
+    EXPECT_EQ(1000000u, loopback.baud());
+
+    // The cable can't carry it, so the probe never gets through and both ends go back
+    device.setLineLimit(1000000);
+    EXPECT_FALSE(client.setBaud(2000000));
+    EXPECT_EQ(1000000u, device.rate());
+    EXPECT_EQ(1000000u, loopback.baud());
+    id = client.send("line 10 10 0 0");
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(REPLY_ACK, client.reply(id));
+    EXPECT_EQ(0, device.screen().pen_x);
+
+    // Not while framed, the link's sequence carries on over it
+    ASSERT_TRUE(client.setFramed(true));
+    EXPECT_FALSE(client.setBaud(500000));
+    EXPECT_EQ(1000000u, device.rate());
+}
+
+TEST(VectorClient, sequence) {
+    SimDevice device;
+    LoopbackTransport loopback(&device);
+    VectorClient client(&loopback);
+    ASSERT_TRUE(client.handshake());
+
+    FrameEncoder frame;
+    frame.addPolyline({-100, -100, 100, -100, 100, 100, -100, 100}, true);
+    client.sendAll(frame.sequence());
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(7u, client.stats().acked);
+    EXPECT_TRUE(device.screen().sequence_enabled);
+    EXPECT_EQ(4, device.screen().sequence_size);
+}
+
+TEST(VectorClient, sequenceEdit) {
+    SimDevice device;
+    LoopbackTransport loopback(&device);
+    VectorClient client(&loopback);
+    ASSERT_TRUE(client.handshake());
+
+    FrameEncoder square;
+    square.addPolyline({-100, -100, 100, -100, 100, 100, -100, 100}, true);
+    client.sendAll(square.sequence());
+    ASSERT_TRUE(client.flush());
+    device.run(20000);
+    uint16_t frames = device.screen().frame_count;
+
+    // One corner moves and a mark is added. Only those entries are sent, and drawing never stops
+    FrameEncoder moved;
+    moved.addPolyline({-100, -100, 100, -100, 120, 120, -100, 100}, true);
+    moved.addPoint(0, 0);
+    std::vector<std::string> edits = moved.sequenceFrom(square);
+    EXPECT_EQ(3u, edits.size());
+    uint32_t acked = client.stats().acked;
+    client.sendAll(edits);
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(edits.size(), client.stats().acked - acked);
+    EXPECT_GE(device.screen().sequence_idx, 0);
+    ASSERT_EQ(5, device.screen().sequence_size);
+    const LineMotion* line = (const LineMotion*)device.screen().sequence[1];
+    EXPECT_EQ(120, line->x2);
+    EXPECT_EQ(SM_Point, device.screen().sequence[4]->type);
+    device.run(20000);
+    EXPECT_GT(device.screen().frame_count, frames);
+
+    // Back to the square
+    edits = square.sequenceFrom(moved);
+    client.sendAll(edits);
+    ASSERT_TRUE(client.flush());
+    EXPECT_EQ(0u, client.stats().naked);
+    EXPECT_EQ(4, device.screen().sequence_size);
+    EXPECT_EQ(100, ((const LineMotion*)device.screen().sequence[1])->x2);
+
+    // A different frame is loaded again
+    FrameEncoder star;
+    star.addPolyline({0, 100, 60, -80, -95, 30, 95, 30, -60, -80}, true);
+    EXPECT_EQ(star.sequence(), star.sequenceFrom(square));
+}
+
+TEST(SerialTransport, pty) {
+    // The client end of a pty behaves like a serial port
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    ASSERT_GE(master, 0);
+    ASSERT_EQ(0, grantpt(master));
+    ASSERT_EQ(0, unlockpt(master));
+
+    SerialTransport serial;
+    ASSERT_TRUE(serial.open(ptsname(master), 115200));
+    ASSERT_TRUE(serial.write("line 1 2 3 4\n", 13));
+    char buf[64] = {};
+    size_t count = 0;
+    while (count < 13) {
+        ssize_t got = read(master, buf + count, sizeof(buf) - count);
+        ASSERT_GT(got, 0);
+        count += got;
+    }
+    EXPECT_EQ(std::string("line 1 2 3 4\n"), std::string(buf, count));
+
+    ASSERT_EQ(4, write(master, "ACK\n", 4));
+    count = serial.read(buf, sizeof(buf), 1000);
+    EXPECT_EQ(std::string("ACK\n"), std::string(buf, count));
+    EXPECT_EQ(0u, serial.read(buf, sizeof(buf), 10));
+    close(master);
+}
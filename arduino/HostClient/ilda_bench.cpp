@@ -0,0 +1,98 @@
+// ilda_bench.cpp
+// Throughput of indexing and converting a large ILDA show
+// make bench, or ./ildabench [show.ild]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "ilda_player.h"
+
+#define SHOW_FRAMES 5000
+#define SHOW_POINTS 600
+#define ROUNDS      5
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Spirals that turn a little each frame, broken into strokes by blanked moves
+static bool writeShow(const char* path) {
+    FILE* out = fopen(path, "wb");
+    if (out == NULL) return false;
+    std::vector<IldaPoint> points(SHOW_POINTS);
+    for (int frame = 0; frame < SHOW_FRAMES; frame++) {
+        for (int i = 0; i < SHOW_POINTS; i++) {
+            double angle  = frame * 0.01 + i * 0.1;
+            double radius = 30000.0 * i / SHOW_POINTS;
+            points[i].x       = radius * cos(angle);
+            points[i].y       = radius * sin(angle);
+            points[i].blanked = (i % 25 == 0);
+        }
+        // Both 2D formats
+        std::string data = IldaFile::encode(points, (frame & 1) ? 5 : 1, frame, SHOW_FRAMES);
+        fwrite(data.data(), 1, data.size(), out);
+    }
+    std::string end = IldaFile::encode(std::vector<IldaPoint>(), 5, 0, 0);
+    fwrite(end.data(), 1, end.size(), out);
+    return fclose(out) == 0;
+}
+
+int main(int argc, char** argv) {
+    char path[] = "/tmp/ilda_benchXXXXXX";
+    const char* show = (argc > 1) ? argv[1] : NULL;
+    if (show == NULL) {
+        int fd = mkstemp(path);
+        if (fd < 0) {
+            perror("mkstemp");
+            return 1;
+        }
+        close(fd);
+        if (!writeShow(path)) {
+            perror("write");
+            return 1;
+        }
+        show = path;
+    }
+
+    Clock::time_point start = Clock::now();
+    IldaFile file;
+    bool opened = file.open(show);
+    double index_time = secondsSince(start);
+    if (show == path) unlink(path);
+    if (!opened) {
+        fprintf(stderr, "Can't read %s\n", show);
+        return 1;
+    }
+
+    uint64_t points  = 0;
+    uint64_t motions = 0;
+    uint64_t bytes   = 0;
+    IldaConverter converter;
+    FrameEncoder encoder;
+    start = Clock::now();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (size_t i = 0; i < file.frames(); i++) {
+            encoder.clear();
+            motions += converter.convert(file.frame(i), &encoder);
+            points  += file.frame(i).count;
+            for (size_t j = 0; j < encoder.motions().size(); j++) bytes += encoder.motions()[j].size();
+        }
+    }
+    double convert_time = secondsSince(start);
+
+    uint64_t frames = (uint64_t)ROUNDS * file.frames();
+    printf("%zu frames, indexed in %.2f ms\n", file.frames(), index_time * 1000);
+    printf("convert | %9.0f frames/s %11.0f points/s %11.0f motions/s | %6.1f MB of commands/s\n",
+           frames / convert_time, points / convert_time, motions / convert_time, bytes / convert_time / 1e6);
+    printf("%.1f bytes of commands per frame. The link needs %.0f baud for 30 fps\n",
+           (double)bytes / frames, (double)bytes / frames * 30 * 10);
+    return 0;
+}
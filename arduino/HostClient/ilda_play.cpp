@@ -0,0 +1,44 @@
+// ilda_play.cpp
+// Plays an ILDA show on a SerialVectorGenerator
+// ./ildaplay show.ild /dev/ttyACM0 [baud] [fps] [loops]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ilda_player.h"
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s show.ild port [baud] [fps] [loops]\n", argv[0]);
+        return 1;
+    }
+    uint32_t baud = (argc > 3) ? atoi(argv[3]) : 115200;
+    PlayOptions options;
+    if (argc > 4) options.fps   = atof(argv[4]);
+    if (argc > 5) options.loops = atoi(argv[5]);
+
+    IldaFile file;
+    if (!file.open(argv[1])) {
+        fprintf(stderr, "Can't read %s\n", argv[1]);
+        return 1;
+    }
+    SerialTransport serial;
+    if (!serial.open(argv[2], baud)) {
+        perror(argv[2]);
+        return 1;
+    }
+    ClientOptions client_options;
+    client_options.retries = 255;
+    VectorClient client(&serial, client_options);
+    if (!client.handshake()) {
+        fprintf(stderr, "No answer from %s\n", argv[2]);
+        return 1;
+    }
+
+    IldaPlayer player(&client);
+    bool ok = player.play(file, options);
+    const PlayStats& stats = player.stats();
+    printf("%u frames sent, %u dropped, %u motions in %.2f s\n", stats.frames, stats.dropped, stats.motions,
+           stats.micros / 1e6);
+    return (ok) ? 0 : 1;
+}
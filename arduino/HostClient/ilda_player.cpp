@@ -0,0 +1,228 @@
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include "ilda_player.h"
+
+static inline uint16_t readBE16(const uint8_t* data) {
+    return ((uint16_t)data[0] << 8) | data[1];
+}
+
+static inline void writeBE16(std::string* out, uint16_t value) {
+    *out += (char)(value >> 8);
+    *out += (char)(value & 0xFF);
+}
+
+// Bytes in each record, or zero for formats that aren't known
+static uint8_t recordSize(uint8_t format) {
+    switch (format) {
+    case 0:  return 8;  // 3D, palette colour
+    case 1:  return 6;  // 2D, palette colour
+    case 2:  return 3;  // Palette
+    case 4:  return 10; // 3D, true colour
+    case 5:  return 8;  // 2D, true colour
+    default: return 0;
+    }
+}
+
+// File
+
+IldaFile::IldaFile(): map(NULL), map_size(0) {}
+
+IldaFile::~IldaFile() {
+    this->close();
+}
+
+bool IldaFile::open(const char* path) {
+    this->close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < ILDA_HEADER_SIZE) {
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) return false;
+    madvise(data, info.st_size, MADV_SEQUENTIAL);
+    this->map      = (uint8_t*)data;
+    this->map_size = info.st_size;
+    return this->load(this->map, this->map_size);
+}
+
+bool IldaFile::load(const uint8_t* data, size_t size) {
+    this->index.clear();
+    size_t offset = 0;
+    while (offset + ILDA_HEADER_SIZE <= size) {
+        const uint8_t* header = data + offset;
+        if (memcmp(header, "ILDA", 4) != 0) break;
+        uint8_t format  = header[7];
+        uint16_t count  = readBE16(header + 24);
+        uint8_t rec_len = recordSize(format);
+        if (count == 0 || rec_len == 0) break;
+        if (offset + ILDA_HEADER_SIZE + (size_t)count * rec_len > size) break;
+
+        if (format != 2) {
+            IldaFrame frame = {header + ILDA_HEADER_SIZE, count, format, rec_len};
+            this->index.push_back(frame);
+        }
+        offset += ILDA_HEADER_SIZE + (size_t)count * rec_len;
+    }
+    return !this->index.empty();
+}
+
+void IldaFile::close() {
+    if (this->map != NULL) munmap(this->map, this->map_size);
+    this->map      = NULL;
+    this->map_size = 0;
+    this->index.clear();
+}
+
+IldaPoint IldaFile::point(const IldaFrame& frame, uint16_t idx) {
+    const uint8_t* record = frame.records + (size_t)idx * frame.record_size;
+    // 3D formats have z before the status
+    uint8_t status = (frame.format == 0 || frame.format == 4) ? record[6] : record[4];
+    IldaPoint point = {(int16_t)readBE16(record), (int16_t)readBE16(record + 2), (status & ILDA_BLANKED) != 0};
+    return point;
+}
+
+std::string IldaFile::encode(const std::vector<IldaPoint>& points, uint8_t format, uint16_t number, uint16_t total) {
+    std::string out("ILDA\0\0\0", 7);
+    out += (char)format;
+    out += std::string("frame   player  ", 16);
+    writeBE16(&out, points.size());
+    writeBE16(&out, number);
+    writeBE16(&out, total);
+    out += std::string(2, '\0');
+
+    bool three_d = (format == 0 || format == 4);
+    for (size_t i = 0; i < points.size(); i++) {
+        writeBE16(&out, points[i].x);
+        writeBE16(&out, points[i].y);
+        if (three_d) writeBE16(&out, 0);
+        uint8_t status = (points[i].blanked) ? ILDA_BLANKED : 0;
+        if (i + 1 == points.size()) status |= ILDA_LAST_POINT;
+        out += (char)status;
+        // White, or the first palette entry
+        out += (format == 0 || format == 1) ? std::string(1, '\0') : std::string(3, '\xFF');
+    }
+    return out;
+}
+
+// Conversion
+
+std::string IldaScale::command() const {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "scale %u %u %d %d\n", this->width, this->width, this->centered, this->centered);
+    return buf;
+}
+
+IldaConverter::IldaConverter(const IldaScale& scale): scale(scale), shift(16) {
+    // Same rounding as the device's log2ceil
+    for (int8_t bit = 15; bit >= 0; bit--) {
+        if ((scale.width >> bit) & 0x01) {
+            this->shift = 15 - bit;
+            break;
+        }
+    }
+}
+
+int16_t IldaConverter::mapX(int16_t x) const {
+    return (this->scale.centered) ? (x >> this->shift) : ((x + 32768) >> this->shift);
+}
+
+int16_t IldaConverter::mapY(int16_t y) const {
+    return (this->scale.centered) ? (y >> this->shift) : ((y + 32768) >> this->shift);
+}
+
+size_t IldaConverter::convert(const IldaFrame& frame, FrameEncoder* encoder) const {
+    size_t before = encoder->motions().size();
+    bool have_prev  = false;
+    bool prev_lit   = false;
+    bool lit_alone  = false; // The last point is lit, but no line has drawn it
+    int16_t x_prev  = 0;
+    int16_t y_prev  = 0;
+    for (uint16_t i = 0; i < frame.count; i++) {
+        IldaPoint point = IldaFile::point(frame, i);
+        int16_t x = this->mapX(point.x);
+        int16_t y = this->mapY(point.y);
+        bool moved = (!have_prev || x != x_prev || y != y_prev);
+
+        // The blanking bit is for the move to the point
+        if (point.blanked) {
+            if (moved && lit_alone) encoder->addPoint(x_prev, y_prev);
+            if (moved) lit_alone = false;
+        }
+        else if (have_prev && moved) {
+            encoder->addLine(x_prev, y_prev, x, y);
+            lit_alone = false;
+        }
+        else if (!prev_lit) {
+            // Lit where the beam already is
+            lit_alone = true;
+        }
+        have_prev = true;
+        prev_lit  = !point.blanked || (prev_lit && !moved);
+        x_prev    = x;
+        y_prev    = y;
+    }
+    if (lit_alone) encoder->addPoint(x_prev, y_prev);
+    return encoder->motions().size() - before;
+}
+
+// Player
+
+uint64_t WallClock::now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void WallClock::sleep(uint32_t micros) {
+    usleep(micros);
+}
+
+IldaPlayer::IldaPlayer(VectorClient* client, PlayClock* clock):
+    client(client),
+    clock((clock != NULL) ? clock : &this->wall)
+{
+    memset(&this->counters, 0, sizeof(this->counters));
+}
+
+bool IldaPlayer::play(const IldaFile& file, const PlayOptions& options) {
+    memset(&this->counters, 0, sizeof(this->counters));
+    IldaConverter converter(options.scale);
+    FrameEncoder encoder;
+    this->client->send(options.scale.command());
+
+    uint64_t period = (options.fps > 0) ? (uint64_t)(1000000 / options.fps) : 0;
+    uint64_t start  = this->clock->now();
+    uint64_t due    = start;
+    for (uint32_t loop = 0; loop < options.loops; loop++) {
+        for (size_t i = 0; i < file.frames(); i++, due += period) {
+            if (period > 0) {
+                uint64_t now = this->clock->now();
+                if (now < due) {
+                    this->clock->sleep(due - now);
+                }
+                else if (now >= due + period) {
+                    // The next frame is due already
+                    this->counters.dropped++;
+                    continue;
+                }
+            }
+
+            encoder.clear();
+            this->counters.motions += converter.convert(file.frame(i), &encoder);
+            this->client->sendAll((options.sequence) ? encoder.sequence() : encoder.motions());
+            this->counters.frames++;
+        }
+    }
+    bool ok = this->client->flush();
+    this->counters.micros = this->clock->now() - start;
+    return ok;
+}
@@ -0,0 +1,131 @@
+// IldaPlayer
+// Plays ILDA (.ild) laser show files on a SerialVectorGenerator
+// Formats 0, 1, 4, and 5 are drawn. Colour is ignored, only the blanking bit is used
+
+#ifndef ILDA_PLAYER_H
+#define ILDA_PLAYER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "host_client.h"
+
+#define ILDA_HEADER_SIZE 32
+#define ILDA_LAST_POINT  0x80 // Status bits
+#define ILDA_BLANKED     0x40
+
+struct IldaPoint {
+    int16_t x;
+    int16_t y;
+    bool blanked;
+};
+
+// A frame is a view into the mapped file
+struct IldaFrame {
+    const uint8_t* records;
+    uint16_t count;
+    uint8_t format;
+    uint8_t record_size;
+};
+
+// A memory mapped ILDA file
+// Palette sections are skipped. Reading stops at the end header or the first bad one
+class IldaFile {
+public:
+    IldaFile();
+    ~IldaFile();
+
+    bool open(const char* path);
+    // Read frames out of memory that isn't owned by the file
+    bool load(const uint8_t* data, size_t size);
+    void close();
+
+    size_t frames() const { return this->index.size(); }
+    const IldaFrame& frame(size_t idx) const { return this->index[idx]; }
+    static IldaPoint point(const IldaFrame& frame, uint16_t idx);
+
+    // One frame section, for writing test shows
+    static std::string encode(const std::vector<IldaPoint>& points, uint8_t format, uint16_t number, uint16_t total);
+
+private:
+    uint8_t* map;
+    size_t map_size;
+    std::vector<IldaFrame> index;
+};
+
+// Where ILDA's signed 16 bit space lands on the device
+struct IldaScale {
+    uint16_t width; // As given to the scale command. The window spans the next power of two above it
+    bool centered;
+
+    IldaScale(): width(1024), centered(true) {}
+    // The scale command that sets up the device to match
+    std::string command() const;
+};
+
+// Turns frames into commands
+// Lit runs become lines. A lit point on its own becomes a point. Blanked points just move the start of the next one
+class IldaConverter {
+public:
+    IldaConverter(const IldaScale& scale = IldaScale());
+    // Appends the commands to the encoder and returns the motions added
+    size_t convert(const IldaFrame& frame, FrameEncoder* encoder) const;
+
+private:
+    int16_t mapX(int16_t x) const;
+    int16_t mapY(int16_t y) const;
+
+    IldaScale scale;
+    uint8_t shift;
+};
+
+// Time for the player. Tests run it on simulated time
+class PlayClock {
+public:
+    virtual ~PlayClock() {}
+    virtual uint64_t now() = 0;
+    virtual void sleep(uint32_t micros) = 0;
+};
+
+class WallClock: public PlayClock {
+public:
+    uint64_t now();
+    void sleep(uint32_t micros);
+};
+
+struct PlayOptions {
+    double fps;      // Zero plays as fast as the link allows
+    bool sequence;   // Load each frame as a sequence so it's redrawn until the next one
+    uint32_t loops;  // Times through the file
+    IldaScale scale;
+
+    PlayOptions(): fps(30), sequence(false), loops(1) {}
+};
+
+struct PlayStats {
+    uint32_t frames;  // Sent
+    uint32_t dropped; // Skipped because the link fell behind
+    uint32_t motions;
+    uint64_t micros;
+};
+
+class IldaPlayer {
+public:
+    IldaPlayer(VectorClient* client, PlayClock* clock = NULL);
+
+    // Frames are sent when they're due
+    // When a frame is still going out after the next one was due, those that are late are dropped
+    bool play(const IldaFile& file, const PlayOptions& options);
+    const PlayStats& stats() const { return this->counters; }
+
+private:
+    VectorClient* client;
+    PlayClock* clock;
+    WallClock wall;
+    PlayStats counters;
+};
+
+#endif // ILDA_PLAYER_H
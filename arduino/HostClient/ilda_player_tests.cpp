@@ -0,0 +1,179 @@
+// ilda_player_tests.cpp
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "ilda_player.h"
+#include "sim_device.h"
+
+// Plays on the simulated device's time
+class SimClock: public PlayClock {
+public:
+    SimClock(SimDevice* device): device(device) {}
+    uint64_t now() { return this->device->now(); }
+    void sleep(uint32_t micros) { this->device->run(micros); }
+
+private:
+    SimDevice* device;
+};
+
+static IldaPoint lit(int16_t x, int16_t y) {
+    IldaPoint point = {x, y, false};
+    return point;
+}
+
+static IldaPoint blank(int16_t x, int16_t y) {
+    IldaPoint point = {x, y, true};
+    return point;
+}
+
+// A square of lit lines, reached with a blanked move
+static std::string squareFrame(uint8_t format, uint16_t number, uint16_t total) {
+    std::vector<IldaPoint> points = {blank(-1024, -1024), lit(1024, -1024), lit(1024, 1024),
+                                     lit(-1024, 1024), lit(-1024, -1024)};
+    return IldaFile::encode(points, format, number, total);
+}
+
+TEST(IldaFile, sections) {
+    std::string data = squareFrame(5, 0, 2);
+    // A palette of two colours is skipped
+    data += std::string("ILDA\0\0\0\2", 8) + std::string(16, ' ') + std::string("\0\2\0\0\0\0\0\0", 8);
+    data += std::string(6, '\x7F');
+    data += IldaFile::encode({lit(-1, 2), blank(3, -4)}, 0, 1, 2);
+    // End of file
+    data += IldaFile::encode({}, 5, 0, 0);
+    data += "trailing junk";
+
+    IldaFile file;
+    ASSERT_TRUE(file.load((const uint8_t*)data.data(), data.size()));
+    ASSERT_EQ(2u, file.frames());
+    EXPECT_EQ(5, file.frame(0).count);
+    EXPECT_EQ(5, file.frame(0).format);
+    EXPECT_EQ(2, file.frame(1).count);
+
+    IldaPoint point = IldaFile::point(file.frame(0), 0);
+    EXPECT_EQ(-1024, point.x);
+    EXPECT_EQ(-1024, point.y);
+    EXPECT_TRUE(point.blanked);
+    point = IldaFile::point(file.frame(1), 1);
+    EXPECT_EQ(3,  point.x);
+    EXPECT_EQ(-4, point.y);
+    EXPECT_TRUE(point.blanked);
+
+    // A frame cut short is dropped
+    EXPECT_FALSE(file.load((const uint8_t*)data.data(), 40));
+}
+
+TEST(IldaFile, mapped) {
+    char path[] = "/tmp/ilda_testXXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    std::string data = squareFrame(1, 0, 2) + squareFrame(4, 1, 2);
+    ASSERT_EQ((ssize_t)data.size(), write(fd, data.data(), data.size()));
+    close(fd);
+
+    IldaFile file;
+    ASSERT_TRUE(file.open(path));
+    EXPECT_EQ(2u, file.frames());
+    EXPECT_EQ(1024, IldaFile::point(file.frame(1), 1).x);
+    EXPECT_FALSE(IldaFile::point(file.frame(1), 1).blanked);
+    unlink(path);
+
+    EXPECT_FALSE(file.open(path));
+}
+
+TEST(IldaConverter, blanking) {
+    std::string data = IldaFile::encode({blank(-16384, 0), lit(0, 0), lit(16384, 0),  // Two lines
+                                         blank(0, 16384), lit(0, 16384),             // A dot
+                                         blank(16384, 16384), lit(16384, 16384),     // Dwell on the last point
+                                         lit(16384, 16384)}, 5, 0, 1);
+    IldaFile file;
+    ASSERT_TRUE(file.load((const uint8_t*)data.data(), data.size()));
+
+    FrameEncoder encoder;
+    IldaConverter converter;
+    EXPECT_EQ(4u, converter.convert(file.frame(0), &encoder));
+    const std::vector<std::string>& motions = encoder.motions();
+    ASSERT_EQ(4u, motions.size());
+    EXPECT_EQ("line -512 0 0 0\n",  motions[0]);
+    EXPECT_EQ("line 0 0 512 0\n",   motions[1]);
+    EXPECT_EQ("point 0 512\n",      motions[2]);
+    EXPECT_EQ("point 512 512\n",    motions[3]);
+}
+
+TEST(IldaConverter, scale) {
+    std::string data = IldaFile::encode({lit(-32768, -32768), blank(32767, 32767), lit(32767, 32767)}, 1, 0, 1);
+    IldaFile file;
+    ASSERT_TRUE(file.load((const uint8_t*)data.data(), data.size()));
+
+    // Corner to corner of a window from 0 to 4096. Widths round up to a power of two
+    IldaScale scale;
+    scale.width    = 3000;
+    scale.centered = false;
+    EXPECT_EQ("scale 3000 3000 0 0\n", scale.command());
+    FrameEncoder encoder;
+    IldaConverter(scale).convert(file.frame(0), &encoder);
+    ASSERT_EQ(2u, encoder.motions().size());
+    EXPECT_EQ("point 0 0\n",       encoder.motions()[0]);
+    EXPECT_EQ("point 4095 4095\n", encoder.motions()[1]);
+}
+
+TEST(IldaPlayer, keepsUp) {
+    std::string data;
+    for (int i = 0; i < 10; i++) data += squareFrame(5, i, 10);
+    IldaFile file;
+    ASSERT_TRUE(file.load((const uint8_t*)data.data(), data.size()));
+
+    SimDevice device;
+    SimClock clock(&device);
+    LoopbackTransport loopback(&device);
+    VectorClient client(&loopback);
+    ASSERT_TRUE(client.handshake());
+    IldaPlayer player(&client, &clock);
+    PlayOptions options;
+    options.fps = 30;
+    ASSERT_TRUE(player.play(file, options));
+
+    EXPECT_EQ(10u, player.stats().frames);
+    EXPECT_EQ(0u,  player.stats().dropped);
+    EXPECT_EQ(40u, player.stats().motions);
+    EXPECT_EQ(41u, client.stats().acked);
+    EXPECT_EQ(11, device.screen().x_size_pow);
+    // Nine frame periods, then the last frame goes out
+    EXPECT_GE(player.stats().micros, 300000u);
+    EXPECT_LT(player.stats().micros, 340000u);
+}
+
+TEST(IldaPlayer, dropsFrames) {
+    // Short lines so the link is what can't keep up
+    std::vector<IldaPoint> points;
+    for (int i = 0; i < 60; i++) {
+        points.push_back(blank(i * 500, 0));
+        points.push_back(lit(i * 500 + 100, 100));
+    }
+    std::string data;
+    for (int i = 0; i < 20; i++) data += IldaFile::encode(points, 5, i, 20);
+    IldaFile file;
+    ASSERT_TRUE(file.load((const uint8_t*)data.data(), data.size()));
+
+    SimDevice device(256, 40, 9600);
+    SimClock clock(&device);
+    LoopbackTransport loopback(&device);
+    ClientOptions client_options;
+    client_options.timeout_ms = 5000;
+    VectorClient client(&loopback, client_options);
+    ASSERT_TRUE(client.handshake());
+    IldaPlayer player(&client, &clock);
+    PlayOptions options;
+    options.fps = 30;
+    ASSERT_TRUE(player.play(file, options));
+
+    EXPECT_GT(player.stats().dropped, 0u);
+    EXPECT_EQ(20u, player.stats().frames + player.stats().dropped);
+    EXPECT_EQ(60u * player.stats().frames, player.stats().motions);
+}
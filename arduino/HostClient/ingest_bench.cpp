@@ -0,0 +1,164 @@
+// ingest_bench.cpp
+// How fast the device code spins with nothing to do, and how fast it takes in commands, against copying them out
+// Runs the sketch's checkForCommand steps on the device code built for this host, not an AVR
+// make bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "host_client.h"
+
+extern "C" {
+#include "command_parser.h"
+#include "device_core.h"
+#include "ring_mem_pool.h"
+#include "sample_cache.h"
+#include "screen_controller.h"
+}
+
+#define IDLE_LOOPS    20000000
+#define STREAM_ROUNDS 20000
+#define SERIAL_CHUNK  64 // What the sketch reads in one loop
+
+static char pool_mem[8192];
+static DacSample samples[64];
+static RingMemPool pool;
+static ScreenState screen;
+static SampleCache cache;
+static DeviceCore core;
+
+static void setup(bool binary) {
+    ring_init(&pool, pool_mem, sizeof(pool_mem));
+    screen_init(&screen);
+    screen.x_size_pow = 11;
+    screen.y_size_pow = 11;
+    screen.x_centered = true;
+    screen.y_centered = true;
+    cache_init(&cache, samples, 64, 10);
+    device_init(&core, &screen, &pool, &cache);
+    clearCache();
+    cmdSetBinary(binary);
+}
+
+// One pass of checkForCommand. Returns the commands answered
+static uint32_t checkForCommand(const char* data, uint8_t len) {
+    if (len > 0 || core.link.enabled) {
+        // Off the UART a byte at a time
+        char chunk[SERIAL_CHUNK];
+        for (uint8_t i = 0; i < len; i++) chunk[i] = data[i];
+        device_receive(&core, chunk, len);
+    }
+
+    uint8_t seq;
+    while (device_resend(&core, &seq)) {}
+
+    uint32_t answered = 0;
+    CommandResult result;
+    do {
+        if (!device_next(&core, &result)) break;
+        answered++;
+    } while (result.batched && !result.batch_end);
+    return answered;
+}
+
+// Where the baseline copies to. Not static, so the copies can't be left out
+char loop_buf[CMD_BUF_SIZE];
+char copy_buf[CMD_BUF_SIZE];
+
+// checkForCommand as it was before commands were taken in place, for a baseline
+// Every loop cleared a command sized buffer, read into it, and built from it, even with nothing arriving
+// device_next cleared another on every call, and each command was copied out into it
+// The parser no longer shifts its buffer once per command, so this is still a little faster than it was
+static uint32_t checkForCommandCopy(const char* data, uint8_t len) {
+    memset(loop_buf, '\0', CMD_BUF_SIZE);
+    for (uint8_t i = 0; i < len; i++) loop_buf[i] = data[i];
+    device_receive(&core, loop_buf, len);
+
+    uint8_t seq;
+    while (device_resend(&core, &seq)) {}
+
+    uint32_t answered = 0;
+    CommandResult result;
+    do {
+        memset(copy_buf, '\0', CMD_BUF_SIZE);
+        uint8_t size = commandSize();
+        if (!device_next(&core, &result)) break;
+        // Only what it costs matters here, records don't keep where they were read from
+        memcpy(copy_buf, loop_buf, size);
+        answered++;
+    } while (result.batched && !result.batch_end);
+    return answered;
+}
+
+typedef uint32_t (*CheckFn)(const char* data, uint8_t len);
+
+// Loops a second with nothing arriving. A partial line waits for the rest of it
+static void idle(const char* name, const std::string& waiting, CheckFn check) {
+    setup(false);
+    buildCmd(waiting.data(), waiting.size());
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint32_t answered = 0;
+    for (uint32_t i = 0; i < IDLE_LOOPS; i++) answered += check(NULL, 0);
+    double took = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("idle %-26s | %7.2f M loops/s%s\n", name, IDLE_LOOPS / took / 1e6, (answered) ? " (answered some)" : "");
+}
+
+// Bytes a second taken in, a serial buffer at a time, with the pool emptied after each round
+static void stream(const char* name, const std::string& frame, bool binary, CheckFn check) {
+    setup(binary);
+    uint64_t answered = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int round = 0; round < STREAM_ROUNDS; round++) {
+        for (size_t pos = 0; pos < frame.size(); pos += SERIAL_CHUNK) {
+            size_t len = std::min((size_t)SERIAL_CHUNK, frame.size() - pos);
+            answered += check(frame.data() + pos, len);
+        }
+        // What's left of the buffer, like loops with nothing arriving
+        uint32_t more;
+        while ((more = check(NULL, 0)) > 0) answered += more;
+        ring_reset(&pool);
+    }
+    double took = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("stream %-24s | %7.2f MB/s | %6.2f M commands/s\n", name, frame.size() * STREAM_ROUNDS / took / 1e6,
+           answered / took / 1e6);
+}
+
+int main(void) {
+    printf("Host CPU, not AVR\n");
+    idle("empty", "", checkForCommand);
+    idle("empty, copy out", "", checkForCommandCopy);
+    idle("partial line", "line 100 200 300", checkForCommand);
+    idle("partial line, copy out", "line 100 200 300", checkForCommandCopy);
+
+    srand(3);
+    FrameEncoder text;
+    FrameEncoder binary(ENCODE_BINARY);
+    for (int i = 0; i < 100; i++) {
+        int16_t x = rand() % 1600 - 800;
+        int16_t y = rand() % 1600 - 800;
+        text.addLine(x, y, x + rand() % 64 - 32, y + rand() % 64 - 32);
+        binary.addPolyline({x, y, (int16_t)(x + 20), y, (int16_t)(x + 20), (int16_t)(y + 20)}, true);
+    }
+    std::string lines;
+    std::string records;
+    for (size_t i = 0; i < text.motions().size(); i++) lines += text.motions()[i];
+    for (size_t i = 0; i < binary.motions().size(); i++) records += binary.motions()[i];
+    // Four commands a line
+    std::string batches = lines;
+    int ends = 0;
+    for (size_t i = 0; i < batches.size(); i++) {
+        if (batches[i] == '\n' && ++ends % 4 != 0) batches[i] = ';';
+    }
+    stream("text lines", lines, false, checkForCommand);
+    stream("text lines, copy out", lines, false, checkForCommandCopy);
+    stream("text batches", batches, false, checkForCommand);
+    stream("text batches, copy out", batches, false, checkForCommandCopy);
+    stream("binary records", records, true, checkForCommand);
+    stream("binary records, copy out", records, true, checkForCommandCopy);
+    return 0;
+}
@@ -0,0 +1,155 @@
+// lz_bench.cpp
+// How much packing shrinks binary frames, and what unpacking costs the device code
+// Times are for the device code built for this host, not an AVR. Compare them to the plain records, not to the wire
+// make bench
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "host_client.h"
+
+extern "C" {
+#include "command_parser.h"
+#include "device_core.h"
+#include "ring_mem_pool.h"
+#include "sample_cache.h"
+#include "screen_controller.h"
+}
+
+#define DECODE_ROUNDS 2000
+
+// Seven segment glyph, segments a to g
+static void addDigit(FrameEncoder* frame, int digit, int16_t x, int16_t y) {
+    static const uint8_t segments[10] = {0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07, 0x7F, 0x6F};
+    static const int16_t ends[7][4] = {
+        {0, 40, 20, 40}, {20, 40, 20, 20}, {20, 20, 20, 0}, {20, 0, 0, 0},
+        {0, 0, 0, 20}, {0, 20, 0, 40}, {0, 20, 20, 20},
+    };
+    for (int i = 0; i < 7; i++) {
+        if (!(segments[digit] & (1 << i))) continue;
+        frame->addLine(x + ends[i][0], y + ends[i][1], x + ends[i][2], y + ends[i][3]);
+    }
+}
+
+static FrameEncoder digits() {
+    FrameEncoder frame(ENCODE_BINARY);
+    for (int i = 0; i < 10; i++) addDigit(&frame, i, -400 + i * 30, 300);
+    return frame;
+}
+
+static FrameEncoder text() {
+    FrameEncoder frame(ENCODE_BINARY);
+    srand(5);
+    for (int row = 0; row < 4; row++) {
+        for (int col = 0; col < 16; col++) addDigit(&frame, rand() % 10, -400 + col * 30, 300 - row * 60);
+    }
+    return frame;
+}
+
+static FrameEncoder stars() {
+    FrameEncoder frame(ENCODE_BINARY);
+    for (int i = 0; i < 12; i++) {
+        std::vector<int16_t> xy;
+        int16_t r = 40 + 10 * (i % 3);
+        for (int p = 0; p < 5; p++) {
+            xy.push_back(-500 + i * 80 + r * sin(p * 4 * M_PI / 5));
+            xy.push_back(r * cos(p * 4 * M_PI / 5));
+        }
+        frame.addPolyline(xy, true);
+    }
+    return frame;
+}
+
+static FrameEncoder squares() {
+    FrameEncoder frame(ENCODE_BINARY);
+    for (int i = 0; i < 48; i++) {
+        int16_t x = -480 + (i % 8) * 120;
+        int16_t y = -300 + (i / 8) * 100;
+        frame.addPolyline({x, y, (int16_t)(x + 60), y, (int16_t)(x + 60), (int16_t)(y + 60), x, (int16_t)(y + 60)}, true);
+    }
+    return frame;
+}
+
+static FrameEncoder scattered() {
+    FrameEncoder frame(ENCODE_BINARY);
+    srand(3);
+    for (int i = 0; i < 100; i++) {
+        int16_t x = rand() % 1600 - 800;
+        int16_t y = rand() % 1600 - 800;
+        frame.addLine(x, y, x + rand() % 64 - 32, y + rand() % 64 - 32);
+    }
+    return frame;
+}
+
+static size_t totalBytes(const std::vector<std::string>& commands) {
+    size_t total = 0;
+    for (size_t i = 0; i < commands.size(); i++) total += commands[i].size();
+    return total;
+}
+
+// Seconds to run the commands through the device code, with the pool emptied after each round
+static double decode(const std::vector<std::string>& commands, size_t* taken) {
+    static char pool_mem[8192];
+    static DacSample samples[64];
+    RingMemPool pool;
+    ScreenState screen;
+    SampleCache cache;
+    DeviceCore core;
+    CommandResult result;
+    ring_init(&pool, pool_mem, sizeof(pool_mem));
+    screen_init(&screen);
+    screen.x_size_pow = 11;
+    screen.y_size_pow = 11;
+    screen.x_centered = true;
+    screen.y_centered = true;
+    cache_init(&cache, samples, 64, 10);
+    device_init(&core, &screen, &pool, &cache);
+    clearCache();
+    cmdSetBinary(true);
+
+    *taken = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int round = 0; round < DECODE_ROUNDS; round++) {
+        for (size_t i = 0; i < commands.size(); i++) {
+            buildCmd(commands[i].data(), commands[i].size());
+            while (device_next(&core, &result)) *taken += device_acked(&result);
+        }
+        ring_reset(&pool);
+    }
+    double took = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cmdSetBinary(false);
+    return took;
+}
+
+static void bench(const char* name, const FrameEncoder& frame) {
+    std::vector<std::string> packed = frame.packedMotions();
+    size_t raw_bytes    = frame.bytes();
+    size_t packed_bytes = totalBytes(packed);
+
+    size_t raw_taken;
+    size_t packed_taken;
+    double raw_time    = decode(frame.motions(), &raw_taken);
+    double packed_time = decode(packed, &packed_taken);
+    // Per KB of records, so both are timed over the same work
+    double kb = raw_bytes * DECODE_ROUNDS / 1024.0;
+    printf("%-9s %4zu records %5zu bytes -> %4zu packed in %3zu | %5.1f%% | plain %6.1f us/KB, packed %6.1f us/KB%s\n",
+           name, frame.motions().size(), raw_bytes, packed_bytes, packed.size(), 100.0 * packed_bytes / raw_bytes,
+           raw_time * 1e6 / kb, packed_time * 1e6 / kb,
+           (raw_taken == frame.motions().size() * DECODE_ROUNDS && packed_taken == packed.size() * DECODE_ROUNDS)
+           ? "" : " (some refused)");
+}
+
+int main(void) {
+    printf("Packed size as a share of the binary records. Decode times are host CPU, not AVR\n");
+    bench("digits", digits());
+    bench("text", text());
+    bench("stars", stars());
+    bench("squares", squares());
+    bench("scattered", scattered());
+    return 0;
+}
@@ -0,0 +1,270 @@
+// pty_bench.cpp
+// End to end latency and throughput of the streaming protocol
+// The device core runs in real time behind a pty at a simulated baud rate, and the client talks to it as a serial port
+// Latency is from the first byte of a command being written to its motion starting in update_screen
+// Each rate after the first is reached with "set baud", the way a real port would be moved
+// A pty ignores its rate, so it's the simulated device that keeps to it
+// make bench, or ./ptybench [baud...]
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "host_client.h"
+#include "sim_device.h"
+
+#define FRAME_REPEATS 20
+#define SINGLE_COUNT  100
+#define MAX_STARTS    100000
+#define DRAW_WAIT_US  2000000 // Longest wait for another motion to be drawn before counting the rest lost
+#define POOL_FILL     64      // Bytes let ahead in the pool. A few lines: enough to keep it drawing, little to wait behind
+
+typedef std::chrono::steady_clock Clock;
+
+static Clock::time_point epoch;
+
+static uint32_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - epoch).count();
+}
+
+// Notes when each command goes out, and keeps the times of the motions the device took
+// Replies come back in the order the commands were written
+class TimedTransport: public Transport {
+public:
+    TimedTransport(Transport* inner): inner(inner) {}
+    bool write(const char* data, size_t len) {
+        // The client's own commands, like "set hold", draw nothing
+        // Those on the priority lane, like "!pool", are answered out of turn and marked
+        bool motion = (len > 5 && strncmp(data, "line ", 5) == 0);
+        if (len > 0 && data[0] != CMD_PRIO_PREFIX) this->written.push_back(std::make_pair(nowMicros(), motion));
+        return this->inner->write(data, len);
+    }
+    size_t read(char* buf, size_t len, int timeout_ms) {
+        size_t count = this->inner->read(buf, len, timeout_ms);
+        for (size_t i = 0; i < count; i++) {
+            if (buf[i] != '\n') {
+                this->line += buf[i];
+                continue;
+            }
+            if ((this->line == "ACK" || this->line == "NAK") && !this->written.empty()) {
+                if (this->line == "ACK" && this->written.front().second) this->sent.push_back(this->written.front().first);
+                this->written.pop_front();
+            }
+            this->line.clear();
+        }
+        return count;
+    }
+
+    std::vector<uint32_t> sent; // Write times of the accepted commands
+
+private:
+    Transport* inner;
+    std::deque<std::pair<uint32_t, bool> > written; // Time, and whether it was a motion
+    std::string line;
+};
+
+// The device end of the pty
+// Simulated time is kept level with the wall clock, and every motion start is recorded
+class PtyDevice {
+public:
+    PtyDevice(int fd, uint32_t baud): fd(fd), sim(256, 40, baud), start_times(MAX_STARTS), started(0), running(true) {}
+
+    void run() {
+        char buf[256];
+        while (this->running) {
+            ssize_t count = ::read(this->fd, buf, sizeof(buf));
+            if (count > 0) this->sim.receive(buf, count);
+
+            uint32_t wall = nowMicros();
+            while ((int32_t)(wall - this->sim.now()) > 0) {
+                this->sim.run(1);
+                this->noteStarts();
+            }
+
+            std::string out = this->sim.takeOutput();
+            if (!out.empty() && ::write(this->fd, out.data(), out.size()) < 0) break;
+            usleep(50);
+        }
+    }
+
+    void stop() { this->running = false; }
+
+    // Start times, in the order the motions were drawn
+    size_t starts() const { return this->started.load(std::memory_order_acquire); }
+    uint32_t start(size_t idx) const { return this->start_times[idx]; }
+
+private:
+    // Motions leave the pool once drawn, so those started are the ones popped plus the active one
+    // Several can start between checks. They get the time of the last, which is the latest they could have started
+    void noteStarts() {
+        size_t count = this->sim.pool().stats.pops + (this->sim.screen().motion_active ? 1 : 0);
+        size_t idx   = this->started.load(std::memory_order_relaxed);
+        for (; idx < count && idx < MAX_STARTS; idx++) {
+            this->start_times[idx] = this->sim.screen().motion_start;
+        }
+        this->started.store(idx, std::memory_order_release);
+    }
+
+    int fd;
+    SimDevice sim;
+    std::vector<uint32_t> start_times;
+    std::atomic<size_t> started;
+    std::atomic<bool> running;
+};
+
+static double percentile(std::vector<uint32_t> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t idx = std::min(values.size() - 1, (size_t)ceil(p * values.size()) - 1);
+    return values[idx] / 1000.0;
+}
+
+// Motions sent, taken by the device, and drawn are counted apart, so none go missing unseen
+// Latency pairs each motion taken with the one drawn in the same place, so it only means something with none lost
+static void report(const char* name, size_t motions, const TimedTransport& timed, size_t first_sent,
+                   const PtyDevice& device, size_t first_start, const ClientStats& stats, uint32_t elapsed) {
+    size_t acked = timed.sent.size() - first_sent;
+    size_t drawn = device.starts() - first_start;
+    bool lost    = (acked != motions || drawn != acked);
+    std::vector<uint32_t> latency;
+    for (size_t i = 0; !lost && i < drawn; i++) {
+        latency.push_back(device.start(first_start + i) - timed.sent[first_sent + i]);
+    }
+    printf("%-8s sent %5zu acked %5zu drawn %5zu | latency ms p50 %7.2f p99 %7.2f | %7.1f motions/s %8.1f bytes/s"
+           " | retried %u polled %u%s\n", name, motions, acked, drawn, percentile(latency, 0.5),
+           percentile(latency, 0.99), drawn * 1e6 / elapsed, stats.bytes * 1e6 / elapsed, stats.retried, stats.polls,
+           (lost) ? " | LOST" : "");
+}
+
+// Wait for the device to draw everything taken so far, or to stop drawing
+static void waitDrawn(const TimedTransport& timed, size_t first_sent, const PtyDevice& device, size_t first_start) {
+    size_t drawn = device.starts();
+    uint32_t last = nowMicros();
+    while (device.starts() - first_start < timed.sent.size() - first_sent && nowMicros() - last < DRAW_WAIT_US) {
+        usleep(100);
+        if (device.starts() != drawn) {
+            drawn = device.starts();
+            last  = nowMicros();
+        }
+    }
+}
+
+// Each command on its own, so nothing waits in the pool
+static void single(TimedTransport* timed, PtyDevice* device) {
+    VectorClient client(timed);
+    size_t first_sent  = timed->sent.size();
+    size_t first_start = device->starts();
+    uint32_t start = nowMicros();
+    for (int i = 0; i < SINGLE_COUNT; i++) {
+        client.send(FrameEncoder::line(-100, -100, -90, -90));
+        client.flush();
+        waitDrawn(*timed, first_sent, *device, first_start);
+    }
+    report("single", SINGLE_COUNT, *timed, first_sent, *device, first_start, client.stats(), nowMicros() - start);
+}
+
+// Frames back to back, as fast as the link allows
+// Sends are paced from the pool reports. Anything still refused is sent again
+static void stream(const char* name, const FrameEncoder& frame, TimedTransport* timed, PtyDevice* device) {
+    ClientOptions options;
+    options.retries = 255;
+    options.pool_fill = POOL_FILL;
+    VectorClient client(timed, options);
+    size_t first_sent  = timed->sent.size();
+    size_t first_start = device->starts();
+    uint32_t start = nowMicros();
+    for (int i = 0; i < FRAME_REPEATS; i++) {
+        client.sendAll(frame.motions());
+    }
+    client.flush();
+    waitDrawn(*timed, first_sent, *device, first_start);
+    report(name, frame.motions().size() * FRAME_REPEATS, *timed, first_sent, *device, first_start, client.stats(),
+           nowMicros() - start);
+}
+
+static void runAll(TimedTransport* timed, PtyDevice* device) {
+    single(timed, device);
+
+    // A square, edge to edge
+    FrameEncoder square;
+    square.addPolyline({-1000, -1000, 1000, -1000, 1000, 1000, -1000, 1000}, true);
+    stream("square", square, timed, device);
+
+    // A five point star
+    FrameEncoder star;
+    std::vector<int16_t> points;
+    for (int i = 0; i < 5; i++) {
+        double angle = M_PI / 2 + i * 4 * M_PI / 5;
+        points.push_back(500 * cos(angle));
+        points.push_back(500 * sin(angle));
+    }
+    star.addPolyline(points, true);
+    stream("star", star, timed, device);
+
+    // Text like strokes, short enough to be drawn faster than they arrive
+    FrameEncoder text;
+    srand(1);
+    for (int i = 0; i < 40; i++) {
+        int16_t x = rand() % 1600 - 800;
+        int16_t y = rand() % 1600 - 800;
+        text.addLine(x, y, x + rand() % 30, y + rand() % 30);
+    }
+    stream("text", text, timed, device);
+}
+
+int main(int argc, char** argv) {
+    std::vector<uint32_t> rates;
+    for (int i = 1; i < argc; i++) rates.push_back(atoi(argv[i]));
+    if (rates.empty()) rates = {115200, 230400, 500000, 1000000, 2000000};
+    epoch = Clock::now();
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("pty");
+        return 1;
+    }
+    fcntl(master, F_SETFL, O_NONBLOCK);
+    SerialTransport serial;
+    if (!serial.open(ptsname(master), rates[0])) {
+        perror("open");
+        return 1;
+    }
+
+    PtyDevice device(master, rates[0]);
+    std::thread device_thread(&PtyDevice::run, &device);
+    TimedTransport timed(&serial);
+    VectorClient setup(&timed);
+    if (!setup.handshake()) {
+        fprintf(stderr, "No answer from the device\n");
+        device.stop();
+        device_thread.join();
+        return 1;
+    }
+
+    for (uint32_t baud: rates) {
+        // Straight on the port, so the switch's own lines aren't taken for answers to timed commands
+        VectorClient control(&serial);
+        if (baud != serial.baud() && !control.setBaud(baud)) {
+            printf("%u baud refused, staying at %u\n", baud, serial.baud());
+            continue;
+        }
+        printf("%u baud\n", baud);
+        runAll(&timed, &device);
+    }
+
+    device.stop();
+    device_thread.join();
+    close(master);
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "sim_device.h"
+
+#define SIM_SAMPLE_LEN 128
+#define SIM_SAMPLE_PERIOD 20
+
+SimDevice::SimDevice(uint16_t pool_size, uint32_t loop_us, uint32_t baud):
+    motion_mem(pool_size),
+    sample_mem(SIM_SAMPLE_LEN),
+    time(0),
+    loop_us(loop_us),
+    baud(baud),
+    host_baud(0),
+    line_limit(UINT32_MAX),
+    rx_credit(0),
+    command_count(0)
+{
+    // Same start up as the sketch
+    clearCache();
+    cmdSetBinary(false);
+    screen_init(&this->main_screen);
+    ring_init(&this->motion_pool, this->motion_mem.data(), pool_size);
+    cache_init(&this->sample_cache, this->sample_mem.data(), SIM_SAMPLE_LEN, SIM_SAMPLE_PERIOD);
+    device_init(&this->device, &this->main_screen, &this->motion_pool, &this->sample_cache);
+    baud_init(&this->device.baud, baud, SIM_UART_CLOCK);
+    this->main_screen.x_size_pow = 11;
+    this->main_screen.y_size_pow = 11;
+    this->main_screen.x_centered = true;
+    this->main_screen.y_centered = true;
+    this->main_screen.speed      = 50;
+}
+
+// Both ends have to be at the same rate, and one the line can carry
+bool SimDevice::linkUp() const {
+    return (this->host_baud == 0 || this->host_baud == this->baud) && this->baud <= this->line_limit;
+}
+
+// Bytes sent at the wrong rate come out as junk, never as a line end
+static std::string garble(const char* data, size_t len) {
+    std::string junk(data, len);
+    for (size_t i = 0; i < len; i++) junk[i] ^= 0xA5;
+    return junk;
+}
+
+void SimDevice::receive(const char* data, size_t len) {
+    this->rx += (this->linkUp()) ? std::string(data, len) : garble(data, len);
+}
+
+void SimDevice::write(const std::string& text) {
+    this->tx += (this->linkUp()) ? text : garble(text.data(), text.size());
+}
+
+void SimDevice::run(uint32_t micros) {
+    uint32_t end = this->time + micros;
+    while ((int32_t)(end - this->time) > 0) {
+        this->loop();
+        this->time += this->loop_us;
+    }
+}
+
+std::string SimDevice::takeOutput() {
+    std::string out;
+    out.swap(this->tx);
+    return out;
+}
+
+void SimDevice::loop() {
+    DacSample sample;
+    device_update(&this->device, this->time, &sample);
+    this->serve();
+
+    // Like checkBaud in the sketch
+    switch (device_baud_event(&this->device)) {
+    case BAUD_SWITCH:
+    case BAUD_FALLBACK:
+        this->baud = this->device.baud.rate;
+        break;
+    case BAUD_ECHO:
+        this->write(BAUD_PROBE_LINE);
+        break;
+    case BAUD_COMMIT:
+        this->write("ACK\n");
+        break;
+    default:
+        break;
+    }
+}
+
+void SimDevice::serve() {
+    // Read what has arrived
+    size_t read_len = 0;
+    if (this->rx.empty()) {
+        this->rx_credit = 0;
+    }
+    else {
+        this->rx_credit += (uint64_t)this->baud * this->loop_us;
+        read_len = this->rx_credit / 10000000;
+        if (read_len > this->rx.size()) read_len = this->rx.size();
+        if (read_len > SIM_SERIAL_BUF) read_len = SIM_SERIAL_BUF;
+        this->rx_credit -= (uint64_t)read_len * 10000000;
+    }
+    err_t errcode = device_receive(&this->device, this->rx.data(), read_len);
+    this->rx.erase(0, read_len);
+    if (errcode) {
+        this->write(std::string("NAK: ") + cmdErrToText(errcode) + "\n");
+        return;
+    }
+    uint8_t seq;
+    while (device_resend(&this->device, &seq)) {
+        this->write("RESEND " + std::to_string(seq) + "\n");
+    }
+
+    // Commands sharing a line run back to back, like they do within the sketch's time budget
+    CommandResult result;
+    for (int i = 0; i < SIM_BATCH_CMDS; i++) {
+        if (!device_next(&this->device, &result)) return;
+        this->answer(result);
+        if (!result.batched || result.batch_end) return;
+    }
+}
+
+void SimDevice::answer(const CommandResult& result) {
+    if (result.err == CMD_ERR_CMD_NOOP && !result.batched) return;
+    if (result.err != CMD_ERR_CMD_NOOP) this->command_count++;
+
+    // Sketch flags are taken without doing anything. Pool reports come before their answer, like reportPool
+    bool acked = device_acked(&result) || (!result.err && !result.handled);
+    if (!result.err && result.cmd.base.type == Cmd_Pool) this->reportPool(result.cmd.pool.clear);
+    if (result.batched) {
+        if (device_batch_add(&this->device, &result, acked)) {
+            char reply[DEVICE_REPLY_SIZE];
+            device_batch_reply(&this->device, reply, sizeof(reply));
+            this->write(std::string(reply) + "\n");
+        }
+        return;
+    }
+    std::string text = (acked) ? "ACK\n" : "NAK\n";
+    this->write((result.priority) ? CMD_PRIO_PREFIX + text : text);
+}
+
+// Same fields as printPoolStats
+void SimDevice::reportPool(bool clear) {
+    RingStats stats;
+    ring_get_stats(&this->motion_pool, &stats);
+    char line[192];
+    snprintf(line, sizeof(line), "PoolStats size: %u used: %u entries: %u high_bytes: %u high_entries: %u"
+             " out_of_mem: %u wrap_waste: %u pushes: %u pops: %u\n", this->motion_pool.size, stats.used,
+             this->motion_pool.count, stats.high_bytes, stats.high_entries, stats.out_of_mem, stats.wrap_waste,
+             stats.pushes, stats.pops);
+    this->write(line);
+    if (clear) ring_clear_stats(&this->motion_pool);
+}
+
+LoopbackTransport::LoopbackTransport(SimDevice* device): device(device), rate(device->rate()) {}
+
+bool LoopbackTransport::setBaud(uint32_t baud) {
+    this->rate = baud;
+    this->device->setHostBaud(baud);
+    return true;
+}
+
+bool LoopbackTransport::write(const char* data, size_t len) {
+    this->device->receive(data, len);
+    return true;
+}
+
+size_t LoopbackTransport::read(char* buf, size_t len, int timeout_ms) {
+    uint32_t waited = 0;
+    while (this->out.empty() && waited <= (uint32_t)timeout_ms * 1000) {
+        this->device->run(100);
+        waited += 100;
+        this->out += this->device->takeOutput();
+    }
+    size_t count = (this->out.size() < len) ? this->out.size() : len;
+    memcpy(buf, this->out.data(), count);
+    this->out.erase(0, count);
+    return count;
+}
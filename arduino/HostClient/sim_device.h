@@ -0,0 +1,88 @@
+// SimDevice
+// The device core run on the host, answering like the sketch does with the prompt off
+// Time is simulated. Each pass of the loop takes loop_us microseconds
+// Bytes arrive no faster than the baud rate allows, 10 bits to a byte
+// The command parser keeps its buffers in globals, so only one can exist at a time
+
+#ifndef SIM_DEVICE_H
+#define SIM_DEVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "host_client.h"
+
+extern "C" {
+#include "device_core.h"
+}
+
+#define SIM_SERIAL_BUF 64 // Bytes the serial driver hands over per pass, like Serial.available()
+#define SIM_BATCH_CMDS 8  // Batched commands run in one pass, standing in for the sketch's time budget
+#define SIM_UART_CLOCK 16000000 // Like a 16 MHz AVR, for the rates "set baud" takes
+
+class SimDevice {
+public:
+    SimDevice(uint16_t pool_size = 256, uint32_t loop_us = 40, uint32_t baud = 115200);
+
+    // Bytes arriving on the serial port. Junk unless the host is at the device's rate
+    void receive(const char* data, size_t len);
+    // Rate the host is sending and listening at. Zero follows the device
+    void setHostBaud(uint32_t baud) { this->host_baud = baud; }
+    // Fastest rate the cable carries. Anything above comes out as junk both ways
+    void setLineLimit(uint32_t baud) { this->line_limit = baud; }
+    // Run the loop for a while
+    void run(uint32_t micros);
+    std::string takeOutput();
+
+    uint32_t now() const { return this->time; }
+    uint32_t rate() const { return this->baud; }
+    uint32_t commands() const { return this->command_count; }
+    const ScreenState& screen() const { return this->main_screen; }
+    const RingMemPool& pool() const { return this->motion_pool; }
+    const DeviceCore& core() const { return this->device; }
+
+private:
+    void loop();
+    void serve();
+    void answer(const CommandResult& result);
+    void reportPool(bool clear);
+    bool linkUp() const;
+    void write(const std::string& text);
+
+    std::vector<char> motion_mem;
+    std::vector<DacSample> sample_mem;
+    RingMemPool motion_pool;
+    ScreenState main_screen;
+    SampleCache sample_cache;
+    DeviceCore device;
+    std::string rx;
+    std::string tx;
+    uint32_t time;
+    uint32_t loop_us;
+    uint32_t baud;       // Of the device's UART
+    uint32_t host_baud;
+    uint32_t line_limit;
+    uint64_t rx_credit; // Bit microseconds not yet spent on a byte
+    uint32_t command_count;
+};
+
+// Connects a client straight to a simulated device
+// Reads run the device until it answers or the timeout passes in simulated time
+class LoopbackTransport: public Transport {
+public:
+    LoopbackTransport(SimDevice* device);
+    bool write(const char* data, size_t len);
+    size_t read(char* buf, size_t len, int timeout_ms);
+    bool setBaud(uint32_t baud);
+    uint32_t baud() const { return this->rate; }
+
+private:
+    SimDevice* device;
+    std::string out;
+    uint32_t rate;
+};
+
+#endif // SIM_DEVICE_H
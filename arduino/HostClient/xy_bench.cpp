@@ -0,0 +1,53 @@
+// xy_bench.cpp
+// How much faster than real time the XY backend renders
+// make bench
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <vector>
+
+#include "host_client.h"
+#include "xy_render.h"
+
+#define AUDIO_SECONDS 10
+#define BLOCK_FRAMES  4096
+
+// Streamed short lines, then a looping sequence
+static void bench(uint32_t rate, bool sequence) {
+    XyRenderer renderer(rate);
+    FrameEncoder frame;
+    if (sequence) {
+        frame.addPolyline({0, 900, 530, -730, -860, 280, 860, 280, -530, -730}, true);
+        std::vector<std::string> commands = frame.sequence();
+        for (size_t i = 0; i < commands.size(); i++) renderer.queue(commands[i]);
+    }
+    else {
+        srand(3);
+        for (int i = 0; i < 5000; i++) {
+            int16_t x = rand() % 1600 - 800;
+            int16_t y = rand() % 1600 - 800;
+            frame.addLine(x, y, x + rand() % 64 - 32, y + rand() % 64 - 32);
+        }
+        for (size_t i = 0; i < frame.motions().size(); i++) renderer.queue(frame.motions()[i]);
+    }
+
+    std::vector<int16_t> block(2 * BLOCK_FRAMES);
+    uint64_t total = (uint64_t)AUDIO_SECONDS * rate;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (renderer.samples() < total) renderer.render(block.data(), BLOCK_FRAMES);
+    double took = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%6u Hz %-8s | %5.0fx real time | %6.1f ns per sample\n", rate, (sequence) ? "sequence" : "stream",
+           AUDIO_SECONDS / took, took * 1e9 / renderer.samples());
+}
+
+int main(void) {
+    printf("%d s of audio each\n", AUDIO_SECONDS);
+    uint32_t rates[] = {48000, 96000, 192000};
+    for (int i = 0; i < 3; i++) {
+        bench(rates[i], false);
+        bench(rates[i], true);
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include <string.h>
+
+#include "xy_render.h"
+
+extern "C" {
+#include "utils.h"
+}
+
+#define XY_SAMPLE_LEN 4 // The sample cache isn't used, but the core needs one
+
+// Renderer
+
+XyRenderer::XyRenderer(uint32_t rate, uint16_t pool_size):
+    motion_mem(pool_size),
+    sample_mem(XY_SAMPLE_LEN),
+    sample_rate(rate),
+    sample_count(0),
+    blocked_pops(0),
+    blocked(false),
+    rejected_count(0)
+{
+    // Same start up as the sketch
+    clearCache();
+    screen_init(&this->main_screen);
+    ring_init(&this->motion_pool, this->motion_mem.data(), pool_size);
+    cache_init(&this->sample_cache, this->sample_mem.data(), XY_SAMPLE_LEN, 20);
+    device_init(&this->device, &this->main_screen, &this->motion_pool, &this->sample_cache);
+    this->main_screen.x_size_pow = 11;
+    this->main_screen.y_size_pow = 11;
+    this->main_screen.x_centered = true;
+    this->main_screen.y_centered = true;
+    this->main_screen.speed      = 50;
+}
+
+void XyRenderer::queue(const std::string& command) {
+    std::string line = command;
+    if (line.empty() || line[line.size() - 1] != '\n') line += '\n';
+    this->commands.push_back(line);
+}
+
+bool XyRenderer::idle() const {
+    return this->commands.empty() && this->motion_pool.count == 0 && !this->main_screen.sequence_enabled;
+}
+
+static inline bool motionCommand(CommandType type) {
+    return (type == Cmd_Point || type == Cmd_Line || type == Cmd_Curve || type == Cmd_Arc || type == Cmd_RLine);
+}
+
+// Run queued commands until a motion doesn't fit
+void XyRenderer::feed() {
+    if (this->blocked && this->motion_pool.stats.pops == this->blocked_pops) return;
+    this->blocked = false;
+
+    while (!this->commands.empty()) {
+        const std::string& line = this->commands.front();
+        if (line.size() >= CMD_BUF_SIZE || buildCmd(line.data(), line.size()) != CMD_OK) {
+            clearCache();
+            this->commands.pop_front();
+            this->rejected_count++;
+            continue;
+        }
+        CommandResult result;
+        if (!device_next(&this->device, &result)) {
+            clearCache();
+            this->commands.pop_front();
+            continue;
+        }
+
+        // Wait for the pool to drain a little, then try it again
+        if (!result.err && motionCommand(result.cmd.base.type) && this->motion_pool.last_err == RING_OUT_OF_MEM) {
+            this->blocked      = true;
+            this->blocked_pops = this->motion_pool.stats.pops;
+            return;
+        }
+        // Sketch flags aren't handled, and don't matter here
+        if ((result.err && result.err != CMD_ERR_CMD_NOOP) || (!result.err && result.handled && !device_acked(&result))) {
+            this->rejected_count++;
+        }
+        this->commands.pop_front();
+    }
+}
+
+void XyRenderer::render(int16_t* out, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        if (!this->commands.empty()) this->feed();
+        uint32_t time = this->sample_count * 1000000 / this->sample_rate;
+        update_screen(time, &this->main_screen, &this->motion_pool);
+        this->sample_count++;
+
+        // Dipole words are signed
+        out[2 * i]     = (int16_t)position_to_binary(this->main_screen.beam.x, this->main_screen.x_size_pow,
+                                                     DAC_BIT_WIDTH, true);
+        out[2 * i + 1] = (int16_t)position_to_binary(this->main_screen.beam.y, this->main_screen.y_size_pow,
+                                                     DAC_BIT_WIDTH, true);
+    }
+}
+
+// WAV
+
+static void putLE16(uint8_t* buf, uint16_t value) {
+    buf[0] = value & 0xFF;
+    buf[1] = value >> 8;
+}
+
+static void putLE32(uint8_t* buf, uint32_t value) {
+    putLE16(buf, value & 0xFFFF);
+    putLE16(buf + 2, value >> 16);
+}
+
+static void wavHeader(uint8_t* header, uint32_t rate, uint32_t data_bytes) {
+    memcpy(header, "RIFF", 4);
+    putLE32(header + 4, 36 + data_bytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    putLE32(header + 16, 16);       // Format chunk size
+    putLE16(header + 20, 1);        // PCM
+    putLE16(header + 22, 2);        // Channels
+    putLE32(header + 24, rate);
+    putLE32(header + 28, rate * 4); // Bytes per second
+    putLE16(header + 32, 4);        // Bytes per frame
+    putLE16(header + 34, 16);       // Bits per sample
+    memcpy(header + 36, "data", 4);
+    putLE32(header + 40, data_bytes);
+}
+
+WavWriter::WavWriter(uint32_t rate): out(NULL), raw(false), rate(rate), data_bytes(0) {}
+
+WavWriter::~WavWriter() {
+    this->close();
+}
+
+bool WavWriter::open(const char* path) {
+    this->close();
+    this->data_bytes = 0;
+    this->raw = (strcmp(path, "-") == 0);
+    if (this->raw) {
+        this->out = stdout;
+        return true;
+    }
+    this->out = fopen(path, "wb");
+    if (this->out == NULL) return false;
+    // Sizes are filled in on close
+    uint8_t header[44];
+    wavHeader(header, this->rate, 0);
+    return fwrite(header, 1, sizeof(header), this->out) == sizeof(header);
+}
+
+bool WavWriter::write(const int16_t* samples, size_t frames) {
+    // PCM is little endian, like the hosts this runs on
+    size_t bytes = frames * 4;
+    this->data_bytes += bytes;
+    return fwrite(samples, 1, bytes, this->out) == bytes;
+}
+
+bool WavWriter::close() {
+    if (this->out == NULL) return true;
+    bool ok = true;
+    if (this->raw) {
+        ok = (fflush(this->out) == 0);
+    }
+    else {
+        uint8_t header[44];
+        uint32_t data_bytes = (this->data_bytes > 0xFFFFFFFFull - 36) ? 0xFFFFFFFFu - 36 : this->data_bytes;
+        wavHeader(header, this->rate, data_bytes);
+        ok = (fseek(this->out, 0, SEEK_SET) == 0 && fwrite(header, 1, sizeof(header), this->out) == sizeof(header));
+        ok = (fclose(this->out) == 0) && ok;
+    }
+    this->out = NULL;
+    return ok;
+}
@@ -0,0 +1,74 @@
+// XyRenderer
+// Runs the motion engine against a virtual clock at audio rates, for oscilloscopes in XY mode
+// Each sample is the beam position as the DAC would get it, left channel x and right channel y
+// The command parser keeps its buffers in globals, so this can't be used alongside a SimDevice
+
+#ifndef XY_RENDER_H
+#define XY_RENDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "device_core.h"
+}
+
+class XyRenderer {
+public:
+    XyRenderer(uint32_t rate, uint16_t pool_size = 256);
+
+    // Commands go in as the pool has room for them, like a host streaming them
+    void queue(const std::string& command);
+    // Fills frames stereo samples, interleaved
+    void render(int16_t* out, size_t frames);
+    // Nothing left to send or draw
+    bool idle() const;
+
+    uint32_t rate() const { return this->sample_rate; }
+    uint64_t samples() const { return this->sample_count; }
+    uint32_t rejected() const { return this->rejected_count; }
+    const ScreenState& screen() const { return this->main_screen; }
+    const RingMemPool& pool() const { return this->motion_pool; }
+
+private:
+    void feed();
+
+    std::vector<char> motion_mem;
+    std::vector<DacSample> sample_mem;
+    RingMemPool motion_pool;
+    ScreenState main_screen;
+    SampleCache sample_cache;
+    DeviceCore device;
+    std::deque<std::string> commands;
+    uint32_t sample_rate;
+    uint64_t sample_count;
+    uint32_t blocked_pops;   // Pool pops when a motion last didn't fit
+    bool blocked;
+    uint32_t rejected_count; // Commands the device refused
+};
+
+// 16 bit stereo PCM, as a WAV file or raw to stdout
+class WavWriter {
+public:
+    WavWriter(uint32_t rate);
+    ~WavWriter();
+
+    // "-" writes raw samples to stdout
+    bool open(const char* path);
+    bool write(const int16_t* samples, size_t frames);
+    // Fills in the sizes in the header
+    bool close();
+
+private:
+    FILE* out;
+    bool raw;
+    uint32_t rate;
+    uint64_t data_bytes;
+};
+
+#endif // XY_RENDER_H
@@ -0,0 +1,111 @@
+// xy_render_main.cpp
+// Renders drawing commands or an ILDA show as stereo audio for a scope in XY mode
+// ./xyrender [-r rate] [-s seconds] [-o out.wav] [input]
+// Input is command lines, or an .ild show. Without one, commands are read from stdin
+// Output is a WAV file, or raw 16 bit little endian samples to stdout with -o -
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "ilda_player.h"
+#include "xy_render.h"
+
+#define BLOCK_FRAMES 4096
+
+static bool endsWith(const char* text, const char* suffix) {
+    size_t len = strlen(text);
+    size_t end = strlen(suffix);
+    return len >= end && strcasecmp(text + len - end, suffix) == 0;
+}
+
+static bool queueCommands(FILE* in, XyRenderer* renderer) {
+    char line[256];
+    while (fgets(line, sizeof(line), in) != NULL) {
+        renderer->queue(line);
+    }
+    return !ferror(in);
+}
+
+// Each frame is drawn once, as the player streams it
+static bool queueShow(const char* path, XyRenderer* renderer) {
+    IldaFile file;
+    if (!file.open(path)) return false;
+    IldaScale scale;
+    IldaConverter converter(scale);
+    FrameEncoder encoder;
+    renderer->queue(scale.command());
+    for (size_t i = 0; i < file.frames(); i++) {
+        converter.convert(file.frame(i), &encoder);
+    }
+    for (size_t i = 0; i < encoder.motions().size(); i++) {
+        renderer->queue(encoder.motions()[i]);
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    uint32_t rate   = 48000;
+    double seconds  = 0;
+    const char* out = "xy.wav";
+    int opt;
+    while ((opt = getopt(argc, argv, "r:s:o:")) != -1) {
+        switch (opt) {
+        case 'r': rate    = atoi(optarg); break;
+        case 's': seconds = atof(optarg); break;
+        case 'o': out     = optarg;       break;
+        default:
+            fprintf(stderr, "Usage: %s [-r rate] [-s seconds] [-o out.wav|-] [commands.txt|show.ild]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (rate == 0) {
+        fprintf(stderr, "Bad sample rate\n");
+        return 1;
+    }
+
+    XyRenderer renderer(rate);
+    const char* input = (optind < argc) ? argv[optind] : NULL;
+    bool loaded;
+    if (input != NULL && endsWith(input, ".ild")) {
+        loaded = queueShow(input, &renderer);
+    }
+    else {
+        FILE* in = (input != NULL) ? fopen(input, "r") : stdin;
+        loaded = (in != NULL) && queueCommands(in, &renderer);
+        if (in != NULL && in != stdin) fclose(in);
+    }
+    if (!loaded) {
+        fprintf(stderr, "Can't read %s\n", (input != NULL) ? input : "stdin");
+        return 1;
+    }
+
+    WavWriter writer(rate);
+    if (!writer.open(out)) {
+        perror(out);
+        return 1;
+    }
+
+    // Runs until everything is drawn, or for as long as asked. Sequences never finish on their own
+    uint64_t limit = (seconds > 0) ? (uint64_t)(seconds * rate) : UINT64_MAX;
+    int16_t block[2 * BLOCK_FRAMES];
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool ok = true;
+    while (ok && renderer.samples() < limit && (seconds > 0 || !renderer.idle())) {
+        size_t frames = (size_t)std::min<uint64_t>(BLOCK_FRAMES, limit - renderer.samples());
+        renderer.render(block, frames);
+        ok = writer.write(block, frames);
+    }
+    ok = writer.close() && ok;
+    double took  = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double audio = (double)renderer.samples() / rate;
+    fprintf(stderr, "%.2f s at %u Hz in %.2f s, %.0fx real time. %u commands refused\n", audio, rate, took,
+            audio / took, renderer.rejected());
+    return (ok) ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+// xy_render_tests.cpp
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "xy_render.h"
+
+extern "C" {
+#include "utils.h"
+}
+
+TEST(XyRenderer, point) {
+    XyRenderer renderer(48000);
+    renderer.queue("point 512 -256");
+    int16_t out[2 * 64];
+    renderer.render(out, 64);
+    EXPECT_EQ((int16_t)position_to_binary(512, 11, DAC_BIT_WIDTH, true),  out[2 * 63]);
+    EXPECT_EQ((int16_t)position_to_binary(-256, 11, DAC_BIT_WIDTH, true), out[2 * 63 + 1]);
+    EXPECT_EQ(8191,  out[2 * 63]);
+    EXPECT_EQ(-4096, out[2 * 63 + 1]);
+}
+
+TEST(XyRenderer, lineTiming) {
+    // 2000 points at 50 millipoints a microsecond takes 40 ms
+    uint32_t rates[] = {48000, 96000, 192000};
+    for (int r = 0; r < 3; r++) {
+        XyRenderer renderer(rates[r]);
+        renderer.queue("line -1000 0 1000 0");
+        std::vector<int16_t> out(2 * rates[r] / 10);
+        renderer.render(out.data(), out.size() / 2);
+
+        // Moves one way, then stays at the end
+        size_t end = 0;
+        for (size_t i = 1; i < out.size() / 2; i++) {
+            ASSERT_GE(out[2 * i], out[2 * i - 2]);
+            EXPECT_EQ(0, out[2 * i + 1]);
+            if (out[2 * i] > out[2 * i - 2]) end = i;
+        }
+        EXPECT_EQ((int16_t)position_to_binary(1000, 11, DAC_BIT_WIDTH, true), out[out.size() - 2]);
+        double ms = end * 1000.0 / rates[r];
+        EXPECT_NEAR(40.0, ms, 1.0) << rates[r] << " Hz";
+        EXPECT_TRUE(renderer.idle());
+    }
+}
+
+TEST(XyRenderer, streamsIntoPool) {
+    // Far more than fits in the pool at once
+    XyRenderer renderer(96000);
+    for (int i = 0; i < 200; i++) {
+        renderer.queue((i % 2) ? "line -10 -10 10 10" : "line 10 -10 -10 10");
+    }
+    renderer.queue("bogus");
+    std::vector<int16_t> out(2 * 4096);
+    for (int i = 0; i < 100 && !renderer.idle(); i++) {
+        renderer.render(out.data(), 4096);
+    }
+    EXPECT_TRUE(renderer.idle());
+    EXPECT_EQ(200u, renderer.pool().stats.pops);
+    EXPECT_EQ(1u, renderer.rejected());
+}
+
+TEST(XyRenderer, sequenceLoops) {
+    XyRenderer renderer(48000);
+    renderer.queue("sequence start");
+    renderer.queue("line -100 0 100 0");
+    renderer.queue("line 100 0 -100 0");
+    renderer.queue("sequence end");
+    std::vector<int16_t> out(2 * 48000);
+    renderer.render(out.data(), 48000);
+    EXPECT_FALSE(renderer.idle());
+    // 8 ms a pass
+    EXPECT_NEAR(125, renderer.screen().frame_count, 5);
+}
+
+TEST(WavWriter, header) {
+    char path[] = "/tmp/xy_testXXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+
+    WavWriter writer(96000);
+    ASSERT_TRUE(writer.open(path));
+    int16_t samples[] = {1, -1, 300, -300, 32767, -32768};
+    ASSERT_TRUE(writer.write(samples, 3));
+    ASSERT_TRUE(writer.close());
+
+    uint8_t data[64];
+    FILE* in = fopen(path, "rb");
+    ASSERT_TRUE(in != NULL);
+    size_t size = fread(data, 1, sizeof(data), in);
+    fclose(in);
+    unlink(path);
+    ASSERT_EQ(44u + 12u, size);
+    EXPECT_EQ(0, memcmp(data, "RIFF", 4));
+    EXPECT_EQ(36 + 12, data[4] | (data[5] << 8));
+    EXPECT_EQ(0, memcmp(data + 8, "WAVEfmt ", 8));
+    EXPECT_EQ(2, data[22]);                                                 // Channels
+    EXPECT_EQ(96000, data[24] | (data[25] << 8) | (data[26] << 16));        // Rate
+    EXPECT_EQ(16, data[34]);                                                // Bits
+    EXPECT_EQ(0, memcmp(data + 36, "data", 4));
+    EXPECT_EQ(12, data[40]);
+    EXPECT_EQ(0, memcmp(data + 44, samples, 12));
+}
@@ -7,12 +7,14 @@ bool FAST   = false;
 
 extern "C" {
 #include "command_parser.h"
+#include "device_core.h"
 #include "ring_mem_pool.h"
+#include "sample_cache.h"
 #include "screen_controller.h"
 #include "utils.h"
 }
 
-#define BAUD 115200
+#define BAUD 115200 // At start up. "set baud" moves it
 #define DAC_SYNC 9
 #define DAC_LDAC 8
 #define DAC_CLR  7
@@ -20,12 +22,26 @@ extern "C" {
 //#define DAC_CLK_SPEED 5000000 // 5MHz / 200ns
 #define DAC_CLK_SPEED 1000000 // 1MHz
 
+// Keep the samples of a static frame and play them back, on boards with more SRAM than the Uno
+// 1024 samples take 4 KB and hold a 20 ms frame. See sample_cache.h
+#define SAMPLE_CACHE_LEN 1024
+#define SAMPLE_PERIOD    20 // Microseconds between cached samples
+#define BATCH_BUDGET     500 // Microseconds of batched commands run in one loop
+#define SERIAL_CHUNK     64  // Bytes read in one loop, what the UART buffers
+
+// On the Uno these and the core's Serial buffers come to about 1.4 KB of the 2 KB SRAM, leaving
+// room for the stack. Print constant strings with F() and compare with PSTR() so they stay in flash
 char motion_mem[256];
 RingMemPool motion_pool = {0};
 ScreenState main_screen = {0};
+#ifdef SAMPLE_CACHE
+DacSample sample_mem[SAMPLE_CACHE_LEN];
+SampleCache sample_cache = {0};
+#endif
+DeviceCore device = {0};
 
 void newline() {
-    Serial.write("\n");
+    Serial.write('\n');
 }
 
 void debugPrint(String msg) {
@@ -35,25 +51,25 @@ void debugPrint(String msg) {
 }
 
 void printPrompt() {
-    Serial.write("> ");
+    Serial.print(F("> "));
 }
 
 void printErrorCode(err_t errcode) {
     newline();
-    Serial.write("NAK: ");
-    Serial.write(cmdErrToText(errcode));
-    Serial.write("\n");
+    Serial.print(F("NAK: "));
+    Serial.print((const __FlashStringHelper*)cmdErrToText(errcode));
+    Serial.write('\n');
 }
 
 void printError(char* msg) {
-    Serial.write("NAK: ");
+    Serial.print(F("NAK: "));
     Serial.write(msg);
-    Serial.write("\n");
+    Serial.write('\n');
 }
 
 String intToString(int i) {
     char s[10];
-    snprintf(s, 10, "%d", i);
+    snprintf_P(s, 10, PSTR("%d"), i);
     return String(s);
 }
 
@@ -119,11 +135,11 @@ static inline void dac_write2_fast(uint16_t x, uint16_t y) {
     digitalWrite(DAC_LDAC, HIGH);
 }
 
-void update_dac(const ScreenState* screen) {
+void update_dac(const ScreenState* screen, const DacSample* sample) {
     static uint16_t x = 0;
     static uint16_t y = 0;
-    uint16_t new_x = position_to_binary(screen->beam.x, screen->x_size_pow, DAC_BIT_WIDTH, true);
-    uint16_t new_y = position_to_binary(screen->beam.y, screen->y_size_pow, DAC_BIT_WIDTH, true);
+    uint16_t new_x = sample->x;
+    uint16_t new_y = sample->y;
     if (new_x == x && new_y == y) {
         // Nothing to do
         return;
@@ -131,16 +147,16 @@ void update_dac(const ScreenState* screen) {
     x = new_x;
     y = new_y;
     if (DEBUG) {
-        Serial.print("Updating screen:");
-        Serial.print(" x = ");
+        Serial.print(F("Updating screen:"));
+        Serial.print(F(" x = "));
         Serial.print(screen->beam.x);
-        Serial.print(" -> 0x");
+        Serial.print(F(" -> 0x"));
         Serial.print(x, HEX);
-        Serial.print(" y = ");
+        Serial.print(F(" y = "));
         Serial.print(screen->beam.y);
-        Serial.print(" -> 0y");
+        Serial.print(F(" -> 0y"));
         Serial.print(y, HEX);
-        Serial.write("\n");
+        Serial.write('\n');
     }
     if (FAST) {
         dac_write2_fast(x, y);
@@ -150,6 +166,16 @@ void update_dac(const ScreenState* screen) {
     }
 }
 
+// Print the motion pool counters
+// Reported in every mode so the host can read them
+void reportPool(bool clear) {
+    RingStats stats;
+    ring_get_stats(&motion_pool, &stats);
+    printPoolStats(&motion_pool, &stats);
+    Serial.write('\n');
+    if (clear) ring_clear_stats(&motion_pool);
+}
+
 void setup() {
     // Setup DAC control logic pins
     // The are active low
@@ -171,11 +197,18 @@ void setup() {
         SPI.setDataMode(SPI_MODE1);
     }
     Serial.begin(BAUD);
-    Serial.write("Vector Generator Command Terminal\n");
+    Serial.print(F("Vector Generator Command Terminal\n"));
 
     // Initialize memory
     screen_init(&main_screen);
     ring_init(&motion_pool, motion_mem, sizeof(motion_mem));
+#ifdef SAMPLE_CACHE
+    cache_init(&sample_cache, sample_mem, SAMPLE_CACHE_LEN, SAMPLE_PERIOD);
+    device_init(&device, &main_screen, &motion_pool, &sample_cache);
+#else
+    device_init(&device, &main_screen, &motion_pool, NULL);
+#endif
+    baud_init(&device.baud, BAUD, F_CPU);
     main_screen.x_size_pow = 11;
     main_screen.y_size_pow = 11;
     main_screen.x_centered = true;
@@ -186,160 +219,154 @@ void setup() {
     if (PROMPT) printPrompt();
 }
 
-void checkForCommand(void) {
-    char cmd_buf[CMD_BUF_SIZE];
-    memset(cmd_buf, '\0', CMD_BUF_SIZE);
-
-    int read_len = Serial.available();
-    if (read_len == 0) return;
-
-    // Read bytes
-    int total = Serial.readBytes(cmd_buf, read_len);
-    if (total != read_len) {
-        if (PROMPT) {
-            Serial.write("NAK: Unknown error\n");
-            newline();
-            printPrompt();
+// Commands that change the sketch rather than the screen
+void runSketchCommand(CommandResult* result) {
+    CommandUnion* cmd = &result->cmd;
+    switch (cmd->base.type) {
+    case Cmd_Set:
+    case Cmd_Unset:
+        if (strcmp_P(cmd->set.name, PSTR("debug")) == 0) {
+            DEBUG = cmd->set.set;
+            result->success = true;
         }
-        else {
-            Serial.write("NAK\n");
+        else if (strcmp_P(cmd->set.name, PSTR("prompt")) == 0) {
+            PROMPT = cmd->set.set;
+            result->success = true;
         }
-        return;
-    }
-
-    // Build command
-    err_t errcode = buildCmd(cmd_buf, read_len);
-    if (errcode) {
-        printErrorCode(errcode);
-        printPrompt();
-        return;
-    }
-
-    // Check for full command
-    if (!commandComplete()) {
-        return;
+        else if (strcmp_P(cmd->set.name, PSTR("fast")) == 0) {
+            FAST = 1;
+            SPI.setBitOrder(MSBFIRST);
+            SPI.setClockDivider(SPI_CLOCK_DIV16);
+            SPI.setDataMode(SPI_MODE1);
+        }
+        break;
+    case Cmd_Pool:
+        reportPool(cmd->pool.clear);
+        result->success = true;
+        break;
+    default:
+        break;
     }
+}
 
-    // Check for noop command
-    if (noopCommand()) {
-        if (PROMPT) {
-            printPrompt();
+// Answer a command, or note it for the answer to its batch
+void answerCommand(CommandResult* result) {
+    if (result->batched && !PROMPT) {
+        // One answer for the line
+        if (!result->err && !result->handled) {
+            runSketchCommand(result);
+        }
+        if (device_batch_add(&device, result, device_acked(result))) {
+            char reply[DEVICE_REPLY_SIZE];
+            device_batch_reply(&device, reply, sizeof(reply));
+            Serial.write(reply);
+            Serial.write('\n');
         }
         return;
     }
-
-    // Load command
-    errcode = getCmd(cmd_buf, CMD_BUF_SIZE);
-    if (errcode) {
+    if (result->err == CMD_ERR_CMD_NOOP) {
         if (PROMPT) {
-            printErrorCode(errcode);
             printPrompt();
         }
         return;
     }
-
-    // Parse command
-    CommandUnion cmd;
-    errcode = cmdParse(&cmd, cmd_buf, CMD_BUF_SIZE);
-    if (errcode) {
+    if (result->err) {
         if (PROMPT) {
-            printErrorCode(errcode);
+            printErrorCode(result->err);
             printPrompt();
         }
-        return;
-    }
-
-    // Run command
-    bool success = false;
-    ScreenMotion* motion = nullptr;
-    switch (cmd.base.type) {
-    case Cmd_Point:
-        motion = (ScreenMotion*)screen_push_point(&motion_pool, (PointCmd*)&cmd);
-        break;
-    case Cmd_Line:
-        motion = (ScreenMotion*)screen_push_line(&motion_pool, (LineCmd*)&cmd, main_screen.speed);
-        break;
-    case Cmd_Scale:
-        main_screen.x_size_pow = log2ceil(cmd.scale.x_width);
-        main_screen.y_size_pow = log2ceil(cmd.scale.y_width);
-        main_screen.x_centered = cmd.scale.x_centered;
-        main_screen.y_centered = cmd.scale.y_centered;
-        success = true;
-        break;
-    case Cmd_Speed:
-        if (cmd.speed.hold_time > 0) {
-            main_screen.hold_time = cmd.speed.hold_time;
-            success = true;
-        }
-        if (cmd.speed.speed > 0) {
-            main_screen.speed = cmd.speed.speed * 1000;
-            success = true;
-        }
-        break;
-    case Cmd_Sequence:
-        if (cmd.sequence.start) {
-            success = sequence_start(&main_screen);
-            if (success) ring_reset(&motion_pool);
-        }
-        else if (cmd.sequence.end) {
-            success = sequence_end(&main_screen);
-        }
-        else if (cmd.sequence.clear) {
-            success = sequence_clear(&main_screen);
-            if (success) ring_reset(&motion_pool);
-        }
-        break;
-    case Cmd_Set:
-    case Cmd_Unset:
-        if (strcmp(cmd.set.name, "debug") == 0) {
-            DEBUG = cmd.set.set;
-            success = true;
-        }
-        else if (strcmp(cmd.set.name, "prompt") == 0) {
-            PROMPT = cmd.set.set;
-            success = true;
-        }
-        else if (strcmp(cmd.set.name, "repeat") == 0) {
-            main_screen.repeat = cmd.set.set;
-            success = true;
-        }
-        else if (strcmp(cmd.set.name, "fast") == 0) {
-            FAST = 1;
-            SPI.setBitOrder(MSBFIRST);
-            SPI.setClockDivider(SPI_CLOCK_DIV16);
-            SPI.setDataMode(SPI_MODE1);
+        else {
+            // Every command gets an answer so a host can keep count
+            // Priority answers are marked since they can jump ahead of the others
+            if (result->priority) Serial.write(CMD_PRIO_PREFIX);
+            Serial.print(F("NAK\n"));
         }
-        break;
-    case Cmd_Noop:
-        success = true;
-        break;
-    default:
-        break;
+        return;
     }
-
-    if (motion != NULL && main_screen.sequence_enabled) {
-        success = add_to_sequence(&main_screen, motion);
+    if (!result->handled) {
+        runSketchCommand(result);
     }
 
     if (PROMPT) {
-        printCommand((Command*)&cmd);
-        Serial.print("\n");
-        if (motion != NULL) {
-            Serial.print("New Motion: 0x");
-            Serial.print((uint16_t)motion, HEX);
+        printCommand((Command*)&result->cmd);
+        Serial.write('\n');
+        if (result->motion != NULL) {
+            Serial.print(F("New Motion: 0x"));
+            Serial.print((uint16_t)result->motion, HEX);
             if (DEBUG) {
-                Serial.write(" ");
-                serialPrintMotion(motion);
+                Serial.write(' ');
+                serialPrintMotion(result->motion);
             }
-            Serial.print("\n");
+            Serial.write('\n');
         }
         else {
-            Serial.print((success) ? "OK\n" : "FAILED\n");
+            Serial.print((result->success) ? F("OK\n") : F("FAILED\n"));
         }
         printPrompt();
     }
     else {
-        Serial.print((success || motion) ? "ACK\n" : "NAK\n");
+        if (result->priority) Serial.write(CMD_PRIO_PREFIX);
+        Serial.print(device_acked(result) ? F("ACK\n") : F("NAK\n"));
+    }
+}
+
+// Read what has arrived, then run the next command
+// The priority lane is always served first
+void checkForCommand(void) {
+    // Held frames are offered again even when nothing came
+    int read_len = Serial.available();
+    if (read_len > 0 || device.link.enabled) {
+        // Handed over as they come off the UART. The parser keeps them, and commands are run where they land
+        char chunk[SERIAL_CHUNK];
+        if (read_len > SERIAL_CHUNK) read_len = SERIAL_CHUNK;
+        for (int i = 0; i < read_len; i++) {
+            chunk[i] = Serial.read();
+        }
+
+        err_t errcode = device_receive(&device, chunk, read_len);
+        if (errcode) {
+            printErrorCode(errcode);
+            printPrompt();
+            return;
+        }
+    }
+
+    // Frames that were lost or damaged on the way
+    uint8_t seq;
+    while (device_resend(&device, &seq)) {
+        Serial.print(F("RESEND "));
+        Serial.print(seq);
+        Serial.write('\n');
+    }
+
+    // Parse and run commands
+    // Those sharing a line run back to back, while there's time
+    uint32_t start = micros();
+    CommandResult result;
+    do {
+        if (!device_next(&device, &result)) {
+            return;
+        }
+        answerCommand(&result);
+    } while (result.batched && !result.batch_end && micros() - start < BATCH_BUDGET);
+}
+
+// Move the UART for "set baud" once its answer is out, and echo the probe at the new rate
+void checkBaud(void) {
+    switch (device_baud_event(&device)) {
+    case BAUD_SWITCH:
+    case BAUD_FALLBACK:
+        Serial.flush();
+        Serial.begin(device.baud.rate);
+        break;
+    case BAUD_ECHO:
+        Serial.print(F(BAUD_PROBE_LINE));
+        break;
+    case BAUD_COMMIT:
+        Serial.print(F("ACK\n"));
+        break;
+    default:
+        break;
     }
 }
 
@@ -347,7 +374,8 @@ void loop() {
     // Check for command, then update the screen
 
     uint32_t now = micros();
-    bool active = update_screen(now, &main_screen, &motion_pool);
+    DacSample sample;
+    bool active = device_update(&device, now, &sample);
 
     // Handle debug
     static int32_t debug_start = -1;
@@ -359,17 +387,17 @@ void loop() {
         if (debug_start < 0) debug_start = now;
         const ScreenMotion* next_motion = ring_peek(&motion_pool);
         if (memcmp(&beam_state, &main_screen.beam, sizeof(BeamState)) != 0) {
-            Serial.print("\n");
-            Serial.print("Screen update time ");
+            Serial.write('\n');
+            Serial.print(F("Screen update time "));
             Serial.print(after - now);
-            Serial.print("us\n");
+            Serial.print(F("us\n"));
             /*
-            Serial.print("Time: ");
+            Serial.print(F("Time: "));
             Serial.print(now / 1000.0);
-            Serial.print("ms | ");
+            Serial.print(F("ms | "));
             //*/
             printBeamState(&main_screen.beam);
-            Serial.print("\n");
+            Serial.write('\n');
             memcpy(&beam_state, &main_screen.beam, sizeof(BeamState));
             printed = true;
         }
@@ -377,7 +405,7 @@ void loop() {
         if (last_motion != next_motion && next_motion && PROMPT) {
             Serial.write((String("\nNext motion 0x") + String((size_t)next_motion, HEX) + ": ").c_str());
             serialPrintMotion(next_motion);
-            Serial.write("\n");
+            Serial.write('\n');
             last_motion = next_motion;
             printed = true;
         }
@@ -393,16 +421,17 @@ void loop() {
                 printPrompt();
             }
             else {
-                Serial.write("\n");
+                Serial.write('\n');
             }
         }
     }
 
     // Update the screen
-    update_dac(&main_screen);
+    update_dac(&main_screen, &sample);
 
     // Handle command check
     if (!active || !DEBUG) {
         checkForCommand();
     }
+    checkBaud();
 }
@@ -0,0 +1,86 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "baud_switch.h"
+
+void baud_init(BaudSwitch* baud, uint32_t rate, uint32_t clock) {
+    memset(baud, '\0', sizeof(BaudSwitch));
+    baud->rate     = rate;
+    baud->old_rate = rate;
+    baud->clock    = clock;
+}
+
+uint16_t baud_error(uint32_t clock, uint32_t rate) {
+    if (clock == 0 || rate == 0) return UINT16_MAX;
+    // UBRR is 12 bits
+    uint32_t divisor = (clock / 4 / rate + 1) / 2;
+    if (divisor == 0 || divisor > 4096) return UINT16_MAX;
+    uint32_t actual = clock / 8 / divisor;
+    uint32_t diff   = (actual > rate) ? actual - rate : rate - actual;
+    return (uint64_t)diff * 1000 / rate;
+}
+
+bool baud_start(BaudSwitch* baud, uint32_t rate) {
+    if (baud->state != BAUD_IDLE || baud_error(baud->clock, rate) > BAUD_MAX_ERROR) return false;
+    baud->old_rate = baud->rate;
+    baud->rate     = rate;
+    baud->state    = BAUD_SWITCHING;
+    baud->event    = BAUD_SWITCH;
+    baud->line_len = 0;
+    return true;
+}
+
+bool baud_active(const BaudSwitch* baud) {
+    return baud->state != BAUD_IDLE;
+}
+
+static inline bool lineIs(const BaudSwitch* baud, const char* text) {
+    return baud->line_len == strlen(text) && memcmp(baud->line, text, baud->line_len) == 0;
+}
+
+// Bytes at the wrong rate come out as junk. Lines that aren't what's expected are dropped
+static void takeLine(BaudSwitch* baud, uint32_t time) {
+    // The host sends the probe again when the echo didn't get back
+    if (lineIs(baud, BAUD_PROBE_LINE)) {
+        baud->state    = BAUD_CONFIRMING;
+        baud->event    = BAUD_ECHO;
+        baud->deadline = time + BAUD_TIMEOUT;
+    }
+    else if (baud->state == BAUD_CONFIRMING && lineIs(baud, BAUD_COMMIT_LINE)) {
+        baud->state    = BAUD_IDLE;
+        baud->event    = BAUD_COMMIT;
+        baud->old_rate = baud->rate;
+    }
+}
+
+void baud_receive(BaudSwitch* baud, const char* data, uint8_t len, uint32_t time) {
+    if (baud->state != BAUD_PROBING && baud->state != BAUD_CONFIRMING) return;
+    for (uint8_t i = 0; i < len && baud->state != BAUD_IDLE; i++) {
+        if (baud->line_len < BAUD_LINE_MAX) {
+            baud->line[baud->line_len++] = data[i];
+        }
+        if (data[i] == '\n') {
+            takeLine(baud, time);
+            baud->line_len = 0;
+        }
+    }
+}
+
+void baud_update(BaudSwitch* baud, uint32_t time) {
+    if (baud->state != BAUD_PROBING && baud->state != BAUD_CONFIRMING) return;
+    if ((int32_t)(time - baud->deadline) < 0) return;
+    baud->state = BAUD_IDLE;
+    baud->event = BAUD_FALLBACK;
+    baud->rate  = baud->old_rate;
+}
+
+BaudEvent baud_event(BaudSwitch* baud, uint32_t time) {
+    BaudEvent event = baud->event;
+    baud->event = BAUD_NONE;
+    if (event == BAUD_SWITCH) {
+        baud->state    = BAUD_PROBING;
+        baud->deadline = time + BAUD_TIMEOUT;
+    }
+    return event;
+}
@@ -0,0 +1,58 @@
+// BaudSwitch
+// Moves the serial link to another rate without losing it
+// "set baud <rate>" is answered at the old rate, then both ends switch and the host sends BAUD_PROBE_LINE
+// The device echoes it at the new rate, and the host answers BAUD_COMMIT_LINE to keep the rate, which is ACKed
+// Whatever doesn't come within BAUD_TIMEOUT, the device goes back to the old rate and the host follows
+// Serial I/O stays with the caller. It takes the events and moves the UART
+
+#ifndef BAUD_SWITCH_H
+#define BAUD_SWITCH_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#define BAUD_PROBE_LINE  "probe UUUU****\n" // Alternating bits, then runs of them
+#define BAUD_COMMIT_LINE "commit\n"
+#define BAUD_TIMEOUT     250000 // Microseconds to wait for each step
+#define BAUD_MAX_ERROR   30     // Per mille the UART can be off by. Both ends of 8N1 together can be 4.5% apart
+#define BAUD_LINE_MAX    24
+
+typedef enum BaudState {
+    BAUD_IDLE = 0,   // At the rate, bytes go to the parser
+    BAUD_SWITCHING,  // Answered, waiting for the caller to move the UART
+    BAUD_PROBING,    // At the new rate, waiting for the probe
+    BAUD_CONFIRMING, // Probe echoed, waiting for the commit
+} BaudState;
+
+typedef enum BaudEvent {
+    BAUD_NONE = 0,
+    BAUD_SWITCH,   // Move the UART to rate, once the answer is out
+    BAUD_ECHO,     // Write BAUD_PROBE_LINE back
+    BAUD_COMMIT,   // Kept. Answer with ACK
+    BAUD_FALLBACK, // Move the UART back to rate
+} BaudEvent;
+
+typedef struct BaudSwitch {
+    BaudState state;
+    uint32_t rate;     // The UART should be at
+    uint32_t old_rate; // To go back to
+    uint32_t clock;    // UART clock. Zero when the rate can't be changed
+    uint32_t deadline; // Micros
+    BaudEvent event;   // Waiting for the caller
+    char line[BAUD_LINE_MAX];
+    uint8_t line_len;
+} BaudSwitch;
+
+void baud_init(BaudSwitch* baud, uint32_t rate, uint32_t clock);
+// Error of the nearest rate the UART can make, in per mille. Double speed mode, like the Arduino core uses
+uint16_t baud_error(uint32_t clock, uint32_t rate);
+// Start a switch. False when the rate isn't close enough
+bool baud_start(BaudSwitch* baud, uint32_t rate);
+// Bytes go here instead of the parser
+bool baud_active(const BaudSwitch* baud);
+void baud_receive(BaudSwitch* baud, const char* data, uint8_t len, uint32_t time);
+void baud_update(BaudSwitch* baud, uint32_t time);
+// Take the next thing to do. Taking BAUD_SWITCH starts the wait for the probe
+BaudEvent baud_event(BaudSwitch* baud, uint32_t time);
+
+#endif // BAUD_SWITCH_H
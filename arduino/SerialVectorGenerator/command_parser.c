@@ -5,59 +5,220 @@
 #include <string.h>
 
 #include "command_parser.h"
+#include "common.h"
 #include "ring_mem_pool.h"
 
 // cmd prefixes
-const char* cmd_set[Cmd_NUM] = {
-    [Cmd_Scale]    = "scale",
-    [Cmd_Point]    = "point",
-    [Cmd_Line]     = "line",
-    [Cmd_Speed]    = "speed",
-    [Cmd_Hold]     = "hold",
-    [Cmd_Sequence] = "sequence",
-    [Cmd_Set]      = "set",
-    [Cmd_Unset]    = "unset",
-    [Cmd_Noop]     = "noop",
+static const char cmd_set[Cmd_NUM][CMD_NAME_SIZE] PROGMEM = {
+    [Cmd_Scale]     = "scale",
+    [Cmd_Point]     = "point",
+    [Cmd_Line]      = "line",
+    [Cmd_Curve]     = "curve",
+    [Cmd_Arc]       = "arc",
+    [Cmd_Speed]     = "speed",
+    [Cmd_Hold]      = "hold",
+    [Cmd_Sequence]  = "sequence",
+    [Cmd_Set]       = "set",
+    [Cmd_Unset]     = "unset",
+    [Cmd_Slew]      = "slew",
+    [Cmd_Refresh]   = "refresh",
+    [Cmd_Transform] = "transform",
+    [Cmd_Pool]      = "pool",
+    [Cmd_Blank]     = "blank",
+    [Cmd_RLine]     = "rline",
+    [Cmd_RMove]     = "rmove",
+    [Cmd_Noop]      = "noop",
 };
 
-// Ring buffer
+// Command buffer
+// Commands are taken where they are. The front moves past them, and what was taken is only
+// dropped by moving the rest back when more is built and the end is reached
 static char cmd_buf[CMD_BUF_SIZE + 1];
+static char* cmd_front = cmd_buf;
 static uint8_t cmd_buf_len = 0;
+static uint8_t cmd_scan = 0; // Bytes from the front known to hold no line end
+static bool cmd_start = true; // The next byte starts a command
+static bool cmd_batched = false; // The last command taken ended with CMD_BATCH_SEP
+
+// Binary records
+static bool binary_mode = false;
+static uint8_t bin_left = 0; // Bytes still to come in the record being built
+static bool bin_sized = true; // The size of the record being built is known. Packed ones give it second
+
+// Priority lane
+// Lines starting with CMD_PRIO_PREFIX are kept apart so they don't wait behind motions
+static char prio_buf[CMD_PRIO_BUF_SIZE + 1];
+static uint8_t prio_buf_len = 0;
+static uint8_t prio_taken   = 0; // Bytes at the start taken by the last command, dropped when more is built
+static bool prio_building = false; // Bytes are going to the priority lane
+static bool prio_skip_lf  = false; // Drop the \n of a \r\n that ended a priority command
 
 void clearCache(void) {
-    cmd_buf_len = 0;
+    cmd_front     = cmd_buf;
+    cmd_buf_len   = 0;
+    cmd_scan      = 0;
+    cmd_start     = true;
+    cmd_batched   = false;
+    bin_left      = 0;
+    bin_sized     = true;
+    prio_buf_len  = 0;
+    prio_taken    = 0;
+    prio_building = false;
+    prio_skip_lf  = false;
 }
 
-// And a command to the buffer
-err_t buildCmd(const char* new_cmd, uint8_t len) {
-    // Check size
-    if (len + cmd_buf_len > CMD_BUF_SIZE - 1) {
-        // Buffer overrun
-        // Reset buffer
-        clearCache();
+static inline bool lineEnd(char c) {
+    return (c == '\r' || c == '\n');
+}
+
+// Add a byte to the priority lane
+static err_t buildPrio(char c) {
+    if (prio_taken) {
+        prio_buf_len -= prio_taken;
+        memmove(prio_buf, &prio_buf[prio_taken], prio_buf_len);
+        prio_taken = 0;
+    }
+    if (lineEnd(c)) {
+        // One line end is enough to mark it complete
+        prio_skip_lf  = (c == '\r');
+        prio_building = false;
+        c = '\n';
+    }
+    else if (c == '\b') {
+        if (prio_buf_len > 0 && prio_buf[prio_buf_len - 1] != '\n') prio_buf_len--;
+        return CMD_OK;
+    }
+    else if (!isprint(c)) {
+        return CMD_OK;
+    }
+
+    if (prio_buf_len >= CMD_PRIO_BUF_SIZE) {
+        // Drop the lane rather than run half a command
+        prio_buf_len  = 0;
+        prio_building = false;
         return CMD_ERR_CMD_TOO_LONG;
     }
-//    memcpy(&cmd_buf[cmd_buf_len], new_cmd, len);
-//    cmd_buf_len += len;
+    prio_buf[prio_buf_len++] = c;
+    return CMD_OK;
+}
+
+// Room at the end of the buffer for another byte
+static inline void makeRoom(void) {
+    if (cmd_front + cmd_buf_len < &cmd_buf[CMD_BUF_SIZE - 1]) return;
+    memmove(cmd_buf, cmd_front, cmd_buf_len);
+    cmd_front = cmd_buf;
+}
+
+// And a command to the buffer
+err_t buildCmd(const char* new_cmd, uint8_t len) {
+    // Nothing waiting, so nothing to move
+    if (cmd_buf_len == 0) cmd_front = cmd_buf;
     for (uint8_t i = 0; i < len; i++) {
         char c = new_cmd[i];
-        if (isprint(c) || c == '\r' || c == '\n') {
-            cmd_buf[cmd_buf_len++] = c;
+        if (bin_left > 0) {
+            // Record bytes go in as they are
+            if (cmd_buf_len >= CMD_BUF_SIZE - 1) {
+                cmd_buf_len = 0;
+                cmd_scan    = 0;
+                cmd_start   = true;
+                bin_left    = 0;
+                return CMD_ERR_CMD_TOO_LONG;
+            }
+            makeRoom();
+            cmd_front[cmd_buf_len++] = c;
+            if (--bin_left == 0 && !bin_sized) {
+                bin_sized = true;
+                bin_left  = (uint8_t)c;
+                if (bin_left > CMD_PACKED_MAX) {
+                    // Only the record is dropped
+                    cmd_buf_len -= 2;
+                    cmd_scan     = 0;
+                    cmd_start    = true;
+                    bin_left     = 0;
+                    return CMD_ERR_CMD_TOO_LONG;
+                }
+            }
+            cmd_start = (bin_left == 0);
+            continue;
+        }
+        if (prio_building) {
+            err_t errcode = buildPrio(c);
+            if (errcode) return errcode;
+            continue;
         }
-        else if (c == '\b' && cmd_buf_len > 0) {
+        if (prio_skip_lf) {
+            prio_skip_lf = false;
+            if (c == '\n') continue;
+        }
+        if (c == CMD_PRIO_PREFIX && cmd_start) {
+            // Start of a priority command
+            prio_building = true;
+            continue;
+        }
+
+        // Check size
+        // Priority commands still get through when this is full
+        if (cmd_buf_len >= CMD_BUF_SIZE - 1) {
+            // Buffer overrun
+            // Reset buffer
+            cmd_buf_len = 0;
+            cmd_scan    = 0;
+            cmd_start   = true;
+            return CMD_ERR_CMD_TOO_LONG;
+        }
+        makeRoom();
+        if (binary_mode && cmd_start && ((uint8_t)c & CMD_BIN_FLAG)) {
+            // Start of a binary record
+            cmd_front[cmd_buf_len++] = c;
+            bin_left  = cmdBinarySize(c) - 1;
+            bin_sized = ((uint8_t)c != CMD_BIN_PACKED);
+            cmd_start = (bin_left == 0);
+        }
+        else if (isprint(c) || lineEnd(c)) {
+            cmd_front[cmd_buf_len++] = c;
+            cmd_start = lineEnd(c);
+        }
+        else if (c == '\b' && cmd_buf_len > 0 && !binary_mode) {
             // Backspace
             cmd_buf_len--;
+            if (cmd_scan > cmd_buf_len) cmd_scan = cmd_buf_len;
+            cmd_start = (cmd_buf_len == 0 || lineEnd(cmd_front[cmd_buf_len - 1]));
         }
     }
     return CMD_OK;
 }
 
-static int16_t lookForChar(char c) {
-    int i;
-    for (i = 0; i < cmd_buf_len; i++) {
-        if (cmd_buf[i] == c) return i;
+bool prioCommandComplete(void) {
+    return (prio_buf_len > prio_taken && memchr(&prio_buf[prio_taken], '\n', prio_buf_len - prio_taken) != NULL);
+}
+
+// Take the oldest priority command where it is in the lane
+// It's ended with a null there, and stays until more is built
+err_t takePrioCmd(char** cmd, uint8_t* len) {
+    char* start = &prio_buf[prio_taken];
+    char* end   = memchr(start, '\n', prio_buf_len - prio_taken);
+    if (!end) return CMD_ERR_CMD_NOOP;
+
+    *end = '\0';
+    *cmd = start;
+    *len = end - start;
+    prio_taken += *len + 1;
+    return (*len) ? CMD_OK : CMD_ERR_CMD_NOOP;
+}
+
+// Get the oldest priority command
+err_t getPrioCmd(char* buf, uint8_t buf_len) {
+    const char* end = memchr(&prio_buf[prio_taken], '\n', prio_buf_len - prio_taken);
+    if (!end) return CMD_ERR_CMD_NOOP;
+    if (buf_len <= end - &prio_buf[prio_taken]) {
+        return CMD_ERR_BUF_OVERRUN;
     }
-    return -1;
+
+    char* cmd;
+    uint8_t len;
+    err_t errcode = takePrioCmd(&cmd, &len);
+    memcpy(buf, cmd, len + 1);
+    return errcode;
 }
 
 // Shift the buffer pointer
@@ -65,12 +226,10 @@ static void shiftBuf(uint8_t len) {
     // Don't do anything if the shift amount is too much
     if (len > cmd_buf_len) return;
 
-    uint8_t i;
-    for (i = 0; i < len; i++) {
-        cmd_buf[i] = cmd_buf[i + len];
-    }
+    // Nothing moves, the front just passes it
+    cmd_front   += len;
     cmd_buf_len -= len;
-
+    cmd_scan     = 0;
 }
 
 // Trim line ends
@@ -81,12 +240,12 @@ static uint8_t trimCrlf(void) {
     uint8_t shift_len = 0;
     // Check first byte
     if (cmd_buf_len >= 1) {
-         c = cmd_buf[0];
+         c = cmd_front[0];
         if (c == '\r' || c == '\n') shift_len++;
     }
     // Check second byte
     if (cmd_buf_len >= 2) {
-         c = cmd_buf[1];
+         c = cmd_front[1];
         if (c == '\r' || c == '\n') shift_len++;
     }
 
@@ -95,24 +254,38 @@ static uint8_t trimCrlf(void) {
     return shift_len;
 }
 
+// Size of the binary record at the front of the buffer, or zero for a line
+// Lines only hold printable bytes, so a record is the only thing that can start with CMD_BIN_FLAG
+static inline uint8_t binaryFront(void) {
+    if (cmd_buf_len == 0 || !((uint8_t)cmd_front[0] & CMD_BIN_FLAG)) return 0;
+    if ((uint8_t)cmd_front[0] == CMD_BIN_PACKED && cmd_buf_len >= 2) return 2 + (uint8_t)cmd_front[1];
+    return cmdBinarySize(cmd_front[0]);
+}
+
 // Find the end of the next command
 static int16_t crlfPos(void) {
     if (!cmd_buf_len) return 0;
 
-    int16_t cr_pos = lookForChar('\r');
-    int16_t lf_pos = lookForChar('\n');
-
-    // Must be at least one of them for a complete command
-    if (cr_pos == -1 && lf_pos == -1) return -1;
-
-    // There is a \r but not an \n
-    if (cr_pos != -1 && lf_pos == -1) return cr_pos;
+    uint8_t record = binaryFront();
+    if (record) return (cmd_buf_len >= record) ? record : -1;
 
-    // There is an \n but not an \r
-    if (cr_pos == 1 && lf_pos != -1) return lf_pos;
+    // Lines can hold several commands. What was looked through already is skipped
+    for (int16_t i = cmd_scan; i < cmd_buf_len; i++) {
+        if (lineEnd(cmd_front[i]) || cmd_front[i] == CMD_BATCH_SEP) return i;
+    }
+    cmd_scan = cmd_buf_len;
+    return -1;
+}
 
-    // Return the first one
-    return (cr_pos < lf_pos) ? cr_pos : lf_pos;
+// Drop what ended the command, and note if another shares its line
+static uint8_t trimEnd(void) {
+    if (cmd_buf_len > 0 && cmd_front[0] == CMD_BATCH_SEP) {
+        shiftBuf(1);
+        cmd_batched = true;
+        return 1;
+    }
+    cmd_batched = false;
+    return trimCrlf();
 }
 
 // The size of the command
@@ -122,9 +295,9 @@ uint8_t commandSize(void) {
 }
 
 uint8_t noopCommand(void) {
-    if (crlfPos() == -1) return 0;
+    if (crlfPos() == -1 || binaryFront()) return 0;
 
-    return trimCrlf();
+    return trimEnd();
 }
 
 bool commandComplete(void) {
@@ -135,31 +308,54 @@ uint8_t cmdBufLen(void) {
     return cmd_buf_len;
 }
 
-// Get a command string from the command cache
-// and copy it into the buffer
-err_t getCmd(char* buf, uint8_t buf_len) {
+// Take the next command where it is in the buffer
+// Lines are ended with a null in place of what ended them. Records are left as they are
+// It stays there until more is built
+err_t takeCmd(char** cmd, uint8_t* len) {
     // Check for a complete command
-    if (crlfPos() == -1) return 0;
-
-    // Get the command string
-    int cmd_len = commandSize();
+    int16_t cmd_len = crlfPos();
+    if (cmd_len == -1) return CMD_ERR_CMD_NOOP;
     if (cmd_len == 0) {
         // This was a noop command
-        trimCrlf();
+        trimEnd();
         return CMD_ERR_CMD_NOOP;
     }
 
+    // Records have no line end to trim, and what follows them may start with one of their bytes
+    bool record = binaryFront();
+    *cmd = cmd_front;
+    *len = cmd_len;
+    shiftBuf(cmd_len);
+    if (record) {
+        cmd_batched = false;
+    }
+    else {
+        trimEnd();
+        (*cmd)[cmd_len] = '\0';
+    }
+    return CMD_OK;
+}
+
+// Get a command string from the command cache
+// and copy it into the buffer
+err_t getCmd(char* buf, uint8_t buf_len) {
+    // Check for a complete command
+    if (crlfPos() == -1) return 0;
+
     // Buffer size safety check
-    if (buf_len < cmd_len) {
+    if (buf_len < commandSize()) {
         return CMD_ERR_BUF_OVERRUN;
     }
 
-    // Copy command
-    memcpy(buf, cmd_buf, cmd_len);
-    shiftBuf(cmd_len);
-    trimCrlf();
+    char* cmd;
+    uint8_t len;
+    err_t errcode = takeCmd(&cmd, &len);
+    if (!errcode) memcpy(buf, cmd, len);
+    return errcode;
+}
 
-    return 0;
+bool cmdBatched(void) {
+    return cmd_batched;
 }
 
 // Command decoder functer type
@@ -196,6 +392,40 @@ static err_t cmdDecodeLine(LineCmd* cmd) {
     return CMD_OK;
 }
 
+// Decode an rline or rmove command
+static err_t cmdDecodeRel(RelCmd* cmd) {
+    const Command* base = &cmd->base;
+    if (base->numargs != 2) return CMD_ERR_WRONG_NUM_ARGS;
+    cmd->dx = atoi(base->args[0]);
+    cmd->dy = atoi(base->args[1]);
+    return CMD_OK;
+}
+
+// Decode a curve command
+static err_t cmdDecodeCurve(CurveCmd* cmd) {
+    const Command* base = &cmd->base;
+    if (base->numargs != 6 && base->numargs != 8) return CMD_ERR_WRONG_NUM_ARGS;
+    cmd->order = base->numargs / 2 - 1;
+    for (uint8_t i = 0; i <= cmd->order; i++) {
+        cmd->x[i] = atoi(base->args[2 * i]);
+        cmd->y[i] = atoi(base->args[2 * i + 1]);
+    }
+    return CMD_OK;
+}
+
+// Decode an arc command
+static err_t cmdDecodeArc(ArcCmd* cmd) {
+    const Command* base = &cmd->base;
+    if (base->numargs != 5) return CMD_ERR_WRONG_NUM_ARGS;
+    cmd->cx    = atoi(base->args[0]);
+    cmd->cy    = atoi(base->args[1]);
+    cmd->r     = atoi(base->args[2]);
+    cmd->start = atoi(base->args[3]);
+    cmd->end   = atoi(base->args[4]);
+    if (cmd->r < 0) return CMD_ERR_BAD_ARG;
+    return CMD_OK;
+}
+
 // Decode a speed command
 static err_t cmdDecodeSpeed(SpeedCmd* cmd) {
     const Command* base = &cmd->base;
@@ -212,30 +442,135 @@ static err_t cmdDecodeHold(SpeedCmd* cmd) {
     return CMD_OK;
 }
 
+// Decode a slew command
+static err_t cmdDecodeSlew(SlewCmd* cmd) {
+    const Command* base = &cmd->base;
+    if (base->numargs != 2) return CMD_ERR_WRONG_NUM_ARGS;
+    cmd->max_speed = atof(base->args[0]);
+    cmd->accel     = atof(base->args[1]);
+    if (cmd->max_speed < 0 || cmd->accel < 0) return CMD_ERR_BAD_ARG;
+    // Kept in thousandths, in 16 bits
+    if (cmd->max_speed > CMD_SLEW_MAX || cmd->accel > CMD_SLEW_MAX) return CMD_ERR_BAD_ARG;
+    return CMD_OK;
+}
+
+// Decode a refresh command
+static err_t cmdDecodeRefresh(RefreshCmd* cmd) {
+    const Command* base = &cmd->base;
+    if (base->numargs != 1 && base->numargs != 2) return CMD_ERR_WRONG_NUM_ARGS;
+    cmd->rate = atof(base->args[0]);
+    cmd->idle = (base->numargs == 2) ? !!atoi(base->args[1]) : false;
+    if (cmd->rate < 0) return CMD_ERR_BAD_ARG;
+    // The period is kept in whole microseconds, in 32 bits
+    if (cmd->rate > 0 && (cmd->rate < CMD_REFRESH_MIN || cmd->rate > CMD_REFRESH_MAX)) return CMD_ERR_BAD_ARG;
+    return CMD_OK;
+}
+
+// Whether a transform value fits in fixed point, NaN doesn't
+static inline bool inTransformRange(float value) {
+    return value >= -CMD_TRANSFORM_MAX && value <= CMD_TRANSFORM_MAX;
+}
+
+// Decode a transform command
+static err_t cmdDecodeTransform(TransformCmd* cmd) {
+    const Command* base = &cmd->base;
+    switch (base->numargs) {
+    case 0:
+        // Reset
+        cmd->a = 1;
+        cmd->d = 1;
+        break;
+    case 1:
+    case 2:
+    case 4:
+        cmd->rotate = true;
+        cmd->angle  = atoi(base->args[0]);
+        cmd->scale  = (base->numargs >= 2) ? atof(base->args[1]) : 1;
+        if (base->numargs == 4) {
+            cmd->tx = atoi(base->args[2]);
+            cmd->ty = atoi(base->args[3]);
+        }
+        break;
+    case 6:
+        cmd->a  = atof(base->args[0]);
+        cmd->b  = atof(base->args[1]);
+        cmd->c  = atof(base->args[2]);
+        cmd->d  = atof(base->args[3]);
+        cmd->tx = atoi(base->args[4]);
+        cmd->ty = atoi(base->args[5]);
+        break;
+    default:
+        return CMD_ERR_WRONG_NUM_ARGS;
+    }
+    // Kept in 16.16 fixed point
+    if (!inTransformRange(cmd->scale) || !inTransformRange(cmd->a) || !inTransformRange(cmd->b)
+        || !inTransformRange(cmd->c) || !inTransformRange(cmd->d)) {
+        return CMD_ERR_BAD_ARG;
+    }
+    return CMD_OK;
+}
+
+// Decode a pool command
+static err_t cmdDecodePool(PoolCmd* cmd) {
+    const Command* base = &cmd->base;
+    if (base->numargs > 1) return CMD_ERR_WRONG_NUM_ARGS;
+    cmd->clear = false;
+    if (base->numargs == 1) {
+        if (strcmp_P(base->args[0], PSTR("clear")) != 0) return CMD_ERR_BAD_ARG;
+        cmd->clear = true;
+    }
+    return CMD_OK;
+}
+
 // Decode a sequence command
 static err_t cmdDecodeSequence(SequenceCmd* cmd) {
-    const Command* base = &cmd->base;
-    if (base->numargs != 1) return CMD_ERR_WRONG_NUM_ARGS;
-    if (strcmp(base->args[0], "start") == 0) {
+    Command* base = &cmd->base;
+    if (base->numargs == 0) return CMD_ERR_WRONG_NUM_ARGS;
+    if (strcmp_P(base->args[0], PSTR("set")) == 0 || strcmp_P(base->args[0], PSTR("insert")) == 0) {
+        if (base->numargs < 3) return CMD_ERR_WRONG_NUM_ARGS;
+        cmd->set    = (base->args[0][0] == 's');
+        cmd->insert = !cmd->set;
+    }
+    else if (strcmp_P(base->args[0], PSTR("delete")) == 0) {
+        if (base->numargs != 2) return CMD_ERR_WRONG_NUM_ARGS;
+        cmd->remove = true;
+    }
+    else if (base->numargs != 1) {
+        return CMD_ERR_WRONG_NUM_ARGS;
+    }
+    else if (strcmp_P(base->args[0], PSTR("start")) == 0) {
         cmd->start = true;
     }
-    else if (strcmp(base->args[0], "end") == 0) {
+    else if (strcmp_P(base->args[0], PSTR("end")) == 0) {
         cmd->end = true;
     }
-    else if (strcmp(base->args[0], "clear") == 0) {
+    else if (strcmp_P(base->args[0], PSTR("clear")) == 0) {
         cmd->clear = true;
     }
     else {
         return CMD_ERR_BAD_ARG;
     }
+
+    if (cmd->set || cmd->insert || cmd->remove) {
+        if (!isdigit((unsigned char)base->args[1][0])) return CMD_ERR_BAD_ARG;
+        cmd->idx = atoi(base->args[1]);
+    }
+    if (cmd->set || cmd->insert) {
+        // Put the motion back together. It's parsed again when it's run
+        for (uint8_t i = 3; i < base->numargs; i++) {
+            base->args[i][-1] = ' ';
+        }
+        cmd->motion = base->args[2];
+    }
     return CMD_OK;
 }
 
 // Decode Set/Unset command
 static err_t cmdDecodeSet(SetCmd* cmd) {
     const Command* base = &cmd->base;
-    if (base->numargs != 1) return CMD_ERR_WRONG_NUM_ARGS;
-    cmd->name = base->args[0];
+    if (base->numargs != 1 && (base->numargs != 2 || !cmd->set)) return CMD_ERR_WRONG_NUM_ARGS;
+    cmd->name  = base->args[0];
+    cmd->value = (base->numargs == 2) ? base->args[1] : NULL;
     return CMD_OK;
 }
 
@@ -271,43 +606,78 @@ err_t cmdParse(CommandUnion* cmd, char* buf, uint8_t len) {
 
     // Get cmd type
     err_t (*decode_fn)(Command* cmd) = NULL;
-    if (strcmp(cmd_set[Cmd_Scale], cmd_start) == 0) {
+    if (strcmp_P(cmd_start, cmd_set[Cmd_Scale]) == 0) {
         cmd->base.type = Cmd_Scale;
         decode_fn = (DecodeFn)cmdDecodeScale;
     }
-    else if (strcmp(cmd_set[Cmd_Point], cmd_start) == 0) {
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_Point]) == 0) {
         cmd->base.type = Cmd_Point;
         decode_fn = (DecodeFn)cmdDecodePoint;
     }
-    else if (strcmp(cmd_set[Cmd_Line], cmd_start) == 0) {
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_Line]) == 0) {
         cmd->base.type = Cmd_Line;
         decode_fn = (DecodeFn)cmdDecodeLine;
     }
-    else if (strcmp(cmd_set[Cmd_Speed], cmd_start) == 0) {
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_Curve]) == 0) {
+        cmd->base.type = Cmd_Curve;
+        decode_fn = (DecodeFn)cmdDecodeCurve;
+    }
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_Arc]) == 0) {
+        cmd->base.type = Cmd_Arc;
+        decode_fn = (DecodeFn)cmdDecodeArc;
+    }
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_Speed]) == 0) {
         cmd->base.type = Cmd_Speed;
         cmd->speed.hold_time = 0;
         decode_fn = (DecodeFn)cmdDecodeSpeed;
     }
-    else if (strcmp(cmd_set[Cmd_Hold], cmd_start) == 0) {
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_Hold]) == 0) {
         cmd->base.type = Cmd_Speed; // This isn't a mistake
         cmd->speed.speed = 0;
         decode_fn = (DecodeFn)cmdDecodeHold;
     }
-    else if (strcmp(cmd_set[Cmd_Sequence], cmd_start) == 0) {
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_Sequence]) == 0) {
         cmd->base.type = Cmd_Sequence;
         decode_fn = (DecodeFn)cmdDecodeSequence;
     }
-    else if (strcmp(cmd_set[Cmd_Set], cmd_start) == 0) {
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_Set]) == 0) {
         cmd->base.type = Cmd_Set;
         cmd->set.set = true;
         decode_fn = (DecodeFn)cmdDecodeSet;
     }
-    else if (strcmp(cmd_set[Cmd_Unset], cmd_start) == 0) {
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_Unset]) == 0) {
         cmd->base.type = Cmd_Unset;
         cmd->set.set = false;
         decode_fn = (DecodeFn)cmdDecodeSet;
     }
-    else if (strcmp(cmd_set[Cmd_Noop], cmd_start) == 0) {
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_Slew]) == 0) {
+        cmd->base.type = Cmd_Slew;
+        decode_fn = (DecodeFn)cmdDecodeSlew;
+    }
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_Refresh]) == 0) {
+        cmd->base.type = Cmd_Refresh;
+        decode_fn = (DecodeFn)cmdDecodeRefresh;
+    }
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_Transform]) == 0) {
+        cmd->base.type = Cmd_Transform;
+        decode_fn = (DecodeFn)cmdDecodeTransform;
+    }
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_Pool]) == 0) {
+        cmd->base.type = Cmd_Pool;
+        decode_fn = (DecodeFn)cmdDecodePool;
+    }
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_Blank]) == 0) {
+        cmd->base.type = Cmd_Blank;
+    }
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_RLine]) == 0) {
+        cmd->base.type = Cmd_RLine;
+        decode_fn = (DecodeFn)cmdDecodeRel;
+    }
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_RMove]) == 0) {
+        cmd->base.type = Cmd_RMove;
+        decode_fn = (DecodeFn)cmdDecodeRel;
+    }
+    else if (strcmp_P(cmd_start, cmd_set[Cmd_Noop]) == 0) {
         cmd->base.type = Cmd_Noop;
     }
     else {
@@ -322,29 +692,97 @@ err_t cmdParse(CommandUnion* cmd, char* buf, uint8_t len) {
     return CMD_OK;
 }
 
+void cmdSetBinary(bool enable) {
+    binary_mode = enable;
+}
+
+bool cmdBinary(void) {
+    return binary_mode;
+}
+
+uint8_t cmdBinarySize(uint8_t first) {
+    switch (first) {
+    case CMD_BIN_POINT:
+    case CMD_BIN_RLINE:
+    case CMD_BIN_RMOVE:
+        return 5;
+    case CMD_BIN_LINE:
+        return 9;
+    case CMD_BIN_RLINE8:
+    case CMD_BIN_RMOVE8:
+        return 3;
+    case CMD_BIN_PACKED:
+        // Up to the length. The packed bytes follow
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+static inline int16_t binInt16(const uint8_t* buf) {
+    return (int16_t)(buf[0] | ((uint16_t)buf[1] << 8));
+}
+
+// Decode a binary record into the same commands the lines give
+err_t cmdDecodeBinary(CommandUnion* cmd, const uint8_t* buf, uint8_t len) {
+    memset(cmd, '\0', sizeof(CommandUnion));
+    if (len < cmdBinarySize(buf[0])) return CMD_ERR_PARSE;
+
+    const uint8_t* args = &buf[1];
+    switch (buf[0]) {
+    case CMD_BIN_POINT:
+        cmd->base.type = Cmd_Point;
+        cmd->point.x   = binInt16(&args[0]);
+        cmd->point.y   = binInt16(&args[2]);
+        break;
+    case CMD_BIN_LINE:
+        cmd->base.type = Cmd_Line;
+        cmd->line.x1   = binInt16(&args[0]);
+        cmd->line.y1   = binInt16(&args[2]);
+        cmd->line.x2   = binInt16(&args[4]);
+        cmd->line.y2   = binInt16(&args[6]);
+        break;
+    case CMD_BIN_RLINE:
+    case CMD_BIN_RMOVE:
+        cmd->base.type = (buf[0] == CMD_BIN_RLINE) ? Cmd_RLine : Cmd_RMove;
+        cmd->rel.dx    = binInt16(&args[0]);
+        cmd->rel.dy    = binInt16(&args[2]);
+        break;
+    case CMD_BIN_RLINE8:
+    case CMD_BIN_RMOVE8:
+        cmd->base.type = (buf[0] == CMD_BIN_RLINE8) ? Cmd_RLine : Cmd_RMove;
+        cmd->rel.dx    = (int8_t)args[0];
+        cmd->rel.dy    = (int8_t)args[1];
+        break;
+    default:
+        return CMD_ERR_BAD_CMD;
+    }
+    return CMD_OK;
+}
+
 const char* cmdErrToText(err_t errcode) {
     switch (errcode) {
     case CMD_OK:
-        return "No error";
+        return PSTR("No error");
     case CMD_ERROR_OTHER:
-        return "Other command error";
+        return PSTR("Other command error");
     case CMD_ERR_BUF_OVERRUN:
-        return "Buffer overrun";
+        return PSTR("Buffer overrun");
     case CMD_ERR_BAD_CMD:
-        return "Unknown command";
+        return PSTR("Unknown command");
     case CMD_ERR_CMD_TOO_LONG:
-        return "Command too long";
+        return PSTR("Command too long");
     case CMD_ERR_CMD_NOOP:
-        return "Noop command not handled";
-    case CMD_MAX_NUM_ARGS:
-        return "Too marny arguments";
+        return PSTR("Noop command not handled");
+    case CMD_ERR_TOO_MANY_ARGS:
+        return PSTR("Too marny arguments");
     case CMD_ERR_WRONG_NUM_ARGS:
-        return "Wrong number of arguments";
+        return PSTR("Wrong number of arguments");
     case CMD_ERR_PARSE:
-        return "Parse error";
+        return PSTR("Parse error");
     case CMD_ERR_BAD_ARG:
-        return "Bad argument";
+        return PSTR("Bad argument");
     default:
-        return "Unknown command error";
+        return PSTR("Unknown command error");
     }
 }
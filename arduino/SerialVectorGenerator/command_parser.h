@@ -7,8 +7,30 @@
 #include "ring_mem_pool.h"
 
 #define CMD_BUF_SIZE 255
-#define CMD_MAX_NUM_ARGS 10
+#define CMD_MAX_NUM_ARGS 11 // A cubic curve given to sequence set
 #define CMD_MAX_TOKEN 16
+#define CMD_NAME_SIZE 10 // Longest command name, "transform", and its end
+#define CMD_PRIO_PREFIX '!'
+#define CMD_PRIO_BUF_SIZE 32
+#define CMD_BATCH_SEP ';'
+#define CMD_BATCH_MAX 64 // Commands of a batch answered together at most
+#define CMD_SLEW_MAX  (UINT16_MAX / 1000.0f) // Largest slew speed or acceleration
+#define CMD_REFRESH_MIN 1.0f       // Slowest and fastest locked frame rates, so the period fits in 32 bit microseconds
+#define CMD_REFRESH_MAX 1000000.0f
+#define CMD_TRANSFORM_MAX 32767.0f // Largest matrix entry or scale, so it fits in 16.16 fixed point
+
+// Binary records
+// First byte of each, with the command in the low bits. The arguments follow little endian, with no line end
+#define CMD_BIN_FLAG   0x80
+#define CMD_BIN_POINT  0x80 // x y, int16
+#define CMD_BIN_LINE   0x81 // x1 y1 x2 y2, int16
+#define CMD_BIN_RLINE  0x82 // dx dy, int16
+#define CMD_BIN_RMOVE  0x83 // dx dy, int16
+#define CMD_BIN_RLINE8 0x84 // dx dy, int8
+#define CMD_BIN_RMOVE8 0x85 // dx dy, int8
+#define CMD_BIN_PACKED 0x86 // len, then len bytes: the chain, then records packed by lz_pack.h
+#define CMD_PACKED_MAX     128 // Packed bytes a record can hold, with the chain
+#define CMD_PACKED_MOTIONS 8   // Motions a host should pack together at most, so they fit while the pool is half full
 
 #define CMD_OK                  0
 #define CMD_ERROR_OTHER        -1
@@ -27,16 +49,34 @@ typedef enum CommandType {
     Cmd_Scale = 0,
     Cmd_Point,
     Cmd_Line,
+    Cmd_Curve,
+    Cmd_Arc,
     Cmd_Speed,
     Cmd_Hold,
     Cmd_Sequence,
     Cmd_Set,
     Cmd_Unset,
+    Cmd_Slew,
+    Cmd_Refresh,
+    Cmd_Transform,
+    Cmd_Pool,
+    Cmd_Blank,
+    Cmd_RLine,
+    Cmd_RMove,
     Cmd_Noop,
+    Cmd_Packed,
     Cmd_NUM,
 } CommandType;
 
 // Command formats
+// Any command other than a motion can be started with CMD_PRIO_PREFIX, e.g. "!blank"
+// Those are run before anything waiting in the normal buffer
+// Blank, scale, transform, and sequence clear restart the current motion so they show at once
+// With the prompt off, their ACK or NAK starts with CMD_PRIO_PREFIX too
+// Commands on the normal lane can share a line, split by CMD_BATCH_SEP, e.g. "line 0 0 9 9;rline 0 -9"
+// With the prompt off, a batch gets one answer: "ACK n" when all n were taken, or else "NAK " and a 1 or 0 for each
+// Batches longer than CMD_BATCH_MAX are answered every CMD_BATCH_MAX commands
+//
 // Scale: Set the scale for the dimentions
 //        scale x_width y_width x_centered y_centered
 //        x_width: Number that represents distance between center and edge of x-dimention. Will be rounded up to nearest power of 2
@@ -44,8 +84,16 @@ typedef enum CommandType {
 //        x_centered: Sets zero point for x-dimention to the center of the screen when true
 //        y_centered: Sets zero point for y-dimention to the center of the screen when true
 //
-// Set: Set the position on the screen
-//      set x y
+// Set: Set a flag
+//      set name [value]
+//      unset name
+//      binary: Take binary records as well as lines. Wait for its ACK before sending any
+//      framed: Take the stream in checked frames, see frame_link.h. Wait for its ACK before sending any
+//              Bad frames are answered "RESEND n", and only frame n needs to come again
+//      baud: Move the serial link to another rate, e.g. "set baud 1000000". See baud_switch.h
+//            Answered at the old rate. NAKed when the UART can't get close enough to it
+//      hold: A motion refused for want of room turns away every motion after it too, until "set hold" comes again
+//            Sent again in order after that, refused motions are drawn in the order they were first sent
 // Line: Draw a line on the sreen
 //       line x1 y1 x2 y2 ms
 //       x1: Start position x-dimention
@@ -53,6 +101,76 @@ typedef enum CommandType {
 //       x2: End position x-dimention
 //       y2: End position y-dimention
 //       ms: Time in milliseconds to get to that position
+//
+// RLine: Draw a line from where the last motion ended
+//        rline dx dy
+//        dx, dy: Distance to the end of the line
+//
+// RMove: Move where the next relative line starts, without drawing
+//        rmove dx dy
+//
+// Curve: Draw a quadratic or cubic Bezier curve on the screen
+//        curve x0 y0 cx cy x1 y1
+//        curve x0 y0 c1x c1y c2x c2y x1 y1
+//        x0, y0: Start position
+//        cx, cy: Control points. One for quadratic, two for cubic
+//        x1, y1: End position
+//
+// Arc: Draw a circular arc on the screen
+//      arc cx cy r start_angle end_angle
+//      cx, cy: Center of the circle
+//      r: Radius
+//      start_angle, end_angle: Degrees counter clockwise from the x-axis. Drawn clockwise when end is less than start
+//
+// Slew: Plan line velocities to stay within the slew rate of the deflection amps
+//       slew max_speed accel
+//       max_speed: Fastest the beam may move in points per microsecond. Zero disables planning
+//       accel: Points per microsecond the beam may gain or lose in a millisecond
+//       Corners sharper than a right angle are taken at the speed set by the speed command
+//       Neither can be more than CMD_SLEW_MAX
+//
+// Refresh: Lock the frame rate of a sequence
+//          refresh hz [idle]
+//          hz: Frames per second. Line speeds are scaled to fit the frame. Zero disables the lock
+//              Otherwise from CMD_REFRESH_MIN to CMD_REFRESH_MAX
+//          idle: When true short frames are drawn at normal speed and padded with blank time
+//
+// Transform: Scale, rotate, and move what is drawn, including a loaded sequence
+//            transform a b c d tx ty
+//            transform angle [scale [tx ty]]
+//            transform
+//            a, b, c, d: Matrix. x' = a*x + b*y + tx, y' = c*x + d*y + ty
+//            angle: Degrees counter clockwise
+//            scale: Size multiplier
+//            tx, ty: Move after scaling and rotating
+//            No arguments resets it. Arcs only follow rotation, uniform scaling, and moves
+//            a, b, c, d, and scale can't be more than CMD_TRANSFORM_MAX either way
+//
+// Sequence: Keep a frame of motions and draw it over and over
+//           sequence start|end|clear
+//           sequence set idx motion
+//           sequence insert idx motion
+//           sequence delete idx
+//           start: Drop what's queued, motions that follow are kept until end. Then they're drawn
+//           clear: Stop drawing and drop the sequence, like blank
+//           set, insert, delete: Edit entry idx of a loaded sequence without stopping it, e.g. "sequence set 3 line 0 0 9 9"
+//           motion: A point, line, curve, or arc. Insert at the size appends
+//
+// Blank: Stop drawing now. Queued motions and any sequence are dropped
+//        blank
+//
+// Pool: Report how full the motion pool has been
+//       pool [clear]
+//       clear: Reset the counters after reporting them
+//
+// Binary records: With binary set, a command starting with CMD_BIN_FLAG is a record of a fixed size
+//                 The size comes from the first byte. Lines are still read between records
+//                 Relative lines fit in three bytes when both distances fit in a byte
+//                 A packed record holds other records. All of its motions are taken, or none when the pool
+//                 hasn't room for them, so it can be sent again like an absolute motion
+//                 Its chain is zero to start the LZ window afresh, as a host does at the start of a frame.
+//                 Otherwise it's the count of packed records taken since, and copies reach back into theirs.
+//                 One that doesn't follow on from those taken is an error. Sent again, they keep their order with "set hold"
 
 typedef struct Command {
     char* buf;
@@ -83,33 +201,105 @@ typedef struct LineCmd {
     int16_t y2;
 } LineCmd;
 
+typedef struct RelCmd {
+    Command base;
+    int16_t dx;
+    int16_t dy;
+} RelCmd;
+
+typedef struct CurveCmd {
+    Command base;
+    uint8_t order; // 2 for quadratic, 3 for cubic
+    int16_t x[4];
+    int16_t y[4];
+} CurveCmd;
+
+typedef struct ArcCmd {
+    Command base;
+    int16_t cx;
+    int16_t cy;
+    int16_t r;
+    int16_t start;
+    int16_t end;
+} ArcCmd;
+
 typedef struct SpeedCmd {
     Command base;
     int16_t hold_time;
     float speed;
 } SpeedCmd;
 
+typedef struct SlewCmd {
+    Command base;
+    float max_speed;
+    float accel;
+} SlewCmd;
+
+typedef struct RefreshCmd {
+    Command base;
+    float rate;
+    bool idle;
+} RefreshCmd;
+
+typedef struct TransformCmd {
+    Command base;
+    bool rotate;   // Given as an angle and scale instead of a matrix
+    int16_t angle; // Degrees
+    float scale;
+    float a;
+    float b;
+    float c;
+    float d;
+    int16_t tx;
+    int16_t ty;
+} TransformCmd;
+
+typedef struct PoolCmd {
+    Command base;
+    bool clear;
+} PoolCmd;
+
 typedef struct SequenceCmd {
     Command base;
     bool start;
     bool end;
     bool clear;
+    bool set;
+    bool insert;
+    bool remove;
+    uint8_t idx;  // Entry to edit
+    char* motion; // Rest of the line for set and insert, e.g. "line 0 0 9 9"
 } SequenceCmd;
 
+typedef struct PackedCmd {
+    Command base;
+    uint8_t records; // Unpacked from it
+    uint8_t len;     // Packed bytes
+} PackedCmd;
+
 typedef struct SetCmd {
     Command base;
     bool set;
     const char* name;
+    const char* value; // Given to set only, NULL when there's none
 } SetCmd;
 
 typedef union CmdUnion {
-    Command     base;
-    ScaleCmd    scale;
-    PointCmd    point;
-    LineCmd     line;
-    SpeedCmd    speed;
-    SequenceCmd sequence;
-    SetCmd      set;
+    Command      base;
+    ScaleCmd     scale;
+    PointCmd     point;
+    LineCmd      line;
+    RelCmd       rel;
+    CurveCmd     curve;
+    ArcCmd       arc;
+    SpeedCmd     speed;
+    SlewCmd      slew;
+    RefreshCmd   refresh;
+    TransformCmd transform;
+    PoolCmd      pool;
+    SequenceCmd  sequence;
+    SetCmd       set;
+    PackedCmd    packed;
 } CommandUnion;
 
 void clearCache(void);
@@ -117,9 +307,22 @@ err_t buildCmd(const char* new_cmd, uint8_t len);
 uint8_t commandSize(void);
 uint8_t noopCommand(void);
 bool commandComplete(void);
+bool prioCommandComplete(void);
+err_t getPrioCmd(char* buf, uint8_t buf_len);
+// Take the next command without copying it. It's good until more is built
+err_t takePrioCmd(char** cmd, uint8_t* len);
 uint8_t cmdBufLen(void);
 err_t getCmd(char* buf, uint8_t buf_len);
+err_t takeCmd(char** cmd, uint8_t* len);
+// The last command taken was followed by CMD_BATCH_SEP
+bool cmdBatched(void);
 err_t cmdParse(CommandUnion* cmd_pool, char* buf, uint8_t len);
+void cmdSetBinary(bool enable);
+bool cmdBinary(void);
+// Bytes in the record started by this byte. Unknown records are a single byte
+uint8_t cmdBinarySize(uint8_t first);
+err_t cmdDecodeBinary(CommandUnion* cmd, const uint8_t* buf, uint8_t len);
+// The text is in flash on AVR, see common.h
 const char* cmdErrToText(err_t errcode);
 
 #endif // CONTROL_PARSER_HH
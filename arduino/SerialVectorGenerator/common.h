@@ -5,4 +5,16 @@
 #define NULL 0
 #endif
 
+// Constant strings and tables stay in flash on AVR, or every one takes a copy in its 2 KB of SRAM
+// Elsewhere they're read like any other memory
+#ifdef AVR
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define strcmp_P   strcmp
+#define snprintf_P snprintf
+#endif
+
 #endif // COMMON_H
@@ -1,55 +1,157 @@
 #include <string.h>
 
 #include "command_parser.h"
+#include "ring_mem_pool.h"
 #include "screen_controller.h"
 
 static inline String printScaleCmd(const ScaleCmd* cmd) {
-    Serial.print("scale");
-    Serial.print(" x_width: ");
+    Serial.print(F("scale"));
+    Serial.print(F(" x_width: "));
     Serial.print(cmd->x_width);
-    Serial.print(" y_width: ");
+    Serial.print(F(" y_width: "));
     Serial.print(cmd->y_width);
-    Serial.print(" x_centered: ");
+    Serial.print(F(" x_centered: "));
     Serial.print(cmd->x_centered);
-    Serial.print(" y_centered: ");
+    Serial.print(F(" y_centered: "));
     Serial.print(cmd->y_centered);
 }
 
 static inline void printPointCmd(const PointCmd* cmd) {
-    Serial.print("point x: ");
+    Serial.print(F("point x: "));
     Serial.print(cmd->x);
-    Serial.print(" y: ");
+    Serial.print(F(" y: "));
     Serial.print(cmd->y);
 }
 
 static inline void printLineCmd(const LineCmd* cmd) {
-    Serial.print("line");
-    Serial.print(" x1: ");
+    Serial.print(F("line"));
+    Serial.print(F(" x1: "));
     Serial.print(cmd->x1);
-    Serial.print(" y1: ");
+    Serial.print(F(" y1: "));
     Serial.print(cmd->y1);
-    Serial.print(" x2: ");
+    Serial.print(F(" x2: "));
     Serial.print(cmd->x2);
-    Serial.print(" y2: ");
+    Serial.print(F(" y2: "));
     Serial.print(cmd->y2);
 }
 
+static inline void printCurveCmd(const CurveCmd* cmd) {
+    Serial.print(F("curve"));
+    for (uint8_t i = 0; i <= cmd->order; i++) {
+        Serial.print(F(" x"));
+        Serial.print(i);
+        Serial.print(F(": "));
+        Serial.print(cmd->x[i]);
+        Serial.print(F(" y"));
+        Serial.print(i);
+        Serial.print(F(": "));
+        Serial.print(cmd->y[i]);
+    }
+}
+
+static inline void printArcCmd(const ArcCmd* cmd) {
+    Serial.print(F("arc"));
+    Serial.print(F(" cx: "));
+    Serial.print(cmd->cx);
+    Serial.print(F(" cy: "));
+    Serial.print(cmd->cy);
+    Serial.print(F(" r: "));
+    Serial.print(cmd->r);
+    Serial.print(F(" start: "));
+    Serial.print(cmd->start);
+    Serial.print(F(" end: "));
+    Serial.print(cmd->end);
+}
+
 static inline void printSpeedCmd(const SpeedCmd* cmd) {
-    Serial.print("speed");
-    Serial.print(" holdtime: ");
+    Serial.print(F("speed"));
+    Serial.print(F(" holdtime: "));
     Serial.print(cmd->hold_time);
-    Serial.print(" speed: ");
+    Serial.print(F(" speed: "));
     Serial.print(cmd->speed);
 }
 
+static inline void printSlewCmd(const SlewCmd* cmd) {
+    Serial.print(F("slew"));
+    Serial.print(F(" max_speed: "));
+    Serial.print(cmd->max_speed);
+    Serial.print(F(" accel: "));
+    Serial.print(cmd->accel);
+}
+
+static inline void printRefreshCmd(const RefreshCmd* cmd) {
+    Serial.print(F("refresh"));
+    Serial.print(F(" rate: "));
+    Serial.print(cmd->rate);
+    Serial.print(F(" idle: "));
+    Serial.print(cmd->idle);
+}
+
+static inline void printTransformCmd(const TransformCmd* cmd) {
+    Serial.print(F("transform"));
+    if (cmd->rotate) {
+        Serial.print(F(" angle: "));
+        Serial.print(cmd->angle);
+        Serial.print(F(" scale: "));
+        Serial.print(cmd->scale);
+    }
+    else {
+        Serial.print(F(" a: "));
+        Serial.print(cmd->a);
+        Serial.print(F(" b: "));
+        Serial.print(cmd->b);
+        Serial.print(F(" c: "));
+        Serial.print(cmd->c);
+        Serial.print(F(" d: "));
+        Serial.print(cmd->d);
+    }
+    Serial.print(F(" tx: "));
+    Serial.print(cmd->tx);
+    Serial.print(F(" ty: "));
+    Serial.print(cmd->ty);
+}
+
+static inline void printRelCmd(const RelCmd* cmd) {
+    Serial.print((cmd->base.type == Cmd_RLine) ? F("rline") : F("rmove"));
+    Serial.print(F(" dx: "));
+    Serial.print(cmd->dx);
+    Serial.print(F(" dy: "));
+    Serial.print(cmd->dy);
+}
+
 static inline void printSequenceCmd(const SequenceCmd* cmd) {
-    Serial.print("sequence ");
+    Serial.print(F("sequence "));
     Serial.print(cmd->base.args[0]);
+    if (cmd->set || cmd->insert || cmd->remove) {
+        Serial.print(F(" idx: "));
+        Serial.print(cmd->idx);
+    }
+    if (cmd->motion != NULL) {
+        Serial.write(' ');
+        Serial.print(cmd->motion);
+    }
 }
 
 static inline void printSetCmd(const SetCmd* cmd) {
-    Serial.print((cmd->set) ? "set " : "unset ");
+    Serial.print((cmd->set) ? F("set ") : F("unset "));
     Serial.print(cmd->base.args[0]);
+    if (cmd->value != NULL) {
+        Serial.write(' ');
+        Serial.print(cmd->value);
+    }
+}
+
+static inline void printPackedCmd(const PackedCmd* cmd) {
+    Serial.print(F("packed records: "));
+    Serial.print(cmd->records);
+    Serial.print(F(" len: "));
+    Serial.print(cmd->len);
+}
+
+static inline void printPoolCmd(const PoolCmd* cmd) {
+    Serial.print(F("pool"));
+    Serial.print(F(" clear: "));
+    Serial.print(cmd->clear);
 }
 
 void printCommand(const Command* cmd) {
@@ -63,10 +165,32 @@ void printCommand(const Command* cmd) {
     case Cmd_Line:
         printLineCmd((const LineCmd*) cmd);
         break;
+    case Cmd_RLine:
+    case Cmd_RMove:
+        printRelCmd((const RelCmd*) cmd);
+        break;
+    case Cmd_Curve:
+        printCurveCmd((const CurveCmd*) cmd);
+        break;
+    case Cmd_Arc:
+        printArcCmd((const ArcCmd*) cmd);
+        break;
     case Cmd_Speed:
     case Cmd_Hold:
         printSpeedCmd((const SpeedCmd*) cmd);
         break;
+    case Cmd_Slew:
+        printSlewCmd((const SlewCmd*) cmd);
+        break;
+    case Cmd_Refresh:
+        printRefreshCmd((const RefreshCmd*) cmd);
+        break;
+    case Cmd_Transform:
+        printTransformCmd((const TransformCmd*) cmd);
+        break;
+    case Cmd_Pool:
+        printPoolCmd((const PoolCmd*) cmd);
+        break;
     case Cmd_Sequence:
         printSequenceCmd((const SequenceCmd*) cmd);
         break;
@@ -74,37 +198,78 @@ void printCommand(const Command* cmd) {
     case Cmd_Unset:
         printSetCmd((const SetCmd*) cmd);
         break;
+    case Cmd_Blank:
+        Serial.print(F("blank"));
+        break;
     case Cmd_Noop:
-        Serial.print("noop");
+        Serial.print(F("noop"));
+        break;
+    case Cmd_Packed:
+        printPackedCmd((const PackedCmd*) cmd);
         break;
     default:
-        Serial.print("Unknown command motion type ");
+        Serial.print(F("Unknown command motion type "));
         Serial.print(cmd->type);
         break;
     }
 }
 
 static inline void printPointMotion(const PointMotion* motion) {
-    Serial.print("PointMotion x: ");
+    Serial.print(F("PointMotion x: "));
     Serial.print(motion->x);
-    Serial.print(" y: ");
+    Serial.print(F(" y: "));
     Serial.print(motion->y);
 }
 
 static inline String printLineMotion(const LineMotion* motion) {
-    Serial.write("LineMotion ");
-    Serial.print(" x1: ");
-    Serial.print(motion->mx1 / 1000);
-    Serial.print(" y1: ");
-    Serial.print(motion->my1 / 1000);
-    Serial.print(" x2: ");
-    Serial.print(motion->mx2 / 1000);
-    Serial.print(" y2: ");
-    Serial.print(motion->my2 / 1000);
-    Serial.print(" dx: ");
-    Serial.print(motion->dx);
-    Serial.print(" dy: ");
-    Serial.print(motion->dy);
+    Serial.print(F("LineMotion "));
+    Serial.print(F(" x1: "));
+    Serial.print(motion->x1);
+    Serial.print(F(" y1: "));
+    Serial.print(motion->y1);
+    Serial.print(F(" x2: "));
+    Serial.print(motion->x2);
+    Serial.print(F(" y2: "));
+    Serial.print(motion->y2);
+    Serial.print(F(" speed: "));
+    Serial.print(motion->speed);
+}
+
+static inline void printCurveMotion(const CurveMotion* motion) {
+    uint8_t last = (motion->base.type == SM_Quad) ? 2 : 3;
+    Serial.print((motion->base.type == SM_Quad) ? F("QuadMotion ") : F("CubicMotion "));
+    for (uint8_t i = 0; i <= last; i++) {
+        Serial.print(F(" x"));
+        Serial.print(i);
+        Serial.print(F(": "));
+        Serial.print(motion->p[i][0]);
+        Serial.print(F(" y"));
+        Serial.print(i);
+        Serial.print(F(": "));
+        Serial.print(motion->p[i][1]);
+    }
+    Serial.print(F(" steps: "));
+    Serial.print(motion->steps);
+    Serial.print(F(" duration: "));
+    Serial.print(motion->duration);
+}
+
+static inline void printArcMotion(const ArcMotion* motion) {
+    Serial.print(F("ArcMotion "));
+    Serial.print(F(" cx: "));
+    Serial.print(motion->cx);
+    Serial.print(F(" cy: "));
+    Serial.print(motion->cy);
+    Serial.print(F(" r: "));
+    Serial.print(motion->r);
+    Serial.print(F(" start: "));
+    Serial.print(motion->start);
+    Serial.print(F(" end: "));
+    Serial.print(motion->end);
+    Serial.print(F(" steps: "));
+    Serial.print(motion->steps);
+    Serial.print(F(" duration: "));
+    Serial.print(motion->duration);
 }
 
 void serialPrintMotion(const ScreenMotion* motion) {
@@ -115,16 +280,48 @@ void serialPrintMotion(const ScreenMotion* motion) {
     case SM_Line:
         printLineMotion((const LineMotion*) motion);
         break;
+    case SM_Quad:
+    case SM_Cubic:
+        printCurveMotion((const CurveMotion*) motion);
+        break;
+    case SM_Arc:
+        printArcMotion((const ArcMotion*) motion);
+        break;
     default:
-        Serial.write((String("Unknown screen motion type ") + motion->type).c_str());
+        Serial.print(F("Unknown screen motion type "));
+        Serial.print(motion->type);
         break;
     }
 }
 
+void printPoolStats(const RingMemPool* ring, const RingStats* stats) {
+    Serial.print(F("PoolStats"));
+    Serial.print(F(" size: "));
+    Serial.print(ring->size);
+    Serial.print(F(" used: "));
+    Serial.print(stats->used);
+    Serial.print(F(" entries: "));
+    Serial.print(ring->count);
+    Serial.print(F(" high_bytes: "));
+    Serial.print(stats->high_bytes);
+    Serial.print(F(" high_entries: "));
+    Serial.print(stats->high_entries);
+    Serial.print(F(" out_of_mem: "));
+    Serial.print(stats->out_of_mem);
+    Serial.print(F(" wrap_waste: "));
+    Serial.print(stats->wrap_waste);
+    Serial.print(F(" pushes: "));
+    Serial.print(stats->pushes);
+    Serial.print(F(" pops: "));
+    Serial.print(stats->pops);
+}
+
 void printBeamState(const BeamState* state) {
-    Serial.write((String("BeamState ")
-        + " x: "      + state->x
-        + " y: "      + state->y
-        + " active: " + state->a
-    ).c_str());
+    Serial.print(F("BeamState "));
+    Serial.print(F(" x: "));
+    Serial.print(state->x);
+    Serial.print(F(" y: "));
+    Serial.print(state->y);
+    Serial.print(F(" active: "));
+    Serial.print(state->a);
 }
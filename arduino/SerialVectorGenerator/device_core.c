@@ -0,0 +1,498 @@
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "device_core.h"
+#include "lz_pack.h"
+#include "utils.h"
+
+// Frames are only taken whole. Errors past that are reported like any others
+static bool deliverPayload(void* ctx, const uint8_t* data, uint8_t len) {
+    (void)ctx;
+    if (CMD_BUF_SIZE - 1 - cmdBufLen() < len) return false;
+    buildCmd((const char*)data, len);
+    return true;
+}
+
+void device_init(DeviceCore* core, ScreenState* screen, RingMemPool* pool, SampleCache* cache) {
+    core->screen = screen;
+    core->pool   = pool;
+#ifdef SAMPLE_CACHE
+    core->cache  = cache;
+#else
+    (void)cache;
+#endif
+    core->batch_open  = false;
+    core->batch_count = 0;
+    link_init(&core->link, deliverPayload, NULL);
+    baud_init(&core->baud, 0, 0);
+    core->hold    = false;
+    core->holding = false;
+    lz_init(&core->packed, NULL, 0);
+    core->packed_chain = 0;
+    core->now = 0;
+}
+
+err_t device_receive(DeviceCore* core, const char* data, uint8_t len) {
+    if (baud_active(&core->baud)) {
+        baud_receive(&core->baud, data, len, core->now);
+        return CMD_OK;
+    }
+    if (!core->link.enabled) {
+        return (len) ? buildCmd(data, len) : CMD_OK;
+    }
+    link_receive(&core->link, (const uint8_t*)data, len);
+    return CMD_OK;
+}
+
+bool device_resend(DeviceCore* core, uint8_t* seq) {
+    return link_resend(&core->link, seq);
+}
+
+// Motions keep their order in the normal buffer
+static inline bool motionCommand(CommandType type) {
+    return (type == Cmd_Point || type == Cmd_Line || type == Cmd_Curve || type == Cmd_Arc
+            || type == Cmd_RLine || type == Cmd_RMove);
+}
+
+// Drop the recorded frame, if there's a cache to keep one
+static inline void invalidateCache(DeviceCore* core) {
+#ifdef SAMPLE_CACHE
+    cache_invalidate(core->cache);
+#else
+    (void)core;
+#endif
+}
+
+// Commands that change what's on the screen, cut in at once when given on the priority lane
+static bool changesOutput(const CommandUnion* cmd) {
+    switch (cmd->base.type) {
+    case Cmd_Scale:
+    case Cmd_Transform:
+    case Cmd_Blank:
+        return true;
+    case Cmd_Sequence:
+        return cmd->sequence.clear;
+    default:
+        return false;
+    }
+}
+
+// Move the pen to where a motion ends
+static void movePen(ScreenState* screen, const CommandUnion* cmd) {
+    float end;
+    switch (cmd->base.type) {
+    case Cmd_Point:
+        screen->pen_x = cmd->point.x;
+        screen->pen_y = cmd->point.y;
+        break;
+    case Cmd_Line:
+        screen->pen_x = cmd->line.x2;
+        screen->pen_y = cmd->line.y2;
+        break;
+    case Cmd_Curve:
+        screen->pen_x = cmd->curve.x[cmd->curve.order];
+        screen->pen_y = cmd->curve.y[cmd->curve.order];
+        break;
+    case Cmd_Arc:
+        end = cmd->arc.end * (float)M_PI / 180;
+        screen->pen_x = cmd->arc.cx + lroundf(cmd->arc.r * cosf(end));
+        screen->pen_y = cmd->arc.cy + lroundf(cmd->arc.r * sinf(end));
+        break;
+    case Cmd_RLine:
+    case Cmd_RMove:
+        screen->pen_x += cmd->rel.dx;
+        screen->pen_y += cmd->rel.dy;
+        break;
+    default:
+        break;
+    }
+}
+
+// Build the motion of a sequence edit, stored as given like those loaded
+static ScreenMotion* buildEdit(const ScreenState* screen, RingMemPool* scratch, const CommandUnion* cmd) {
+    switch (cmd->base.type) {
+    case Cmd_Point:
+        return (ScreenMotion*)screen_push_point(screen, scratch, &cmd->point);
+    case Cmd_Line:
+        return (ScreenMotion*)screen_push_line(screen, scratch, &cmd->line);
+    case Cmd_Curve:
+        return (ScreenMotion*)screen_push_curve(screen, scratch, &cmd->curve);
+    case Cmd_Arc:
+        return (ScreenMotion*)screen_push_arc(screen, scratch, &cmd->arc);
+    default:
+        return NULL;
+    }
+}
+
+// Change one entry of a loaded sequence, leaving the rest of the frame as it is
+static bool editSequence(DeviceCore* core, const SequenceCmd* edit) {
+    ScreenState* screen = core->screen;
+    if (edit->remove) return sequence_delete(screen, edit->idx);
+    if (!screen->sequence_enabled) return false;
+
+    CommandUnion cmd;
+    if (cmdParse(&cmd, edit->motion, strlen(edit->motion)) != CMD_OK) return false;
+
+    // Built on the side, the sequence copies it where it goes
+    char scratch_mem[sizeof(MotionUnion) + RING_LARGE_HDR + 1];
+    RingMemPool scratch;
+    ring_init(&scratch, scratch_mem, sizeof(scratch_mem));
+    const ScreenMotion* motion = buildEdit(screen, &scratch, &cmd);
+    if (motion == NULL) return false;
+    return (edit->set) ? sequence_set(screen, core->pool, edit->idx, motion)
+                       : sequence_insert(screen, core->pool, edit->idx, motion);
+}
+
+// Run a parsed command
+static void runCommand(DeviceCore* core, CommandResult* result) {
+    ScreenState* screen = core->screen;
+    RingMemPool* pool   = core->pool;
+    CommandUnion* cmd   = &result->cmd;
+    LineCmd line;
+    result->handled = true;
+    result->success = false;
+    result->motion  = NULL;
+
+    // Behind a refused motion. Taking it would draw it first
+    if (core->holding && motionCommand(cmd->base.type)) return;
+
+    switch (cmd->base.type) {
+    case Cmd_Point:
+        result->motion = (ScreenMotion*)screen_push_point(screen, pool, &cmd->point);
+        // Motions off the screen are dropped without an error
+        result->success = (pool->last_err == RING_OK);
+        break;
+    case Cmd_Line:
+        result->motion = (ScreenMotion*)screen_push_line(screen, pool, &cmd->line);
+        result->success = (pool->last_err == RING_OK);
+        break;
+    case Cmd_Curve:
+        result->motion = (ScreenMotion*)screen_push_curve(screen, pool, &cmd->curve);
+        result->success = (pool->last_err == RING_OK);
+        break;
+    case Cmd_Arc:
+        result->motion = (ScreenMotion*)screen_push_arc(screen, pool, &cmd->arc);
+        result->success = (pool->last_err == RING_OK);
+        break;
+    case Cmd_RLine:
+        line.x1 = screen->pen_x;
+        line.y1 = screen->pen_y;
+        line.x2 = screen->pen_x + cmd->rel.dx;
+        line.y2 = screen->pen_y + cmd->rel.dy;
+        result->motion = (ScreenMotion*)screen_push_line(screen, pool, &line);
+        result->success = (pool->last_err == RING_OK);
+        break;
+    case Cmd_RMove:
+        result->success = true;
+        break;
+    case Cmd_Scale:
+        screen->x_size_pow = log2ceil(cmd->scale.x_width);
+        screen->y_size_pow = log2ceil(cmd->scale.y_width);
+        screen->x_centered = cmd->scale.x_centered;
+        screen->y_centered = cmd->scale.y_centered;
+        result->success = true;
+        break;
+    case Cmd_Speed:
+        if (cmd->speed.hold_time > 0) {
+            screen->hold_time = cmd->speed.hold_time;
+            result->success = true;
+        }
+        if (cmd->speed.speed > 0) {
+            screen->speed = cmd->speed.speed * 1000;
+            result->success = true;
+        }
+        break;
+    case Cmd_Slew:
+        result->success = screen_set_slew(screen, cmd->slew.max_speed * 1000, cmd->slew.accel * 1000);
+        break;
+    case Cmd_Refresh:
+        result->success = screen_set_refresh(screen, (cmd->refresh.rate > 0) ? 1000000 / cmd->refresh.rate : 0,
+                                             cmd->refresh.idle);
+        break;
+    case Cmd_Transform:
+        if (cmd->transform.rotate) {
+            result->success = screen_set_rotation(screen, cmd->transform.angle, cmd->transform.scale,
+                                                  cmd->transform.tx, cmd->transform.ty);
+        }
+        else {
+            result->success = screen_set_transform(screen, cmd->transform.a, cmd->transform.b, cmd->transform.c,
+                                                   cmd->transform.d, cmd->transform.tx, cmd->transform.ty);
+        }
+        break;
+    case Cmd_Blank:
+        result->success = screen_blank(screen, pool);
+        break;
+    case Cmd_Sequence:
+        if (cmd->sequence.start) {
+            result->success = sequence_start(screen);
+            if (result->success) ring_reset(pool);
+        }
+        else if (cmd->sequence.end) {
+            result->success = sequence_end(screen);
+        }
+        else if (cmd->sequence.clear) {
+            // Stops the motion being drawn from the cleared pool too
+            result->success = screen_blank(screen, pool);
+        }
+        else {
+            result->success = editSequence(core, &cmd->sequence);
+        }
+        break;
+    case Cmd_Set:
+    case Cmd_Unset:
+        if (strcmp_P(cmd->set.name, PSTR("repeat")) == 0) {
+            screen->repeat = cmd->set.set;
+            result->success = true;
+        }
+        else if (strcmp_P(cmd->set.name, PSTR("binary")) == 0) {
+            cmdSetBinary(cmd->set.set);
+            result->success = true;
+        }
+        else if (strcmp_P(cmd->set.name, PSTR("baud")) == 0) {
+            result->success = (cmd->set.set && cmd->set.value != NULL
+                               && baud_start(&core->baud, strtoul(cmd->set.value, NULL, 10)));
+        }
+        else if (strcmp_P(cmd->set.name, PSTR("hold")) == 0) {
+            // Also where the host has seen the refusals, and starts sending them again
+            core->hold    = cmd->set.set;
+            core->holding = false;
+            result->success = true;
+        }
+        else if (strcmp_P(cmd->set.name, PSTR("framed")) == 0) {
+            link_reset(&core->link);
+            core->link.enabled = cmd->set.set;
+            result->success = true;
+        }
+        else {
+            // Sketch flags
+            result->handled = false;
+        }
+        break;
+    case Cmd_Pool:
+        // Reported by the caller
+        result->handled = false;
+        break;
+    case Cmd_Noop:
+        result->success = true;
+        break;
+    default:
+        break;
+    }
+
+    // Motions dropped off the screen still move the pen. Those refused for want of room don't
+    if (result->success && motionCommand(cmd->base.type)) {
+        movePen(screen, cmd);
+    }
+    else if (core->hold && motionCommand(cmd->base.type)) {
+        core->holding = true;
+    }
+
+    if (result->motion != NULL && screen->sequence_enabled) {
+        result->success = add_to_sequence(screen, result->motion);
+    }
+
+    if (result->priority && result->success && changesOutput(cmd)) {
+        screen_preempt(screen);
+    }
+
+    // Anything that changes the drawn frame has to be recorded again
+    switch (cmd->base.type) {
+    case Cmd_Scale:
+    case Cmd_Speed:
+    case Cmd_Slew:
+    case Cmd_Refresh:
+    case Cmd_Transform:
+    case Cmd_Sequence:
+    case Cmd_Blank:
+        invalidateCache(core);
+        break;
+    default:
+        if (result->motion != NULL && screen->sequence_enabled) {
+            invalidateCache(core);
+        }
+        break;
+    }
+}
+
+// Next record out of a packed one
+static err_t unpackRecord(LzUnpack* lz, CommandUnion* cmd) {
+    uint8_t record[9]; // The largest record, a line
+    if (lz_read(lz, record, 1) != 1) return CMD_ERR_PARSE;
+    uint8_t size = cmdBinarySize(record[0]);
+    if (record[0] == CMD_BIN_PACKED || size > sizeof(record) || lz_read(lz, record + 1, size - 1) != size - 1) {
+        return CMD_ERR_PARSE;
+    }
+    return cmdDecodeBinary(cmd, record, size);
+}
+
+// Start unpacking a packed record. Its first byte is zero to start the window afresh,
+// or the count of packed records taken since then to carry on from their window
+static void startPacked(LzUnpack* lz, const uint8_t* buf) {
+    if (buf[2] == 0) {
+        lz_init(lz, buf + 3, buf[1] - 1);
+    }
+    else {
+        lz_resume(lz, buf + 3, buf[1] - 1);
+    }
+}
+
+// Run the records of a packed one as they're unpacked, straight into the pool
+// They're unpacked once first to check them and count the room they need, so all are taken or none
+static void runPacked(DeviceCore* core, CommandResult* result, const uint8_t* buf) {
+    LzUnpack lz;
+    uint8_t records = 0;
+    uint16_t needed = 0;
+    bool success    = false;
+    if (core->holding) {
+        // Turned away unchecked, as it may carry on from one turned away before it
+    }
+    else if (buf[1] == 0 || (buf[2] != 0 && buf[2] != core->packed_chain)) {
+        // Doesn't follow on from the packed records taken
+        result->err = CMD_ERR_PARSE;
+        return;
+    }
+    else {
+        lz = core->packed;
+        startPacked(&lz, buf);
+        while (!lz_done(&lz)) {
+            result->err = unpackRecord(&lz, &result->cmd);
+            if (result->err) return;
+            // Lines are the largest motion a record makes
+            if (result->cmd.base.type != Cmd_RMove) needed += ring_entry_size(sizeof(LineMotion));
+            records++;
+        }
+
+        if (needed > 0 && ring_remaining(core->pool) <= needed) {
+            core->pool->stats.out_of_mem++;
+            core->holding = core->hold;
+        }
+        else {
+            success = true;
+            startPacked(&core->packed, buf);
+            for (uint8_t i = 0; i < records; i++) {
+                unpackRecord(&core->packed, &result->cmd);
+                runCommand(core, result);
+                success = success && (result->success || result->motion != NULL);
+            }
+            core->packed_chain = (uint8_t)(buf[2] + 1);
+        }
+    }
+
+    memset(&result->cmd, '\0', sizeof(CommandUnion));
+    result->cmd.base.type      = Cmd_Packed;
+    result->cmd.packed.records = records;
+    result->cmd.packed.len     = buf[1];
+    result->handled = true;
+    result->success = success;
+    result->motion  = NULL;
+}
+
+bool device_next(DeviceCore* core, CommandResult* result) {
+    // Nothing to do. Checked first so an idle loop doesn't touch the result
+    bool prio = prioCommandComplete();
+    if (!prio && !commandComplete()) return false;
+
+    char* buf   = NULL;
+    uint8_t len = 0;
+    result->handled   = false;
+    result->success   = false;
+    result->motion    = NULL;
+    result->batched   = false;
+    result->batch_end = false;
+
+    // Priority command
+    if (prio) {
+        result->priority = true;
+        result->err      = takePrioCmd(&buf, &len);
+    }
+    else {
+        result->priority  = false;
+        result->err       = (noopCommand()) ? CMD_ERR_CMD_NOOP : takeCmd(&buf, &len);
+        // The command that ends a batch's line is part of it too
+        result->batched   = core->batch_open || cmdBatched();
+        result->batch_end = result->batched && !cmdBatched();
+        core->batch_open  = cmdBatched();
+    }
+    if (result->err) return true;
+
+    // Parse command
+    if ((uint8_t)buf[0] == CMD_BIN_PACKED) {
+        // Holds motions, which keep their order
+        if (result->priority) {
+            result->err = CMD_ERR_BAD_CMD;
+        }
+        else {
+            runPacked(core, result, (const uint8_t*)buf);
+        }
+        return true;
+    }
+    if ((uint8_t)buf[0] & CMD_BIN_FLAG) {
+        result->err = cmdDecodeBinary(&result->cmd, (const uint8_t*)buf, len);
+    }
+    else {
+        result->err = cmdParse(&result->cmd, buf, len);
+    }
+    if (!result->err && result->priority && motionCommand(result->cmd.base.type)) {
+        result->err = CMD_ERR_BAD_CMD;
+    }
+    if (result->err) return true;
+
+    runCommand(core, result);
+    return true;
+}
+
+bool device_acked(const CommandResult* result) {
+    return (!result->err && (result->success || result->motion));
+}
+
+bool device_batch_add(DeviceCore* core, const CommandResult* result, bool acked) {
+    if (result->err != CMD_ERR_CMD_NOOP) {
+        uint8_t idx = core->batch_count++;
+        if (acked) {
+            core->batch_map[idx / 8] |= 1 << (idx % 8);
+        }
+        else {
+            core->batch_map[idx / 8] &= ~(1 << (idx % 8));
+        }
+    }
+    return core->batch_count > 0 && (result->batch_end || core->batch_count >= CMD_BATCH_MAX);
+}
+
+void device_batch_reply(DeviceCore* core, char* buf, uint8_t len) {
+    uint8_t acked = 0;
+    for (uint8_t i = 0; i < core->batch_count; i++) {
+        acked += (core->batch_map[i / 8] >> (i % 8)) & 0x01;
+    }
+    if (acked == core->batch_count) {
+        snprintf_P(buf, len, PSTR("ACK %u"), core->batch_count);
+    }
+    else {
+        // Which ones to send again
+        uint8_t pos = snprintf_P(buf, len, PSTR("NAK "));
+        for (uint8_t i = 0; i < core->batch_count && pos + 1 < len; i++) {
+            buf[pos++] = ((core->batch_map[i / 8] >> (i % 8)) & 0x01) ? '1' : '0';
+        }
+        buf[pos] = '\0';
+    }
+    core->batch_count = 0;
+}
+
+bool device_update(DeviceCore* core, uint32_t time, DacSample* sample) {
+    core->now = time;
+    baud_update(&core->baud, time);
+#ifdef SAMPLE_CACHE
+    return cache_update(core->cache, time, core->screen, core->pool, sample);
+#else
+    bool active = update_screen(time, core->screen, core->pool);
+    cache_beam_sample(core->screen, sample);
+    return active;
+#endif
+}
+
+BaudEvent device_baud_event(DeviceCore* core) {
+    return baud_event(&core->baud, core->now);
+}
@@ -0,0 +1,71 @@
+// DeviceCore
+// Takes commands out of the parser and runs them against the screen, motion pool and sample cache
+// Serial and DAC I/O stay with the caller, so the same core runs in the sketch and in host simulations
+
+#ifndef DEVICE_CORE_H
+#define DEVICE_CORE_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "baud_switch.h"
+#include "command_parser.h"
+#include "frame_link.h"
+#include "lz_pack.h"
+#include "ring_mem_pool.h"
+#include "sample_cache.h"
+#include "screen_controller.h"
+
+#define DEVICE_REPLY_SIZE (CMD_BATCH_MAX + 8) // Room for a batch answer
+
+typedef struct DeviceCore {
+    ScreenState* screen;
+    RingMemPool* pool;
+#ifdef SAMPLE_CACHE
+    SampleCache* cache;
+#endif
+    bool batch_open;                        // Running a line of CMD_BATCH_SEP separated commands
+    uint8_t batch_count;                    // Commands of it not yet answered
+    uint8_t batch_map[CMD_BATCH_MAX / 8];   // Bit per command, set when it was taken
+    FrameLink link;                         // Between the wire and the parser once "set framed" is taken
+    BaudSwitch baud;                        // Set up by the caller with the rate and UART clock
+    bool hold;                              // "set hold" taken
+    bool holding;                           // Turning motions away behind a refused one
+    LzUnpack packed;                        // Window of the packed records taken, for the next to carry on from
+    uint8_t packed_chain;                   // Packed records taken since one started the window. Zero for none
+    uint32_t now;                           // Time of the last update
+} DeviceCore;
+
+typedef struct CommandResult {
+    CommandUnion cmd;
+    err_t err;            // Why the command couldn't be loaded or parsed. CMD_ERR_CMD_NOOP for empty lines
+    bool priority;        // Came in on the priority lane
+    bool batched;         // Shares its line with other commands. Answered together by device_batch_reply
+    bool batch_end;       // Last of its line, the batch is answered after it
+    bool handled;         // False for commands left to the caller, like setting sketch flags
+    bool success;
+    ScreenMotion* motion; // Motion added to the pool
+} CommandResult;
+
+// The cache is left alone, and may be NULL, where SAMPLE_CACHE isn't built. Frames are then drawn live
+void device_init(DeviceCore* core, ScreenState* screen, RingMemPool* pool, SampleCache* cache);
+// Take bytes off the wire, through the frame link when it's on. Call every loop, even with none
+// While a baud switch runs they go to it instead
+err_t device_receive(DeviceCore* core, const char* data, uint8_t len);
+// Next frame to ask the host to send again. Answered as "RESEND n"
+bool device_resend(DeviceCore* core, uint8_t* seq);
+// Parse and run the next command where it is in the parser's buffer. The priority lane goes first
+// The arguments of the result point into that buffer, and are good until more is received
+// Returns false when there's no complete command
+bool device_next(DeviceCore* core, CommandResult* result);
+// Whether a command is answered with ACK when the prompt is off
+bool device_acked(const CommandResult* result);
+// Note how a batched command went. True when the batch is due an answer
+bool device_batch_add(DeviceCore* core, const CommandResult* result, bool acked);
+// Write the answer for the batch so far, without a line end, and start counting again
+void device_batch_reply(DeviceCore* core, char* buf, uint8_t len);
+bool device_update(DeviceCore* core, uint32_t time, DacSample* sample);
+// What to do next for "set baud". Check after answering commands and after updates
+BaudEvent device_baud_event(DeviceCore* core);
+
+#endif // DEVICE_CORE_H
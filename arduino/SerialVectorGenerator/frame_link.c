@@ -0,0 +1,199 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "frame_link.h"
+
+void link_init(FrameLink* link, LinkDeliver deliver, void* ctx) {
+    memset(link, '\0', sizeof(FrameLink));
+    link->deliver = deliver;
+    link->ctx     = ctx;
+}
+
+void link_reset(FrameLink* link) {
+    link->frame_len    = 0;
+    link->overrun      = false;
+    link->expected     = 0;
+    link->next_seen    = 0;
+    link->hold_len     = 0;
+    link->resend_count = 0;
+}
+
+uint16_t link_crc16(const uint8_t* data, uint16_t len) {
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+uint8_t link_encode(uint8_t seq, const uint8_t* payload, uint8_t len, uint8_t* out) {
+    if (len > LINK_PAYLOAD_MAX) return 0;
+
+    uint8_t raw[LINK_PAYLOAD_MAX + LINK_OVERHEAD];
+    raw[0] = seq;
+    memcpy(raw + 1, payload, len);
+    uint16_t crc = link_crc16(raw, len + 1);
+    raw[len + 1] = crc & 0xFF;
+    raw[len + 2] = crc >> 8;
+
+    // Each zero becomes the distance to the next one
+    uint8_t code_pos = 0;
+    uint8_t pos      = 1;
+    uint8_t code     = 1;
+    for (uint8_t i = 0; i < len + LINK_OVERHEAD; i++) {
+        if (raw[i] == 0) {
+            out[code_pos] = code;
+            code_pos      = pos++;
+            code          = 1;
+            continue;
+        }
+        out[pos++] = raw[i];
+        code++;
+    }
+    out[code_pos] = code;
+    out[pos++]    = LINK_DELIM;
+    return pos;
+}
+
+// Decode in place. The output is never ahead of the input
+static int16_t cobsDecode(uint8_t* buf, uint8_t len) {
+    uint8_t in  = 0;
+    uint8_t out = 0;
+    while (in < len) {
+        uint8_t code = buf[in++];
+        if (code == 0 || in + code - 1 > len) return -1;
+        for (uint8_t i = 1; i < code; i++) {
+            buf[out++] = buf[in++];
+        }
+        if (code != 0xFF && in < len) buf[out++] = 0;
+    }
+    return out;
+}
+
+static void askFor(FrameLink* link, uint8_t seq) {
+    for (uint8_t i = 0; i < link->resend_count; i++) {
+        if (link->resend[i] == seq) return;
+    }
+    if (link->resend_count >= LINK_RESEND_MAX) return;
+    link->resend[link->resend_count++] = seq;
+    link->stats.resends++;
+}
+
+// Offset of a held frame, or -1
+static int16_t findHeld(const FrameLink* link, uint8_t seq) {
+    uint8_t pos = 0;
+    while (pos < link->hold_len) {
+        if (link->hold[pos] == seq) return pos;
+        pos += 2 + link->hold[pos + 1];
+    }
+    return -1;
+}
+
+// Hand on held frames while the next one is there
+static void release(FrameLink* link) {
+    int16_t pos;
+    while ((pos = findHeld(link, link->expected)) != -1) {
+        uint8_t size = 2 + link->hold[pos + 1];
+        if (!link->deliver(link->ctx, link->hold + pos + 2, link->hold[pos + 1])) return;
+        memmove(link->hold + pos, link->hold + pos + size, link->hold_len - pos - size);
+        link->hold_len -= size;
+        link->expected++;
+        link->stats.frames++;
+    }
+}
+
+static void takeFrame(FrameLink* link, uint8_t seq, const uint8_t* payload, uint8_t len) {
+    // Already handed on. The host sent it again before our answer got there
+    if ((int8_t)(seq - link->expected) < 0) return;
+
+    // Frames skipped on the way here were lost
+    if ((int8_t)(seq - link->next_seen) >= 0) {
+        for (uint8_t missing = link->next_seen; missing != seq; missing++) {
+            askFor(link, missing);
+        }
+        link->next_seen = seq + 1;
+    }
+
+    if (findHeld(link, seq) != -1) return;
+    if (seq == link->expected && link->deliver(link->ctx, payload, len)) {
+        link->expected++;
+        link->stats.frames++;
+        release(link);
+        return;
+    }
+
+    // Keep it until the ones before it are in. Without room it has to come again
+    if (link->hold_len + 2 + len > LINK_HOLD_SIZE) {
+        askFor(link, seq);
+        return;
+    }
+    link->hold[link->hold_len]     = seq;
+    link->hold[link->hold_len + 1] = len;
+    memcpy(link->hold + link->hold_len + 2, payload, len);
+    link->hold_len += 2 + len;
+    link->stats.held++;
+}
+
+// The number of a bad frame can't be trusted. It's one of those still missing, if it was sent again,
+// or else the one after the newest, since frames go out in order
+static void badFrame(FrameLink* link) {
+    link->stats.bad++;
+    for (uint8_t missing = link->expected; missing != link->next_seen; missing++) {
+        if (findHeld(link, missing) == -1) askFor(link, missing);
+    }
+    // Guesses stop at what the host could have sent
+    if ((uint8_t)(link->next_seen - link->expected) < LINK_AHEAD_MAX) {
+        askFor(link, link->next_seen);
+        link->next_seen++;
+    }
+}
+
+static void endFrame(FrameLink* link) {
+    if (link->overrun) {
+        badFrame(link);
+        return;
+    }
+    // Delimiters on their own just resync
+    if (link->frame_len == 0) return;
+
+    int16_t len = cobsDecode(link->frame, link->frame_len);
+    if (len < LINK_OVERHEAD) {
+        badFrame(link);
+        return;
+    }
+    uint16_t crc = link->frame[len - 2] | ((uint16_t)link->frame[len - 1] << 8);
+    if (crc != link_crc16(link->frame, len - 2)) {
+        badFrame(link);
+        return;
+    }
+    takeFrame(link, link->frame[0], link->frame + 1, len - LINK_OVERHEAD);
+}
+
+void link_receive(FrameLink* link, const uint8_t* data, uint16_t len) {
+    release(link);
+    for (uint16_t i = 0; i < len; i++) {
+        if (data[i] == LINK_DELIM) {
+            endFrame(link);
+            link->frame_len = 0;
+            link->overrun   = false;
+        }
+        else if (link->frame_len < LINK_FRAME_SIZE) {
+            link->frame[link->frame_len++] = data[i];
+        }
+        else {
+            link->overrun = true;
+        }
+    }
+}
+
+bool link_resend(FrameLink* link, uint8_t* seq) {
+    if (link->resend_count == 0) return false;
+    *seq = link->resend[0];
+    link->resend_count--;
+    memmove(link->resend, link->resend + 1, link->resend_count);
+    return true;
+}
@@ -0,0 +1,62 @@
+// FrameLink
+// Packet layer for noisy serial links, in front of the command parser
+// Each frame is COBS encoded and ends with a zero byte. Decoded, it holds a sequence number,
+// up to LINK_PAYLOAD_MAX bytes of the command stream, and a CRC16 of both, little endian
+// A frame that fails its check is dropped on its own and its number is asked for again.
+// Frames that come after a missing one are held, so the stream is always handed on in order.
+// There's room to hold one full frame. Any more past a gap are asked for again
+
+#ifndef FRAME_LINK_H
+#define FRAME_LINK_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#define LINK_DELIM        0x00
+#define LINK_PAYLOAD_MAX  64
+#define LINK_OVERHEAD     3                                  // Sequence number and CRC
+#define LINK_FRAME_SIZE   (LINK_PAYLOAD_MAX + LINK_OVERHEAD + 1) // Encoded, without the delimiter
+#define LINK_HOLD_SIZE    (LINK_PAYLOAD_MAX + 2)             // Frames that came early, with a two byte header each
+#define LINK_RESEND_MAX   8
+#define LINK_AHEAD_MAX    32                                 // Frames unanswered at most. Far past the host's window
+
+// Hands a payload on. False when there's no room for it yet, it's held and offered again
+typedef bool (*LinkDeliver)(void* ctx, const uint8_t* data, uint8_t len);
+
+typedef struct LinkStats {
+    uint32_t frames;  // Handed on
+    uint16_t bad;     // Failed to decode or check
+    uint16_t held;    // Came before one that was missing
+    uint16_t resends; // Asked for again
+} LinkStats;
+
+typedef struct FrameLink {
+    bool enabled;
+    uint8_t frame[LINK_FRAME_SIZE]; // Encoded bytes since the last delimiter
+    uint8_t frame_len;
+    bool overrun;                   // The frame was too long. Dropped at its delimiter
+    uint8_t expected;               // Next sequence number to hand on
+    uint8_t next_seen;              // One past the newest sequence number received or asked for
+    uint8_t hold[LINK_HOLD_SIZE];   // Each is the sequence number, the length, then the payload
+    uint8_t hold_len;
+    uint8_t resend[LINK_RESEND_MAX];
+    uint8_t resend_count;
+    LinkDeliver deliver;
+    void* ctx;
+    LinkStats stats;
+} FrameLink;
+
+void link_init(FrameLink* link, LinkDeliver deliver, void* ctx);
+// Start again from sequence number zero, dropping anything partial or held
+void link_reset(FrameLink* link);
+// Take bytes off the wire. Call with none to offer held frames again
+void link_receive(FrameLink* link, const uint8_t* data, uint16_t len);
+// Next sequence number to ask the host for
+bool link_resend(FrameLink* link, uint8_t* seq);
+
+// CRC-16/CCITT-FALSE
+uint16_t link_crc16(const uint8_t* data, uint16_t len);
+// Frame a payload, delimiter included. The output needs LINK_FRAME_SIZE + 1 bytes. Returns its size
+uint8_t link_encode(uint8_t seq, const uint8_t* payload, uint8_t len, uint8_t* out);
+
+#endif // FRAME_LINK_H
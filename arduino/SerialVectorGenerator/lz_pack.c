@@ -0,0 +1,125 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "lz_pack.h"
+
+void lz_init(LzUnpack* lz, const uint8_t* in, uint8_t len) {
+    memset(lz, '\0', sizeof(LzUnpack));
+    lz->in     = in;
+    lz->in_len = len;
+}
+
+void lz_resume(LzUnpack* lz, const uint8_t* in, uint8_t len) {
+    lz->in       = in;
+    lz->in_len   = len;
+    lz->in_pos   = 0;
+    lz->left     = 0;
+    lz->distance = 0;
+    lz->error    = false;
+}
+
+static inline void fail(LzUnpack* lz) {
+    lz->error = true;
+    lz->left  = 0;
+}
+
+// Read the next token. False at the end, or when it's bad
+static bool startToken(LzUnpack* lz) {
+    if (lz->error || lz->in_pos >= lz->in_len) return false;
+
+    uint8_t token = lz->in[lz->in_pos++];
+    if (!(token & LZ_MATCH)) {
+        lz->distance = 0;
+        lz->left     = token + 1;
+        if (lz->in_len - lz->in_pos < lz->left) {
+            fail(lz);
+            return false;
+        }
+        return true;
+    }
+
+    if (lz->in_pos >= lz->in_len) {
+        fail(lz);
+        return false;
+    }
+    lz->distance = lz->in[lz->in_pos++] + 1;
+    lz->left     = (token & ~LZ_MATCH) + LZ_MIN_MATCH;
+    if (lz->distance > lz->filled) {
+        fail(lz);
+        return false;
+    }
+    return true;
+}
+
+uint8_t lz_read(LzUnpack* lz, uint8_t* out, uint8_t len) {
+    uint8_t count = 0;
+    while (count < len) {
+        if (lz->left == 0 && !startToken(lz)) break;
+
+        uint8_t c = (lz->distance == 0) ? lz->in[lz->in_pos++] :
+                    lz->window[(uint8_t)(lz->out_pos - lz->distance) & (LZ_WINDOW - 1)];
+        lz->window[lz->out_pos & (LZ_WINDOW - 1)] = c;
+        lz->out_pos++;
+        if (lz->filled < LZ_WINDOW) lz->filled++;
+        lz->left--;
+        out[count++] = c;
+    }
+    return count;
+}
+
+bool lz_done(const LzUnpack* lz) {
+    return !lz->error && lz->left == 0 && lz->in_pos >= lz->in_len;
+}
+
+// Write literals in runs the tokens can hold
+static bool putLiterals(const uint8_t* in, uint16_t len, uint8_t* out, uint16_t* out_len, uint16_t out_max) {
+    while (len > 0) {
+        uint16_t run = (len > LZ_MAX_LITERALS) ? LZ_MAX_LITERALS : len;
+        if (*out_len + 1 + run > out_max) return false;
+        out[(*out_len)++] = run - 1;
+        memcpy(out + *out_len, in, run);
+        *out_len += run;
+        in  += run;
+        len -= run;
+    }
+    return true;
+}
+
+uint16_t lz_pack(const uint8_t* in, uint16_t len, uint8_t* out, uint16_t out_max) {
+    return lz_pack_from(in, 0, len, out, out_max);
+}
+
+uint16_t lz_pack_from(const uint8_t* in, uint16_t start, uint16_t len, uint8_t* out, uint16_t out_max) {
+    uint16_t out_len   = 0;
+    uint16_t pos       = start;
+    uint16_t lit_start = start;
+    while (pos < len) {
+        // Longest match in the window, which reaches back before start. The nearest wins a tie
+        uint8_t best_len  = 0;
+        uint8_t best_dist = 0;
+        for (uint16_t dist = 1; dist <= LZ_WINDOW && dist <= pos; dist++) {
+            uint8_t match = 0;
+            while (pos + match < len && match < LZ_MAX_MATCH && in[pos + match] == in[pos + match - dist]) {
+                match++;
+            }
+            if (match > best_len) {
+                best_len  = match;
+                best_dist = dist;
+            }
+        }
+        if (best_len < LZ_MIN_MATCH) {
+            pos++;
+            continue;
+        }
+
+        if (!putLiterals(in + lit_start, pos - lit_start, out, &out_len, out_max)) return 0;
+        if (out_len + 2 > out_max) return 0;
+        out[out_len++] = LZ_MATCH | (best_len - LZ_MIN_MATCH);
+        out[out_len++] = best_dist - 1;
+        pos      += best_len;
+        lit_start = pos;
+    }
+    if (!putLiterals(in + lit_start, pos - lit_start, out, &out_len, out_max)) return 0;
+    return out_len;
+}
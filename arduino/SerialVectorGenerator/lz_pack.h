@@ -0,0 +1,47 @@
+// LzPack
+// Byte oriented LZ77 for packed binary records, with a window small enough for AVR RAM
+// The data is a run of tokens. A token below LZ_MATCH is followed by token + 1 literal bytes
+// A token with LZ_MATCH set is followed by a byte holding the distance back less one,
+// and copies (token & ~LZ_MATCH) + LZ_MIN_MATCH bytes from that far back in what's been decoded
+// Copies can overlap what they write, so a short run repeats
+// Decoding is streamed, only the last LZ_WINDOW bytes out are kept. Data can carry on from the
+// window of the data before it, so copies reach back across records
+
+#ifndef LZ_PACK_H
+#define LZ_PACK_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#define LZ_WINDOW       64 // A power of 2
+#define LZ_MATCH        0x80
+#define LZ_MIN_MATCH    3
+#define LZ_MAX_MATCH    (0x7F + LZ_MIN_MATCH)
+#define LZ_MAX_LITERALS 0x80
+
+typedef struct LzUnpack {
+    const uint8_t* in;
+    uint8_t in_len;
+    uint8_t in_pos;
+    uint8_t window[LZ_WINDOW]; // The last bytes out, for copies to come from
+    uint8_t out_pos;           // Where the next byte out goes in the window
+    uint8_t filled;            // Bytes of the window decoded so far
+    uint8_t left;              // Bytes left of the token
+    uint8_t distance;          // Back to copy from. Zero for literals
+    bool error;
+} LzUnpack;
+
+void lz_init(LzUnpack* lz, const uint8_t* in, uint8_t len);
+// Decode more data, with copies reaching back into what was decoded before it
+void lz_resume(LzUnpack* lz, const uint8_t* in, uint8_t len);
+// Decode up to len bytes. Fewer at the end of the data, or when it's bad
+uint8_t lz_read(LzUnpack* lz, uint8_t* out, uint8_t len);
+// All the data has been decoded
+bool lz_done(const LzUnpack* lz);
+
+// Pack len bytes, for the host. Returns the packed size, or zero when it won't fit in out_max
+uint16_t lz_pack(const uint8_t* in, uint16_t len, uint8_t* out, uint16_t out_max);
+// Pack the bytes from start to len, to be decoded by lz_resume after those before start
+uint16_t lz_pack_from(const uint8_t* in, uint16_t start, uint16_t len, uint8_t* out, uint16_t out_max);
+
+#endif // LZ_PACK_H
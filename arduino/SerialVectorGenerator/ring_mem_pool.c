@@ -4,6 +4,41 @@
 #include "common.h"
 #include "ring_mem_pool.h"
 
+static inline uint8_t hdrSize(uint16_t size) {
+    return (size < RING_LARGE) ? sizeof(RingEntryHdr) : RING_LARGE_HDR;
+}
+
+// Write a header and return where the data starts
+static inline void* writeHdr(char* at, uint16_t size) {
+    if (size < RING_LARGE) {
+        ((RingEntryHdr*)at)->size = size;
+        return at + sizeof(RingEntryHdr);
+    }
+    at[0] = (char)RING_LARGE;
+    at[1] = size & 0xFF;
+    at[2] = size >> 8;
+    at[3] = (char)RING_LARGE;
+    return at + RING_LARGE_HDR;
+}
+
+// Read the header at the start of an entry
+static inline uint16_t readHdr(const char* at, uint8_t* hdr_size) {
+    const uint8_t* hdr = (const uint8_t*)at;
+    if (hdr[0] != RING_LARGE) {
+        *hdr_size = sizeof(RingEntryHdr);
+        return hdr[0];
+    }
+    *hdr_size = RING_LARGE_HDR;
+    return hdr[1] | (hdr[2] << 8);
+}
+
+// Read the header just before the data of an entry
+static inline uint16_t readHdrBefore(const void* entry) {
+    const uint8_t* end = (const uint8_t*)entry;
+    if (end[-1] != RING_LARGE) return end[-1];
+    return end[-3] | (end[-2] << 8);
+}
+
 // Initialize ring
 void ring_init(RingMemPool* ring, void* memory, uint16_t size) {
     memset(ring, '\0', sizeof(RingMemPool));
@@ -15,12 +50,42 @@ void ring_init(RingMemPool* ring, void* memory, uint16_t size) {
 void ring_reset(RingMemPool* ring) {
     int16_t size     = ring->size;
     void* memory = ring->memory;
+    RingStats stats  = ring->stats;
     memset(ring, '\0', sizeof(RingMemPool));
     ring->size     = size;
     ring->memory   = memory;
+    ring->stats    = stats;
     ring->last_err = RING_OK;
 }
 
+// Bytes taken by queued entries, headers included
+uint16_t ring_used(const RingMemPool* ring) {
+    uint16_t head = ring->head;
+    uint16_t tail = ring->tail;
+    uint16_t wrap_point = ring->wrap_point;
+    if (wrap_point) return wrap_point - tail + head;
+    return head - tail;
+}
+
+// Copy the counters out, with the current usage filled in
+void ring_get_stats(const RingMemPool* ring, RingStats* stats) {
+    *stats = ring->stats;
+    stats->used = ring_used(ring);
+}
+
+void ring_clear_stats(RingMemPool* ring) {
+    memset(&ring->stats, '\0', sizeof(RingStats));
+}
+
+// Update the high water marks after entries are added
+static inline void statsPushed(RingMemPool* ring, uint8_t entries) {
+    RingStats* stats = &ring->stats;
+    uint16_t used = ring_used(ring);
+    stats->pushes += entries;
+    if (used > stats->high_bytes) stats->high_bytes = used;
+    if (ring->count > stats->high_entries) stats->high_entries = ring->count;
+}
+
 // Check how much contiguous memory is available
 // Only a writer may call this
 uint16_t ring_remaining(const RingMemPool* ring) {
@@ -59,10 +124,16 @@ uint16_t ring_remaining(const RingMemPool* ring) {
 }
 
 // Get an entry onto the ring
-void* ring_get(RingMemPool* ring, uint8_t size) {
+void* ring_get(RingMemPool* ring, uint16_t size) {
     // Error guard
     if (ring->last_err == RING_CRITICAL) return NULL;
 
+    // The head can't move while a reservation is open
+    if (ring->reserve_end) {
+        ring->last_err = RING_ERR;
+        return NULL;
+    }
+
     // Don't do anything for zero size
     if (size == 0) {
         ring->last_err = RING_OK;
@@ -70,8 +141,9 @@ void* ring_get(RingMemPool* ring, uint8_t size) {
     }
 
     // Check remaining memory
-    uint8_t full_size = size + sizeof(RingEntryHdr);
-    if (ring_remaining(ring) <= full_size) {
+    uint16_t full_size = ring_entry_size(size);
+    if (size >= ring->size || ring_remaining(ring) <= full_size) {
+        ring->stats.out_of_mem++;
         ring->last_err = RING_OUT_OF_MEM;
         return NULL;
     }
@@ -81,6 +153,7 @@ void* ring_get(RingMemPool* ring, uint8_t size) {
     if (ring->size - ring->head < full_size) {
         if (ring->tail < ring->head) {
             // Wrap head
+            ring->stats.wrap_waste += ring->size - ring->head;
             ring->wrap_point = ring->head;
             ring->head = 0;
         }
@@ -91,18 +164,11 @@ void* ring_get(RingMemPool* ring, uint8_t size) {
         }
     }
 
-    // Construct a header
-    uint16_t data_count = 0;
-    RingEntryHdr* hdr = (RingEntryHdr*) &ring->memory[ring->head];
-    hdr->size = size;
-    data_count += sizeof(RingEntryHdr);
-
-    // Get pointer to entry
-    void* start = &ring->memory[ring->head];
-    data_count += size;
+    // Construct a header and get pointer to entry
+    void* start = writeHdr(&((char*)ring->memory)[ring->head], size);
 
     // Update head and metadata
-    ring->head += data_count;
+    ring->head += full_size;
     if (ring->head >= ring->size) {
         // This should never happen
         ring->head = 0;
@@ -112,8 +178,117 @@ void* ring_get(RingMemPool* ring, uint8_t size) {
     }
 
     ring->count++;
+    statsPushed(ring, 1);
+    ring->last_err = RING_OK;
+    return start;
+}
+
+// Bytes an entry takes on the ring
+uint16_t ring_entry_size(uint16_t size) {
+    return size + hdrSize(size);
+}
+
+// Reserve contiguous memory for several entries
+// total is the sum of ring_entry_size for each entry
+// Fill it with ring_reserve_entry, then commit or roll back
+void* ring_reserve(RingMemPool* ring, uint16_t total) {
+    // Error guard
+    if (ring->last_err == RING_CRITICAL) return NULL;
+
+    // Only one reservation at a time
+    if (ring->reserve_end) {
+        ring->last_err = RING_ERR;
+        return NULL;
+    }
+
+    // Don't do anything for zero size
+    if (total == 0) {
+        ring->last_err = RING_OK;
+        return NULL;
+    }
+
+    // Check remaining memory
+    if (ring_remaining(ring) <= total) {
+        ring->stats.out_of_mem++;
+        ring->last_err = RING_OUT_OF_MEM;
+        return NULL;
+    }
+
+    // Same placement as ring_get, but the head isn't moved until the commit
+    uint16_t start = (ring->size - ring->head < total) ? 0 : ring->head;
+    ring->reserved    = start;
+    ring->reserve_end = start + total;
+    ring->fill        = start;
+    ring->pending     = 0;
+    ring->last_err    = RING_OK;
+    return &((char*)ring->memory)[start];
+}
+
+// Get the next entry out of the open reservation
+void* ring_reserve_entry(RingMemPool* ring, uint16_t size) {
+    // Error guard
+    if (ring->last_err == RING_CRITICAL) return NULL;
+
+    if (!ring->reserve_end || size == 0) {
+        ring->last_err = RING_ERR;
+        return NULL;
+    }
+
+    uint16_t full_size = ring_entry_size(size);
+    if (ring->reserve_end - ring->fill < full_size) {
+        ring->last_err = RING_OUT_OF_MEM;
+        return NULL;
+    }
+
+    // Construct a header
+    void* start = writeHdr(&((char*)ring->memory)[ring->fill], size);
+    ring->fill += full_size;
+    ring->pending++;
     ring->last_err = RING_OK;
-    return start + sizeof(RingEntryHdr);
+    return start;
+}
+
+// Make the reserved entries visible to readers in one update
+// n_entries must match what was written or nothing is added
+uint8_t ring_commit(RingMemPool* ring, uint8_t n_entries) {
+    // Error guard
+    if (ring->last_err == RING_CRITICAL) return 0;
+
+    if (!ring->reserve_end || n_entries != ring->pending) {
+        ring_rollback(ring);
+        ring->last_err = RING_ERR;
+        return 0;
+    }
+
+    if (n_entries && ring->reserved != ring->head) {
+        // The reservation is at the start of the memory
+        if (ring->tail == ring->head) {
+            // Empty. Move the tail with the head
+            ring->tail = 0;
+        }
+        else {
+            // Wrap head
+            ring->stats.wrap_waste += ring->size - ring->head;
+            ring->wrap_point = ring->head;
+        }
+    }
+
+    // Update head and metadata
+    if (n_entries) {
+        ring->head = ring->fill;
+        ring->count += n_entries;
+        statsPushed(ring, n_entries);
+    }
+    ring->reserve_end = 0;
+    ring->pending     = 0;
+    ring->last_err    = RING_OK;
+    return n_entries;
+}
+
+// Drop the open reservation and everything written in it
+void ring_rollback(RingMemPool* ring) {
+    ring->reserve_end = 0;
+    ring->pending     = 0;
 }
 
 void* ring_peek(const RingMemPool* ring) {
@@ -125,11 +300,37 @@ void* ring_peek(const RingMemPool* ring) {
         return NULL; // Nothing to pop
     }
 
-    return &ring->memory[ring->tail + sizeof(RingEntryHdr)];
+    uint8_t hdr_size;
+    readHdr(&((char*)ring->memory)[ring->tail], &hdr_size);
+    return &((char*)ring->memory)[ring->tail + hdr_size];
+}
+
+// Get the entry after the given one without removing anything
+// Returns NULL if the given entry is the newest one
+void* ring_peek_next(const RingMemPool* ring, const void* entry) {
+    // Error guard
+    if (ring->last_err == RING_CRITICAL || !entry) return NULL;
+
+    // Find the start of the following entry
+    uint16_t next = (const char*)entry - (const char*)ring->memory + readHdrBefore(entry);
+
+    // Follow the wrap point
+    if (ring->wrap_point && next >= ring->wrap_point) {
+        next = 0;
+    }
+
+    // Reached the head
+    if (next == ring->head) {
+        return NULL;
+    }
+
+    uint8_t hdr_size;
+    readHdr(&((char*)ring->memory)[next], &hdr_size);
+    return &((char*)ring->memory)[next + hdr_size];
 }
 
 // Clear an entry from the ring
-uint8_t ring_pop(RingMemPool* ring) {
+uint16_t ring_pop(RingMemPool* ring) {
     // Error guard
     if (ring->last_err == RING_CRITICAL) return 0;
 
@@ -140,8 +341,9 @@ uint8_t ring_pop(RingMemPool* ring) {
     }
 
     // Get header and move tail
-    RingEntryHdr* hdr = &ring->memory[ring->tail];
-    uint8_t size = hdr->size + sizeof(RingEntryHdr);
+    uint8_t hdr_size;
+    uint16_t data_size = readHdr(&((char*)ring->memory)[ring->tail], &hdr_size);
+    uint16_t size = data_size + hdr_size;
 
     // Wrap tail if it has passed the wrap point
     if (ring->wrap_point && ring->tail + size >= ring->wrap_point) {
@@ -160,6 +362,7 @@ uint8_t ring_pop(RingMemPool* ring) {
     }
 
     ring->count--;
+    ring->stats.pops++;
     ring->last_err = RING_OK;
-    return hdr->size;
+    return data_size;
 }
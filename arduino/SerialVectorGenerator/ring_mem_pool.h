@@ -10,10 +10,28 @@
 #define RING_ERR -1
 #define RING_OUT_OF_MEM -2
 #define RING_CRITICAL -3
+
+// Entries smaller than RING_LARGE have a one byte header holding the size
+// Larger ones start with RING_LARGE and a 16-bit size, and end with RING_LARGE
+// again so the header can be read from either side
+#define RING_LARGE     0xFF
+#define RING_LARGE_HDR 4
 typedef struct RingEntryHdr {
     uint8_t size;
 } RingEntryHdr;
 
+// Occupancy counters for sizing the pool
+// They survive ring_reset so a whole session can be measured
+typedef struct RingStats {
+    uint16_t used;         // Bytes in use right now, headers included
+    uint16_t high_bytes;   // Most bytes ever in use
+    uint8_t  high_entries; // Most entries ever queued
+    uint16_t out_of_mem;   // Times an entry didn't fit
+    uint32_t wrap_waste;   // Bytes skipped at the end of the memory when wrapping
+    uint32_t pushes;
+    uint32_t pops;
+} RingStats;
+
 typedef struct RingMemPool {
     volatile uint8_t  count;
     volatile uint16_t size;
@@ -22,13 +40,32 @@ typedef struct RingMemPool {
     volatile uint16_t wrap_point;
     volatile int8_t   last_err;
     void* memory;
+
+    // Open reservation. Nothing in it can be seen until it's committed
+    uint16_t reserved;    // Start of the reservation
+    uint16_t reserve_end; // Zero when nothing is reserved
+    uint16_t fill;        // End of the entries written so far
+    uint8_t  pending;     // Entries written so far
+
+    RingStats stats;
 } RingMemPool;
 
 void ring_init(RingMemPool* ring, void* memory, uint16_t size);
 void ring_reset(RingMemPool* ring);
 uint16_t ring_remaining(const RingMemPool* ring);
-void* ring_get(RingMemPool* ring, uint8_t size);
+uint16_t ring_used(const RingMemPool* ring);
+void ring_get_stats(const RingMemPool* ring, RingStats* stats);
+void ring_clear_stats(RingMemPool* ring);
+void* ring_get(RingMemPool* ring, uint16_t size);
 void* ring_peek(const RingMemPool* ring);
-uint8_t ring_pop(RingMemPool* ring);
+void* ring_peek_next(const RingMemPool* ring, const void* entry);
+uint16_t ring_pop(RingMemPool* ring);
+
+// Put several entries on the ring all at once
+uint16_t ring_entry_size(uint16_t size);
+void* ring_reserve(RingMemPool* ring, uint16_t total);
+void* ring_reserve_entry(RingMemPool* ring, uint16_t size);
+uint8_t ring_commit(RingMemPool* ring, uint8_t n_entries);
+void ring_rollback(RingMemPool* ring);
 
 #endif // RING_MEM_POOL_H
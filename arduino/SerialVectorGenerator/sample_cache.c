@@ -0,0 +1,122 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ring_mem_pool.h"
+#include "sample_cache.h"
+#include "screen_controller.h"
+#include "utils.h"
+
+void cache_beam_sample(const ScreenState* screen, DacSample* sample) {
+    sample->x = position_to_binary(screen->beam.x, screen->x_size_pow, DAC_BIT_WIDTH, true);
+    sample->y = position_to_binary(screen->beam.y, screen->y_size_pow, DAC_BIT_WIDTH, true);
+}
+
+#ifdef SAMPLE_CACHE
+
+void cache_init(SampleCache* cache, DacSample* samples, uint16_t capacity, uint16_t period) {
+    memset(cache, '\0', sizeof(SampleCache));
+    cache->samples  = samples;
+    cache->capacity = capacity;
+    cache->period   = period;
+    cache->state    = CACHE_EMPTY;
+}
+
+// Drop the recording. Call whenever the drawn frame may change
+void cache_invalidate(SampleCache* cache) {
+    cache->state = CACHE_EMPTY;
+    cache->count = 0;
+    cache->idx   = 0;
+}
+
+// Record one sample of the frame
+static void recordSample(SampleCache* cache, ScreenState* screen, RingMemPool* pool) {
+    // Samples are taken on a fixed period, even if this is called late
+    cache->last_time += cache->period;
+    update_screen(cache->last_time, screen, pool);
+    if (screen->frame_count != cache->frame) {
+        // Frame is complete. Play it back from the start
+        if (cache->count == 0) {
+            cache->state = CACHE_FULL;
+            cache_beam_sample(screen, &cache->out);
+            return;
+        }
+        cache->state = CACHE_READY;
+        cache->idx   = 0;
+        cache->out   = cache->samples[0];
+        return;
+    }
+    if (cache->count >= cache->capacity) {
+        // Too long to cache
+        cache->state = CACHE_FULL;
+        cache_beam_sample(screen, &cache->out);
+        return;
+    }
+    cache_beam_sample(screen, &cache->samples[cache->count]);
+    cache->out = cache->samples[cache->count++];
+}
+
+// Move playback up to the current time
+static void playSample(SampleCache* cache, uint32_t time) {
+    uint32_t steps = (time - cache->last_time) / cache->period;
+    if (steps > cache->count) {
+        // Fell far behind. Don't try to catch up
+        cache->last_time = time;
+        steps = 1;
+    }
+    else {
+        cache->last_time += steps * cache->period;
+    }
+    cache->idx = (cache->idx + steps) % cache->count;
+    cache->out = cache->samples[cache->idx];
+}
+
+// Find the DAC words for the current time
+// Returns false when the screen has nothing to draw
+bool cache_update(SampleCache* cache, uint32_t time, ScreenState* screen, RingMemPool* pool, DacSample* sample) {
+    bool looping = (screen->sequence_enabled && screen->sequence_idx >= 0);
+    if (!looping && cache->state != CACHE_EMPTY) {
+        cache_invalidate(cache);
+    }
+
+    // Start recording a sequence that hasn't been drawn yet
+    if (looping && cache->state == CACHE_EMPTY && screen->sequence_idx == 0 && !screen->motion_active && cache->capacity) {
+        cache->state     = CACHE_RECORDING;
+        cache->count     = 0;
+        cache->frame     = screen->frame_count;
+        cache->last_time = time - cache->period;
+    }
+
+    bool active = true;
+    switch (cache->state) {
+    case CACHE_RECORDING:
+        if (time - cache->last_time >= cache->period) {
+            recordSample(cache, screen, pool);
+        }
+        break;
+    case CACHE_READY:
+        if (time - cache->last_time >= cache->period) {
+            playSample(cache, time);
+        }
+        break;
+    default: {
+        // Drawn live
+        uint16_t frame = screen->frame_count;
+        active = update_screen(time, screen, pool);
+        cache_beam_sample(screen, &cache->out);
+        if (looping && cache->state == CACHE_EMPTY && screen->frame_count != frame && cache->capacity) {
+            // The next frame just started. Record it from here
+            cache->state      = CACHE_RECORDING;
+            cache->frame      = screen->frame_count;
+            cache->samples[0] = cache->out;
+            cache->count      = 1;
+            cache->last_time  = time;
+        }
+        break;
+    }
+    }
+    *sample = cache->out;
+    return active;
+}
+
+#endif // SAMPLE_CACHE
@@ -0,0 +1,58 @@
+// SampleCache
+// Records the DAC words of one pass over a sequence, then plays them back
+// Static scenes are redrawn without recalculating any motion
+// With no room for samples every frame is drawn live
+// Only built where SAMPLE_CACHE is defined. The Uno's 2 KB of SRAM has no room for a frame worth keeping
+
+#ifndef SAMPLE_CACHE_H
+#define SAMPLE_CACHE_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include "ring_mem_pool.h"
+#include "screen_controller.h"
+
+#ifdef AVR
+#include <avr/io.h>
+#endif
+
+// Boards with more SRAM than the Uno, and host builds
+#if !defined(AVR) || RAMEND > 0x8FF
+#define SAMPLE_CACHE
+#endif
+
+typedef enum CacheState {
+    CACHE_EMPTY = 0, // Waiting for a sequence frame to start
+    CACHE_RECORDING, // Drawing the frame at a fixed period and keeping the samples
+    CACHE_READY,     // Playing the samples back
+    CACHE_FULL,      // The frame didn't fit, drawn live until invalidated
+} CacheState;
+
+typedef struct DacSample {
+    uint16_t x;
+    uint16_t y;
+} DacSample;
+
+typedef struct SampleCache {
+    DacSample* samples;
+    uint16_t capacity;   // Number of samples that fit
+    uint16_t count;      // Number of samples recorded
+    uint16_t idx;        // Sample being played
+    uint16_t period;     // Microseconds between samples
+    uint32_t last_time;  // Time of the last sample
+    uint16_t frame;      // Sequence pass being recorded
+    CacheState state;
+    DacSample out;       // Sample on the DAC
+} SampleCache;
+
+// DAC words for where the beam is
+void cache_beam_sample(const ScreenState* screen, DacSample* sample);
+
+#ifdef SAMPLE_CACHE
+void cache_init(SampleCache* cache, DacSample* samples, uint16_t capacity, uint16_t period);
+void cache_invalidate(SampleCache* cache);
+bool cache_update(SampleCache* cache, uint32_t time, ScreenState* screen, RingMemPool* pool, DacSample* sample);
+#endif // SAMPLE_CACHE
+
+#endif // SAMPLE_CACHE_H
@@ -1,12 +1,134 @@
 #include <inttypes.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "common.h"
 #include "ring_mem_pool.h"
 #include "screen_controller.h"
 #include "utils.h"
 
+// Keep motions compact so more of them fit in the pool
+_Static_assert(sizeof(ScreenMotion) == 1, "Motion type must be one byte");
+_Static_assert(sizeof(PointMotion) <= 6, "PointMotion must stay packed");
+_Static_assert(sizeof(LineMotion) <= 12, "LineMotion must stay packed");
+
+static inline int16_t toPoints(int32_t millipoints) {
+#ifdef AVR
+    return millipoints >> 10; // Dividing by 1024 is close enough
+#else
+    return millipoints / 1000;
+#endif
+}
+
+static inline int16_t saturate16(int32_t value) {
+    return (value > INT16_MAX) ? INT16_MAX : (value < INT16_MIN) ? INT16_MIN : value;
+}
+
+// Work out the visible window from the scale
+static void screenBounds(const ScreenState* screen, ScreenBounds* bounds) {
+    int32_t x_width  = 1l << screen->x_size_pow;
+    int32_t y_width  = 1l << screen->y_size_pow;
+    int32_t x_offset = (!screen->x_centered) ? 0 : x_width >> 1;
+    int32_t y_offset = (!screen->y_centered) ? 0 : y_width >> 1;
+    bounds->x_min = saturate16(-x_offset);
+    bounds->x_max = saturate16(x_width - x_offset);
+    bounds->y_min = saturate16(-y_offset);
+    bounds->y_max = saturate16(y_width - y_offset);
+}
+
+static inline bool boxInside(const ScreenBounds* bounds, int32_t x_min, int32_t y_min, int32_t x_max, int32_t y_max) {
+    return (x_min >= bounds->x_min && x_max <= bounds->x_max && y_min >= bounds->y_min && y_max <= bounds->y_max);
+}
+
+static inline bool boxOutside(const ScreenBounds* bounds, int32_t x_min, int32_t y_min, int32_t x_max, int32_t y_max) {
+    return (x_max < bounds->x_min || x_min > bounds->x_max || y_max < bounds->y_min || y_min > bounds->y_max);
+}
+
+static inline void clampBeam(const ScreenBounds* bounds, BeamState* beam) {
+    beam->x = max(min(beam->x, bounds->x_max), bounds->x_min);
+    beam->y = max(min(beam->y, bounds->y_max), bounds->y_min);
+}
+
+// Cohen-Sutherland outcodes
+#define CLIP_LEFT   0x01
+#define CLIP_RIGHT  0x02
+#define CLIP_BOTTOM 0x04
+#define CLIP_TOP    0x08
+
+static inline uint8_t outCode(const ScreenBounds* bounds, int32_t x, int32_t y) {
+    uint8_t code = 0;
+    if (x < bounds->x_min) code |= CLIP_LEFT;
+    else if (x > bounds->x_max) code |= CLIP_RIGHT;
+    if (y < bounds->y_min) code |= CLIP_BOTTOM;
+    else if (y > bounds->y_max) code |= CLIP_TOP;
+    return code;
+}
+
+// Cut a line down to the part inside the screen
+// Returns false if none of it is visible
+static bool clipLine(const ScreenBounds* bounds, int32_t* x1, int32_t* y1, int32_t* x2, int32_t* y2) {
+    uint8_t code1 = outCode(bounds, *x1, *y1);
+    uint8_t code2 = outCode(bounds, *x2, *y2);
+    while (code1 | code2) {
+        if (code1 & code2) {
+            // Both ends are off the same side
+            return false;
+        }
+
+        // Move the end that is outside onto the edge it crosses
+        uint8_t code = (code1) ? code1 : code2;
+        int32_t dx = *x2 - *x1;
+        int32_t dy = *y2 - *y1;
+        int32_t x, y;
+        if (code & CLIP_TOP) {
+            y = bounds->y_max;
+            x = *x1 + (int64_t)dx * (y - *y1) / dy;
+        }
+        else if (code & CLIP_BOTTOM) {
+            y = bounds->y_min;
+            x = *x1 + (int64_t)dx * (y - *y1) / dy;
+        }
+        else if (code & CLIP_RIGHT) {
+            x = bounds->x_max;
+            y = *y1 + (int64_t)dy * (x - *x1) / dx;
+        }
+        else {
+            x = bounds->x_min;
+            y = *y1 + (int64_t)dy * (x - *x1) / dx;
+        }
+
+        if (code == code1) {
+            *x1 = x;
+            *y1 = y;
+            code1 = outCode(bounds, x, y);
+        }
+        else {
+            *x2 = x;
+            *y2 = y;
+            code2 = outCode(bounds, x, y);
+        }
+    }
+    return true;
+}
+
+// Apply a transform to a position
+static inline void transformXY(const Transform* xform, int32_t* x, int32_t* y) {
+    if (xform->identity) return;
+    const int64_t round = TRANSFORM_ONE >> 1;
+    int32_t tx = ((int64_t)xform->a * *x + (int64_t)xform->b * *y + round) >> 16;
+    int32_t ty = ((int64_t)xform->c * *x + (int64_t)xform->d * *y + round) >> 16;
+    *x = tx + xform->tx;
+    *y = ty + xform->ty;
+}
+
+// Scale a length, or the time to draw it, by a transform
+static inline uint32_t transformLength(const Transform* xform, uint32_t length) {
+    if (xform->identity) return length;
+    return ((uint64_t)length * xform->scale + (TRANSFORM_ONE >> 1)) >> 16;
+}
+
 static inline bool calcPoint(uint32_t elapsed, const PointMotion* motion, const ScreenState* screen, BeamState* beam) {
     beam->x = motion->x;
     beam->y = motion->y;
@@ -28,7 +150,7 @@ static inline bool line_completed(int32_t end, int32_t pos, bool direction) {
     return ((direction && pos > end) || (!direction && (pos < end)));
 }
 
-static inline bool calcLine(uint32_t elapsed, const LineMotion* motion, BeamState* beam) {
+static inline bool calcLine(uint32_t elapsed, const LineStepper* motion, BeamState* beam) {
     // Dert: Distance = Rate * time
 
     // Calculate movement in each dimention
@@ -43,16 +165,294 @@ static inline bool calcLine(uint32_t elapsed, const LineMotion* motion, BeamStat
         next_y = motion->my2;
         beam->a = 0;
     }
-#ifdef AVR
-    beam->x = next_x >> 10;
-    beam->y = next_y >> 10;
-#else
-    beam->x = next_x / 1000;
-    beam->y = next_y / 1000;
-#endif
+    beam->x = toPoints(next_x);
+    beam->y = toPoints(next_y);
     return (beam->a > 0);
 }
 
+// Integer square root, rounded down
+static uint32_t isqrt64(uint64_t value) {
+    uint64_t root = 0;
+    uint64_t bit  = 1ull << 62;
+    while (bit > value) bit >>= 2;
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root   = (root >> 1) + bit;
+        }
+        else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+// Work out the velocity of a line as it starts
+// Integer only, so the AVR doesn't pull in soft float for every line
+static void startLine(LineStepper* stepper, const LineMotion* motion) {
+    // Multiply by 1000 to get millipoints
+    stepper->mx1 = 1000l*motion->x1;
+    stepper->my1 = 1000l*motion->y1;
+    stepper->mx2 = 1000l*motion->x2;
+    stepper->my2 = 1000l*motion->y2;
+
+    // Calculate length in sixteenths of a point
+    // Rounded up, so the beam never moves faster than the pushed speed
+    int32_t dx = (int32_t)motion->x2 - motion->x1;
+    int32_t dy = (int32_t)motion->y2 - motion->y1;
+    uint64_t square = ((uint64_t)((int64_t)dx * dx) + (uint64_t)((int64_t)dy * dy)) << 8;
+    uint32_t length = isqrt64(square);
+    if ((uint64_t)length * length < square) length++;
+    if (length == 0) {
+        // Nowhere to go. Finish on the next sample
+        stepper->dx = motion->speed;
+        stepper->dy = motion->speed;
+        return;
+    }
+
+    // Millipoints per microsecond, rounded toward zero
+    stepper->dx = (int64_t)dx * motion->speed * 16 / (int32_t)length;
+    stepper->dy = (int64_t)dy * motion->speed * 16 / (int32_t)length;
+}
+
+static inline const int16_t* curveEnd(const CurveMotion* motion) {
+    return motion->p[(motion->base.type == SM_Quad) ? 2 : 3];
+}
+
+#define FIXED_ONE (1ll << 32)
+
+// Round from 32 fractional bits to points
+static inline int16_t fixedToPoints(int64_t value) {
+    return (value + FIXED_ONE / 2) >> 32;
+}
+
+static inline void clockAdvance(StepClock* clock, uint16_t steps) {
+    clock->due += clock->per_step;
+    if (clock->due_frac >= steps - clock->rem) {
+        clock->due_frac -= steps - clock->rem;
+        clock->due++;
+    }
+    else {
+        clock->due_frac += clock->rem;
+    }
+}
+
+static void clockStart(StepClock* clock, uint32_t duration, uint16_t steps) {
+    clock->per_step = duration / steps;
+    clock->rem      = duration % steps;
+    clock->due      = 0;
+    clock->due_frac = 0;
+    clockAdvance(clock, steps);
+}
+
+static inline bool clockDue(const StepClock* clock, uint32_t elapsed) {
+    return elapsed >= clock->due + (clock->due_frac > 0);
+}
+
+// Aim the steps of a planned line, from a distance along it and a change in that each step
+static void aimPlan(LinePlan* plan, int64_t step, int64_t change) {
+    plan->dx  = (step * plan->ux) >> 16;
+    plan->dy  = (step * plan->uy) >> 16;
+    plan->ddx = (change * plan->ux) >> 16;
+    plan->ddy = (change * plan->uy) >> 16;
+}
+
+static inline bool calcPlannedLine(uint32_t elapsed, LinePlan* plan, BeamState* beam) {
+    if (elapsed > plan->duration) {
+        // Motion is complete
+        beam->x = toPoints(plan->mx2);
+        beam->y = toPoints(plan->my2);
+        beam->a = 0;
+        return false;
+    }
+
+    // Step up to the current time. Only the ends of the phases need a multiply
+    while (plan->step < plan->steps && clockDue(&plan->clock, elapsed)) {
+        clockAdvance(&plan->clock, plan->steps);
+        if (plan->step == plan->cruise) aimPlan(plan, plan->peak, 0);
+        if (plan->step == plan->decel) aimPlan(plan, plan->peak - plan->slow / 2, -plan->slow);
+        plan->x  += plan->dx;
+        plan->y  += plan->dy;
+        plan->dx += plan->ddx;
+        plan->dy += plan->ddy;
+        plan->step++;
+    }
+
+    beam->a = 1;
+    if (plan->step == plan->steps) {
+        // Land exactly on the end
+        beam->x = toPoints(plan->mx2);
+        beam->y = toPoints(plan->my2);
+    }
+    else {
+        beam->x = toPoints(plan->x >> PLAN_FRAC_BITS);
+        beam->y = toPoints(plan->y >> PLAN_FRAC_BITS);
+    }
+    return true;
+}
+
+// Set up forward differencing of a curve
+static void startCurve(CurveStepper* stepper, const CurveMotion* motion) {
+    // Polynomial coefficients for each dimention, a*t^3 + b*t^2 + c*t + d
+    int64_t n = motion->steps;
+    int64_t diffs[2][3];
+    for (uint8_t i = 0; i < 2; i++) {
+        int32_t p0 = motion->p[0][i];
+        int32_t p1 = motion->p[1][i];
+        int32_t p2 = motion->p[2][i];
+        int64_t a, b, c;
+        if (motion->base.type == SM_Quad) {
+            a = 0;
+            b = p0 - 2 * p1 + p2;
+            c = 2 * (p1 - p0);
+        }
+        else {
+            int32_t p3 = motion->p[3][i];
+            a = -p0 + 3 * p1 - 3 * p2 + p3;
+            b = 3 * p0 - 6 * p1 + 3 * p2;
+            c = 3 * (p1 - p0);
+        }
+
+        // Scale for a step of 1/n
+        a = a * FIXED_ONE / (n * n * n);
+        b = b * FIXED_ONE / (n * n);
+        c = c * FIXED_ONE / n;
+        diffs[i][0] = a + b + c;
+        diffs[i][1] = 6 * a + 2 * b;
+        diffs[i][2] = 6 * a;
+    }
+
+    stepper->x    = motion->p[0][0] * FIXED_ONE;
+    stepper->y    = motion->p[0][1] * FIXED_ONE;
+    stepper->dx   = diffs[0][0];
+    stepper->dy   = diffs[1][0];
+    stepper->ddx  = diffs[0][1];
+    stepper->ddy  = diffs[1][1];
+    stepper->dddx = diffs[0][2];
+    stepper->dddy = diffs[1][2];
+    stepper->step = 0;
+    clockStart(&stepper->clock, motion->duration, motion->steps);
+}
+
+static inline bool calcCurve(uint32_t elapsed, const CurveMotion* motion, CurveStepper* stepper, const ScreenBounds* bounds, BeamState* beam) {
+    if (elapsed > motion->duration) {
+        // Motion is complete
+        const int16_t* end = curveEnd(motion);
+        beam->x = end[0];
+        beam->y = end[1];
+        beam->a = 0;
+        if (stepper->clamp) clampBeam(bounds, beam);
+        return false;
+    }
+
+    // Step up to the current time
+    while (stepper->step < motion->steps && clockDue(&stepper->clock, elapsed)) {
+        clockAdvance(&stepper->clock, motion->steps);
+        stepper->x   += stepper->dx;
+        stepper->y   += stepper->dy;
+        stepper->dx  += stepper->ddx;
+        stepper->dy  += stepper->ddy;
+        stepper->ddx += stepper->dddx;
+        stepper->ddy += stepper->dddy;
+        stepper->step++;
+    }
+
+    beam->a = 1;
+    if (stepper->step == motion->steps) {
+        // Land exactly on the end
+        const int16_t* end = curveEnd(motion);
+        beam->x = end[0];
+        beam->y = end[1];
+    }
+    else {
+        beam->x = fixedToPoints(stepper->x);
+        beam->y = fixedToPoints(stepper->y);
+    }
+    if (stepper->clamp) clampBeam(bounds, beam);
+    return true;
+}
+
+// Curves stay inside the box around their control points
+static void curveBox(const CurveMotion* motion, int16_t* x_min, int16_t* y_min, int16_t* x_max, int16_t* y_max) {
+    uint8_t last = (motion->base.type == SM_Quad) ? 2 : 3;
+    *x_min = *x_max = motion->p[0][0];
+    *y_min = *y_max = motion->p[0][1];
+    for (uint8_t i = 1; i <= last; i++) {
+        *x_min = min(*x_min, motion->p[i][0]);
+        *x_max = max(*x_max, motion->p[i][0]);
+        *y_min = min(*y_min, motion->p[i][1]);
+        *y_max = max(*y_max, motion->p[i][1]);
+    }
+}
+
+#define ARC_POS_BITS 14
+#define ARC_ROT_BITS 30
+
+static inline float degToRad(int16_t degrees) {
+    return degrees * (float)M_PI / 180;
+}
+
+// Set up incremental rotation of an arc
+static void startArc(ArcStepper* stepper, const ArcMotion* motion) {
+    float start = degToRad(motion->start);
+    float end   = degToRad(motion->end);
+    float step  = (end - start) / motion->steps;
+    stepper->x        = lroundf(motion->r * cosf(start) * (1l << ARC_POS_BITS));
+    stepper->y        = lroundf(motion->r * sinf(start) * (1l << ARC_POS_BITS));
+    // Half angle form keeps the small step precise in a float
+    float half = sinf(step / 2);
+    stepper->cos_step = (1l << ARC_ROT_BITS) - lroundf(2 * half * half * (1l << ARC_ROT_BITS));
+    stepper->sin_step = lroundf(sinf(step) * (1l << ARC_ROT_BITS));
+    stepper->end_x    = motion->cx + lroundf(motion->r * cosf(end));
+    stepper->end_y    = motion->cy + lroundf(motion->r * sinf(end));
+    stepper->step     = 0;
+    clockStart(&stepper->clock, motion->duration, motion->steps);
+}
+
+static inline bool calcArc(uint32_t elapsed, const ArcMotion* motion, ArcStepper* stepper, const ScreenBounds* bounds, BeamState* beam) {
+    if (elapsed > motion->duration) {
+        // Motion is complete
+        beam->x = stepper->end_x;
+        beam->y = stepper->end_y;
+        beam->a = 0;
+        if (stepper->clamp) clampBeam(bounds, beam);
+        return false;
+    }
+
+    // Rotate up to the current time
+    const int64_t round = 1l << (ARC_ROT_BITS - 1);
+    while (stepper->step < motion->steps && clockDue(&stepper->clock, elapsed)) {
+        clockAdvance(&stepper->clock, motion->steps);
+        int32_t x = stepper->x;
+        int32_t y = stepper->y;
+        stepper->x = ((int64_t)x * stepper->cos_step - (int64_t)y * stepper->sin_step + round) >> ARC_ROT_BITS;
+        stepper->y = ((int64_t)x * stepper->sin_step + (int64_t)y * stepper->cos_step + round) >> ARC_ROT_BITS;
+        stepper->step++;
+    }
+
+    beam->a = 1;
+    if (stepper->step == motion->steps) {
+        // Land exactly on the end
+        beam->x = stepper->end_x;
+        beam->y = stepper->end_y;
+    }
+    else {
+        const int32_t half = 1l << (ARC_POS_BITS - 1);
+        beam->x = motion->cx + ((stepper->x + half) >> ARC_POS_BITS);
+        beam->y = motion->cy + ((stepper->y + half) >> ARC_POS_BITS);
+    }
+    if (stepper->clamp) clampBeam(bounds, beam);
+    return true;
+}
+
+// Scale time spent drawing to fit the frame period
+// Split to keep the multiplication from overflowing
+static inline uint32_t scaleTime(uint32_t elapsed, uint16_t scale) {
+    if (scale == FRAME_SCALE_ONE) return elapsed;
+    return (elapsed >> 8) * scale + (((elapsed & 0xFF) * scale) >> 8);
+}
+
 static inline bool nextBeamState(uint32_t elapsed, const ScreenMotion* motion, ScreenState* screen) {
     BeamState beam;
     bool active;
@@ -61,7 +461,18 @@ static inline bool nextBeamState(uint32_t elapsed, const ScreenMotion* motion, S
         active = calcPoint(elapsed, (PointMotion*)motion, screen, &beam);
         break;
     case SM_Line:
-        active = calcLine(elapsed, (LineMotion*)motion, &beam);
+        elapsed = scaleTime(elapsed, screen->frame_scale);
+        active = (screen->plan.valid) ? calcPlannedLine(elapsed, &screen->plan, &beam) :
+                                        calcLine(elapsed, &screen->line, &beam)     ;
+        break;
+    case SM_Quad:
+    case SM_Cubic:
+        elapsed = scaleTime(elapsed, screen->frame_scale);
+        active = calcCurve(elapsed, (CurveMotion*)motion, &screen->curve, &screen->bounds, &beam);
+        break;
+    case SM_Arc:
+        elapsed = scaleTime(elapsed, screen->frame_scale);
+        active = calcArc(elapsed, (ArcMotion*)motion, &screen->arc, &screen->bounds, &beam);
         break;
     default:
         active = false;
@@ -70,18 +481,377 @@ static inline bool nextBeamState(uint32_t elapsed, const ScreenMotion* motion, S
         beam.a = 0;
     }
 
-    // Bounds check
-    int16_t x_width = 1 << screen->x_size_pow;
-    int16_t y_width = 1 << screen->y_size_pow;
-    int16_t x_offset = (!screen->x_centered) ? 0 : x_width >> 1;
-    int16_t y_offset = (!screen->y_centered) ? 0 : y_width >> 1;
-    beam.x = max(min(beam.x, x_width - x_offset), -x_offset);
-    beam.y = max(min(beam.y, y_width - y_offset), -y_offset);
+    // Motions were clipped to the screen when they started
     screen->beam = beam;
 
     return active;
 }
 
+// Size of a motion in the pool
+static size_t motionSize(const ScreenMotion* motion) {
+    switch (motion->type) {
+    case SM_Point:
+        return sizeof(PointMotion);
+    case SM_Line:
+        return sizeof(LineMotion);
+    case SM_Quad:
+        return QUAD_MOTION_SIZE;
+    case SM_Cubic:
+        return CUBIC_MOTION_SIZE;
+    case SM_Arc:
+        return sizeof(ArcMotion);
+    default:
+        return sizeof(ScreenMotion);
+    }
+}
+
+static bool placePoint(const Transform* xform, const ScreenBounds* bounds, PointMotion* motion) {
+    int32_t x = motion->x;
+    int32_t y = motion->y;
+    transformXY(xform, &x, &y);
+    if (outCode(bounds, x, y)) return false;
+    motion->x = x;
+    motion->y = y;
+    return true;
+}
+
+static bool placeLine(const Transform* xform, const ScreenBounds* bounds, LineMotion* motion) {
+    int32_t x1 = motion->x1;
+    int32_t y1 = motion->y1;
+    int32_t x2 = motion->x2;
+    int32_t y2 = motion->y2;
+    transformXY(xform, &x1, &y1);
+    transformXY(xform, &x2, &y2);
+
+    // Cut the line down to the screen
+    if (!clipLine(bounds, &x1, &y1, &x2, &y2)) return false;
+    motion->x1 = x1;
+    motion->y1 = y1;
+    motion->x2 = x2;
+    motion->y2 = y2;
+    return true;
+}
+
+static bool placeCurve(const Transform* xform, const ScreenBounds* bounds, CurveMotion* motion) {
+    uint8_t last = (motion->base.type == SM_Quad) ? 2 : 3;
+    int32_t x_min = INT32_MAX;
+    int32_t y_min = INT32_MAX;
+    int32_t x_max = INT32_MIN;
+    int32_t y_max = INT32_MIN;
+    for (uint8_t i = 0; i <= last; i++) {
+        int32_t x = motion->p[i][0];
+        int32_t y = motion->p[i][1];
+        transformXY(xform, &x, &y);
+        x_min = min(x_min, x);
+        x_max = max(x_max, x);
+        y_min = min(y_min, y);
+        y_max = max(y_max, y);
+        motion->p[i][0] = saturate16(x);
+        motion->p[i][1] = saturate16(y);
+    }
+
+    // A curve that is partly visible is clamped when it's drawn
+    if (boxOutside(bounds, x_min, y_min, x_max, y_max)) return false;
+    if (!xform->identity) {
+        motion->steps    = min(max(transformLength(xform, motion->steps), (uint32_t)1), (uint32_t)CURVE_MAX_STEPS);
+        motion->duration = max(transformLength(xform, motion->duration), (uint32_t)1);
+    }
+    return true;
+}
+
+static bool placeArc(const Transform* xform, const ScreenBounds* bounds, ArcMotion* motion) {
+    int32_t cx = motion->cx;
+    int32_t cy = motion->cy;
+    int32_t r  = transformLength(xform, motion->r);
+    transformXY(xform, &cx, &cy);
+
+    // An arc that is partly visible is clamped when it's drawn
+    if (boxOutside(bounds, cx - r, cy - r, cx + r, cy + r)) return false;
+    motion->cx = saturate16(cx);
+    motion->cy = saturate16(cy);
+    motion->r  = saturate16(r);
+    if (!xform->identity) {
+        // Arcs can only be turned and scaled evenly, not skewed
+        motion->start    = (xform->mirror) ? xform->angle - motion->start : xform->angle + motion->start;
+        motion->end      = (xform->mirror) ? xform->angle - motion->end   : xform->angle + motion->end;
+        motion->steps    = min(max(transformLength(xform, motion->steps), (uint32_t)1), (uint32_t)CURVE_MAX_STEPS);
+        motion->duration = max(transformLength(xform, motion->duration), (uint32_t)1);
+    }
+    return true;
+}
+
+// Transform a motion and clip it to the screen, in place
+// Returns false if none of it is visible
+static bool placeMotion(const ScreenState* screen, MotionUnion* motion) {
+    ScreenBounds bounds;
+    screenBounds(screen, &bounds);
+    switch (motion->base.type) {
+    case SM_Point:
+        return placePoint(&screen->transform, &bounds, &motion->point);
+    case SM_Line:
+        return placeLine(&screen->transform, &bounds, &motion->line);
+    case SM_Quad:
+    case SM_Cubic:
+        return placeCurve(&screen->transform, &bounds, &motion->curve);
+    case SM_Arc:
+        return placeArc(&screen->transform, &bounds, &motion->arc);
+    default:
+        return false;
+    }
+}
+
+// Clip a placed motion again, in place, for when the screen has shrunk since it was pushed
+// Curves and arcs are clamped as they're drawn. Returns false if none of it is visible
+static bool clipMotion(const ScreenBounds* bounds, ScreenMotion* motion) {
+    if (motion->type == SM_Point) {
+        const PointMotion* point = (const PointMotion*)motion;
+        return !outCode(bounds, point->x, point->y);
+    }
+    if (motion->type != SM_Line) return true;
+
+    LineMotion* line = (LineMotion*)motion;
+    int32_t x1 = line->x1;
+    int32_t y1 = line->y1;
+    int32_t x2 = line->x2;
+    int32_t y2 = line->y2;
+    if (!clipLine(bounds, &x1, &y1, &x2, &y2)) return false;
+    line->x1 = x1;
+    line->y1 = y1;
+    line->x2 = x2;
+    line->y2 = y2;
+    return true;
+}
+
+// Copy a stored motion and place it on the screen
+static inline bool loadMotion(const ScreenState* screen, const ScreenMotion* motion, MotionUnion* dest) {
+    memcpy(dest, motion, motionSize(motion));
+    return placeMotion(screen, dest);
+}
+
+// Length in millipoints
+static uint32_t lineLength(const LineMotion* motion) {
+    int32_t dx = (int32_t)motion->x2 - motion->x1;
+    int32_t dy = (int32_t)motion->y2 - motion->y1;
+    return isqrt64(((uint64_t)((int64_t)dx * dx) + (uint64_t)((int64_t)dy * dy)) * 1000000);
+}
+
+// The speed the line was pushed with, in plan units
+// Any corner can be taken at this speed
+static inline uint32_t lineSpeed(const LineMotion* motion) {
+    return (uint32_t)motion->speed << PLAN_FRAC_BITS;
+}
+
+static inline bool planEnabled(const ScreenState* screen) {
+    return (screen->max_slew > 0 && screen->slew_accel > 0);
+}
+
+// Square of the speed gained over a distance in millipoints
+// The acceleration is in millipoints per microsecond gained in a millisecond
+static inline uint64_t reachSquared(uint16_t accel, uint32_t distance) {
+    return (uint64_t)accel * distance * (2ull << (2 * PLAN_FRAC_BITS)) / 1000;
+}
+
+// Distance in millipoints to change between speeds whose squares are given
+static inline uint32_t rampDistance(uint16_t accel, uint64_t from_sq, uint64_t to_sq) {
+    uint64_t diff = (to_sq > from_sq) ? to_sq - from_sq : from_sq - to_sq;
+    return diff * 1000 / ((uint64_t)accel << (2 * PLAN_FRAC_BITS + 1));
+}
+
+// Microseconds to change between speeds
+static inline uint32_t rampTime(uint16_t accel, uint32_t from, uint32_t to) {
+    uint32_t diff = (to > from) ? to - from : from - to;
+    return (uint64_t)diff * 1000 / ((uint32_t)accel << PLAN_FRAC_BITS);
+}
+
+// Fastest speed the beam can have when it crosses into the next motion
+static uint32_t junctionSpeed(const ScreenState* screen, const LinePlan* plan, const ScreenMotion* next,
+                              uint32_t v_safe, uint32_t v_max) {
+    if (!next || next->type != SM_Line) return v_safe;
+
+    // The beam jumps to the start of a line that isn't connected
+    const LineMotion* line = (const LineMotion*)next;
+    if (1000l*line->x1 != plan->mx2 || 1000l*line->y1 != plan->my2) return v_safe;
+
+    uint32_t length = lineLength(line);
+    if (length == 0) return v_safe;
+
+    // Slow down as the corner gets sharper, cosine with 16 fractional bits
+    // Right angles and beyond are taken at the safe speed
+    int64_t dot = (int64_t)plan->ux * (line->x2 - line->x1) + (int64_t)plan->uy * (line->y2 - line->y1);
+    int64_t cos_angle = dot * 1000 / (int64_t)length;
+    uint32_t speed = v_safe + ((cos_angle > 0) ? ((uint64_t)(v_max - v_safe) * cos_angle) >> 16 : 0);
+
+    // Leave enough room in the next line to get back down to the safe speed
+    uint32_t brake = isqrt64((uint64_t)v_safe * v_safe + reachSquared(screen->slew_accel, length));
+    return min(speed, brake);
+}
+
+// Build the velocity profile of a line, chained on from the plan of the one before it
+// Returns false when there's nothing to plan and it's drawn at constant speed
+static bool planLine(const ScreenState* screen, LinePlan* plan, const LineMotion* motion, const ScreenMotion* next) {
+    uint32_t v_safe = lineSpeed(motion);
+    uint32_t v_max  = (uint32_t)screen->max_slew << PLAN_FRAC_BITS;
+    uint32_t length = lineLength(motion);
+    int32_t mx1 = 1000l*motion->x1;
+    int32_t my1 = 1000l*motion->y1;
+
+    // A line connected to the previous one starts at its exit speed
+    uint32_t v_entry = (plan->valid && plan->mx2 == mx1 && plan->my2 == my1) ? plan->v_exit : v_safe;
+
+    plan->valid = false;
+    if (!planEnabled(screen) || v_max <= v_safe || length == 0) {
+        // Draw at constant speed
+        return false;
+    }
+
+    plan->mx2 = 1000l*motion->x2;
+    plan->my2 = 1000l*motion->y2;
+    plan->ux  = ((int64_t)(plan->mx2 - mx1) << 16) / (int64_t)length;
+    plan->uy  = ((int64_t)(plan->my2 - my1) << 16) / (int64_t)length;
+    uint16_t accel = screen->slew_accel;
+    v_entry = min(v_entry, v_max);
+
+    // The exit speed has to be reachable from the entry speed
+    uint64_t reach    = reachSquared(accel, length);
+    uint64_t entry_sq = (uint64_t)v_entry * v_entry;
+    uint32_t v_exit   = junctionSpeed(screen, plan, next, v_safe, v_max);
+    v_exit = min(v_exit, isqrt64(entry_sq + reach));
+    v_exit = max(v_exit, (entry_sq > reach) ? isqrt64(entry_sq - reach) : 0);
+    uint64_t exit_sq = (uint64_t)v_exit * v_exit;
+
+    // Peak where speeding up and slowing down meet, limited by the max slew
+    uint32_t v_peak = isqrt64((reach + entry_sq + exit_sq) / 2);
+    v_peak = min(v_peak, v_max);
+    v_peak = max(v_peak, max(v_entry, v_exit));
+    uint64_t peak_sq = (uint64_t)v_peak * v_peak;
+
+    // Time of each phase
+    uint32_t ramps   = rampDistance(accel, entry_sq, peak_sq) + rampDistance(accel, peak_sq, exit_sq);
+    uint32_t t_accel = rampTime(accel, v_entry, v_peak);
+    uint32_t t_decel = rampTime(accel, v_peak, v_exit);
+    uint32_t t_cruise = (length > ramps) ? ((uint64_t)(length - ramps) << PLAN_FRAC_BITS) / v_peak : 0;
+    uint32_t duration = max(t_accel + t_cruise + t_decel, (uint32_t)1);
+
+    // Whole steps of each phase
+    uint32_t steps = (duration + LINE_STEP_US - 1) / LINE_STEP_US;
+    steps = min(max(steps, (uint32_t)1), (uint32_t)LINE_MAX_STEPS);
+    uint32_t accel_steps = ((uint64_t)t_accel * steps + duration / 2) / duration;
+    uint32_t decel_steps = ((uint64_t)t_decel * steps + duration / 2) / duration;
+    decel_steps = min(decel_steps, steps - accel_steps);
+    uint32_t cruise_steps = steps - accel_steps - decel_steps;
+
+    // Distance of a step at the entry and exit speeds. The peak step is worked out from them so the steps
+    // add up to the length. Steps speeding up or slowing down are taken at their midpoint speed
+    int64_t entry = (uint64_t)v_entry * duration / steps;
+    int64_t exit  = (uint64_t)v_exit * duration / steps;
+    int64_t peak  = (((int64_t)length << (PLAN_FRAC_BITS + 1)) - accel_steps * entry - decel_steps * exit) /
+                    (int64_t)(accel_steps + 2 * cruise_steps + decel_steps);
+    peak = max(peak, (int64_t)0);
+    int64_t gain = (accel_steps) ? (peak - entry) / (int64_t)accel_steps : 0;
+
+    plan->v_entry  = v_entry;
+    plan->v_exit   = v_exit;
+    plan->duration = duration;
+    plan->steps    = steps;
+    plan->cruise   = accel_steps;
+    plan->decel    = accel_steps + cruise_steps;
+    plan->step     = 0;
+    plan->peak     = peak;
+    plan->slow     = (decel_steps) ? (peak - exit) / (int64_t)decel_steps : 0;
+    plan->x        = (int64_t)mx1 << PLAN_FRAC_BITS;
+    plan->y        = (int64_t)my1 << PLAN_FRAC_BITS;
+    aimPlan(plan, entry + gain / 2, gain);
+    clockStart(&plan->clock, duration, steps);
+    plan->valid    = true;
+    return true;
+}
+
+// The motion that will follow the given one, if known yet
+// Sequence motions are placed into the buffer
+static inline const ScreenMotion* followingMotion(const ScreenState* screen, const RingMemPool* pool, const ScreenMotion* motion, MotionUnion* buf) {
+    if (screen->sequence_enabled) {
+        const ScreenMotion* next = screen->sequence[(screen->sequence_idx + 1) % screen->sequence_size];
+        return (loadMotion(screen, next, buf)) ? &buf->base : NULL;
+    }
+    return ring_peek_next(pool, motion);
+}
+
+// Measure the time needed to draw the sequence
+// Planned lines are timed by the profile they're drawn with. A first pass chains the first line on from the last
+static void measureSequence(ScreenState* screen) {
+    uint32_t draw_time = 0;
+    LinePlan plan;
+    plan.valid = false;
+    for (uint8_t pass = (planEnabled(screen)) ? 0 : 1; pass < 2; pass++) {
+        draw_time = 0;
+        screen->frame_points = 0;
+        for (int8_t i = 0; i < screen->sequence_size; i++) {
+            MotionUnion placed;
+            MotionUnion next;
+            if (!loadMotion(screen, screen->sequence[i], &placed)) continue;
+            const ScreenMotion* motion = &placed.base;
+            if (motion->type != SM_Line) plan.valid = false;
+            switch (motion->type) {
+            case SM_Point:
+                screen->frame_points++;
+                break;
+            case SM_Line:
+                if (planEnabled(screen)
+                    && planLine(screen, &plan, &placed.line,
+                                (loadMotion(screen, screen->sequence[(i + 1) % screen->sequence_size], &next)) ?
+                                &next.base : NULL)) {
+                    draw_time += plan.duration;
+                }
+                else {
+                    draw_time += lineLength(&placed.line) / placed.line.speed;
+                }
+                break;
+            case SM_Quad:
+            case SM_Cubic:
+                draw_time += placed.curve.duration;
+                break;
+            case SM_Arc:
+                draw_time += placed.arc.duration;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    screen->frame_draw_time = draw_time;
+}
+
+// Start a new frame of a locked sequence
+// Returns false while idling until the frame period has elapsed
+static bool startFrame(uint32_t time, ScreenState* screen) {
+    uint32_t since = time - screen->frame_start;
+    if (screen->frame_running && since < screen->refresh_period) {
+        return false;
+    }
+
+    // Keep in phase unless the last frame overran
+    screen->frame_start   = (screen->frame_running && since < 2 * screen->refresh_period) ?
+                            screen->frame_start + screen->refresh_period : time;
+    screen->frame_running = true;
+
+    // Points are held for a fixed time, only lines can be sped up or slowed down
+    uint32_t hold_time = (uint32_t)screen->frame_points * screen->hold_time * 1000;
+    uint32_t available = (screen->refresh_period > hold_time) ? screen->refresh_period - hold_time : 0;
+    uint32_t scale;
+    if (available == 0) {
+        scale = FRAME_SCALE_MAX;
+    }
+    else {
+        scale = ((uint64_t)screen->frame_draw_time * FRAME_SCALE_ONE + available - 1) / available;
+    }
+    if (screen->refresh_idle) {
+        // Draw at the normal speed and idle for the rest of the frame
+        scale = max(scale, (uint32_t)FRAME_SCALE_ONE);
+    }
+    screen->frame_scale = min(max(scale, (uint32_t)FRAME_SCALE_MIN), (uint32_t)FRAME_SCALE_MAX);
+    return true;
+}
+
 void screen_init(ScreenState* screen) {
     memset(screen, '\0', sizeof(ScreenState));
     screen->x_size_pow       = DAC_BIT_WIDTH;
@@ -90,74 +860,158 @@ void screen_init(ScreenState* screen) {
     screen->hold_time        = 1;  // 1 ms
     screen->sequence_enabled = false;
     screen->sequence_idx     = -1;
+    screen->frame_scale      = FRAME_SCALE_ONE;
+    screen->transform.a        = TRANSFORM_ONE;
+    screen->transform.d        = TRANSFORM_ONE;
+    screen->transform.scale    = TRANSFORM_ONE;
+    screen->transform.identity = true;
 }
 
-PointMotion* screen_push_point(RingMemPool* pool, const PointCmd* cmd) {
+// Place a new motion and add it to the pool
+// Motions loading into a sequence are stored as given, they're placed when drawn
+static ScreenMotion* pushMotion(const ScreenState* screen, RingMemPool* pool, MotionUnion* motion) {
+    if (!screen->sequence_enabled && !placeMotion(screen, motion)) {
+        // Motion is off the screen. That's not an error
+        if (pool->last_err != RING_CRITICAL) pool->last_err = RING_OK;
+        return NULL;
+    }
+
     // Allocate object from the pool
-    PointMotion* motion = ring_get(pool, sizeof(PointMotion));
-    if (!motion) {
+    size_t size = motionSize(&motion->base);
+    ScreenMotion* entry = ring_get(pool, size);
+    if (!entry) {
         return NULL;
     }
+    memcpy(entry, motion, size);
+    return entry;
+}
+
+PointMotion* screen_push_point(const ScreenState* screen, RingMemPool* pool, const PointCmd* cmd) {
+    MotionUnion motion;
+    motion.point.base.type = SM_Point;
+    motion.point.x = cmd->x;
+    motion.point.y = cmd->y;
+    return (PointMotion*)pushMotion(screen, pool, &motion);
+}
 
+LineMotion* screen_push_line(const ScreenState* screen, RingMemPool* pool, const LineCmd* cmd) {
     // Populate motion
-    motion->base.type = SM_Point;
-    motion->x = cmd->x;
-    motion->y = cmd->y;
-    return motion;
+    MotionUnion motion;
+    motion.line.base.type = SM_Line;
+    motion.line.x1        = cmd->x1;
+    motion.line.y1        = cmd->y1;
+    motion.line.x2        = cmd->x2;
+    motion.line.y2        = cmd->y2;
+    motion.line.speed     = max(2, screen->speed);
+
+    return (LineMotion*)pushMotion(screen, pool, &motion);
 }
 
-LineMotion* screen_push_line(RingMemPool* pool, const LineCmd* cmd, uint16_t speed) {
-    // Allocate object from the pool
-    speed = max(2, speed);
-    LineMotion* motion = ring_get(pool, sizeof(LineMotion));
-    if (!motion) {
-        return NULL;
+// Estimate the arc length of a Bezier curve from its chord and control polygon
+static float curveLength(float points[][2], uint8_t order) {
+    float polygon = 0;
+    for (uint8_t i = 0; i < order; i++) {
+        polygon += hypotf(points[i + 1][0] - points[i][0], points[i + 1][1] - points[i][1]);
     }
-    // Calculate length in millipoints
-    float length = sqrtf(powf(cmd->x2 - cmd->x1, 2) + powf(cmd->y2 - cmd->y1, 2)) * 1000;
+    float chord = hypotf(points[order][0] - points[0][0], points[order][1] - points[0][1]);
+    return (2 * chord + (order - 1) * polygon) / (order + 1);
+}
+
+CurveMotion* screen_push_curve(const ScreenState* screen, RingMemPool* pool, const CurveCmd* cmd) {
+    uint16_t speed = max(2, screen->speed);
+    bool cubic = (cmd->order == 3);
+
+    // Split the curve in half to estimate the arc length
+    uint8_t last = cmd->order;
+    float halves[2][4][2];
+    float work[4][2];
+    for (uint8_t i = 0; i <= last; i++) {
+        work[i][0] = cmd->x[i];
+        work[i][1] = cmd->y[i];
+    }
+    for (uint8_t n = 0; n <= last; n++) {
+        // De Casteljau. Each pass gives one more point of each half
+        for (uint8_t d = 0; d < 2; d++) {
+            halves[0][n][d]        = work[0][d];
+            halves[1][last - n][d] = work[last - n][d];
+        }
+        for (uint8_t i = 0; i < last - n; i++) {
+            work[i][0] = (work[i][0] + work[i + 1][0]) / 2;
+            work[i][1] = (work[i][1] + work[i + 1][1]) / 2;
+        }
+    }
+    float length = curveLength(halves[0], last) + curveLength(halves[1], last);
 
     // Populate motion
-    motion->base.type = SM_Line;
-#ifndef AVR
-    motion->x1 = cmd->x1;
-    motion->y1 = cmd->y1;
-    motion->x2 = cmd->x2;
-    motion->y2 = cmd->y2;
-#endif
-    // Multiply by 1000 to get millipoints
-    motion->mx1 = 1000l*cmd->x1;
-    motion->my1 = 1000l*cmd->y1;
-    motion->mx2 = 1000l*cmd->x2;
-    motion->my2 = 1000l*cmd->y2;
-    motion->dx  = (float)(motion->mx2 - motion->mx1) * speed / length;
-    motion->dy  = (float)(motion->my2 - motion->my1) * speed / length;
+    MotionUnion motion;
+    motion.curve.base.type = (cubic) ? SM_Cubic : SM_Quad;
+    for (uint8_t i = 0; i <= last; i++) {
+        motion.curve.p[i][0] = cmd->x[i];
+        motion.curve.p[i][1] = cmd->y[i];
+    }
+    float steps = ceilf(length / CURVE_STEP_LEN);
+    motion.curve.steps    = (steps < 1) ? 1 : (steps > CURVE_MAX_STEPS) ? CURVE_MAX_STEPS : steps;
+    motion.curve.duration = max(1.0f, length * 1000 / speed);
 
-    return motion;
+    return (CurveMotion*)pushMotion(screen, pool, &motion);
+}
+
+ArcMotion* screen_push_arc(const ScreenState* screen, RingMemPool* pool, const ArcCmd* cmd) {
+    uint16_t speed = max(2, screen->speed);
+
+    // Populate motion
+    float length = fabsf(degToRad(cmd->end - cmd->start)) * cmd->r;
+    float steps  = ceilf(length / CURVE_STEP_LEN);
+    MotionUnion motion;
+    motion.arc.base.type = SM_Arc;
+    motion.arc.cx        = cmd->cx;
+    motion.arc.cy        = cmd->cy;
+    motion.arc.r         = cmd->r;
+    motion.arc.start     = cmd->start;
+    motion.arc.end       = cmd->end;
+    motion.arc.steps     = (steps < 1) ? 1 : (steps > CURVE_MAX_STEPS) ? CURVE_MAX_STEPS : steps;
+    motion.arc.duration  = max(1.0f, length * 1000 / speed);
+
+    return (ArcMotion*)pushMotion(screen, pool, &motion);
+}
+
+// Move on to the next motion of the sequence, counting each pass
+static inline void nextInSequence(ScreenState* screen) {
+    screen->sequence_idx = (screen->sequence_idx + 1) % screen->sequence_size;
+    if (screen->sequence_idx == 0) {
+        screen->frame_count++;
+    }
 }
 
 bool update_screen(uint32_t time, ScreenState* screen, RingMemPool* pool) {
     int32_t elapsed = time - screen->motion_start;
 
     // Get the current motion
-    ScreenMotion* motion = (!screen->sequence_enabled) ? ring_peek(pool)                        :
-                           (screen->sequence_idx >= 0) ? screen->sequence[screen->sequence_idx] :
-                                                         NULL                                   ;
+    // A running sequence motion was placed when it started
+    ScreenMotion* motion = (!screen->sequence_enabled) ? ring_peek(pool)      :
+                           (screen->sequence_idx >= 0) ? &screen->active.base :
+                                                         NULL                 ;
     if (!motion) {
         return false;
     }
 
     // Check for active motion
+    bool restart = false;
     if (screen->motion_active) {
         // Get the next motion
-        if (nextBeamState(elapsed, motion, screen)) {
+        if (!screen->preempt && nextBeamState(elapsed, motion, screen)) {
             // Current motion is still active
             return true;
         }
+        screen->beam.a = 0;
+        // A preempted motion is drawn again from its start, as things now are
+        restart = screen->preempt;
+        screen->preempt = false;
         // Motion has completed
-        if (screen->sequence_enabled) {
-            screen->sequence_idx = (screen->sequence_idx + 1) % screen->sequence_size;
+        if (!restart && screen->sequence_enabled) {
+            nextInSequence(screen);
         }
-        else if (!screen->repeat || pool->count > 1) {
+        else if (!restart && (!screen->repeat || pool->count > 1)) {
             ring_pop(pool);
         }
         screen->motion_active = 0;
@@ -171,13 +1025,197 @@ bool update_screen(uint32_t time, ScreenState* screen, RingMemPool* pool) {
         return false;
     }
 
+    // Hold the frame rate of a locked sequence
+    if (screen->sequence_enabled && screen->refresh_period && screen->sequence_idx == 0 && !restart) {
+        if (!startFrame(time, screen)) {
+            // Idle with the beam off
+            screen->beam.a = 0;
+            return false;
+        }
+    }
+
+    // Sequences are stored as given. Draw a placed copy
+    if (screen->sequence_enabled) {
+        if (!loadMotion(screen, motion, &screen->active)) {
+            // Off the screen, skip it
+            nextInSequence(screen);
+            screen->beam.a = 0;
+            return false;
+        }
+        motion = &screen->active.base;
+    }
+    screenBounds(screen, &screen->bounds);
+
+    // Streamed motions were placed when pushed, against the screen as it was then
+    if (!screen->sequence_enabled && !clipMotion(&screen->bounds, motion)) {
+        // Off the screen now, skip it
+        ring_pop(pool);
+        screen->beam.a = 0;
+        return false;
+    }
+
     // Determine new beam position
     screen->motion_active = 1;
     screen->motion_start = time;
+    if (motion->type == SM_Line) {
+        startLine(&screen->line, (const LineMotion*)motion);
+    }
+    if (motion->type == SM_Line && planEnabled(screen)) {
+        MotionUnion next;
+        planLine(screen, &screen->plan, (LineMotion*)motion, followingMotion(screen, pool, motion, &next));
+    }
+    else {
+        screen->plan.valid = false;
+    }
+    if (motion->type == SM_Quad || motion->type == SM_Cubic) {
+        const CurveMotion* curve = (const CurveMotion*)motion;
+        int16_t x_min, y_min, x_max, y_max;
+        curveBox(curve, &x_min, &y_min, &x_max, &y_max);
+        startCurve(&screen->curve, curve);
+        screen->curve.clamp = !boxInside(&screen->bounds, x_min, y_min, x_max, y_max);
+    }
+    else if (motion->type == SM_Arc) {
+        const ArcMotion* arc = (const ArcMotion*)motion;
+        startArc(&screen->arc, arc);
+        screen->arc.clamp = !boxInside(&screen->bounds, (int32_t)arc->cx - arc->r, (int32_t)arc->cy - arc->r,
+                                                        (int32_t)arc->cx + arc->r, (int32_t)arc->cy + arc->r);
+    }
     nextBeamState(0, motion, screen);
     return true;
 }
 
+// Cut the active motion short so a control command shows at once
+// It starts over on the next update rather than being dropped
+void screen_preempt(ScreenState* screen) {
+    screen->preempt = screen->motion_active;
+}
+
+// Turn the beam off and drop everything waiting to be drawn
+bool screen_blank(ScreenState* screen, RingMemPool* pool) {
+    sequence_clear(screen);
+    ring_reset(pool);
+    screen->motion_active = false;
+    screen->preempt       = false;
+    screen->beam.a        = 0;
+    return true;
+}
+
+// Lock sequence frames to a refresh period
+bool screen_set_refresh(ScreenState* screen, uint32_t period, bool idle) {
+    screen->refresh_period = period;
+    screen->refresh_idle   = idle;
+    screen->frame_running  = false;
+    screen->frame_scale    = FRAME_SCALE_ONE;
+    return true;
+}
+
+// Sine of 0 to 90 degrees with 15 fractional bits
+static const uint16_t sine_table[91] PROGMEM = {
+        0,   572,  1144,  1715,  2286,  2856,  3425,  3993,  4560,  5126,
+     5690,  6252,  6813,  7371,  7927,  8481,  9032,  9580, 10126, 10668,
+    11207, 11743, 12275, 12803, 13328, 13848, 14365, 14876, 15384, 15886,
+    16384, 16877, 17364, 17847, 18324, 18795, 19261, 19720, 20174, 20622,
+    21063, 21498, 21926, 22348, 22763, 23170, 23571, 23965, 24351, 24730,
+    25102, 25466, 25822, 26170, 26510, 26842, 27166, 27482, 27789, 28088,
+    28378, 28660, 28932, 29197, 29452, 29698, 29935, 30163, 30382, 30592,
+    30792, 30983, 31164, 31336, 31499, 31651, 31795, 31928, 32052, 32166,
+    32270, 32365, 32449, 32524, 32588, 32643, 32688, 32723, 32748, 32763,
+    32768,
+};
+
+// Sine of whole degrees with 16 fractional bits
+static int32_t sinDeg(int32_t degrees) {
+    degrees %= 360;
+    if (degrees < 0) degrees += 360;
+    bool negative = (degrees >= 180);
+    if (negative) degrees -= 180;
+    if (degrees > 90) degrees = 180 - degrees;
+    int32_t value = (int32_t)pgm_read_word(&sine_table[degrees]) << 1;
+    return (negative) ? -value : value;
+}
+
+// Angle of (x, y) in whole degrees, like atan2 from -179 to 180
+static int16_t atanDeg(int32_t y, int32_t x) {
+    uint32_t ax = labs(x);
+    uint32_t ay = labs(y);
+    uint32_t radius = isqrt64((uint64_t)ax * ax + (uint64_t)ay * ay);
+    if (radius == 0) return 0;
+    // Look up the shorter side, where the sine changes fastest
+    bool steep = (ay > ax);
+    int32_t sine = ((uint64_t)(steep ? ax : ay) << 16) / radius;
+    int16_t degrees = 0;
+    while (degrees < 45 && sinDeg(degrees) + sinDeg(degrees + 1) < 2 * sine) degrees++;
+    if (steep) degrees = 90 - degrees;
+    if (x < 0) degrees = 180 - degrees;
+    return (y < 0) ? -degrees : degrees;
+}
+
+static inline int32_t toFixed(float value) {
+    return lroundf(value * TRANSFORM_ONE);
+}
+
+static void transformChanged(ScreenState* screen) {
+    Transform* xform = &screen->transform;
+    xform->identity = (xform->a == TRANSFORM_ONE && xform->b == 0 && xform->c == 0 && xform->d == TRANSFORM_ONE
+                       && xform->tx == 0 && xform->ty == 0);
+
+    // A loaded sequence now takes a different time to draw
+    if (screen->sequence_enabled && screen->sequence_idx >= 0) {
+        measureSequence(screen);
+    }
+}
+
+// Set how fast planned lines can go, in millipoints per microsecond and that gained in a millisecond
+// A loaded sequence now takes a different time to draw
+bool screen_set_slew(ScreenState* screen, uint16_t max_speed, uint16_t accel) {
+    screen->max_slew   = max_speed;
+    screen->slew_accel = accel;
+    screen->plan.valid = false;
+    if (screen->sequence_enabled && screen->sequence_idx >= 0) {
+        measureSequence(screen);
+    }
+    return true;
+}
+
+// Set the transform from a matrix
+bool screen_set_transform(ScreenState* screen, float a, float b, float c, float d, int16_t tx, int16_t ty) {
+    Transform* xform = &screen->transform;
+    xform->a      = toFixed(a);
+    xform->b      = toFixed(b);
+    xform->c      = toFixed(c);
+    xform->d      = toFixed(d);
+    // Determinant with 32 fractional bits, so its root has 16
+    int64_t det   = (int64_t)xform->a * xform->d - (int64_t)xform->b * xform->c;
+    xform->tx     = tx;
+    xform->ty     = ty;
+    uint32_t root = isqrt64((det < 0) ? -det : det);
+    xform->scale  = (root > INT32_MAX) ? INT32_MAX : root;
+    xform->angle  = atanDeg(xform->c, xform->a);
+    xform->mirror = (det < 0);
+    transformChanged(screen);
+    return true;
+}
+
+// Set the transform from a rotation and an even scale
+bool screen_set_rotation(ScreenState* screen, int16_t degrees, float scale, int16_t tx, int16_t ty) {
+    Transform* xform = &screen->transform;
+    const int64_t round = TRANSFORM_ONE >> 1;
+    int32_t size = toFixed(scale);
+    int32_t cosine = ((int64_t)size * sinDeg((int32_t)degrees + 90) + round) >> 16;
+    int32_t sine   = ((int64_t)size * sinDeg(degrees) + round) >> 16;
+    xform->a      = cosine;
+    xform->b      = -sine;
+    xform->c      = sine;
+    xform->d      = cosine;
+    xform->tx     = tx;
+    xform->ty     = ty;
+    xform->scale  = labs(size);
+    xform->angle  = ((size < 0) ? degrees + 180 : degrees) % 360;
+    xform->mirror = false;
+    transformChanged(screen);
+    return true;
+}
+
 // Start loading a sequence
 bool sequence_start(ScreenState* screen) {
     if (screen->sequence_enabled) {
@@ -185,6 +1223,7 @@ bool sequence_start(ScreenState* screen) {
         return false;
     }
     screen->sequence_enabled = true;
+    screen->plan.valid       = false;
     return true;
 }
 
@@ -194,7 +1233,9 @@ bool sequence_end(ScreenState* screen) {
         // There is no sequence to end, or it's currently running
         return false;
     }
-    screen->sequence_idx = 0;
+    screen->sequence_idx  = 0;
+    screen->frame_running = false;
+    measureSequence(screen);
     return true;
 }
 
@@ -203,6 +1244,9 @@ bool sequence_clear(ScreenState* screen) {
     screen->sequence_enabled = false;
     screen->sequence_size    = 0;
     screen->sequence_idx     = -1;
+    screen->plan.valid       = false;
+    screen->frame_running    = false;
+    screen->frame_scale      = FRAME_SCALE_ONE;
     return true;
 }
 
@@ -217,3 +1261,121 @@ bool add_to_sequence(ScreenState* screen, ScreenMotion* motion) {
     screen->sequence[screen->sequence_size++] = motion;
     return true;
 }
+
+// Entry of the sequence that holds the motion, or -1
+static int8_t sequenceEntry(const ScreenState* screen, const ScreenMotion* motion) {
+    for (int8_t i = 0; i < screen->sequence_size; i++) {
+        if (screen->sequence[i] == motion) return i;
+    }
+    return -1;
+}
+
+// Move the oldest motion still in the sequence behind the newest
+// Popping only moves the ends, so the pool is put back when the copy doesn't fit
+static void moveOldest(ScreenState* screen, RingMemPool* pool) {
+    ScreenMotion* oldest = ring_peek(pool);
+    int8_t idx = sequenceEntry(screen, oldest);
+    if (idx < 0 || pool->reserve_end) return;
+
+    RingMemPool saved = *pool;
+    size_t size = motionSize(oldest);
+    MotionUnion copy;
+    memcpy(&copy, oldest, size);
+    ring_pop(pool);
+    ScreenMotion* moved = ring_get(pool, size);
+    if (!moved) {
+        *pool = saved;
+        return;
+    }
+    memcpy(moved, &copy, size);
+    screen->sequence[idx] = moved;
+}
+
+// Store a copy of a motion for an edit
+// Edits leave the motions they replaced in the pool, and it only frees from its oldest end
+// Each store drops those from that end and moves one still in use to the other,
+// so the pool turns over and every replaced motion comes round to be dropped
+static ScreenMotion* storeMotion(ScreenState* screen, RingMemPool* pool, const ScreenMotion* motion) {
+    while (pool->count > 0 && sequenceEntry(screen, ring_peek(pool)) < 0) {
+        ring_pop(pool);
+    }
+    moveOldest(screen, pool);
+
+    size_t size = motionSize(motion);
+    ScreenMotion* entry = ring_get(pool, size);
+    if (entry) {
+        memcpy(entry, motion, size);
+    }
+    return entry;
+}
+
+// A running sequence takes a different time to draw after an edit
+static inline void sequenceEdited(ScreenState* screen) {
+    if (screen->sequence_idx >= 0) {
+        measureSequence(screen);
+    }
+}
+
+// Replace an entry of a sequence. What's being drawn finishes first
+// A motion the same size as the old one is copied over it, taking nothing from the pool
+bool sequence_set(ScreenState* screen, RingMemPool* pool, uint8_t idx, const ScreenMotion* motion) {
+    if (!screen->sequence_enabled || idx >= screen->sequence_size) {
+        return false;
+    }
+    size_t size = motionSize(motion);
+    if (motionSize(screen->sequence[idx]) == size) {
+        memcpy(screen->sequence[idx], motion, size);
+    }
+    else {
+        ScreenMotion* entry = storeMotion(screen, pool, motion);
+        if (!entry) return false;
+        screen->sequence[idx] = entry;
+    }
+    sequenceEdited(screen);
+    return true;
+}
+
+// Add an entry before idx, or at the end when idx is the size
+bool sequence_insert(ScreenState* screen, RingMemPool* pool, uint8_t idx, const ScreenMotion* motion) {
+    if (!screen->sequence_enabled || screen->sequence_size >= SEQ_LEN || idx > screen->sequence_size) {
+        return false;
+    }
+    ScreenMotion* entry = storeMotion(screen, pool, motion);
+    if (!entry) return false;
+    memmove(&screen->sequence[idx + 1], &screen->sequence[idx],
+            (screen->sequence_size - idx) * sizeof(ScreenMotion*));
+    screen->sequence[idx] = entry;
+    screen->sequence_size++;
+
+    // Keep on the motion being drawn. One not started yet gives way to the new one
+    if ((int8_t)idx < screen->sequence_idx || ((int8_t)idx == screen->sequence_idx && screen->motion_active)) {
+        screen->sequence_idx++;
+    }
+    sequenceEdited(screen);
+    return true;
+}
+
+// Remove an entry. A running sequence keeps at least one, clear it instead
+bool sequence_delete(ScreenState* screen, uint8_t idx) {
+    if (!screen->sequence_enabled || idx >= screen->sequence_size
+        || (screen->sequence_idx >= 0 && screen->sequence_size == 1)
+    ) {
+        return false;
+    }
+    screen->sequence_size--;
+    memmove(&screen->sequence[idx], &screen->sequence[idx + 1],
+            (screen->sequence_size - idx) * sizeof(ScreenMotion*));
+
+    if ((int8_t)idx < screen->sequence_idx) {
+        screen->sequence_idx--;
+    }
+    else if ((int8_t)idx == screen->sequence_idx && screen->motion_active) {
+        // The copy being drawn finishes, then the one that followed it
+        screen->sequence_idx = (idx == 0) ? screen->sequence_size - 1 : idx - 1;
+    }
+    if (screen->sequence_idx >= screen->sequence_size) {
+        screen->sequence_idx = 0;
+    }
+    sequenceEdited(screen);
+    return true;
+}
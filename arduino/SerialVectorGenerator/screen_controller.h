@@ -3,11 +3,29 @@
 
 #include <inttypes.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "command_parser.h"
 
 #define SEQ_LEN 16
 
+// Curves are stepped about every 2 points
+#define CURVE_STEP_LEN  2
+#define CURVE_MAX_STEPS 1024
+
+// Time scale is fixed point with 8 fractional bits
+#define FRAME_SCALE_ONE 256
+#define FRAME_SCALE_MIN (FRAME_SCALE_ONE >> 4)
+#define FRAME_SCALE_MAX (FRAME_SCALE_ONE << 4)
+
+// Planned lines are stepped about every LINE_STEP_US
+#define LINE_STEP_US   16
+#define LINE_MAX_STEPS 4096
+#define PLAN_FRAC_BITS 8
+
+// Transform matrix is fixed point with 16 fractional bits
+#define TRANSFORM_ONE (1l << 16)
+
 
 typedef struct BeamState {
     int16_t x;
@@ -19,10 +37,14 @@ typedef enum ScreenMotionType {
     SM_None = 0,
     SM_Point,
     SM_Line,
+    SM_Quad,
+    SM_Cubic,
+    SM_Arc,
 } ScreenMotionType;
 
+// Motions are packed to fit as many as possible in the pool
 typedef struct ScreenMotion {
-    ScreenMotionType type;
+    uint8_t type; // ScreenMotionType
 } ScreenMotion;
 
 typedef struct PointMotion {
@@ -31,21 +53,148 @@ typedef struct PointMotion {
     int16_t y;
 } PointMotion;
 
+// The velocity is worked out when the line starts
 typedef struct LineMotion {
     ScreenMotion base;
-#ifndef AVR
     int16_t x1;
     int16_t y1;
     int16_t x2;
     int16_t y2;
-#endif
+    uint16_t speed; // Millipoints per microsecond
+} LineMotion;
+
+// Quadratic and cubic Bezier curves
+typedef struct CurveMotion {
+    ScreenMotion base;
+    uint16_t steps;    // Forward differencing steps
+    uint32_t duration; // Microseconds to draw
+    int16_t p[4][2];   // Start, control points, and end. Quadratics don't store the last one
+} CurveMotion;
+
+#define QUAD_MOTION_SIZE  offsetof(CurveMotion, p[3])
+#define CUBIC_MOTION_SIZE sizeof(CurveMotion)
+
+// Circular arc, counter clockwise when the end angle is larger than the start
+typedef struct ArcMotion {
+    ScreenMotion base;
+    uint16_t steps;    // Rotation steps
+    uint32_t duration; // Microseconds to draw
+    int16_t cx;
+    int16_t cy;
+    int16_t r;
+    int16_t start;     // Degrees
+    int16_t end;       // Degrees
+} ArcMotion;
+
+// Any motion
+typedef union MotionUnion {
+    ScreenMotion base;
+    PointMotion  point;
+    LineMotion   line;
+    CurveMotion  curve;
+    ArcMotion    arc;
+} MotionUnion;
+
+// Affine transform applied to motions
+// x' = a*x + b*y + tx
+// y' = c*x + d*y + ty
+typedef struct Transform {
+    int32_t a;
+    int32_t b;
+    int32_t c;
+    int32_t d;
+    int16_t tx;
+    int16_t ty;
+    int32_t scale;  // Change in length, the root of the determinant
+    int16_t angle;  // Degrees of rotation, for arcs
+    bool mirror;    // Flips arcs over
+    bool identity;
+} Transform;
+
+// Position and velocity of the active line
+typedef struct LineStepper {
     int32_t mx1;
     int32_t my1;
     int32_t mx2;
     int32_t my2;
     int32_t dx; // Millipoints per microsecond
     int32_t dy; // Millipoints per microsecond
-} LineMotion;
+} LineStepper;
+
+// When the steps of a curve or arc are due. Step k is due at duration * k / steps microseconds, rounded up
+// Kept as a running quotient and remainder, so long slow motions can't overflow and a sample needs no divide
+typedef struct StepClock {
+    uint32_t due;      // Next step, whole microseconds
+    uint16_t due_frac; // Next step, remainder in steps
+    uint32_t per_step; // duration / steps
+    uint16_t rem;      // duration % steps
+} StepClock;
+
+// Forward differencing state of the active curve
+// Positions are in points with 32 fractional bits
+typedef struct CurveStepper {
+    int64_t x;
+    int64_t y;
+    int64_t dx;
+    int64_t dy;
+    int64_t ddx;
+    int64_t ddy;
+    int64_t dddx;
+    int64_t dddy;
+    uint16_t step;
+    StepClock clock;
+    bool clamp;        // Curve goes off the screen
+} CurveStepper;
+
+// Incremental rotation state of the active arc
+// Offsets from the center are in points with 14 fractional bits
+// The rotation is in 30 fractional bits
+typedef struct ArcStepper {
+    int32_t x;
+    int32_t y;
+    int32_t cos_step;
+    int32_t sin_step;
+    int16_t end_x;
+    int16_t end_y;
+    uint16_t step;
+    StepClock clock;
+    bool clamp;        // Arc goes off the screen
+} ArcStepper;
+
+// Visible window of the screen, inclusive
+typedef struct ScreenBounds {
+    int16_t x_min;
+    int16_t x_max;
+    int16_t y_min;
+    int16_t y_max;
+} ScreenBounds;
+
+// Velocity profile of the active line, stepped like a curve
+// Speeds up from the entry speed, cruises, then slows to the exit speed
+// Speeds are millipoints per microsecond and distances millipoints, both with PLAN_FRAC_BITS fractional bits
+typedef struct LinePlan {
+    bool valid;
+    int32_t mx2;        // End of the line
+    int32_t my2;
+    int32_t ux;         // Direction, 16 fractional bits
+    int32_t uy;
+    uint32_t v_entry;
+    uint32_t v_exit;
+    uint32_t duration;  // Microseconds to draw
+    uint16_t steps;
+    uint16_t cruise;    // Step where speeding up ends
+    uint16_t decel;     // Step where slowing down starts
+    uint16_t step;
+    StepClock clock;
+    int64_t peak;       // Distance of a cruising step
+    int64_t slow;       // Distance each step loses slowing down
+    int64_t x;          // Position
+    int64_t y;
+    int64_t dx;         // Next step
+    int64_t dy;
+    int64_t ddx;        // Change in the step
+    int64_t ddy;
+} LinePlan;
 
 typedef struct ScreenState {
     uint8_t x_size_pow; // Size is a power of 2
@@ -54,23 +203,61 @@ typedef struct ScreenState {
     bool y_centered;
     uint16_t hold_time;    // Time to hold a point
     uint16_t speed;        // Millipoints moved in a microsecond
+    uint16_t max_slew;     // Fastest millipoints moved in a microsecond. Zero disables planning
+    uint16_t slew_accel;   // Millipoints per microsecond gained in a millisecond
     uint32_t motion_start; // Time when current motion started
+    int16_t pen_x;         // Where the last motion pushed ended, for relative commands
+    int16_t pen_y;
     BeamState beam;
+    LinePlan plan;          // Kept after the line, for the next to carry on from
+    union {                 // Only the active motion's
+        LineStepper line;
+        CurveStepper curve;
+        ArcStepper arc;
+    };
+    ScreenBounds bounds;    // Visible window when the active motion started
+    Transform transform;
+    MotionUnion active;     // Transformed copy of the running sequence motion
     bool motion_active;
+    bool preempt;           // Start the active motion over at the next update
     bool repeat;
     bool sequence_enabled;
     int8_t sequence_size;
     int8_t sequence_idx;
     ScreenMotion* sequence[SEQ_LEN];
+    uint32_t refresh_period;  // Microseconds per sequence frame. Zero disables the lock
+    bool refresh_idle;        // Pad short frames with blank time instead of slowing down
+    bool frame_running;       // A locked frame has been started
+    uint32_t frame_start;     // Time when the current frame started
+    uint32_t frame_draw_time; // Microseconds to draw the lines of the sequence at their pushed speed
+    uint8_t frame_points;     // Number of points held in the sequence
+    uint16_t frame_scale;     // Line time scale of the current frame
+    uint16_t frame_count;     // Passes made over the sequence
 } ScreenState;
 
 void screen_init(ScreenState* screen);
-PointMotion* screen_push_point(RingMemPool* pool, const PointCmd* cmd);
-LineMotion* screen_push_line(RingMemPool* pool, const LineCmd* cmd, uint16_t speed);
+// Motions are transformed and clipped to the screen as they are pushed
+// Motions entirely off the screen are dropped. NULL is returned and the pool error is RING_OK
+// While a sequence is loading motions are stored as given, and transformed each time they are drawn
+PointMotion* screen_push_point(const ScreenState* screen, RingMemPool* pool, const PointCmd* cmd);
+LineMotion* screen_push_line(const ScreenState* screen, RingMemPool* pool, const LineCmd* cmd);
+CurveMotion* screen_push_curve(const ScreenState* screen, RingMemPool* pool, const CurveCmd* cmd);
+ArcMotion* screen_push_arc(const ScreenState* screen, RingMemPool* pool, const ArcCmd* cmd);
 bool update_screen(uint32_t time, ScreenState* screen, RingMemPool* pool);
+void screen_preempt(ScreenState* screen);
+bool screen_blank(ScreenState* screen, RingMemPool* pool);
+bool screen_set_refresh(ScreenState* screen, uint32_t period, bool idle);
+bool screen_set_slew(ScreenState* screen, uint16_t max_speed, uint16_t accel);
+bool screen_set_transform(ScreenState* screen, float a, float b, float c, float d, int16_t tx, int16_t ty);
+bool screen_set_rotation(ScreenState* screen, int16_t degrees, float scale, int16_t tx, int16_t ty);
 bool sequence_start(ScreenState* screen);
 bool sequence_end(ScreenState* screen);
 bool sequence_clear(ScreenState* screen);
 bool add_to_sequence(ScreenState* screen, ScreenMotion* motion);
+// Edit a loaded sequence, running or not, without stopping it. The motion is copied
+// Motions the edits replace are dropped from the pool a few edits later
+bool sequence_set(ScreenState* screen, RingMemPool* pool, uint8_t idx, const ScreenMotion* motion);
+bool sequence_insert(ScreenState* screen, RingMemPool* pool, uint8_t idx, const ScreenMotion* motion);
+bool sequence_delete(ScreenState* screen, uint8_t idx);
 
 #endif // SCREEN_CONTROLLER_HH
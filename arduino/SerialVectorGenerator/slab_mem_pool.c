@@ -0,0 +1,117 @@
+#include <inttypes.h>
+#include <string.h>
+
+#include "common.h"
+#include "slab_mem_pool.h"
+
+// Blocks keep the alignment of the entries they hold
+static inline uint8_t blockSize(uint8_t size) {
+    const uint8_t align = __alignof__(int32_t);
+    if (size == 0) size = 1;
+    return (size + align - 1) / align * align;
+}
+
+static inline char* blockAt(const SlabClass* cls, uint8_t idx) {
+    return cls->start + (uint16_t)idx * cls->size;
+}
+
+// Memory needed for the given classes
+uint16_t slab_footprint(const uint8_t* sizes, const uint8_t* counts, uint8_t num_classes) {
+    uint16_t total = 0;
+    for (uint8_t i = 0; i < num_classes; i++) {
+        total += (uint16_t)blockSize(sizes[i]) * counts[i];
+    }
+    return total;
+}
+
+// Initialize slab
+bool slab_init(SlabMemPool* slab, void* memory, uint16_t size,
+               const uint8_t* sizes, const uint8_t* counts, uint8_t num_classes) {
+    memset(slab, '\0', sizeof(SlabMemPool));
+    if (num_classes > SLAB_MAX_CLASSES || slab_footprint(sizes, counts, num_classes) > size) {
+        slab->last_err = SLAB_OUT_OF_MEM;
+        return false;
+    }
+    for (uint8_t i = 0; i < num_classes; i++) {
+        if (counts[i] > SLAB_MAX_BLOCKS) {
+            slab->last_err = SLAB_OUT_OF_MEM;
+            return false;
+        }
+    }
+
+    // Carve the memory into a run of blocks for each class
+    char* start = memory;
+    for (uint8_t i = 0; i < num_classes; i++) {
+        SlabClass* cls = &slab->classes[i];
+        cls->size  = blockSize(sizes[i]);
+        cls->count = counts[i];
+        cls->start = start;
+        start += (uint16_t)cls->size * cls->count;
+    }
+    slab->num_classes = num_classes;
+    slab_reset(slab);
+    return true;
+}
+
+// Free every block
+void slab_reset(SlabMemPool* slab) {
+    for (uint8_t i = 0; i < slab->num_classes; i++) {
+        SlabClass* cls = &slab->classes[i];
+        cls->used = 0;
+        cls->free = (cls->count) ? 0 : SLAB_NONE;
+
+        // Link the blocks in order
+        for (uint8_t n = 0; n < cls->count; n++) {
+            *blockAt(cls, n) = (n + 1 < cls->count) ? n + 1 : SLAB_NONE;
+        }
+    }
+    slab->last_err = SLAB_OK;
+}
+
+// Number of free blocks that can hold the given size
+uint8_t slab_available(const SlabMemPool* slab, uint8_t size) {
+    uint16_t available = 0;
+    for (uint8_t i = 0; i < slab->num_classes; i++) {
+        const SlabClass* cls = &slab->classes[i];
+        if (cls->size >= size) {
+            available += cls->count - cls->used;
+        }
+    }
+    return (available > 0xFF) ? 0xFF : available;
+}
+
+// Get a block from the smallest class that has one free
+void* slab_get(SlabMemPool* slab, uint8_t size) {
+    for (uint8_t i = 0; i < slab->num_classes; i++) {
+        SlabClass* cls = &slab->classes[i];
+        if (cls->size < size || cls->free == SLAB_NONE) continue;
+
+        char* block = blockAt(cls, cls->free);
+        cls->free = *block;
+        cls->used++;
+        slab->last_err = SLAB_OK;
+        return block;
+    }
+    slab->last_err = SLAB_OUT_OF_MEM;
+    return NULL;
+}
+
+// Return a block to its class
+bool slab_free(SlabMemPool* slab, void* block) {
+    for (uint8_t i = 0; i < slab->num_classes; i++) {
+        SlabClass* cls = &slab->classes[i];
+        char* end = cls->start + (uint16_t)cls->size * cls->count;
+        if ((char*)block < cls->start || (char*)block >= end) continue;
+
+        // Must be the start of a block that is in use
+        uint16_t offset = (char*)block - cls->start;
+        if (offset % cls->size != 0 || cls->used == 0) break;
+        *(char*)block = cls->free;
+        cls->free = offset / cls->size;
+        cls->used--;
+        slab->last_err = SLAB_OK;
+        return true;
+    }
+    slab->last_err = SLAB_BAD_FREE;
+    return false;
+}
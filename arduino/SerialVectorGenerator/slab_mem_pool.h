@@ -0,0 +1,45 @@
+// SlabMemPool
+// A memory pool of fixed size blocks, with a free list for each size class
+// Blocks are handed out and returned in O(1) and can be freed in any order
+// The pool never fragments. Entries have no header
+
+#ifndef SLAB_MEM_POOL_H
+#define SLAB_MEM_POOL_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#define SLAB_OK 0
+#define SLAB_OUT_OF_MEM -2
+#define SLAB_BAD_FREE -4
+
+#define SLAB_MAX_CLASSES 4
+#define SLAB_MAX_BLOCKS  254
+#define SLAB_NONE        0xFF
+
+// The first byte of a free block is the index of the next free block
+typedef struct SlabClass {
+    uint8_t size;        // Block size, rounded up to keep entries aligned
+    uint8_t count;       // Number of blocks
+    uint8_t used;        // Number of blocks handed out
+    uint8_t free;        // First free block
+    char* start;         // First block
+} SlabClass;
+
+typedef struct SlabMemPool {
+    SlabClass classes[SLAB_MAX_CLASSES]; // Smallest size first
+    uint8_t num_classes;
+    int8_t last_err;
+} SlabMemPool;
+
+// Sizes must be in increasing order
+// Returns false if the memory can't hold all of the blocks
+bool slab_init(SlabMemPool* slab, void* memory, uint16_t size,
+               const uint8_t* sizes, const uint8_t* counts, uint8_t num_classes);
+void slab_reset(SlabMemPool* slab);
+uint16_t slab_footprint(const uint8_t* sizes, const uint8_t* counts, uint8_t num_classes);
+uint8_t slab_available(const SlabMemPool* slab, uint8_t size);
+void* slab_get(SlabMemPool* slab, uint8_t size);
+bool slab_free(SlabMemPool* slab, void* block);
+
+#endif // SLAB_MEM_POOL_H
@@ -0,0 +1,92 @@
+// baud_switch_tests.cpp
+
+#include <string.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "baud_switch.h"
+}
+
+class BaudSwitchTest: public testing::Test {
+protected:
+    void SetUp() {
+        baud_init(&this->baud, 115200, 16000000);
+    }
+
+    void receive(const std::string& text, uint32_t time) {
+        baud_receive(&this->baud, text.data(), text.size(), time);
+    }
+
+    BaudSwitch baud;
+};
+
+TEST_F(BaudSwitchTest, error) {
+    // A 16 MHz AVR makes 2M, 1M and 500k exactly. 115200 is the usual 2.1% off, 230400 too far
+    EXPECT_EQ(0,  baud_error(16000000, 2000000));
+    EXPECT_EQ(0,  baud_error(16000000, 1000000));
+    EXPECT_EQ(0,  baud_error(16000000, 500000));
+    EXPECT_EQ(21, baud_error(16000000, 115200));
+    EXPECT_EQ(35, baud_error(16000000, 230400));
+    EXPECT_GT(baud_error(16000000, 3000000), BAUD_MAX_ERROR);
+    EXPECT_EQ(UINT16_MAX, baud_error(16000000, 100));
+    EXPECT_EQ(UINT16_MAX, baud_error(0, 115200));
+
+    EXPECT_FALSE(baud_start(&this->baud, 230400));
+    EXPECT_FALSE(baud_active(&this->baud));
+    EXPECT_EQ(BAUD_NONE, baud_event(&this->baud, 0));
+}
+
+TEST_F(BaudSwitchTest, commit) {
+    ASSERT_TRUE(baud_start(&this->baud, 1000000));
+    EXPECT_TRUE(baud_active(&this->baud));
+    EXPECT_FALSE(baud_start(&this->baud, 500000));
+    EXPECT_EQ(1000000u, this->baud.rate);
+
+    // Nothing is taken until the UART has moved
+    this->receive(BAUD_PROBE_LINE, 0);
+    EXPECT_EQ(BAUD_SWITCH, baud_event(&this->baud, 1000));
+    EXPECT_EQ(BAUD_PROBING, this->baud.state);
+
+    // Junk from before the host switched is dropped
+    this->receive("\xF3\xA0\x12\n", 2000);
+    EXPECT_EQ(BAUD_NONE, baud_event(&this->baud, 2000));
+    this->receive(BAUD_PROBE_LINE, 3000);
+    EXPECT_EQ(BAUD_ECHO, baud_event(&this->baud, 3000));
+
+    // Each step gets its own wait
+    baud_update(&this->baud, 3000 + BAUD_TIMEOUT - 1);
+    EXPECT_EQ(BAUD_NONE, baud_event(&this->baud, 0));
+    this->receive(BAUD_COMMIT_LINE, 3000 + BAUD_TIMEOUT - 1);
+    EXPECT_EQ(BAUD_COMMIT, baud_event(&this->baud, 0));
+    EXPECT_FALSE(baud_active(&this->baud));
+
+    baud_update(&this->baud, 10 * BAUD_TIMEOUT);
+    EXPECT_EQ(BAUD_NONE, baud_event(&this->baud, 0));
+    EXPECT_EQ(1000000u, this->baud.rate);
+}
+
+TEST_F(BaudSwitchTest, fallback) {
+    ASSERT_TRUE(baud_start(&this->baud, 2000000));
+    EXPECT_EQ(BAUD_SWITCH, baud_event(&this->baud, 1000));
+
+    // The commit can't come before the probe
+    this->receive(BAUD_COMMIT_LINE, 2000);
+    baud_update(&this->baud, 1000 + BAUD_TIMEOUT - 1);
+    EXPECT_EQ(BAUD_NONE, baud_event(&this->baud, 0));
+    baud_update(&this->baud, 1000 + BAUD_TIMEOUT);
+    EXPECT_EQ(BAUD_FALLBACK, baud_event(&this->baud, 0));
+    EXPECT_EQ(115200u, this->baud.rate);
+    EXPECT_FALSE(baud_active(&this->baud));
+
+    // Probed, but never committed
+    ASSERT_TRUE(baud_start(&this->baud, 500000));
+    baud_event(&this->baud, 0);
+    this->receive(BAUD_PROBE_LINE, 100);
+    EXPECT_EQ(BAUD_ECHO, baud_event(&this->baud, 0));
+    baud_update(&this->baud, 100 + BAUD_TIMEOUT);
+    EXPECT_EQ(BAUD_FALLBACK, baud_event(&this->baud, 0));
+    EXPECT_EQ(115200u, this->baud.rate);
+}
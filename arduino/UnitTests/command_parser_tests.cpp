@@ -12,11 +12,13 @@ class CommandParserTest: public testing::Test {
 protected:
     void SetUp() {
         clearCache();
+        cmdSetBinary(false);
         memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
     }
     void build_command(const char* cmd_str, unsigned size) {
         ASSERT_EQ(CMD_OK, buildCmd((std::string(cmd_str) + "\r\n").data(), size));
         ASSERT_TRUE(commandComplete());
+        memset(this->cmd_buf, '\0', CMD_BUF_SIZE);
         ASSERT_EQ(CMD_OK, getCmd(this->cmd_buf, CMD_BUF_SIZE));
         ASSERT_EQ(std::string(cmd_str), std::string(this->cmd_buf));
     }
@@ -72,3 +74,526 @@ TEST_F(CommandParserTest, line) {
     EXPECT_EQ(452, line_cmd->x2);
     EXPECT_EQ(87,  line_cmd->y2);
 }
+
+TEST_F(CommandParserTest, relative) {
+    const char cmd_str[] = "rline 12 -300";
+    this->build_command(cmd_str, sizeof(cmd_str));
+    CommandUnion cmd;
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+    ASSERT_EQ(Cmd_RLine, cmd.base.type);
+    EXPECT_EQ(12,   cmd.rel.dx);
+    EXPECT_EQ(-300, cmd.rel.dy);
+
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char move_str[] = "rmove -1 2";
+    this->build_command(move_str, sizeof(move_str));
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+    ASSERT_EQ(Cmd_RMove, cmd.base.type);
+    EXPECT_EQ(-1, cmd.rel.dx);
+
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char bad_str[] = "rline 1";
+    this->build_command(bad_str, sizeof(bad_str));
+    EXPECT_EQ(CMD_ERR_WRONG_NUM_ARGS, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+}
+
+TEST_F(CommandParserTest, slew) {
+    // Send and parse command
+    const char cmd_str[] = "slew 0.05 0.01";
+    this->build_command(cmd_str, sizeof(cmd_str));
+    CommandUnion cmd;
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE))
+        << "Base command: " << cmd.base.buf << "; Num args: " << cmd.base.numargs;
+
+    // Check parsed command
+    ASSERT_EQ(Cmd_Slew, cmd.base.type);
+    SlewCmd* slew_cmd = (SlewCmd*)&cmd;
+    EXPECT_FLOAT_EQ(0.05, slew_cmd->max_speed);
+    EXPECT_FLOAT_EQ(0.01, slew_cmd->accel);
+
+    // Past what the screen can hold
+    const char big_str[] = "slew 65.6 0.01";
+    this->build_command(big_str, sizeof(big_str));
+    EXPECT_EQ(CMD_ERR_BAD_ARG, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+    const char accel_str[] = "slew 65.5 70";
+    this->build_command(accel_str, sizeof(accel_str));
+    EXPECT_EQ(CMD_ERR_BAD_ARG, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+}
+
+TEST_F(CommandParserTest, refresh) {
+    // Send and parse command
+    const char cmd_str[] = "refresh 60 1";
+    this->build_command(cmd_str, sizeof(cmd_str));
+    CommandUnion cmd;
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE))
+        << "Base command: " << cmd.base.buf << "; Num args: " << cmd.base.numargs;
+
+    // Check parsed command
+    ASSERT_EQ(Cmd_Refresh, cmd.base.type);
+    RefreshCmd* refresh_cmd = (RefreshCmd*)&cmd;
+    EXPECT_FLOAT_EQ(60, refresh_cmd->rate);
+    EXPECT_TRUE(refresh_cmd->idle);
+
+    // Too slow for the period to fit, or too fast to have one
+    const char slow_str[] = "refresh 0.0001";
+    this->build_command(slow_str, sizeof(slow_str));
+    EXPECT_EQ(CMD_ERR_BAD_ARG, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+    const char fast_str[] = "refresh 2000000";
+    this->build_command(fast_str, sizeof(fast_str));
+    EXPECT_EQ(CMD_ERR_BAD_ARG, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+    const char off_str[] = "refresh 0";
+    this->build_command(off_str, sizeof(off_str));
+    EXPECT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+}
+
+TEST_F(CommandParserTest, transform) {
+    // Matrix
+    const char matrix_str[] = "transform 0.5 -1 1 0.5 10 -20";
+    this->build_command(matrix_str, sizeof(matrix_str));
+    CommandUnion cmd;
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE))
+        << "Base command: " << cmd.base.buf << "; Num args: " << cmd.base.numargs;
+    ASSERT_EQ(Cmd_Transform, cmd.base.type);
+    TransformCmd* transform_cmd = (TransformCmd*)&cmd;
+    EXPECT_FALSE(transform_cmd->rotate);
+    EXPECT_FLOAT_EQ(0.5, transform_cmd->a);
+    EXPECT_FLOAT_EQ(-1,  transform_cmd->b);
+    EXPECT_FLOAT_EQ(1,   transform_cmd->c);
+    EXPECT_FLOAT_EQ(0.5, transform_cmd->d);
+    EXPECT_EQ(10,  transform_cmd->tx);
+    EXPECT_EQ(-20, transform_cmd->ty);
+
+    // Rotation
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char rotate_str[] = "transform 45 2 3 4";
+    this->build_command(rotate_str, sizeof(rotate_str));
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE))
+        << "Base command: " << cmd.base.buf << "; Num args: " << cmd.base.numargs;
+    EXPECT_TRUE(transform_cmd->rotate);
+    EXPECT_EQ(45, transform_cmd->angle);
+    EXPECT_FLOAT_EQ(2, transform_cmd->scale);
+    EXPECT_EQ(3, transform_cmd->tx);
+    EXPECT_EQ(4, transform_cmd->ty);
+
+    // Reset
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char reset_str[] = "transform";
+    this->build_command(reset_str, sizeof(reset_str));
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+    EXPECT_FALSE(transform_cmd->rotate);
+    EXPECT_FLOAT_EQ(1, transform_cmd->a);
+    EXPECT_FLOAT_EQ(0, transform_cmd->b);
+    EXPECT_FLOAT_EQ(0, transform_cmd->c);
+    EXPECT_FLOAT_EQ(1, transform_cmd->d);
+
+    // Three arguments aren't a form
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char bad_str[] = "transform 1 2 3";
+    this->build_command(bad_str, sizeof(bad_str));
+    EXPECT_EQ(CMD_ERR_WRONG_NUM_ARGS, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+
+    // Too big for fixed point, either way
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char big_scale_str[] = "transform 0 100000";
+    this->build_command(big_scale_str, sizeof(big_scale_str));
+    EXPECT_EQ(CMD_ERR_BAD_ARG, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char big_matrix_str[] = "transform 1 0 -40000 1 0 0";
+    this->build_command(big_matrix_str, sizeof(big_matrix_str));
+    EXPECT_EQ(CMD_ERR_BAD_ARG, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char nan_str[] = "transform 0 nan";
+    this->build_command(nan_str, sizeof(nan_str));
+    EXPECT_EQ(CMD_ERR_BAD_ARG, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+
+    // The largest that fits
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char max_str[] = "transform 0 -32767";
+    this->build_command(max_str, sizeof(max_str));
+    EXPECT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+}
+
+TEST_F(CommandParserTest, curve) {
+    // Quadratic
+    const char quad_str[] = "curve 0 0 10 -20 30 4";
+    this->build_command(quad_str, sizeof(quad_str));
+    CommandUnion cmd;
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE))
+        << "Base command: " << cmd.base.buf << "; Num args: " << cmd.base.numargs;
+    ASSERT_EQ(Cmd_Curve, cmd.base.type);
+    CurveCmd* curve_cmd = (CurveCmd*)&cmd;
+    EXPECT_EQ(2,   curve_cmd->order);
+    EXPECT_EQ(0,   curve_cmd->x[0]);
+    EXPECT_EQ(0,   curve_cmd->y[0]);
+    EXPECT_EQ(10,  curve_cmd->x[1]);
+    EXPECT_EQ(-20, curve_cmd->y[1]);
+    EXPECT_EQ(30,  curve_cmd->x[2]);
+    EXPECT_EQ(4,   curve_cmd->y[2]);
+
+    // Cubic
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char cubic_str[] = "curve 1 2 3 4 5 6 7 8";
+    this->build_command(cubic_str, sizeof(cubic_str));
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE))
+        << "Base command: " << cmd.base.buf << "; Num args: " << cmd.base.numargs;
+    ASSERT_EQ(Cmd_Curve, cmd.base.type);
+    EXPECT_EQ(3, curve_cmd->order);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(2 * i + 1, curve_cmd->x[i]);
+        EXPECT_EQ(2 * i + 2, curve_cmd->y[i]);
+    }
+
+    // Wrong number of points
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char bad_str[] = "curve 1 2 3 4";
+    this->build_command(bad_str, sizeof(bad_str));
+    EXPECT_EQ(CMD_ERR_WRONG_NUM_ARGS, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+}
+
+TEST_F(CommandParserTest, arc) {
+    // Send and parse command
+    const char cmd_str[] = "arc -10 20 300 45 -90";
+    this->build_command(cmd_str, sizeof(cmd_str));
+    CommandUnion cmd;
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE))
+        << "Base command: " << cmd.base.buf << "; Num args: " << cmd.base.numargs;
+
+    // Check parsed command
+    ASSERT_EQ(Cmd_Arc, cmd.base.type);
+    ArcCmd* arc_cmd = (ArcCmd*)&cmd;
+    EXPECT_EQ(-10, arc_cmd->cx);
+    EXPECT_EQ(20,  arc_cmd->cy);
+    EXPECT_EQ(300, arc_cmd->r);
+    EXPECT_EQ(45,  arc_cmd->start);
+    EXPECT_EQ(-90, arc_cmd->end);
+}
+
+TEST_F(CommandParserTest, pool) {
+    const char pool_str[] = "pool";
+    this->build_command(pool_str, sizeof(pool_str));
+    CommandUnion cmd;
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE))
+        << "Base command: " << cmd.base.buf << "; Num args: " << cmd.base.numargs;
+    ASSERT_EQ(Cmd_Pool, cmd.base.type);
+    EXPECT_FALSE(cmd.pool.clear);
+
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char clear_str[] = "pool clear";
+    this->build_command(clear_str, sizeof(clear_str));
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+    EXPECT_TRUE(cmd.pool.clear);
+
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char bad_str[] = "pool reset";
+    this->build_command(bad_str, sizeof(bad_str));
+    EXPECT_EQ(CMD_ERR_BAD_ARG, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+}
+
+TEST_F(CommandParserTest, set) {
+    const char baud_str[] = "set baud 1000000";
+    this->build_command(baud_str, sizeof(baud_str));
+    CommandUnion cmd;
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+    ASSERT_EQ(Cmd_Set, cmd.base.type);
+    EXPECT_TRUE(cmd.set.set);
+    EXPECT_STREQ("baud", cmd.set.name);
+    EXPECT_STREQ("1000000", cmd.set.value);
+
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char flag_str[] = "set prompt";
+    this->build_command(flag_str, sizeof(flag_str));
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+    EXPECT_TRUE(cmd.set.set);
+    EXPECT_EQ(NULL, cmd.set.value);
+
+    // Only set takes a value
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char bad_str[] = "unset baud 1";
+    this->build_command(bad_str, sizeof(bad_str));
+    EXPECT_NE(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+}
+
+TEST_F(CommandParserTest, sequenceEdit) {
+    const char set_str[] = "sequence set 3 curve 0 0 1 1 2 2 3 3";
+    this->build_command(set_str, sizeof(set_str));
+    CommandUnion cmd;
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+    ASSERT_EQ(Cmd_Sequence, cmd.base.type);
+    EXPECT_TRUE(cmd.sequence.set);
+    EXPECT_EQ(3, cmd.sequence.idx);
+    EXPECT_STREQ("curve 0 0 1 1 2 2 3 3", cmd.sequence.motion);
+
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char delete_str[] = "sequence delete 2";
+    this->build_command(delete_str, sizeof(delete_str));
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+    EXPECT_TRUE(cmd.sequence.remove);
+    EXPECT_EQ(2, cmd.sequence.idx);
+    EXPECT_EQ(NULL, cmd.sequence.motion);
+
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char bad_idx_str[] = "sequence insert x line 0 0 1 1";
+    this->build_command(bad_idx_str, sizeof(bad_idx_str));
+    EXPECT_EQ(CMD_ERR_BAD_ARG, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char no_motion_str[] = "sequence insert 1";
+    this->build_command(no_motion_str, sizeof(no_motion_str));
+    EXPECT_EQ(CMD_ERR_WRONG_NUM_ARGS, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    const char extra_str[] = "sequence start 1";
+    this->build_command(extra_str, sizeof(extra_str));
+    EXPECT_EQ(CMD_ERR_WRONG_NUM_ARGS, cmdParse(&cmd, this->cmd_buf, CMD_BUF_SIZE));
+}
+
+TEST_F(CommandParserTest, priorityLane) {
+    // Priority lines are pulled out of the normal stream
+    const char stream[] = "line 1 2 3 4\r\n!blank\r\npoint 5 6\r\n";
+    ASSERT_EQ(CMD_OK, buildCmd(stream, sizeof(stream) - 1));
+    ASSERT_TRUE(prioCommandComplete());
+    char buf[CMD_BUF_SIZE] = {};
+    ASSERT_EQ(CMD_OK, getPrioCmd(buf, sizeof(buf)));
+    EXPECT_STREQ("blank", buf);
+    EXPECT_FALSE(prioCommandComplete());
+
+    CommandUnion cmd;
+    ASSERT_EQ(CMD_OK, cmdParse(&cmd, buf, CMD_BUF_SIZE));
+    EXPECT_EQ(Cmd_Blank, cmd.base.type);
+
+    // The normal stream is untouched
+    memset(buf, '\0', sizeof(buf));
+    ASSERT_EQ(CMD_OK, getCmd(buf, sizeof(buf)));
+    EXPECT_STREQ("line 1 2 3 4", buf);
+    memset(buf, '\0', sizeof(buf));
+    ASSERT_EQ(CMD_OK, getCmd(buf, sizeof(buf)));
+    EXPECT_STREQ("point 5 6", buf);
+
+    // Only a prefix at the start of a line counts
+    const char inline_str[] = "scale !1\r";
+    ASSERT_EQ(CMD_OK, buildCmd(inline_str, sizeof(inline_str) - 1));
+    EXPECT_FALSE(prioCommandComplete());
+}
+
+TEST_F(CommandParserTest, priorityLaneSplit) {
+    // Arrives in pieces, in between a motion that's still coming in
+    const char first[] = "line 1 2 ";
+    const char second[] = "3 4\n!spe";
+    const char third[] = "ed 2\n";
+    ASSERT_EQ(CMD_OK, buildCmd(first, sizeof(first) - 1));
+    ASSERT_EQ(CMD_OK, buildCmd(second, sizeof(second) - 1));
+    EXPECT_FALSE(prioCommandComplete());
+    ASSERT_EQ(CMD_OK, buildCmd(third, sizeof(third) - 1));
+    ASSERT_TRUE(prioCommandComplete());
+    char buf[CMD_BUF_SIZE] = {};
+    ASSERT_EQ(CMD_OK, getPrioCmd(buf, sizeof(buf)));
+    EXPECT_STREQ("speed 2", buf);
+}
+
+TEST_F(CommandParserTest, priorityLaneFullBuffer) {
+    // Fill the normal buffer with motions
+    const char line[] = "line 100 100 200 200\n";
+    while (cmdBufLen() + sizeof(line) < CMD_BUF_SIZE - 1) {
+        ASSERT_EQ(CMD_OK, buildCmd(line, sizeof(line) - 1));
+    }
+
+    // A priority command still gets in
+    const char blank[] = "!blank\n";
+    ASSERT_EQ(CMD_OK, buildCmd(blank, sizeof(blank) - 1));
+    EXPECT_TRUE(prioCommandComplete());
+
+    // And one too long for the lane is dropped
+    const char too_long[] = "!transform 1.000 0.000 0.000 1.000 1000 1000\n";
+    EXPECT_EQ(CMD_ERR_CMD_TOO_LONG, buildCmd(too_long, sizeof(too_long) - 1));
+}
+
+TEST_F(CommandParserTest, binaryRecords) {
+    // Record bytes that look like line ends, priority prefixes, and backspaces are kept
+    const char stream[] = "\x84\x0A\x21"                   // rline 10 33
+                          "\x82\x08\x0D\xFF\xFF"         // rline 3336 -1
+                          "point 1 2\n"
+                          "\x81\x01\x00\x02\x00\x03\x00\x0A\x00" // line 1 2 3 10
+                          "\x85\xFF\x80";                  // rmove -1 -128
+    cmdSetBinary(true);
+    ASSERT_EQ(CMD_OK, buildCmd(stream, sizeof(stream) - 1));
+    EXPECT_FALSE(prioCommandComplete());
+
+    CommandUnion cmd;
+    char buf[CMD_BUF_SIZE];
+    ASSERT_TRUE(commandComplete());
+    ASSERT_EQ(0, noopCommand());
+    ASSERT_EQ(CMD_OK, getCmd(buf, sizeof(buf)));
+    ASSERT_EQ(CMD_OK, cmdDecodeBinary(&cmd, (const uint8_t*)buf, sizeof(buf)));
+    ASSERT_EQ(Cmd_RLine, cmd.base.type);
+    EXPECT_EQ(10, cmd.rel.dx);
+    EXPECT_EQ(33, cmd.rel.dy);
+
+    ASSERT_EQ(CMD_OK, getCmd(buf, sizeof(buf)));
+    ASSERT_EQ(CMD_OK, cmdDecodeBinary(&cmd, (const uint8_t*)buf, sizeof(buf)));
+    ASSERT_EQ(Cmd_RLine, cmd.base.type);
+    EXPECT_EQ(3336, cmd.rel.dx);
+    EXPECT_EQ(-1,   cmd.rel.dy);
+
+    // Lines still come through in between
+    memset(buf, '\0', sizeof(buf));
+    ASSERT_EQ(CMD_OK, getCmd(buf, sizeof(buf)));
+    EXPECT_STREQ("point 1 2", buf);
+
+    ASSERT_EQ(CMD_OK, getCmd(buf, sizeof(buf)));
+    ASSERT_EQ(CMD_OK, cmdDecodeBinary(&cmd, (const uint8_t*)buf, sizeof(buf)));
+    ASSERT_EQ(Cmd_Line, cmd.base.type);
+    EXPECT_EQ(1,  cmd.line.x1);
+    EXPECT_EQ(10, cmd.line.y2);
+
+    ASSERT_EQ(CMD_OK, getCmd(buf, sizeof(buf)));
+    ASSERT_EQ(CMD_OK, cmdDecodeBinary(&cmd, (const uint8_t*)buf, sizeof(buf)));
+    ASSERT_EQ(Cmd_RMove, cmd.base.type);
+    EXPECT_EQ(-1,   cmd.rel.dx);
+    EXPECT_EQ(-128, cmd.rel.dy);
+    EXPECT_FALSE(commandComplete());
+    EXPECT_EQ(0, cmdBufLen());
+}
+
+TEST_F(CommandParserTest, binarySplit) {
+    // A record isn't complete until all of it is in
+    cmdSetBinary(true);
+    ASSERT_EQ(CMD_OK, buildCmd("\x80\x05", 2));
+    EXPECT_FALSE(commandComplete());
+    ASSERT_EQ(CMD_OK, buildCmd("\x00\x0A\x00!noop\n", 9));
+    ASSERT_TRUE(commandComplete());
+    EXPECT_EQ(5, commandSize());
+    // The priority command after it starts a line
+    EXPECT_TRUE(prioCommandComplete());
+
+    char buf[CMD_BUF_SIZE];
+    CommandUnion cmd;
+    ASSERT_EQ(CMD_OK, getCmd(buf, sizeof(buf)));
+    ASSERT_EQ(CMD_OK, cmdDecodeBinary(&cmd, (const uint8_t*)buf, sizeof(buf)));
+    ASSERT_EQ(Cmd_Point, cmd.base.type);
+    EXPECT_EQ(5,  cmd.point.x);
+    EXPECT_EQ(10, cmd.point.y);
+
+    // Unknown records are one byte long
+    ASSERT_EQ(CMD_OK, buildCmd("\xF0\x84\x01\x02", 4));
+    ASSERT_EQ(CMD_OK, getCmd(buf, sizeof(buf)));
+    EXPECT_EQ(CMD_ERR_BAD_CMD, cmdDecodeBinary(&cmd, (const uint8_t*)buf, sizeof(buf)));
+    ASSERT_EQ(CMD_OK, getCmd(buf, sizeof(buf)));
+    EXPECT_EQ(CMD_OK, cmdDecodeBinary(&cmd, (const uint8_t*)buf, sizeof(buf)));
+
+    // Without binary set, the same bytes are dropped like any other unprintable byte
+    cmdSetBinary(false);
+    ASSERT_EQ(CMD_OK, buildCmd("\x84\x01\x02", 3));
+    EXPECT_EQ(0, cmdBufLen());
+}
+
+TEST_F(CommandParserTest, packedRecords) {
+    // The length comes second, and nothing in the packed bytes ends the record
+    cmdSetBinary(true);
+    ASSERT_EQ(CMD_OK, buildCmd("\x86\x04\x03\x0A", 4));
+    EXPECT_FALSE(commandComplete());
+    ASSERT_EQ(CMD_OK, buildCmd("\n!point 1 2\n", 12));
+    ASSERT_TRUE(commandComplete());
+    EXPECT_EQ(6, commandSize());
+    EXPECT_FALSE(prioCommandComplete());
+
+    char buf[CMD_BUF_SIZE];
+    ASSERT_EQ(CMD_OK, getCmd(buf, sizeof(buf)));
+    EXPECT_EQ(0, memcmp("\x86\x04\x03\x0A\n!", buf, 6));
+    memset(buf, '\0', sizeof(buf));
+    ASSERT_EQ(CMD_OK, getCmd(buf, sizeof(buf)));
+    EXPECT_STREQ("point 1 2", buf);
+
+    // Longer than one can be. Only the record is dropped
+    ASSERT_EQ(CMD_OK, buildCmd("point 3 4\n", 10));
+    std::string record("\x86", 1);
+    record += (char)(CMD_PACKED_MAX + 1);
+    EXPECT_EQ(CMD_ERR_CMD_TOO_LONG, buildCmd(record.data(), record.size()));
+    ASSERT_EQ(CMD_OK, buildCmd("point 5 6\n", 10));
+    memset(buf, '\0', sizeof(buf));
+    ASSERT_EQ(CMD_OK, getCmd(buf, sizeof(buf)));
+    EXPECT_STREQ("point 3 4", buf);
+    memset(buf, '\0', sizeof(buf));
+    ASSERT_EQ(CMD_OK, getCmd(buf, sizeof(buf)));
+    EXPECT_STREQ("point 5 6", buf);
+
+    // An empty one is two bytes
+    ASSERT_EQ(CMD_OK, buildCmd("\x86\x00", 2));
+    ASSERT_TRUE(commandComplete());
+    EXPECT_EQ(2, commandSize());
+}
+
+TEST_F(CommandParserTest, takeInPlace) {
+    // Commands are taken where they landed, one after another, ended with a null
+    ASSERT_EQ(CMD_OK, buildCmd("point 1 2\r\nline 0 0 3 3;blank\n!noop\n", 36));
+    char* first;
+    char* second;
+    char* third;
+    char* prio;
+    uint8_t len;
+    ASSERT_EQ(CMD_OK, takePrioCmd(&prio, &len));
+    EXPECT_STREQ("noop", prio);
+    ASSERT_EQ(CMD_OK, takeCmd(&first, &len));
+    EXPECT_STREQ("point 1 2", first);
+    EXPECT_EQ(9, len);
+    ASSERT_EQ(CMD_OK, takeCmd(&second, &len));
+    EXPECT_EQ(first + 11, second);
+    EXPECT_TRUE(cmdBatched());
+    ASSERT_EQ(CMD_OK, takeCmd(&third, &len));
+    EXPECT_STREQ("line 0 0 3 3", second);
+    EXPECT_STREQ("blank", third);
+    EXPECT_EQ(CMD_ERR_CMD_NOOP, takeCmd(&first, &len));
+    EXPECT_EQ(CMD_ERR_CMD_NOOP, takePrioCmd(&prio, &len));
+
+    // What's left is moved back only when the end is reached
+    for (int i = 0; i < 40; i++) {
+        ASSERT_EQ(CMD_OK, buildCmd("point 10 20\n", 12));
+        if (i % 2) {
+            ASSERT_EQ(CMD_OK, takeCmd(&first, &len));
+            EXPECT_STREQ("point 10 20", first);
+        }
+    }
+    ASSERT_EQ(CMD_OK, buildCmd("!blank\npoint 5", 14));
+    EXPECT_EQ(20 * 12 + 7, cmdBufLen());
+    for (int i = 0; i < 20; i++) {
+        ASSERT_EQ(CMD_OK, takeCmd(&first, &len));
+        EXPECT_STREQ("point 10 20", first);
+    }
+    EXPECT_FALSE(commandComplete());
+    ASSERT_EQ(CMD_OK, buildCmd(" 6\n", 3));
+    ASSERT_EQ(CMD_OK, takeCmd(&first, &len));
+    EXPECT_STREQ("point 5 6", first);
+    ASSERT_EQ(CMD_OK, takePrioCmd(&prio, &len));
+    EXPECT_STREQ("blank", prio);
+}
+
+TEST_F(CommandParserTest, batch) {
+    ASSERT_EQ(CMD_OK, buildCmd("point 1 2;;line 0 0 3 3;blank\r\npoint 4 5\n", 42));
+
+    ASSERT_TRUE(commandComplete());
+    ASSERT_EQ(CMD_OK, getCmd(this->cmd_buf, CMD_BUF_SIZE));
+    EXPECT_STREQ("point 1 2", this->cmd_buf);
+    EXPECT_TRUE(cmdBatched());
+
+    // Empty commands in a batch are noops
+    EXPECT_EQ(1, noopCommand());
+    EXPECT_TRUE(cmdBatched());
+
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    ASSERT_EQ(CMD_OK, getCmd(this->cmd_buf, CMD_BUF_SIZE));
+    EXPECT_STREQ("line 0 0 3 3", this->cmd_buf);
+    EXPECT_TRUE(cmdBatched());
+
+    // The last of the line
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    ASSERT_EQ(CMD_OK, getCmd(this->cmd_buf, CMD_BUF_SIZE));
+    EXPECT_STREQ("blank", this->cmd_buf);
+    EXPECT_FALSE(cmdBatched());
+
+    memset(this->cmd_buf, '\0', sizeof(this->cmd_buf));
+    ASSERT_EQ(CMD_OK, getCmd(this->cmd_buf, CMD_BUF_SIZE));
+    EXPECT_STREQ("point 4 5", this->cmd_buf);
+    EXPECT_FALSE(cmdBatched());
+    EXPECT_EQ(0, cmdBufLen());
+}
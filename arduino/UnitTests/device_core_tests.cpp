@@ -0,0 +1,516 @@
+// device_core_tests.cpp
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "command_parser.h"
+#include "device_core.h"
+#include "lz_pack.h"
+#include "ring_mem_pool.h"
+#include "sample_cache.h"
+#include "screen_controller.h"
+}
+
+class DeviceCoreTest: public testing::Test {
+protected:
+    void SetUp() {
+        clearCache();
+        cmdSetBinary(false);
+        ring_init(&this->pool, this->pool_mem, sizeof(this->pool_mem));
+        screen_init(&this->screen);
+        this->screen.x_size_pow = 11;
+        this->screen.y_size_pow = 11;
+        this->screen.x_centered = true;
+        this->screen.y_centered = true;
+        cache_init(&this->cache, this->samples, 64, 10);
+        device_init(&this->device, &this->screen, &this->pool, &this->cache);
+    }
+
+    void send(const std::string& text) {
+        ASSERT_EQ(CMD_OK, buildCmd(text.data(), text.size()));
+    }
+
+    // A packed record holding the records after those before start, which its chain carries on from
+    std::string packed(const std::string& records, uint8_t chain = 0, uint16_t start = 0) {
+        uint8_t out[CMD_PACKED_MAX - 1];
+        uint16_t len = lz_pack_from((const uint8_t*)records.data(), start, records.size(), out, sizeof(out));
+        return std::string("\x86") + (char)(len + 1) + (char)chain + std::string((const char*)out, len);
+    }
+
+    char pool_mem[64];
+    RingMemPool pool;
+    ScreenState screen;
+    DacSample samples[64];
+    SampleCache cache;
+    DeviceCore device;
+    CommandResult result;
+};
+
+TEST_F(DeviceCoreTest, runsInOrder) {
+    this->send("line 0 0 10 10\r\nbogus 1\r\n\r\nset repeat\r\nset prompt\r\n");
+    EXPECT_FALSE(this->screen.repeat);
+
+    // Motion
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_EQ(CMD_OK, this->result.err);
+    EXPECT_EQ(Cmd_Line, this->result.cmd.base.type);
+    EXPECT_TRUE(this->result.motion);
+    EXPECT_TRUE(device_acked(&this->result));
+    EXPECT_EQ(1, this->pool.count);
+
+    // Unknown command
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_EQ(CMD_ERR_BAD_CMD, this->result.err);
+    EXPECT_FALSE(device_acked(&this->result));
+
+    // Empty line
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_EQ(CMD_ERR_CMD_NOOP, this->result.err);
+
+    // Screen flag
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(this->result.handled);
+    EXPECT_TRUE(this->screen.repeat);
+
+    // Sketch flag
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_FALSE(this->result.handled);
+    EXPECT_STREQ("prompt", this->result.cmd.set.name);
+
+    EXPECT_FALSE(device_next(&this->device, &this->result));
+}
+
+TEST_F(DeviceCoreTest, poolFull) {
+    // Lines are refused once the pool is full, and accepted again once it drains
+    int acked = 0;
+    for (int i = 0; i < 8; i++) {
+        this->send("line 0 0 100 100\n");
+        ASSERT_TRUE(device_next(&this->device, &this->result));
+        acked += device_acked(&this->result);
+    }
+    EXPECT_EQ(this->pool.count, acked);
+    EXPECT_LT(acked, 8);
+
+    DacSample sample;
+    for (uint32_t t = 0; this->pool.count; t += 100) {
+        device_update(&this->device, t, &sample);
+    }
+    this->send("line 0 0 100 100\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+}
+
+TEST_F(DeviceCoreTest, hold) {
+    // Once a line is refused, the motions after it are too, even with room for them
+    this->send("set hold\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+    for (int i = 0; i < 8; i++) {
+        this->send("line 0 0 100 100\n");
+        ASSERT_TRUE(device_next(&this->device, &this->result));
+        if (!device_acked(&this->result)) break;
+    }
+    EXPECT_FALSE(device_acked(&this->result));
+    ring_reset(&this->pool);
+    this->send("rmove 10 10\npoint 0 0\nscale 2048 2048 1 1\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_FALSE(device_acked(&this->result));
+    EXPECT_EQ(100, this->screen.pen_x);
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_FALSE(device_acked(&this->result));
+    EXPECT_EQ(0, this->pool.count);
+    // Other commands still run
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+
+    // Taken again once the host says so
+    this->send("set hold\nline 0 0 100 100\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+    EXPECT_EQ(1, this->pool.count);
+}
+
+TEST_F(DeviceCoreTest, priorityFirst) {
+    this->send("line 0 0 100 100\nline 0 0 -100 100\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    DacSample sample;
+    EXPECT_TRUE(device_update(&this->device, 0, &sample));
+
+    // Jumps ahead of the waiting line and cuts the active one short
+    this->send("!blank\n!line 1 1 2 2\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(this->result.priority);
+    EXPECT_EQ(Cmd_Blank, this->result.cmd.base.type);
+    EXPECT_TRUE(device_acked(&this->result));
+    EXPECT_EQ(0, this->pool.count);
+
+    // Motions aren't taken on the priority lane
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(this->result.priority);
+    EXPECT_EQ(CMD_ERR_BAD_CMD, this->result.err);
+
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_FALSE(this->result.priority);
+    EXPECT_EQ(Cmd_Line, this->result.cmd.base.type);
+    EXPECT_EQ(-100, this->result.cmd.line.x2);
+}
+
+TEST_F(DeviceCoreTest, priorityPreempt) {
+    this->send("line 0 0 100 0\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    DacSample sample;
+    EXPECT_TRUE(device_update(&this->device, 0, &sample));
+
+    // Reports and flags leave the line being drawn alone
+    this->send("!pool\n!noop\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+    EXPECT_FALSE(this->screen.preempt);
+    EXPECT_TRUE(device_update(&this->device, 10, &sample));
+    EXPECT_EQ(0u, this->screen.motion_start);
+
+    // A new scale cuts it short, and it's drawn again from the start
+    this->send("!scale 2048 2048 1 1\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+    EXPECT_TRUE(this->screen.preempt);
+    EXPECT_TRUE(device_update(&this->device, 20, &sample));
+    EXPECT_EQ(20u, this->screen.motion_start);
+    EXPECT_EQ(1, this->pool.count);
+}
+
+TEST_F(DeviceCoreTest, relative) {
+    // The pen follows absolute motions, and relative ones carry on from it
+    this->send("line 0 0 10 20\nrline 5 -5\nrmove 100 0\nrline 0 7\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_EQ(10, this->screen.pen_x);
+    EXPECT_EQ(20, this->screen.pen_y);
+
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    ASSERT_TRUE(this->result.motion);
+    const LineMotion* line = (const LineMotion*)this->result.motion;
+    EXPECT_EQ(SM_Line, line->base.type);
+    EXPECT_EQ(15, this->screen.pen_x);
+    EXPECT_EQ(15, this->screen.pen_y);
+
+    // Moves draw nothing
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+    EXPECT_FALSE(this->result.motion);
+    EXPECT_EQ(2, this->pool.count);
+
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+    EXPECT_EQ(115, this->screen.pen_x);
+    EXPECT_EQ(22,  this->screen.pen_y);
+
+    // Arcs leave it at their end
+    this->send("arc 0 0 100 0 90\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_EQ(0,   this->screen.pen_x);
+    EXPECT_EQ(100, this->screen.pen_y);
+
+    // Not on the priority lane
+    this->send("!rmove 1 1\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_EQ(CMD_ERR_BAD_CMD, this->result.err);
+}
+
+TEST_F(DeviceCoreTest, relativePoolFull) {
+    // A relative line that doesn't fit leaves the pen so it can be sent again
+    this->send("point 0 0\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    for (int i = 0; i < 8; i++) {
+        this->send("rline 10 0\n");
+        ASSERT_TRUE(device_next(&this->device, &this->result));
+        if (!device_acked(&this->result)) break;
+    }
+    EXPECT_FALSE(device_acked(&this->result));
+    EXPECT_EQ(10 * (this->pool.count - 1), this->screen.pen_x);
+}
+
+TEST_F(DeviceCoreTest, binary) {
+    this->send("set binary\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+    EXPECT_TRUE(cmdBinary());
+
+    // point 100 -2, then rline 10 -10 and rline 300 0
+    this->send(std::string("\x80\x64\x00\xFE\xFF\x84\x0A\xF6\x82\x2C\x01\x00\x00", 13));
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_EQ(Cmd_Point, this->result.cmd.base.type);
+    EXPECT_TRUE(device_acked(&this->result));
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_EQ(Cmd_RLine, this->result.cmd.base.type);
+    EXPECT_TRUE(device_acked(&this->result));
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_EQ(Cmd_RLine, this->result.cmd.base.type);
+    EXPECT_EQ(410, this->screen.pen_x);
+    EXPECT_EQ(-12, this->screen.pen_y);
+
+    // Unknown records are refused on their own
+    this->send(std::string("\xC0unset binary\n"));
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_EQ(CMD_ERR_BAD_CMD, this->result.err);
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+    EXPECT_FALSE(cmdBinary());
+}
+
+TEST_F(DeviceCoreTest, packed) {
+    this->send("set binary\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+
+    // point 5 5, rline 10 0, rmove 0 10, rline -10 0
+    this->send(this->packed(std::string("\x80\x05\x00\x05\x00\x84\x0A\x00\x85\x00\x0A\x84\xF6\x00", 14)));
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_EQ(Cmd_Packed, this->result.cmd.base.type);
+    EXPECT_EQ(4, this->result.cmd.packed.records);
+    EXPECT_TRUE(device_acked(&this->result));
+    EXPECT_EQ(3, this->pool.count);
+    EXPECT_EQ(5,  this->screen.pen_x);
+    EXPECT_EQ(15, this->screen.pen_y);
+
+    // Lines that won't all fit are all refused, and the pen stays so it can be sent again
+    std::string lines;
+    for (int i = 0; i < 4; i++) {
+        lines += std::string("\x81\x00\x00\x00\x00\x10\x00\x10\x00", 9);
+    }
+    lines += std::string("\x84\x01\x01", 3);
+    uint16_t out_of_mem = this->pool.stats.out_of_mem;
+    this->send(this->packed(lines));
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_FALSE(device_acked(&this->result));
+    EXPECT_EQ(CMD_OK, this->result.err);
+    EXPECT_EQ(3, this->pool.count);
+    EXPECT_EQ(out_of_mem + 1, this->pool.stats.out_of_mem);
+    EXPECT_EQ(15, this->screen.pen_y);
+
+    // Bad data, nested records, and records cut short are refused before anything runs
+    this->send(std::string("\x86\x03\x00\x80\x00", 5));
+    this->send(this->packed(std::string("\x85\x01\x01\x86\x00", 5)));
+    this->send(this->packed(std::string("\x85\x01\x01\x81\x00", 5)));
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(device_next(&this->device, &this->result));
+        EXPECT_EQ(CMD_ERR_PARSE, this->result.err);
+    }
+    EXPECT_EQ(15, this->screen.pen_y);
+
+    // Packed records keep their order with the motions
+    this->send("!" + this->packed(std::string("\x85\x01\x01", 3)) + "\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_NE(CMD_OK, this->result.err);
+    EXPECT_EQ(15, this->screen.pen_y);
+}
+
+TEST_F(DeviceCoreTest, packedChain) {
+    this->send("set binary\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+
+    // The same glyph twice. The second is all one copy from the window the first left
+    std::string glyph("\x85\x1E\x00\x84\x14\x00\x84\x00\x1E\x84\xEC\xE2", 12);
+    std::string first  = this->packed(glyph);
+    std::string second = this->packed(glyph + glyph, 1, glyph.size());
+    EXPECT_EQ(5u, second.size());
+    this->send(first);
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+    ring_reset(&this->pool);
+    this->send(second);
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+    EXPECT_EQ(4, this->result.cmd.packed.records);
+    EXPECT_EQ(3, this->pool.count);
+    EXPECT_EQ(60, this->screen.pen_x);
+    EXPECT_EQ(0, this->screen.pen_y);
+
+    // One that doesn't follow on from those taken is an error, and changes nothing
+    this->send(second + this->packed(glyph + glyph, 3, glyph.size()));
+    for (int i = 0; i < 2; i++) {
+        ASSERT_TRUE(device_next(&this->device, &this->result));
+        EXPECT_EQ(CMD_ERR_PARSE, this->result.err);
+    }
+    EXPECT_EQ(60, this->screen.pen_x);
+
+    // Refused for room, and the one after it while holding. They're taken when sent again
+    this->send("set hold\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    std::string third = this->packed(glyph + glyph, 2, glyph.size());
+    this->send(third);
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_FALSE(device_acked(&this->result));
+    this->send(this->packed(glyph + glyph, 3, glyph.size()));
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_FALSE(device_acked(&this->result));
+    EXPECT_EQ(CMD_OK, this->result.err);
+    EXPECT_EQ(60, this->screen.pen_x);
+    ring_reset(&this->pool);
+    this->send("set hold\n" + third);
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+    EXPECT_EQ(90, this->screen.pen_x);
+}
+
+TEST_F(DeviceCoreTest, batch) {
+    char reply[DEVICE_REPLY_SIZE];
+    this->send("point 1 1;;bogus;point 2 2\npoint 3 3\n");
+
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(this->result.batched);
+    EXPECT_FALSE(this->result.batch_end);
+    EXPECT_FALSE(device_batch_add(&this->device, &this->result, device_acked(&this->result)));
+
+    // Empty commands aren't counted
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_EQ(CMD_ERR_CMD_NOOP, this->result.err);
+    EXPECT_FALSE(device_batch_add(&this->device, &this->result, device_acked(&this->result)));
+
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_EQ(CMD_ERR_BAD_CMD, this->result.err);
+    EXPECT_FALSE(device_batch_add(&this->device, &this->result, device_acked(&this->result)));
+
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(this->result.batched);
+    EXPECT_TRUE(this->result.batch_end);
+    ASSERT_TRUE(device_batch_add(&this->device, &this->result, device_acked(&this->result)));
+    device_batch_reply(&this->device, reply, sizeof(reply));
+    EXPECT_STREQ("NAK 101", reply);
+
+    // A line of its own is answered as usual
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_FALSE(this->result.batched);
+    EXPECT_EQ(3, this->pool.count);
+}
+
+TEST_F(DeviceCoreTest, longBatch) {
+    char reply[DEVICE_REPLY_SIZE];
+    unsigned answers = 0;
+    std::string line;
+    for (int i = 0; i < CMD_BATCH_MAX + 2; i++) line += "set repeat;";
+    line += "unset repeat\n";
+
+    // Fed a piece at a time, as the buffer has room
+    size_t sent = 0;
+    for (;;) {
+        size_t room = CMD_BUF_SIZE - 1 - cmdBufLen();
+        if (sent < line.size() && room > 0) {
+            size_t count = std::min(room, line.size() - sent);
+            this->send(line.substr(sent, count));
+            sent += count;
+        }
+        if (!device_next(&this->device, &this->result)) break;
+        ASSERT_TRUE(this->result.batched);
+        if (!device_batch_add(&this->device, &this->result, device_acked(&this->result))) continue;
+
+        device_batch_reply(&this->device, reply, sizeof(reply));
+        answers++;
+        EXPECT_STREQ((answers == 1) ? "ACK 64" : "ACK 3", reply);
+    }
+    EXPECT_EQ(2u, answers);
+    EXPECT_FALSE(this->screen.repeat);
+}
+
+TEST_F(DeviceCoreTest, framed) {
+    ASSERT_EQ(CMD_OK, device_receive(&this->device, "set framed\n", 11));
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+    EXPECT_TRUE(this->device.link.enabled);
+
+    // The command stream is inside the frames. A bad one is asked for by number
+    uint8_t frames[3][LINK_FRAME_SIZE + 1];
+    uint8_t sizes[3];
+    sizes[0] = link_encode(0, (const uint8_t*)"point 1 ", 8, frames[0]);
+    sizes[1] = link_encode(1, (const uint8_t*)"2\nblank\n", 8, frames[1]);
+    sizes[2] = link_encode(2, (const uint8_t*)"unset framed\n", 13, frames[2]);
+    frames[1][3] ^= 0x01;
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(CMD_OK, device_receive(&this->device, (const char*)frames[i], sizes[i]));
+    }
+    uint8_t seq;
+    ASSERT_TRUE(device_resend(&this->device, &seq));
+    EXPECT_EQ(1, seq);
+    EXPECT_FALSE(device_resend(&this->device, &seq));
+    EXPECT_FALSE(device_next(&this->device, &this->result));
+
+    frames[1][3] ^= 0x01;
+    ASSERT_EQ(CMD_OK, device_receive(&this->device, (const char*)frames[1], sizes[1]));
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_EQ(Cmd_Point, this->result.cmd.base.type);
+    EXPECT_EQ(2, this->result.cmd.point.y);
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_EQ(Cmd_Blank, this->result.cmd.base.type);
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+    EXPECT_FALSE(this->device.link.enabled);
+}
+
+TEST_F(DeviceCoreTest, sequenceEdit) {
+    this->send("sequence start\nline 0 0 100 0\nline 100 0 100 100\nline 100 100 0 0\nsequence end\n");
+    for (int i = 0; i < 5; i++) {
+        ASSERT_TRUE(device_next(&this->device, &this->result));
+        ASSERT_TRUE(device_acked(&this->result));
+    }
+    DacSample sample;
+    uint32_t time = 0;
+    EXPECT_TRUE(device_update(&this->device, time, &sample));
+
+    // Motions the same size are copied over the old ones, and the frame keeps being drawn
+    for (int i = 0; i < 20; i++) {
+        this->send("sequence set 1 line 100 0 100 " + std::to_string(i) + "\n");
+        ASSERT_TRUE(device_next(&this->device, &this->result));
+        ASSERT_TRUE(device_acked(&this->result)) << "Edit " << i;
+        time += 3000;
+        EXPECT_TRUE(device_update(&this->device, time, &sample));
+    }
+    ASSERT_EQ(3, this->screen.sequence_size);
+    EXPECT_EQ(100, ((const LineMotion*)this->screen.sequence[0])->x2);
+    EXPECT_EQ(19, ((const LineMotion*)this->screen.sequence[1])->y2);
+    EXPECT_EQ(0, ((const LineMotion*)this->screen.sequence[2])->x2);
+    EXPECT_EQ(3, this->pool.count);
+    EXPECT_TRUE(this->screen.motion_active);
+
+    // Others take room in the pool. It only holds four lines, so what they replace has to be dropped
+    this->send("sequence delete 2\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    ASSERT_TRUE(device_acked(&this->result));
+    for (int i = 0; i < 20; i++) {
+        this->send((i % 2) ? "sequence set 1 line 0 0 5 " + std::to_string(i) + "\n" : "sequence set 1 point 5 5\n");
+        ASSERT_TRUE(device_next(&this->device, &this->result));
+        ASSERT_TRUE(device_acked(&this->result)) << "Edit " << i;
+        time += 3000;
+        device_update(&this->device, time, &sample);
+    }
+    ASSERT_EQ(2, this->screen.sequence_size);
+    EXPECT_EQ(100, ((const LineMotion*)this->screen.sequence[0])->x2);
+    EXPECT_EQ(19, ((const LineMotion*)this->screen.sequence[1])->y2);
+    EXPECT_LE(this->pool.count, 4);
+
+    this->send("sequence insert 2 point 5 5\nsequence delete 0\nsequence delete 5\nsequence set 0 rline 1 1\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_TRUE(device_acked(&this->result));
+    ASSERT_EQ(2, this->screen.sequence_size);
+    EXPECT_EQ(SM_Line, this->screen.sequence[0]->type);
+    EXPECT_EQ(SM_Point, this->screen.sequence[1]->type);
+
+    // Out of range, and only motions that don't depend on the pen
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_FALSE(device_acked(&this->result));
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_FALSE(device_acked(&this->result));
+
+    // Nothing to edit without a sequence
+    this->send("sequence clear\nsequence set 0 point 1 1\n");
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    ASSERT_TRUE(device_next(&this->device, &this->result));
+    EXPECT_FALSE(device_acked(&this->result));
+}
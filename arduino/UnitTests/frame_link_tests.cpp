@@ -0,0 +1,130 @@
+// frame_link_tests.cpp
+
+#include <string.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "frame_link.h"
+}
+
+class FrameLinkTest: public testing::Test {
+protected:
+    void SetUp() {
+        link_init(&this->link, collect, this);
+        this->room = 1000;
+    }
+
+    static bool collect(void* ctx, const uint8_t* data, uint8_t len) {
+        FrameLinkTest* test = (FrameLinkTest*)ctx;
+        if (len > test->room) return false;
+        test->room -= len;
+        test->out.append((const char*)data, len);
+        return true;
+    }
+
+    std::string frame(uint8_t seq, const std::string& payload) {
+        uint8_t buf[LINK_FRAME_SIZE + 1];
+        uint8_t size = link_encode(seq, (const uint8_t*)payload.data(), payload.size(), buf);
+        return std::string((const char*)buf, size);
+    }
+
+    void receive(const std::string& bytes) {
+        link_receive(&this->link, (const uint8_t*)bytes.data(), bytes.size());
+    }
+
+    std::string resends() {
+        std::string seqs;
+        uint8_t seq;
+        while (link_resend(&this->link, &seq)) seqs += std::to_string(seq) + " ";
+        return seqs;
+    }
+
+    FrameLink link;
+    std::string out;
+    size_t room;
+};
+
+TEST_F(FrameLinkTest, encode) {
+    EXPECT_EQ(0x29B1, link_crc16((const uint8_t*)"123456789", 9));
+
+    // Zeros in the payload and the sequence number are stuffed, so the only zero is the delimiter
+    std::string payload("\x00\x01\x00\x00point 1 2\n", 14);
+    std::string bytes = this->frame(0, payload);
+    EXPECT_EQ(payload.size() + 5, bytes.size());
+    EXPECT_EQ(bytes.size() - 1, bytes.find('\0'));
+
+    this->receive(bytes);
+    EXPECT_EQ(payload, this->out);
+    EXPECT_EQ("", this->resends());
+
+    // Too long to frame
+    uint8_t buf[LINK_FRAME_SIZE + 1];
+    uint8_t big[LINK_PAYLOAD_MAX + 1] = {0};
+    EXPECT_EQ(0, link_encode(0, big, sizeof(big), buf));
+    EXPECT_EQ(LINK_FRAME_SIZE + 1, link_encode(0, big, LINK_PAYLOAD_MAX, buf));
+}
+
+TEST_F(FrameLinkTest, badFrame) {
+    std::string second = this->frame(1, "line 0 0 9 9\n");
+    second[5] ^= 0x04;
+    // Split anywhere on the wire
+    std::string bytes = this->frame(0, "point 1 2\n") + second + this->frame(2, "blank\n") + this->frame(3, "point 3 4\n");
+    for (size_t i = 0; i < bytes.size(); i += 7) this->receive(bytes.substr(i, 7));
+
+    // Only the bad one is asked for. Those after it wait for it
+    EXPECT_EQ("point 1 2\n", this->out);
+    EXPECT_EQ("1 ", this->resends());
+    EXPECT_EQ(1u, this->link.stats.bad);
+    EXPECT_EQ(2u, this->link.stats.held);
+
+    this->receive(this->frame(1, "line 0 0 9 9\n"));
+    EXPECT_EQ("point 1 2\nline 0 0 9 9\nblank\npoint 3 4\n", this->out);
+    EXPECT_EQ(0, this->link.hold_len);
+
+    // Sent again after all, it's dropped
+    this->receive(this->frame(2, "blank\n"));
+    EXPECT_EQ(4u, this->link.stats.frames);
+    EXPECT_EQ("", this->resends());
+}
+
+TEST_F(FrameLinkTest, lostFrames) {
+    // A gap shows which ones never came, and a frame cut off at the end is guessed to be the next
+    std::string last = this->frame(4, "point 4 4\n");
+    this->receive(this->frame(0, "a\n") + this->frame(3, "d\n") + last.substr(4));
+    EXPECT_EQ("1 2 4 ", this->resends());
+    EXPECT_EQ("a\n", this->out);
+
+    this->receive(this->frame(2, "c\n") + this->frame(1, "b\n") + last);
+    EXPECT_EQ("a\nb\nc\nd\npoint 4 4\n", this->out);
+
+    // Sequence numbers wrap
+    this->link.expected  = 255;
+    this->link.next_seen = 255;
+    this->receive(this->frame(255, "e\n") + this->frame(0, "f\n"));
+    EXPECT_EQ("a\nb\nc\nd\npoint 4 4\ne\nf\n", this->out);
+    EXPECT_EQ("", this->resends());
+}
+
+TEST_F(FrameLinkTest, noRoom) {
+    // Frames wait while the parser is full
+    this->room = 4;
+    this->receive(this->frame(0, "point 1 2\n"));
+    EXPECT_EQ("", this->out);
+    this->room = 100;
+    link_receive(&this->link, NULL, 0);
+    EXPECT_EQ("point 1 2\n", this->out);
+
+    // Only one full frame is held. The rest have to come again
+    std::string payload(LINK_PAYLOAD_MAX, 'x');
+    this->receive(this->frame(2, payload) + this->frame(3, payload) + this->frame(4, payload));
+    EXPECT_EQ("1 3 4 ", this->resends());
+    EXPECT_EQ(2 + LINK_PAYLOAD_MAX, this->link.hold_len);
+
+    // Frames longer than any that can be sent are bad. It could have been any still missing
+    this->receive(std::string(LINK_FRAME_SIZE + 10, 'x') + std::string(1, '\0'));
+    EXPECT_EQ(1u, this->link.stats.bad);
+    EXPECT_EQ("1 3 4 5 ", this->resends());
+}
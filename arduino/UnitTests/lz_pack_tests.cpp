@@ -0,0 +1,148 @@
+// lz_pack_tests.cpp
+
+#include <string.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "lz_pack.h"
+}
+
+class LzPackTest: public testing::Test {
+protected:
+    std::vector<uint8_t> pack(const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> packed(data.size() * 2 + 2);
+        uint16_t len = lz_pack(data.data(), data.size(), packed.data(), packed.size());
+        packed.resize(len);
+        return packed;
+    }
+
+    // Unpack in uneven steps, like records of different sizes
+    std::vector<uint8_t> unpack(const std::vector<uint8_t>& packed) {
+        std::vector<uint8_t> data;
+        uint8_t buf[7];
+        lz_init(&this->lz, packed.data(), packed.size());
+        for (uint8_t step = 1; ; step = step % sizeof(buf) + 1) {
+            uint8_t len = lz_read(&this->lz, buf, step);
+            data.insert(data.end(), buf, buf + len);
+            if (len < step) break;
+        }
+        return data;
+    }
+
+    LzUnpack lz;
+};
+
+TEST_F(LzPackTest, roundtrip) {
+    // Lines along a stroke share many of their bytes
+    std::vector<uint8_t> data;
+    for (int i = 0; i < 12; i++) {
+        const uint8_t record[] = {0x81, (uint8_t)(i * 8), 0x00, 0x40, 0x00, (uint8_t)(i * 8 + 8), 0x00, 0x40, 0x00};
+        data.insert(data.end(), record, record + sizeof(record));
+    }
+    std::vector<uint8_t> packed = this->pack(data);
+    ASSERT_GT(packed.size(), 0u);
+    EXPECT_LT(packed.size(), data.size() * 3 / 4);
+    EXPECT_EQ(data, this->unpack(packed));
+    EXPECT_TRUE(lz_done(&this->lz));
+
+    // Nothing repeats, so it's all literals
+    std::vector<uint8_t> plain;
+    for (int i = 0; i < 200; i++) {
+        plain.push_back(i);
+    }
+    packed = this->pack(plain);
+    EXPECT_EQ(plain.size() + 2, packed.size());
+    EXPECT_EQ(plain, this->unpack(packed));
+    EXPECT_TRUE(lz_done(&this->lz));
+}
+
+TEST_F(LzPackTest, overlap) {
+    // A copy longer than its distance repeats a short run
+    std::vector<uint8_t> data(100, 0x55);
+    data[0] = 0x83;
+    std::vector<uint8_t> packed = this->pack(data);
+    EXPECT_EQ(5u, packed.size());
+    EXPECT_EQ(data, this->unpack(packed));
+
+    // Further back than the window can reach
+    std::vector<uint8_t> far;
+    for (int i = 0; i < LZ_WINDOW + 8; i++) {
+        far.push_back(i * 37 + 11);
+    }
+    far.insert(far.end(), far.begin(), far.begin() + 8);
+    packed = this->pack(far);
+    EXPECT_EQ(far.size() + 1, packed.size());
+    EXPECT_EQ(far, this->unpack(packed));
+}
+
+TEST_F(LzPackTest, resume) {
+    // The second piece is one copy from the first
+    std::vector<uint8_t> data;
+    for (int i = 0; i < 2; i++) {
+        const uint8_t record[] = {0x85, 0x1E, 0x00, 0x84, 0x14, 0x00, 0x84, 0xEC, 0xE2};
+        data.insert(data.end(), record, record + sizeof(record));
+    }
+    uint8_t first[32];
+    uint8_t second[32];
+    uint16_t first_len  = lz_pack(data.data(), 9, first, sizeof(first));
+    uint16_t second_len = lz_pack_from(data.data(), 9, data.size(), second, sizeof(second));
+    EXPECT_EQ(10, first_len);
+    EXPECT_EQ(2, second_len);
+
+    uint8_t out[9];
+    lz_init(&this->lz, first, first_len);
+    EXPECT_EQ(9, lz_read(&this->lz, out, sizeof(out)));
+    lz_resume(&this->lz, second, second_len);
+    EXPECT_EQ(9, lz_read(&this->lz, out, sizeof(out)));
+    EXPECT_TRUE(lz_done(&this->lz));
+    EXPECT_EQ(0, memcmp(out, data.data() + 9, sizeof(out)));
+
+    // Started afresh there's nothing to copy from
+    lz_init(&this->lz, second, second_len);
+    EXPECT_EQ(0, lz_read(&this->lz, out, sizeof(out)));
+    EXPECT_FALSE(lz_done(&this->lz));
+}
+
+TEST_F(LzPackTest, badData) {
+    // Copy before anything was decoded
+    std::vector<uint8_t> packed = {0x80, 0x00};
+    EXPECT_TRUE(this->unpack(packed).empty());
+    EXPECT_FALSE(lz_done(&this->lz));
+
+    // Further back than what's been decoded
+    packed = {0x01, 'a', 'b', 0x80, 0x02};
+    EXPECT_EQ(2u, this->unpack(packed).size());
+    EXPECT_FALSE(lz_done(&this->lz));
+
+    // Literals cut short, and a copy with no distance
+    packed = {0x05, 'a', 'b'};
+    EXPECT_TRUE(this->unpack(packed).empty());
+    EXPECT_FALSE(lz_done(&this->lz));
+    packed = {0x00, 'a', 0x80};
+    EXPECT_EQ(1u, this->unpack(packed).size());
+    EXPECT_FALSE(lz_done(&this->lz));
+
+    // Further back than the window
+    packed.assign(1, 0x7F);
+    packed.insert(packed.end(), 128, 'a');
+    packed.push_back(0x80);
+    packed.push_back(LZ_WINDOW);
+    EXPECT_EQ(128u, this->unpack(packed).size());
+    EXPECT_FALSE(lz_done(&this->lz));
+}
+
+TEST_F(LzPackTest, outMax) {
+    std::vector<uint8_t> data(40, 0x11);
+    uint8_t out[8];
+    EXPECT_EQ(4, lz_pack(data.data(), data.size(), out, 4));
+    EXPECT_EQ(0, lz_pack(data.data(), data.size(), out, 3));
+
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = i;
+    }
+    EXPECT_EQ(0, lz_pack(data.data(), data.size(), out, sizeof(out)));
+    EXPECT_EQ(0, lz_pack(data.data(), 0, out, sizeof(out)));
+}
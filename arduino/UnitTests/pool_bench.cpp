@@ -0,0 +1,109 @@
+// pool_bench.cpp
+// Compares the motion capacity and alloc/free throughput of the ring and slab pools
+// Bulk puts each fill on the ring with one reservation
+// make bench
+
+#include <stdio.h>
+
+#include <chrono>
+
+extern "C" {
+#include "ring_mem_pool.h"
+#include "screen_controller.h"
+#include "slab_mem_pool.h"
+}
+
+#define MEM_SIZE 256
+#define ROUNDS   200000
+
+typedef std::chrono::steady_clock Clock;
+
+static double nsPerOp(Clock::time_point start, long ops) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / ops;
+}
+
+// Motions of one size that fit in the ring
+static int ringCapacity(uint8_t size) {
+    char mem[MEM_SIZE];
+    RingMemPool ring;
+    ring_init(&ring, mem, sizeof(mem));
+    int count = 0;
+    while (ring_get(&ring, size)) count++;
+    return count;
+}
+
+// Motions of one size that fit in the slab
+static int slabCapacity(uint8_t size) {
+    char mem[MEM_SIZE];
+    SlabMemPool slab;
+    uint8_t sizes[]  = {size};
+    uint8_t counts[] = {1};
+    uint16_t block   = slab_footprint(sizes, counts, 1);
+    counts[0] = sizeof(mem) / block;
+    slab_init(&slab, mem, sizeof(mem), sizes, counts, 1);
+    int count = 0;
+    while (slab_get(&slab, size)) count++;
+    return count;
+}
+
+// Fill the ring then drain it, first in first out
+static double ringThroughput(uint8_t size, int fill) {
+    char mem[MEM_SIZE];
+    RingMemPool ring;
+    ring_init(&ring, mem, sizeof(mem));
+    Clock::time_point start = Clock::now();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int i = 0; i < fill; i++) ring_get(&ring, size);
+        for (int i = 0; i < fill; i++) ring_pop(&ring);
+    }
+    return nsPerOp(start, 2l * ROUNDS * fill);
+}
+
+// Same as above, but each fill goes in as one reservation
+static double ringBulkThroughput(uint8_t size, int fill) {
+    char mem[MEM_SIZE];
+    RingMemPool ring;
+    ring_init(&ring, mem, sizeof(mem));
+    uint16_t total = fill * ring_entry_size(size);
+    Clock::time_point start = Clock::now();
+    for (int round = 0; round < ROUNDS; round++) {
+        ring_reserve(&ring, total);
+        for (int i = 0; i < fill; i++) ring_reserve_entry(&ring, size);
+        ring_commit(&ring, fill);
+        for (int i = 0; i < fill; i++) ring_pop(&ring);
+    }
+    return nsPerOp(start, 2l * ROUNDS * fill);
+}
+
+// Fill the slab then free it in reverse
+static double slabThroughput(uint8_t size, int fill) {
+    char mem[MEM_SIZE];
+    SlabMemPool slab;
+    uint8_t sizes[]  = {size};
+    uint8_t counts[] = {(uint8_t)fill};
+    slab_init(&slab, mem, sizeof(mem), sizes, counts, 1);
+    void* blocks[MEM_SIZE];
+    Clock::time_point start = Clock::now();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int i = 0; i < fill; i++) blocks[i] = slab_get(&slab, size);
+        for (int i = fill - 1; i >= 0; i--) slab_free(&slab, blocks[i]);
+    }
+    return nsPerOp(start, 2l * ROUNDS * fill);
+}
+
+static void compare(const char* name, uint8_t size) {
+    int ring_count = ringCapacity(size);
+    int slab_count = slabCapacity(size);
+    int fill = (ring_count < slab_count) ? ring_count : slab_count;
+    printf("%-12s %3u bytes | capacity ring %3d slab %3d | ns per op ring %6.2f bulk %6.2f slab %6.2f\n",
+           name, size, ring_count, slab_count, ringThroughput(size, fill), ringBulkThroughput(size, fill),
+           slabThroughput(size, fill));
+}
+
+int main(void) {
+    printf("%d byte pool, %d rounds\n", MEM_SIZE, ROUNDS);
+    compare("PointMotion", sizeof(PointMotion));
+    compare("LineMotion",  sizeof(LineMotion));
+    compare("CurveMotion", sizeof(CurveMotion));
+    return 0;
+}
@@ -188,3 +188,278 @@ TEST(RingMemoryPool, useAllMemory) {
     EXPECT_EQ(sizeof(buf), ring_remaining(&pool));
     EXPECT_EQ(0, ring_pop(&pool));
 }
+
+TEST(RingMemoryPool, peekNextWrap) {
+    // Init pool
+    char buf[64];
+    RingMemPool pool;
+    ring_init(&pool, buf, sizeof(buf));
+    ASSERT_EQ(RING_OK, pool.last_err);
+
+    // Push past the end of the buffer so the entries wrap
+    int i;
+    for (i = 0; i < 4; i++) {
+        int* mem_in = (int*)ring_get(&pool, 10);
+        ASSERT_NOT_NULL(mem_in) << "Iteration " << i << ". Memory wasn't allocated";
+        *mem_in = i;
+    }
+    ring_pop(&pool);
+    ring_pop(&pool);
+    for (; i < 6; i++) {
+        int* mem_in = (int*)ring_get(&pool, 10);
+        ASSERT_NOT_NULL(mem_in) << "Iteration " << i << ". Memory wasn't allocated";
+        *mem_in = i;
+    }
+    ASSERT_NE(0, pool.wrap_point) << "Expected the ring to wrap";
+
+    // Walk every entry from the oldest to the newest
+    int* entry = (int*)ring_peek(&pool);
+    for (int j = 2; j < 6; j++) {
+        ASSERT_NOT_NULL(entry) << "Entry " << j << " is missing";
+        EXPECT_EQ(j, *entry);
+        entry = (int*)ring_peek_next(&pool, entry);
+    }
+    EXPECT_EQ(NULL, entry) << "Walked past the newest entry";
+}
+
+TEST(RingMemoryPool, reserveAndCommit) {
+    // Init pool
+    char buf[64];
+    RingMemPool pool;
+    ring_init(&pool, buf, sizeof(buf));
+
+    // Reserve room for three entries
+    ASSERT_NOT_NULL(ring_reserve(&pool, 3 * ring_entry_size(sizeof(int))));
+    ASSERT_EQ(RING_OK, pool.last_err);
+    for (int i = 0; i < 3; i++) {
+        int* mem_in = (int*)ring_reserve_entry(&pool, sizeof(int));
+        ASSERT_NOT_NULL(mem_in) << "Iteration " << i << ". Memory wasn't allocated";
+        *mem_in = i;
+    }
+
+    // Nothing can be seen until the commit
+    EXPECT_EQ(NULL, ring_peek(&pool));
+    EXPECT_EQ(NULL, ring_get(&pool, sizeof(int)));
+    EXPECT_EQ(RING_ERR, pool.last_err);
+    EXPECT_EQ(NULL, ring_reserve_entry(&pool, sizeof(int)));
+    EXPECT_EQ(RING_OUT_OF_MEM, pool.last_err);
+
+    EXPECT_EQ(3, ring_commit(&pool, 3));
+    EXPECT_EQ(RING_OK, pool.last_err);
+    EXPECT_EQ(3, pool.count);
+    EXPECT_EQ(3 * ring_entry_size(sizeof(int)), pool.head);
+    for (int i = 0; i < 3; i++) {
+        int* mem_out = (int*)ring_peek(&pool);
+        ASSERT_NOT_NULL(mem_out);
+        EXPECT_EQ(i, *mem_out);
+        EXPECT_EQ(sizeof(int), ring_pop(&pool));
+    }
+    EXPECT_EQ(NULL, ring_peek(&pool));
+
+    // Works with ring_get again
+    EXPECT_NE((void*)NULL, ring_get(&pool, sizeof(int)));
+}
+
+TEST(RingMemoryPool, reserveWrap) {
+    // Init pool
+    char buf[64];
+    RingMemPool pool;
+    ring_init(&pool, buf, sizeof(buf));
+
+    // Fill most of the ring, then free the front of it
+    for (int i = 0; i < 4; i++) {
+        int* mem_in = (int*)ring_get(&pool, 10);
+        ASSERT_NOT_NULL(mem_in);
+        *mem_in = i;
+    }
+    ring_pop(&pool);
+    ring_pop(&pool);
+    ring_pop(&pool);
+    uint16_t head = pool.head;
+
+    // Doesn't fit after the head so it goes at the start
+    ASSERT_EQ((void*)buf, ring_reserve(&pool, 2 * ring_entry_size(12)));
+    *(int*)ring_reserve_entry(&pool, 12) = 4;
+    *(int*)ring_reserve_entry(&pool, 12) = 5;
+    EXPECT_EQ(head, pool.head);
+    EXPECT_EQ(0, pool.wrap_point);
+
+    EXPECT_EQ(2, ring_commit(&pool, 2));
+    EXPECT_EQ(head, pool.wrap_point);
+    EXPECT_EQ(2 * ring_entry_size(12), pool.head);
+
+    // Walk every entry from the oldest to the newest
+    int* entry = (int*)ring_peek(&pool);
+    for (int j = 3; j < 6; j++) {
+        ASSERT_NOT_NULL(entry) << "Entry " << j << " is missing";
+        EXPECT_EQ(j, *entry);
+        entry = (int*)ring_peek_next(&pool, entry);
+    }
+    EXPECT_EQ(NULL, entry) << "Walked past the newest entry";
+}
+
+TEST(RingMemoryPool, reserveRollback) {
+    // Init pool
+    char buf[64];
+    RingMemPool pool;
+    ring_init(&pool, buf, sizeof(buf));
+    int* first = (int*)ring_get(&pool, sizeof(int));
+    ASSERT_NOT_NULL(first);
+    *first = 7;
+    uint16_t head = pool.head;
+
+    // A shape that doesn't fit is refused whole
+    EXPECT_EQ(NULL, ring_reserve(&pool, 8 * ring_entry_size(8)));
+    EXPECT_EQ(RING_OUT_OF_MEM, pool.last_err);
+    EXPECT_EQ(head, pool.head);
+    EXPECT_EQ(1, pool.count);
+
+    // Dropped on request
+    ASSERT_NOT_NULL(ring_reserve(&pool, 2 * ring_entry_size(8)));
+    ASSERT_NOT_NULL(ring_reserve_entry(&pool, 8));
+    ring_rollback(&pool);
+    EXPECT_EQ(head, pool.head);
+
+    // Dropped when the count doesn't match what was written
+    ASSERT_NOT_NULL(ring_reserve(&pool, 2 * ring_entry_size(8)));
+    ASSERT_NOT_NULL(ring_reserve_entry(&pool, 8));
+    EXPECT_EQ(0, ring_commit(&pool, 2));
+    EXPECT_EQ(RING_ERR, pool.last_err);
+    EXPECT_EQ(head, pool.head);
+    EXPECT_EQ(1, pool.count);
+
+    // The earlier entry is untouched
+    EXPECT_EQ(7, *(int*)ring_peek(&pool));
+    EXPECT_EQ(NULL, ring_peek_next(&pool, ring_peek(&pool)));
+    EXPECT_EQ(sizeof(int), ring_pop(&pool));
+    EXPECT_EQ(NULL, ring_peek(&pool));
+}
+
+TEST(RingMemoryPool, largeEntry) {
+    // Init pool
+    char buf[1024];
+    RingMemPool pool;
+    ring_init(&pool, buf, sizeof(buf));
+
+    // Small entries keep the one byte header
+    EXPECT_EQ(255, ring_entry_size(254));
+    EXPECT_EQ(255 + RING_LARGE_HDR, ring_entry_size(255));
+
+    char* small = (char*)ring_get(&pool, 254);
+    ASSERT_NOT_NULL(small);
+    EXPECT_EQ(buf + 1, small);
+    char* large = (char*)ring_get(&pool, 600);
+    ASSERT_NOT_NULL(large);
+    EXPECT_EQ(buf + 255 + RING_LARGE_HDR, large);
+    memset(large, RING_LARGE, 600);
+
+    // Too big for the memory
+    EXPECT_EQ(NULL, ring_get(&pool, 2000));
+    EXPECT_EQ(RING_OUT_OF_MEM, pool.last_err);
+
+    EXPECT_EQ(large, ring_peek_next(&pool, small));
+    EXPECT_EQ(NULL, ring_peek_next(&pool, large));
+    EXPECT_EQ(254, ring_pop(&pool));
+    EXPECT_EQ(large, ring_peek(&pool));
+    EXPECT_EQ(600, ring_pop(&pool));
+    EXPECT_EQ(NULL, ring_peek(&pool));
+}
+
+TEST(RingMemoryPool, mixedSizesWrap) {
+    // Init pool
+    char buf[1024];
+    RingMemPool pool;
+    ring_init(&pool, buf, sizeof(buf));
+
+    // Small and large entries pushed and popped in a shifting pattern
+    const uint16_t sizes[] = {3, 300, 254, 255, 17, 480, 1, 90, 256, 40};
+    const int num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+    int pushed = 0;
+    int popped = 0;
+    int wraps  = 0;
+    for (int round = 0; round < 200; round++) {
+        // Fill until the next one doesn't fit
+        for (;;) {
+            uint16_t size = sizes[pushed % num_sizes];
+            char* mem_in = (char*)ring_get(&pool, size);
+            if (!mem_in) break;
+            memset(mem_in, (char)pushed, size);
+            pushed++;
+        }
+        ASSERT_EQ(RING_OUT_OF_MEM, pool.last_err);
+        if (pool.wrap_point) wraps++;
+
+        // Walk everything that's queued
+        int j = popped;
+        for (char* entry = (char*)ring_peek(&pool); entry; entry = (char*)ring_peek_next(&pool, entry), j++) {
+            EXPECT_EQ((char)j, entry[0]) << "Entry " << j;
+            EXPECT_EQ((char)j, entry[sizes[j % num_sizes] - 1]) << "Entry " << j;
+        }
+        ASSERT_EQ(pushed, j);
+
+        // Pop a few, more than were pushed some rounds
+        for (int i = 0; i < 1 + round % 3 && popped < pushed; i++) {
+            ASSERT_EQ(sizes[popped % num_sizes], ring_pop(&pool)) << "Entry " << popped;
+            popped++;
+        }
+    }
+    EXPECT_GT(wraps, 0) << "Expected the ring to wrap";
+
+    // Drain
+    while (popped < pushed) {
+        ASSERT_EQ(sizes[popped % num_sizes], ring_pop(&pool)) << "Entry " << popped;
+        popped++;
+    }
+    EXPECT_EQ(NULL, ring_peek(&pool));
+    EXPECT_EQ(0, pool.count);
+}
+
+TEST(RingMemoryPool, stats) {
+    // Init pool
+    char buf[64];
+    RingMemPool pool;
+    ring_init(&pool, buf, sizeof(buf));
+    RingStats stats;
+    ring_get_stats(&pool, &stats);
+    EXPECT_EQ(0, stats.used);
+    EXPECT_EQ(0u, stats.pushes);
+
+    // Fill it, then make it wrap
+    for (int i = 0; i < 4; i++) ASSERT_NOT_NULL(ring_get(&pool, 10));
+    EXPECT_EQ(NULL, ring_get(&pool, 30));
+    ring_pop(&pool);
+    ring_pop(&pool);
+    ring_pop(&pool);
+    ASSERT_NOT_NULL(ring_get(&pool, 24));
+    ASSERT_EQ(44, pool.wrap_point);
+
+    ring_get_stats(&pool, &stats);
+    EXPECT_EQ(36, stats.used);
+    EXPECT_EQ(44, stats.high_bytes);
+    EXPECT_EQ(4,  stats.high_entries);
+    EXPECT_EQ(1,  stats.out_of_mem);
+    EXPECT_EQ(20u, stats.wrap_waste);
+    EXPECT_EQ(5u, stats.pushes);
+    EXPECT_EQ(3u, stats.pops);
+
+    // Bulk adds count too
+    EXPECT_EQ(NULL, ring_reserve(&pool, 2 * ring_entry_size(4)));
+    ASSERT_NOT_NULL(ring_reserve(&pool, ring_entry_size(4)));
+    ring_reserve_entry(&pool, 4);
+    EXPECT_EQ(1, ring_commit(&pool, 1));
+    ring_get_stats(&pool, &stats);
+    EXPECT_EQ(41, stats.used);
+    EXPECT_EQ(44, stats.high_bytes);
+    EXPECT_EQ(2,  stats.out_of_mem);
+    EXPECT_EQ(6u, stats.pushes);
+
+    // Kept across a reset, until cleared
+    ring_reset(&pool);
+    ring_get_stats(&pool, &stats);
+    EXPECT_EQ(0,  stats.used);
+    EXPECT_EQ(44, stats.high_bytes);
+    ring_clear_stats(&pool);
+    ring_get_stats(&pool, &stats);
+    EXPECT_EQ(0, stats.high_bytes);
+    EXPECT_EQ(0u, stats.pushes);
+}
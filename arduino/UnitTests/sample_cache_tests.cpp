@@ -0,0 +1,183 @@
+// sample_cache_tests.cpp
+
+#include <string.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "command_parser.h"
+#include "ring_mem_pool.h"
+#include "sample_cache.h"
+#include "screen_controller.h"
+#include "utils.h"
+}
+
+class SampleCacheTest: public testing::Test {
+protected:
+    void SetUp() {
+        this->loadSquare(&this->screen, &this->pool, this->pool_mem, sizeof(this->pool_mem));
+        this->loadSquare(&this->live, &this->live_pool, this->live_mem, sizeof(this->live_mem));
+        cache_init(&this->cache, this->samples, 4096, 10);
+    }
+
+    // Square with sides of 50 points. 20ms to draw at 10 millipoints per microsecond
+    void loadSquare(ScreenState* screen, RingMemPool* pool, char* mem, uint16_t size) {
+        ring_init(pool, mem, size);
+        screen_init(screen);
+        screen->x_size_pow = 11;
+        screen->y_size_pow = 11;
+        screen->x_centered = true;
+        screen->y_centered = true;
+        screen->speed      = 10;
+        const int16_t corners[][2] = {{0, 0}, {50, 0}, {50, 50}, {0, 50}};
+        ASSERT_TRUE(sequence_start(screen));
+        for (int side = 0; side < 4; side++) {
+            LineCmd cmd = {
+                {}, // base
+                corners[side][0],
+                corners[side][1],
+                corners[(side + 1) % 4][0],
+                corners[(side + 1) % 4][1],
+            };
+            LineMotion* motion = screen_push_line(screen, pool, &cmd);
+            ASSERT_TRUE(motion);
+            ASSERT_TRUE(add_to_sequence(screen, (ScreenMotion*)motion));
+        }
+        ASSERT_TRUE(sequence_end(screen));
+    }
+
+    // Draw the reference screen without a cache
+    DacSample liveSample(uint32_t time) {
+        update_screen(time, &this->live, &this->live_pool);
+        return DacSample{
+            position_to_binary(this->live.beam.x, this->live.x_size_pow, DAC_BIT_WIDTH, true),
+            position_to_binary(this->live.beam.y, this->live.y_size_pow, DAC_BIT_WIDTH, true),
+        };
+    }
+
+    // Run the cache until the first frame has been recorded
+    // Returns the time playback started
+    uint32_t record(void) {
+        uint32_t t = 0;
+        DacSample sample;
+        while (t < 100000) {
+            cache_update(&this->cache, t, &this->screen, &this->pool, &sample);
+            if (this->cache.state == CACHE_READY) break;
+            t += 10;
+        }
+        return t;
+    }
+
+    char pool_mem[1<<10];
+    char live_mem[1<<10];
+    RingMemPool pool;
+    RingMemPool live_pool;
+    ScreenState screen;
+    ScreenState live;
+    DacSample samples[4096];
+    SampleCache cache;
+};
+
+TEST_F(SampleCacheTest, record) {
+    // Recording draws the frame as it would be drawn live
+    DacSample sample;
+    uint32_t t = 0;
+    for (; t < 19000; t += 10) {
+        ASSERT_TRUE(cache_update(&this->cache, t, &this->screen, &this->pool, &sample));
+        DacSample expected = this->liveSample(t);
+        ASSERT_EQ(expected.x, sample.x) << "At " << t << "us";
+        ASSERT_EQ(expected.y, sample.y) << "At " << t << "us";
+    }
+    EXPECT_EQ(CACHE_RECORDING, this->cache.state);
+
+    // One sample for each period of the frame
+    t = this->record();
+    EXPECT_EQ(CACHE_READY, this->cache.state);
+    EXPECT_NEAR(2000, this->cache.count, 4);
+    EXPECT_EQ(1u, this->screen.frame_count);
+}
+
+TEST_F(SampleCacheTest, playback) {
+    uint32_t t = this->record();
+    ASSERT_EQ(CACHE_READY, this->cache.state);
+
+    // Samples play back in order without touching the screen
+    uint32_t motion_start = this->screen.motion_start;
+    DacSample sample;
+    for (uint16_t i = 0; i < 2 * this->cache.count; i++) {
+        cache_update(&this->cache, t + 10 * i, &this->screen, &this->pool, &sample);
+        const DacSample& expected = this->samples[i % this->cache.count];
+        ASSERT_EQ(expected.x, sample.x) << "Sample " << i;
+        ASSERT_EQ(expected.y, sample.y) << "Sample " << i;
+    }
+    EXPECT_EQ(motion_start, this->screen.motion_start);
+
+    // Samples are held between periods
+    uint32_t last = t + 10 * (2 * this->cache.count - 1);
+    cache_update(&this->cache, last + 5, &this->screen, &this->pool, &sample);
+    EXPECT_EQ(this->cache.count - 1, this->cache.idx);
+
+    // Late calls skip ahead
+    cache_update(&this->cache, last + 30, &this->screen, &this->pool, &sample);
+    EXPECT_EQ(2, this->cache.idx);
+}
+
+TEST_F(SampleCacheTest, invalidate) {
+    uint32_t t = this->record();
+    ASSERT_EQ(CACHE_READY, this->cache.state);
+
+    // Drawn live until the next frame starts, then recorded again
+    cache_invalidate(&this->cache);
+    EXPECT_EQ(CACHE_EMPTY, this->cache.state);
+    DacSample sample;
+    t += 10;
+    cache_update(&this->cache, t, &this->screen, &this->pool, &sample);
+    EXPECT_EQ(CACHE_EMPTY, this->cache.state);
+    uint32_t end = t + 30000;
+    for (; t < end && this->cache.state == CACHE_EMPTY; t += 10) {
+        cache_update(&this->cache, t, &this->screen, &this->pool, &sample);
+    }
+    EXPECT_EQ(CACHE_RECORDING, this->cache.state);
+
+    // Clearing the sequence drops the recording
+    sequence_clear(&this->screen);
+    cache_update(&this->cache, t, &this->screen, &this->pool, &sample);
+    EXPECT_EQ(CACHE_EMPTY, this->cache.state);
+}
+
+TEST_F(SampleCacheTest, full) {
+    // Frames too long for the cache are drawn live
+    cache_init(&this->cache, this->samples, 100, 10);
+    DacSample sample;
+    uint32_t t = 0;
+    for (; t < 1000; t += 10) {
+        cache_update(&this->cache, t, &this->screen, &this->pool, &sample);
+        this->liveSample(t);
+    }
+    EXPECT_EQ(CACHE_RECORDING, this->cache.state);
+    cache_update(&this->cache, t, &this->screen, &this->pool, &sample);
+    this->liveSample(t);
+    EXPECT_EQ(CACHE_FULL, this->cache.state);
+    for (t += 10; t < 25000; t += 10) {
+        cache_update(&this->cache, t, &this->screen, &this->pool, &sample);
+        DacSample expected = this->liveSample(t);
+        EXPECT_EQ(CACHE_FULL, this->cache.state);
+        EXPECT_EQ(expected.x, sample.x) << "At " << t << "us";
+        EXPECT_EQ(expected.y, sample.y) << "At " << t << "us";
+    }
+}
+
+TEST_F(SampleCacheTest, none) {
+    // Built without a cache, every frame is drawn live
+    cache_init(&this->cache, NULL, 0, 10);
+    DacSample sample;
+    for (uint32_t t = 0; t < 45000; t += 10) {
+        cache_update(&this->cache, t, &this->screen, &this->pool, &sample);
+        DacSample expected = this->liveSample(t);
+        EXPECT_EQ(CACHE_EMPTY, this->cache.state);
+        EXPECT_EQ(expected.x, sample.x) << "At " << t << "us";
+        EXPECT_EQ(expected.y, sample.y) << "At " << t << "us";
+    }
+}
@@ -1,6 +1,8 @@
+#include <math.h>
 #include <string.h>
 
 #include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -30,12 +32,14 @@ protected:
 
 TEST_F(ScreenControllerTest, point) {
     // Create point command and push it to the screen
+    this->screen.x_centered = true;
+    this->screen.y_centered = true;
     PointCmd cmd = {
         {},  // base
         45,  // x
         -98, // y
     };
-    screen_push_point(&this->pool, &cmd);
+    screen_push_point(&this->screen, &this->pool, &cmd);
 
     // Read motion from pool
     PointMotion* motion = (PointMotion*)ring_peek(&this->pool);
@@ -56,7 +60,7 @@ TEST_F(ScreenControllerTest, lineFromOrigin) {
         3,  // x2
         4,  // y2
     };
-    ASSERT_TRUE(screen_push_line(&this->pool, &cmd, this->screen.speed));
+    ASSERT_TRUE(screen_push_line(&this->screen, &this->pool, &cmd));
 
     // Read motion from pool
     LineMotion* motion = (LineMotion*)ring_peek(&this->pool);
@@ -67,12 +71,17 @@ TEST_F(ScreenControllerTest, lineFromOrigin) {
     EXPECT_EQ(0, motion->y1);
     EXPECT_EQ(3, motion->x2);
     EXPECT_EQ(4, motion->y2);
-    EXPECT_EQ(0,    motion->mx1);
-    EXPECT_EQ(0,    motion->my1);
-    EXPECT_EQ(3000, motion->mx2);
-    EXPECT_EQ(4000, motion->my2);
-    EXPECT_EQ(6000, motion->dx);
-    EXPECT_EQ(8000, motion->dy);
+    EXPECT_EQ(10000, motion->speed);
+
+    // The velocity is worked out when the line starts
+    ASSERT_TRUE(screen_push_line(&this->screen, &this->pool, &cmd));
+    update_screen(0, &this->screen, &this->pool);
+    EXPECT_EQ(0,    this->screen.line.mx1);
+    EXPECT_EQ(0,    this->screen.line.my1);
+    EXPECT_EQ(3000, this->screen.line.mx2);
+    EXPECT_EQ(4000, this->screen.line.my2);
+    EXPECT_EQ(6000, this->screen.line.dx);
+    EXPECT_EQ(8000, this->screen.line.dy);
 }
 
 TEST_F(ScreenControllerTest, longLineFromOrigin) {
@@ -85,7 +94,7 @@ TEST_F(ScreenControllerTest, longLineFromOrigin) {
         300, // x2
         400, // y2
     };
-    ASSERT_TRUE(screen_push_line(&this->pool, &cmd, this->screen.speed));
+    ASSERT_TRUE(screen_push_line(&this->screen, &this->pool, &cmd));
 
     // Read motion from pool
     LineMotion* motion = (LineMotion*)ring_peek(&this->pool);
@@ -96,16 +105,124 @@ TEST_F(ScreenControllerTest, longLineFromOrigin) {
     EXPECT_EQ(0,   motion->y1);
     EXPECT_EQ(300, motion->x2);
     EXPECT_EQ(400, motion->y2);
-    EXPECT_EQ(0,      motion->mx1);
-    EXPECT_EQ(0,      motion->my1);
-    EXPECT_EQ(300000, motion->mx2);
-    EXPECT_EQ(400000, motion->my2);
-    EXPECT_EQ(6000, motion->dx);
-    EXPECT_EQ(8000, motion->dy);
+    EXPECT_EQ(10000, motion->speed);
+
+    ASSERT_TRUE(screen_push_line(&this->screen, &this->pool, &cmd));
+    update_screen(0, &this->screen, &this->pool);
+    EXPECT_EQ(0,      this->screen.line.mx1);
+    EXPECT_EQ(0,      this->screen.line.my1);
+    EXPECT_EQ(300000, this->screen.line.mx2);
+    EXPECT_EQ(400000, this->screen.line.my2);
+    EXPECT_EQ(6000, this->screen.line.dx);
+    EXPECT_EQ(8000, this->screen.line.dy);
+}
+
+// Line layout before motions were packed, kept to check against
+typedef struct LegacyLineMotion {
+    ScreenMotionType type;
+    int16_t x1;
+    int16_t y1;
+    int16_t x2;
+    int16_t y2;
+    int32_t mx1;
+    int32_t my1;
+    int32_t mx2;
+    int32_t my2;
+    int32_t dx;
+    int32_t dy;
+} LegacyLineMotion;
+
+// Velocity was worked out when the line was pushed
+static LegacyLineMotion legacyLine(const LineCmd& cmd, uint16_t speed) {
+    LegacyLineMotion line;
+    line.type = SM_Line;
+    line.x1   = cmd.x1;
+    line.y1   = cmd.y1;
+    line.x2   = cmd.x2;
+    line.y2   = cmd.y2;
+    float length = hypotf(cmd.x2 - cmd.x1, cmd.y2 - cmd.y1) * 1000;
+    line.mx1 = 1000l*cmd.x1;
+    line.my1 = 1000l*cmd.y1;
+    line.mx2 = 1000l*cmd.x2;
+    line.my2 = 1000l*cmd.y2;
+    line.dx  = (float)(line.mx2 - line.mx1) * speed / length;
+    line.dy  = (float)(line.my2 - line.my1) * speed / length;
+    return line;
+}
+
+static BeamState legacyBeam(const LegacyLineMotion& line, uint32_t elapsed) {
+    int32_t x = line.mx1 + line.dx * elapsed;
+    int32_t y = line.my1 + line.dy * elapsed;
+    BeamState beam = {0, 0, 1};
+    if ((line.dx > 0 && x > line.mx2) || (line.dx <= 0 && x < line.mx2)
+        || (line.dy > 0 && y > line.my2) || (line.dy <= 0 && y < line.my2)
+    ) {
+        x = line.mx2;
+        y = line.my2;
+        beam.a = 0;
+    }
+    beam.x = x / 1000;
+    beam.y = y / 1000;
+    return beam;
+}
+
+TEST_F(ScreenControllerTest, compactLines) {
+    // Fill the same space with both layouts
+    char mem[256];
+    RingMemPool small;
+    ring_init(&small, mem, sizeof(mem));
+    unsigned legacy = 0;
+    while (ring_get(&small, sizeof(LegacyLineMotion))) legacy++;
+
+    ring_init(&small, mem, sizeof(mem));
+    unsigned packed = 0;
+    LineCmd cmd = {{}, 0, 0, 300, 400};
+    while (screen_push_line(&this->screen, &small, &cmd)) packed++;
+    EXPECT_EQ(RING_OUT_OF_MEM, small.last_err);
+    EXPECT_GE(packed, 2 * legacy);
+}
+
+TEST_F(ScreenControllerTest, compactLineBeam) {
+    // The beam follows the same path as when the velocity was stored
+    this->screen.x_centered = true;
+    this->screen.y_centered = true;
+    const LineCmd lines[] = {
+        {{}, 0, 0, 300, 400},
+        {{}, -500, 20, 480, -7},
+        {{}, 13, -400, 12, 450},
+        {{}, 100, 100, -100, -90},
+        {{}, -1, 0, 1, 0},
+    };
+    const uint16_t speeds[] = {2, 10, 333, 10000};
+    uint32_t time = 0;
+    for (uint16_t speed : speeds) {
+        this->screen.speed = speed;
+        for (const auto& cmd : lines) {
+            LegacyLineMotion expected = legacyLine(cmd, speed);
+            ASSERT_TRUE(screen_push_line(&this->screen, &this->pool, &cmd));
+            update_screen(time, &this->screen, &this->pool);
+            ASSERT_EQ(time, this->screen.motion_start);
+            uint32_t step = 1 + 4000000 / (speed * 1000);
+            for (uint32_t elapsed = 0;; elapsed += step) {
+                update_screen(time + elapsed, &this->screen, &this->pool);
+                BeamState beam = legacyBeam(expected, elapsed);
+                ASSERT_EQ(beam.x, this->screen.beam.x) << cmd.x1 << ", " << cmd.y1 << " at " << elapsed;
+                ASSERT_EQ(beam.y, this->screen.beam.y) << cmd.x1 << ", " << cmd.y1 << " at " << elapsed;
+                if (!beam.a) {
+                    time += elapsed + 1;
+                    break;
+                }
+            }
+            // Let the screen move on to the next line
+            update_screen(time, &this->screen, &this->pool);
+        }
+    }
 }
 
 TEST_F(ScreenControllerTest, lineThroughOrigin) {
     // Create line command and push it to the screen
+    this->screen.x_centered = true;
+    this->screen.y_centered = true;
     // 4-5-6 right triangle
     LineCmd cmd = {
         {}, // base
@@ -114,7 +231,7 @@ TEST_F(ScreenControllerTest, lineThroughOrigin) {
         3,  // x2
         4,  // y2
     };
-    ASSERT_TRUE(screen_push_line(&this->pool, &cmd, this->screen.speed));
+    ASSERT_TRUE(screen_push_line(&this->screen, &this->pool, &cmd));
 
     // Read motion from pool
     LineMotion* motion = (LineMotion*)ring_peek(&this->pool);
@@ -130,6 +247,8 @@ TEST_F(ScreenControllerTest, lineThroughOrigin) {
 
 TEST_F(ScreenControllerTest, lineShifted) {
     // Create line command and push it to the screen
+    this->screen.x_centered = true;
+    this->screen.y_centered = true;
     // 5-11-12 right triangle
     LineCmd cmd = {
         {}, // base
@@ -138,7 +257,7 @@ TEST_F(ScreenControllerTest, lineShifted) {
         3,  // x2
         17, // y2
     };
-    ASSERT_TRUE(screen_push_line(&this->pool, &cmd, this->screen.speed));
+    ASSERT_TRUE(screen_push_line(&this->screen, &this->pool, &cmd));
 
     // Read motion from pool
     LineMotion* motion = (LineMotion*)ring_peek(&this->pool);
@@ -159,7 +278,7 @@ TEST_F(ScreenControllerTest, updateScreenPoint) {
         54, // x
         81, // y
     };
-    screen_push_point(&this->pool, &cmd);
+    screen_push_point(&this->screen, &this->pool, &cmd);
     update_screen(0, &this->screen, &this->pool);
     EXPECT_EQ(1,  this->screen.beam.a);
     EXPECT_EQ(54, this->screen.beam.x);
@@ -172,7 +291,7 @@ TEST_F(ScreenControllerTest, updateScreenPoint) {
     screen.y_centered = true;
     cmd.x = 25;
     cmd.y = 9;
-    screen_push_point(&this->pool, &cmd);
+    screen_push_point(&this->screen, &this->pool, &cmd);
     update_screen(1000, &this->screen, &this->pool);
     EXPECT_EQ(1,  this->screen.beam.a);
     EXPECT_EQ(25, this->screen.beam.x);
@@ -206,48 +325,267 @@ TEST_F(ScreenControllerTest, updateScreenBounds) {
     screen.x_centered = true;
     screen.y_centered = true;
 
-    // X is below bounds
+    // Points off the screen are dropped without an error
+    const int16_t outside[][2] = {{-70, 10}, {110, -1}, {0, -89}, {-1, 100}};
+    for (const auto& point : outside) {
+        PointCmd cmd = {
+            {},       // base
+            point[0], // x
+            point[1], // y
+        };
+        EXPECT_FALSE(screen_push_point(&this->screen, &this->pool, &cmd)) << point[0] << ", " << point[1];
+        EXPECT_EQ(RING_OK, this->pool.last_err);
+    }
+    EXPECT_FALSE(ring_peek(&this->pool));
+
+    // Edges are on the screen
     PointCmd cmd = {
         {},  // base
-        -70, // x
-        10,  // y
+        -32, // x
+        16,  // y
     };
-    screen_push_point(&this->pool, &cmd);
+    ASSERT_TRUE(screen_push_point(&this->screen, &this->pool, &cmd));
     update_screen(0, &this->screen, &this->pool);
     EXPECT_EQ(1,   this->screen.beam.a);
-    EXPECT_EQ(-32, this->screen.beam.x) << "X was below bounds";
-    EXPECT_EQ(10,  this->screen.beam.y);
-    ring_pop(&this->pool);
-
-    // X is above bounds
-    cmd.x = 110;
-    cmd.y = -1;
-    screen_push_point(&this->pool, &cmd);
-    update_screen(0, &this->screen, &this->pool);
-    EXPECT_EQ(1,  this->screen.beam.a);
-    EXPECT_EQ(32, this->screen.beam.x) << "X was above bounds";
-    EXPECT_EQ(-1, this->screen.beam.y);
-    ring_pop(&this->pool);
-
-    // Y is below bounds
-    cmd.x = 0;
-    cmd.y = -89;
-    screen_push_point(&this->pool, &cmd);
-    update_screen(0, &this->screen, &this->pool);
-    EXPECT_EQ(1,   this->screen.beam.a);
-    EXPECT_EQ(0, this->screen.beam.x) << "X was below bounds";
-    EXPECT_EQ(-16,  this->screen.beam.y);
-    ring_pop(&this->pool);
-
-    // Y is above bounds
-    cmd.x = -1;
-    cmd.y = 100;
-    screen_push_point(&this->pool, &cmd);
+    EXPECT_EQ(-32, this->screen.beam.x);
+    EXPECT_EQ(16,  this->screen.beam.y);
+}
+
+TEST_F(ScreenControllerTest, clipLine) {
+    // -32 to 32 by -16 to 16
+    screen.x_size_pow = 6;
+    screen.y_size_pow = 5;
+    screen.x_centered = true;
+    screen.y_centered = true;
+
+    const struct {
+        int16_t in[4];
+        int16_t out[4];
+    } cases[] = {
+        // Inside
+        {{-10, -10, 10, 10},   {-10, -10, 10, 10}},
+        // One end off the right
+        {{0, 0, 64, 0},        {0, 0, 32, 0}},
+        // Both ends off, crossing the screen
+        {{-64, -8, 64, 8},     {-32, -4, 32, 4}},
+        // Off the top and the left
+        {{-40, 0, 0, 40},      {-32, 8, -24, 16}},
+        // Off a corner at each end
+        {{-96, -24, 96, 24},   {-32, -8, 32, 8}},
+    };
+    for (const auto& c : cases) {
+        LineCmd cmd = {{}, c.in[0], c.in[1], c.in[2], c.in[3]};
+        LineMotion* motion = screen_push_line(&this->screen, &this->pool, &cmd);
+        ASSERT_TRUE(motion) << c.in[0] << ", " << c.in[1] << " -> " << c.in[2] << ", " << c.in[3];
+        EXPECT_EQ(c.out[0], motion->x1);
+        EXPECT_EQ(c.out[1], motion->y1);
+        EXPECT_EQ(c.out[2], motion->x2);
+        EXPECT_EQ(c.out[3], motion->y2);
+    }
+
+    // Lines that never touch the screen are dropped
+    const int16_t outside[][4] = {{-64, 0, -40, 10}, {0, 20, 30, 40}, {-40, 10, -20, 40}};
+    for (const auto& line : outside) {
+        LineCmd cmd = {{}, line[0], line[1], line[2], line[3]};
+        EXPECT_FALSE(screen_push_line(&this->screen, &this->pool, &cmd));
+        EXPECT_EQ(RING_OK, this->pool.last_err);
+    }
+}
+
+TEST_F(ScreenControllerTest, clipCurve) {
+    // -32 to 32 by -16 to 16
+    screen.x_size_pow = 6;
+    screen.y_size_pow = 5;
+    screen.x_centered = true;
+    screen.y_centered = true;
+    screen.speed      = 1000;
+
+    // Curves off the screen are dropped
+    CurveCmd cmd = {{}, 2, {40, 50, 60, 0}, {0, 30, 0, 0}};
+    EXPECT_FALSE(screen_push_curve(&this->screen, &this->pool, &cmd));
+    EXPECT_EQ(RING_OK, this->pool.last_err);
+
+    // Curves partly on the screen are clamped while drawn
+    cmd = {{}, 2, {-20, 0, 20, 0}, {0, 60, 0, 0}};
+    ASSERT_TRUE(screen_push_curve(&this->screen, &this->pool, &cmd));
+    uint32_t t = 0;
+    bool clamped = false;
+    while (update_screen(t, &this->screen, &this->pool) && t < 1000000) {
+        EXPECT_LE(this->screen.beam.y, 16);
+        clamped |= (this->screen.beam.y == 16);
+        t += 10;
+    }
+    EXPECT_TRUE(clamped);
+}
+
+TEST_F(ScreenControllerTest, clipAfterScale) {
+    // Pushed on a wide screen
+    screen.x_size_pow = 11;
+    screen.y_size_pow = 11;
+    screen.x_centered = true;
+    screen.y_centered = true;
+    LineCmd line = {{}, -1000, 0, 1000, 0};
+    PointCmd point = {{}, 900, 900};
+    PointCmd inside = {{}, 10, 10};
+    ASSERT_TRUE(screen_push_line(&this->screen, &this->pool, &line));
+    ASSERT_TRUE(screen_push_point(&this->screen, &this->pool, &point));
+    ASSERT_TRUE(screen_push_point(&this->screen, &this->pool, &inside));
+
+    // Drawn after the screen shrinks to -32 to 32
+    screen.x_size_pow = 6;
+    screen.y_size_pow = 6;
+    uint32_t t = 0;
+    while (update_screen(t, &this->screen, &this->pool) && t < 1000000) {
+        EXPECT_GE(this->screen.beam.x, -32);
+        EXPECT_LE(this->screen.beam.x, 32);
+        t += 1;
+    }
+    EXPECT_NEAR(64 * 1000 / this->screen.speed, t, 2);
+
+    // The point now off the screen was skipped, not drawn on the far rail
+    EXPECT_EQ(1, this->pool.count);
+    EXPECT_EQ(0, this->screen.beam.a);
+    EXPECT_TRUE(update_screen(t + 1, &this->screen, &this->pool));
+    EXPECT_EQ(10, this->screen.beam.x);
+    EXPECT_EQ(10, this->screen.beam.y);
+}
+
+TEST_F(ScreenControllerTest, clipLineDuration) {
+    // Only the visible part of the line takes time to draw
+    screen.x_centered = true;
+    screen.y_centered = true;
+    LineCmd cmd = {{}, -2000, 0, 2000, 0};
+    LineMotion* motion = screen_push_line(&this->screen, &this->pool, &cmd);
+    ASSERT_TRUE(motion);
+    EXPECT_EQ(-512, motion->x1);
+    EXPECT_EQ(512,  motion->x2);
+
+    uint32_t t = 0;
+    while (update_screen(t, &this->screen, &this->pool) && t < 1000000) {
+        EXPECT_GE(this->screen.beam.x, -512);
+        EXPECT_LE(this->screen.beam.x, 512);
+        t += 1;
+    }
+    EXPECT_NEAR(1024 * 1000 / this->screen.speed, t, 2);
+}
+
+TEST_F(ScreenControllerTest, transformPoint) {
+    screen.x_centered = true;
+    screen.y_centered = true;
+
+    // Quarter turn then move
+    ASSERT_TRUE(screen_set_rotation(&this->screen, 90, 1, 5, -3));
+    PointCmd cmd = {{}, 10, 0};
+    PointMotion* motion = screen_push_point(&this->screen, &this->pool, &cmd);
+    ASSERT_TRUE(motion);
+    EXPECT_EQ(5, motion->x);
+    EXPECT_EQ(7, motion->y);
+
+    // Matrix
+    ASSERT_TRUE(screen_set_transform(&this->screen, 0.5, -1, 1, 0.5, 0, 0));
+    cmd = {{}, 20, 10};
+    motion = screen_push_point(&this->screen, &this->pool, &cmd);
+    ASSERT_TRUE(motion);
+    EXPECT_EQ(0,  motion->x);
+    EXPECT_EQ(25, motion->y);
+
+    // Moved off the screen
+    ASSERT_TRUE(screen_set_rotation(&this->screen, 0, 1, 600, 0));
+    cmd = {{}, 0, 0};
+    EXPECT_FALSE(screen_push_point(&this->screen, &this->pool, &cmd));
+    EXPECT_EQ(RING_OK, this->pool.last_err);
+
+    // Reset
+    ASSERT_TRUE(screen_set_transform(&this->screen, 1, 0, 0, 1, 0, 0));
+    EXPECT_TRUE(this->screen.transform.identity);
+}
+
+TEST_F(ScreenControllerTest, transformLine) {
+    screen.x_centered = true;
+    screen.y_centered = true;
+
+    // Turned and doubled, drawn at the same speed
+    ASSERT_TRUE(screen_set_rotation(&this->screen, 90, 2, 0, 0));
+    LineCmd cmd = {{}, 0, 0, 30, 40};
+    LineMotion* motion = screen_push_line(&this->screen, &this->pool, &cmd);
+    ASSERT_TRUE(motion);
+    EXPECT_EQ(0,       motion->x1);
+    EXPECT_EQ(0,       motion->y1);
+    EXPECT_EQ(-80,     motion->x2);
+    EXPECT_EQ(60,      motion->y2);
+    EXPECT_EQ(10000,   motion->speed);
+
+    // Velocity follows the turned line
     update_screen(0, &this->screen, &this->pool);
-    EXPECT_EQ(1,  this->screen.beam.a);
-    EXPECT_EQ(-1, this->screen.beam.x) << "X was above bounds";
-    EXPECT_EQ(16, this->screen.beam.y);
-    ring_pop(&this->pool);
+    EXPECT_EQ(-80000,  this->screen.line.mx2);
+    EXPECT_EQ(60000,   this->screen.line.my2);
+    EXPECT_NEAR(-8000, this->screen.line.dx, 1);
+    EXPECT_NEAR(6000,  this->screen.line.dy, 1);
+}
+
+TEST_F(ScreenControllerTest, transformArc) {
+    screen.x_centered = true;
+    screen.y_centered = true;
+    ArcCmd cmd = {{}, 10, 0, 20, 0, 90};
+
+    // Turned and scaled
+    ASSERT_TRUE(screen_set_rotation(&this->screen, 90, 0.5, 0, 0));
+    ArcMotion* motion = screen_push_arc(&this->screen, &this->pool, &cmd);
+    ASSERT_TRUE(motion);
+    EXPECT_EQ(0,   motion->cx);
+    EXPECT_EQ(5,   motion->cy);
+    EXPECT_EQ(10,  motion->r);
+    EXPECT_EQ(90,  motion->start);
+    EXPECT_EQ(180, motion->end);
+
+    // Flipped over the x-axis
+    ASSERT_TRUE(screen_set_transform(&this->screen, 1, 0, 0, -1, 0, 0));
+    motion = screen_push_arc(&this->screen, &this->pool, &cmd);
+    ASSERT_TRUE(motion);
+    EXPECT_EQ(10,  motion->cx);
+    EXPECT_EQ(0,   motion->cy);
+    EXPECT_EQ(20,  motion->r);
+    EXPECT_EQ(0,   motion->start);
+    EXPECT_EQ(-90, motion->end);
+
+    // A matrix turned 120 degrees and doubled
+    ASSERT_TRUE(screen_set_transform(&this->screen, -1, -1.732, 1.732, -1, 0, 0));
+    EXPECT_EQ(120, this->screen.transform.angle);
+    EXPECT_NEAR(2 * TRANSFORM_ONE, this->screen.transform.scale, 16);
+    EXPECT_FALSE(this->screen.transform.mirror);
+    motion = screen_push_arc(&this->screen, &this->pool, &cmd);
+    ASSERT_TRUE(motion);
+    EXPECT_EQ(40,  motion->r);
+    EXPECT_EQ(120, motion->start);
+    EXPECT_EQ(210, motion->end);
+
+    // Mirrored and turned back
+    ASSERT_TRUE(screen_set_transform(&this->screen, 0, 1, 1, 0, 0, 0));
+    EXPECT_EQ(90, this->screen.transform.angle);
+    EXPECT_EQ(TRANSFORM_ONE, this->screen.transform.scale);
+    EXPECT_TRUE(this->screen.transform.mirror);
+    ASSERT_TRUE(screen_set_transform(&this->screen, -1, 1, -1, -1, 0, 0));
+    EXPECT_EQ(-135, this->screen.transform.angle);
+}
+
+TEST_F(ScreenControllerTest, transformCurve) {
+    screen.x_centered = true;
+    screen.y_centered = true;
+    CurveCmd cmd = {{}, 2, {0, 50, 100, 0}, {0, 100, 0, 0}};
+    CurveMotion* plain = screen_push_curve(&this->screen, &this->pool, &cmd);
+    ASSERT_TRUE(plain);
+
+    // Doubled curves take twice as long
+    ASSERT_TRUE(screen_set_rotation(&this->screen, 180, 2, 0, 0));
+    CurveMotion* motion = screen_push_curve(&this->screen, &this->pool, &cmd);
+    ASSERT_TRUE(motion);
+    EXPECT_EQ(0,    motion->p[0][0]);
+    EXPECT_EQ(-100, motion->p[1][0]);
+    EXPECT_EQ(-200, motion->p[1][1]);
+    EXPECT_EQ(-200, motion->p[2][0]);
+    EXPECT_EQ(0,    motion->p[2][1]);
+    EXPECT_EQ(2 * plain->duration, motion->duration);
+    EXPECT_EQ(2 * plain->steps,    motion->steps);
 }
 
 TEST_F(ScreenControllerTest, updateScreenLineFromOrigin) {
@@ -259,7 +597,7 @@ TEST_F(ScreenControllerTest, updateScreenLineFromOrigin) {
         40, // y2
     };
     // Line length of 50
-    screen_push_line(&this->pool, &cmd, this->screen.speed);
+    screen_push_line(&this->screen, &this->pool, &cmd);
 
     // t = 0us; 0% of line
     update_screen(0, &this->screen, &this->pool);
@@ -316,7 +654,7 @@ TEST_F(ScreenControllerTest, updateScreenLongLineFromOrigin) {
         400, // y2
     };
     // Line length of 50
-    screen_push_line(&this->pool, &cmd, this->screen.speed);
+    screen_push_line(&this->screen, &this->pool, &cmd);
 
     // t = 0us; 0% of line
     update_screen(0, &this->screen, &this->pool);
@@ -374,7 +712,7 @@ TEST_F(ScreenControllerTest, updateScreenLineCornerToCorner) {
         40,  // y2
     };
     // Line length of 50
-    screen_push_line(&this->pool, &cmd, this->screen.speed);
+    screen_push_line(&this->screen, &this->pool, &cmd);
 
     // t = 0us; 0% of line
     update_screen(0, &this->screen, &this->pool);
@@ -431,7 +769,7 @@ TEST_F(ScreenControllerTest, updateScreenLongLineCornerToCorner) {
         400,  // y2
     };
     // Line length of 50
-    screen_push_line(&this->pool, &cmd, this->screen.speed);
+    screen_push_line(&this->screen, &this->pool, &cmd);
 
     // t = 0ms; 0% of line
     update_screen(0, &this->screen, &this->pool);
@@ -637,3 +975,584 @@ TEST(ScreenController, signedPositionTo12Bits) {
     EXPECT_EQ(0x07ffu, position_to_binary(1000, 1000, 12, true));
 }
 */
+
+// Square made of collinear segments, so the long sides can be taken fast
+static void pushSquare(const ScreenState* screen, RingMemPool* pool) {
+    const int16_t corners[][2] = {{-200, -200}, {200, -200}, {200, 200}, {-200, 200}};
+    for (int side = 0; side < 4; side++) {
+        const int16_t* start = corners[side];
+        const int16_t* end   = corners[(side + 1) % 4];
+        for (int seg = 0; seg < 4; seg++) {
+            LineCmd cmd = {
+                {}, // base
+                (int16_t)(start[0] + (end[0] - start[0]) * seg / 4),
+                (int16_t)(start[1] + (end[1] - start[1]) * seg / 4),
+                (int16_t)(start[0] + (end[0] - start[0]) * (seg + 1) / 4),
+                (int16_t)(start[1] + (end[1] - start[1]) * (seg + 1) / 4),
+            };
+            ASSERT_TRUE(screen_push_line(screen, pool, &cmd));
+        }
+    }
+}
+
+// Draw everything in the pool and return how long it took
+static uint32_t drawAll(ScreenState* screen, RingMemPool* pool, std::vector<LinePlan>* plans = NULL) {
+    uint32_t t = 0;
+    const ScreenMotion* active = NULL;
+    while (update_screen(t, screen, pool)) {
+        const ScreenMotion* motion = (const ScreenMotion*)ring_peek(pool);
+        if (plans && motion != active) {
+            plans->push_back(screen->plan);
+            active = motion;
+        }
+        t++;
+    }
+    return t;
+}
+
+TEST_F(ScreenControllerTest, preempt) {
+    // Two long lines queued
+    LineCmd first  = {{}, 0, 0, 500, 0};
+    LineCmd second = {{}, 0, 100, 500, 100};
+    ASSERT_TRUE(screen_push_line(&this->screen, &this->pool, &first));
+    ASSERT_TRUE(screen_push_line(&this->screen, &this->pool, &second));
+    EXPECT_TRUE(update_screen(0, &this->screen, &this->pool));
+    EXPECT_TRUE(update_screen(10, &this->screen, &this->pool));
+    EXPECT_EQ(0, this->screen.beam.y);
+
+    // The first line stops where it is and starts over, it isn't dropped
+    screen_preempt(&this->screen);
+    EXPECT_TRUE(update_screen(20, &this->screen, &this->pool));
+    EXPECT_FALSE(this->screen.preempt);
+    EXPECT_EQ(2, this->pool.count);
+    EXPECT_EQ(20u, this->screen.motion_start);
+    EXPECT_EQ(0, this->screen.beam.x);
+    EXPECT_EQ(0, this->screen.beam.y);
+    EXPECT_EQ(1, this->screen.beam.a);
+
+    // Then the second follows as usual
+    EXPECT_TRUE(update_screen(100000, &this->screen, &this->pool));
+    EXPECT_EQ(1, this->pool.count);
+    EXPECT_EQ(100, this->screen.beam.y);
+
+    // Nothing to cut short once it's done
+    EXPECT_FALSE(update_screen(1000000, &this->screen, &this->pool));
+    screen_preempt(&this->screen);
+    EXPECT_FALSE(this->screen.preempt);
+}
+
+TEST_F(ScreenControllerTest, blank) {
+    // A running sequence
+    ASSERT_TRUE(sequence_start(&this->screen));
+    LineCmd cmd = {{}, 0, 0, 500, 0};
+    for (int i = 0; i < 3; i++) {
+        ScreenMotion* motion = (ScreenMotion*)screen_push_line(&this->screen, &this->pool, &cmd);
+        ASSERT_TRUE(add_to_sequence(&this->screen, motion));
+    }
+    ASSERT_TRUE(sequence_end(&this->screen));
+    EXPECT_TRUE(update_screen(0, &this->screen, &this->pool));
+    EXPECT_TRUE(update_screen(10, &this->screen, &this->pool));
+
+    // Everything stops
+    ASSERT_TRUE(screen_blank(&this->screen, &this->pool));
+    EXPECT_FALSE(update_screen(20, &this->screen, &this->pool));
+    EXPECT_EQ(0, this->screen.beam.a);
+    EXPECT_FALSE(this->screen.sequence_enabled);
+    EXPECT_EQ(0, this->pool.count);
+
+    // A new motion is drawn from its start
+    ASSERT_TRUE(screen_push_line(&this->screen, &this->pool, &cmd));
+    EXPECT_TRUE(update_screen(30, &this->screen, &this->pool));
+    EXPECT_EQ(30u, this->screen.motion_start);
+    EXPECT_EQ(0, this->screen.beam.x);
+    EXPECT_EQ(1, this->screen.beam.a);
+}
+
+TEST_F(ScreenControllerTest, slewPlanFrameTime) {
+    this->screen.x_size_pow = 11;
+    this->screen.y_size_pow = 11;
+    this->screen.x_centered = true;
+    this->screen.y_centered = true;
+    this->screen.speed      = 10;
+
+    // Constant speed
+    pushSquare(&this->screen, &this->pool);
+    uint32_t constant_time = drawAll(&this->screen, &this->pool);
+    EXPECT_NEAR(160000u, constant_time, 100u) << "1600 points at 10 millipoints per microsecond";
+
+    // Planned. Accelerating on the sides and slowing at each corner
+    this->screen.max_slew   = 50;
+    this->screen.slew_accel = 10;
+    pushSquare(&this->screen, &this->pool);
+    std::vector<LinePlan> plans;
+    uint32_t planned_time = drawAll(&this->screen, &this->pool, &plans);
+    EXPECT_LT(planned_time, constant_time / 3) << "Planning should cut the frame time";
+
+    // Check each segment
+    ASSERT_EQ(16u, plans.size());
+    for (unsigned i = 0; i < plans.size(); i++) {
+        const LinePlan& plan = plans[i];
+        const uint32_t safe = (uint32_t)this->screen.speed << PLAN_FRAC_BITS;
+        ASSERT_TRUE(plan.valid) << "Segment " << i;
+        // Phases rounded to whole steps can leave the peak a little over
+        EXPECT_LE(plan.peak * plan.steps, ((int64_t)this->screen.max_slew << PLAN_FRAC_BITS) * plan.duration * 101 / 100)
+            << "Segment " << i << " broke the max slew";
+        if (i % 4 == 0) {
+            EXPECT_EQ(safe, plan.v_entry) << "Segment " << i << " left a corner too fast";
+        }
+        if (i % 4 == 3) {
+            EXPECT_EQ(safe, plan.v_exit) << "Segment " << i << " entered a corner too fast";
+        }
+        else {
+            EXPECT_GT(plan.v_exit, safe) << "Segment " << i << " slowed down on a straight";
+            EXPECT_EQ(plan.v_exit, plans[i + 1].v_entry) << "Segment " << i << " speed isn't continuous";
+        }
+    }
+}
+
+TEST_F(ScreenControllerTest, slewPlanLine) {
+    this->screen.x_size_pow = 11;
+    this->screen.y_size_pow = 11;
+    this->screen.x_centered = true;
+    this->screen.y_centered = true;
+    this->screen.speed      = 10;
+    this->screen.max_slew   = 50;
+    this->screen.slew_accel = 10;
+    LineCmd cmd = {
+        {},   // base
+        -300, // x1
+        -400, // y1
+        300,  // x2
+        400,  // y2
+    };
+    // Line length of 1000
+    // Accelerates over 120 points, cruises 760 points, and decelerates over 120 points
+    screen_push_line(&this->screen, &this->pool, &cmd);
+
+    // Starts at the beginning
+    update_screen(0, &this->screen, &this->pool);
+    EXPECT_EQ(1,    this->screen.beam.a);
+    EXPECT_EQ(-300, this->screen.beam.x);
+    EXPECT_EQ(-400, this->screen.beam.y);
+    // Steps of 16 microseconds
+    EXPECT_NEAR(23200, this->screen.plan.duration, 1);
+    EXPECT_EQ(1450, this->screen.plan.steps);
+    EXPECT_EQ(250,  this->screen.plan.cruise);
+    EXPECT_EQ(1200, this->screen.plan.decel);
+
+    // t = 2ms; 40 points in
+    update_screen(2000, &this->screen, &this->pool);
+    EXPECT_EQ(1,    this->screen.beam.a);
+    EXPECT_EQ(-276, this->screen.beam.x);
+    EXPECT_EQ(-368, this->screen.beam.y);
+
+    // t = 4ms; done accelerating 120 points in
+    update_screen(4000, &this->screen, &this->pool);
+    EXPECT_EQ(1,    this->screen.beam.a);
+    EXPECT_EQ(-228, this->screen.beam.x);
+    EXPECT_EQ(-304, this->screen.beam.y);
+
+    // t = 11.6ms; cruising half way
+    update_screen(11600, &this->screen, &this->pool);
+    EXPECT_EQ(1, this->screen.beam.a);
+    EXPECT_EQ(0, this->screen.beam.x);
+    EXPECT_EQ(0, this->screen.beam.y);
+
+    // t = 23.2ms; stopped at the end
+    update_screen(23200, &this->screen, &this->pool);
+    EXPECT_EQ(1,   this->screen.beam.a);
+    EXPECT_EQ(300, this->screen.beam.x);
+    EXPECT_EQ(400, this->screen.beam.y);
+
+    // Past the end
+    update_screen(23300, &this->screen, &this->pool);
+    EXPECT_EQ(0,   this->screen.beam.a);
+    EXPECT_EQ(300, this->screen.beam.x);
+    EXPECT_EQ(400, this->screen.beam.y);
+}
+
+class RefreshTest: public ScreenControllerTest {
+protected:
+    void SetUp() {
+        ScreenControllerTest::SetUp();
+        this->screen.x_size_pow = 11;
+        this->screen.y_size_pow = 11;
+        this->screen.x_centered = true;
+        this->screen.y_centered = true;
+        this->screen.speed      = 10;
+
+        // Square with sides of 100 points. 40ms to draw at 10 millipoints per microsecond
+        const int16_t corners[][2] = {{0, 0}, {100, 0}, {100, 100}, {0, 100}};
+        ASSERT_TRUE(sequence_start(&this->screen));
+        for (int side = 0; side < 4; side++) {
+            LineCmd cmd = {
+                {}, // base
+                corners[side][0],
+                corners[side][1],
+                corners[(side + 1) % 4][0],
+                corners[(side + 1) % 4][1],
+            };
+            LineMotion* motion = screen_push_line(&this->screen, &this->pool, &cmd);
+            ASSERT_TRUE(motion);
+            ASSERT_TRUE(add_to_sequence(&this->screen, (ScreenMotion*)motion));
+        }
+        ASSERT_TRUE(sequence_end(&this->screen));
+    }
+
+    // Run the sequence and record the times each frame started drawing
+    // Each motion can end up to one sample late
+    std::vector<uint32_t> frameStarts(uint32_t duration) {
+        std::vector<uint32_t> starts;
+        bool drawing_first = false;
+        for (uint32_t t = 0; t < duration; t += 10) {
+            update_screen(t, &this->screen, &this->pool);
+            bool first = (this->screen.sequence_idx == 0 && this->screen.beam.a);
+            if (first && !drawing_first) starts.push_back(t);
+            drawing_first = first;
+        }
+        return starts;
+    }
+};
+
+TEST_F(RefreshTest, measured) {
+    EXPECT_EQ(40000u, this->screen.frame_draw_time);
+    EXPECT_EQ(0,      this->screen.frame_points);
+}
+
+TEST_F(RefreshTest, transformed) {
+    // Loaded sequences follow the transform when they're drawn
+    ASSERT_TRUE(screen_set_rotation(&this->screen, 90, 2, 0, 0));
+    EXPECT_EQ(80000u, this->screen.frame_draw_time);
+
+    // Corners of the turned square
+    const int16_t corners[][2] = {{0, 0}, {0, 200}, {-200, 200}, {-200, 0}};
+    int corner = 0;
+    for (uint32_t t = 0; t < 80100 && corner < 4; t += 10) {
+        update_screen(t, &this->screen, &this->pool);
+        if (this->screen.beam.x == corners[corner][0] && this->screen.beam.y == corners[corner][1]) {
+            corner++;
+        }
+        EXPECT_LE(this->screen.beam.x, 0);
+        EXPECT_GE(this->screen.beam.y, 0);
+    }
+    EXPECT_EQ(4, corner);
+
+    // The stored sequence isn't changed
+    const LineMotion* first = (const LineMotion*)this->screen.sequence[0];
+    EXPECT_EQ(100, first->x2);
+    EXPECT_EQ(0,   first->y2);
+}
+
+TEST_F(RefreshTest, slew) {
+    // Planned sides speed up between the corners. Measured as they're drawn
+    ASSERT_TRUE(screen_set_slew(&this->screen, 50, 10));
+    uint32_t draw_time = this->screen.frame_draw_time;
+    EXPECT_LT(draw_time, 40000u * 3 / 4);
+    std::vector<uint32_t> starts = this->frameStarts(200000);
+    ASSERT_GE(starts.size(), 3u);
+    for (unsigned i = 1; i < starts.size(); i++) {
+        EXPECT_NEAR(draw_time, starts[i] - starts[i - 1], 50u) << "Frame " << i;
+    }
+
+    // Locked to 50Hz from the planned time
+    screen_set_refresh(&this->screen, 20000, false);
+    starts = this->frameStarts(400000);
+    EXPECT_EQ((draw_time * FRAME_SCALE_ONE + 19999) / 20000, this->screen.frame_scale);
+    for (unsigned i = 1; i < starts.size(); i++) {
+        EXPECT_NEAR(20000u, starts[i] - starts[i - 1], 50u) << "Frame " << i;
+    }
+}
+
+TEST_F(RefreshTest, unlocked) {
+    std::vector<uint32_t> starts = this->frameStarts(200000);
+    ASSERT_EQ(5u, starts.size());
+    for (unsigned i = 1; i < starts.size(); i++) {
+        EXPECT_NEAR(40000u, starts[i] - starts[i - 1], 50u) << "Frame " << i;
+    }
+}
+
+TEST_F(RefreshTest, speedUp) {
+    // 50Hz. Twice as fast as the natural rate
+    screen_set_refresh(&this->screen, 20000, false);
+    std::vector<uint32_t> starts = this->frameStarts(200000);
+    EXPECT_EQ(2 * FRAME_SCALE_ONE, this->screen.frame_scale);
+    ASSERT_EQ(10u, starts.size());
+    for (unsigned i = 1; i < starts.size(); i++) {
+        EXPECT_NEAR(20000u, starts[i] - starts[i - 1], 50u) << "Frame " << i;
+    }
+}
+
+TEST_F(RefreshTest, slowDown) {
+    // 10Hz. Lines are slowed down to fill the frame
+    screen_set_refresh(&this->screen, 100000, false);
+    std::vector<uint32_t> starts = this->frameStarts(500000);
+    EXPECT_GT(FRAME_SCALE_ONE, this->screen.frame_scale);
+    ASSERT_EQ(5u, starts.size());
+    for (unsigned i = 1; i < starts.size(); i++) {
+        EXPECT_NEAR(100000u, starts[i] - starts[i - 1], 50u) << "Frame " << i;
+    }
+}
+
+TEST_F(RefreshTest, idle) {
+    // 10Hz. Lines are drawn at normal speed, then the beam idles
+    screen_set_refresh(&this->screen, 100000, true);
+    std::vector<uint32_t> starts = this->frameStarts(500000);
+    EXPECT_EQ(FRAME_SCALE_ONE, this->screen.frame_scale);
+    ASSERT_EQ(5u, starts.size());
+    for (unsigned i = 1; i < starts.size(); i++) {
+        EXPECT_NEAR(100000u, starts[i] - starts[i - 1], 50u) << "Frame " << i;
+    }
+
+    // Blank after the frame is drawn
+    for (uint32_t t = 500000; t <= 540100; t += 10) {
+        update_screen(t, &this->screen, &this->pool);
+    }
+    EXPECT_FALSE(update_screen(550000, &this->screen, &this->pool));
+    EXPECT_EQ(0, this->screen.beam.a);
+    EXPECT_TRUE(update_screen(600000, &this->screen, &this->pool));
+    EXPECT_EQ(1, this->screen.beam.a);
+}
+
+// Evaluate a Bezier curve with De Casteljau's algorithm
+static void bezier(const CurveCmd& cmd, double t, double* x, double* y) {
+    double px[4], py[4];
+    for (int i = 0; i <= cmd.order; i++) {
+        px[i] = cmd.x[i];
+        py[i] = cmd.y[i];
+    }
+    for (int n = cmd.order; n > 0; n--) {
+        for (int i = 0; i < n; i++) {
+            px[i] = px[i] + (px[i + 1] - px[i]) * t;
+            py[i] = py[i] + (py[i + 1] - py[i]) * t;
+        }
+    }
+    *x = px[0];
+    *y = py[0];
+}
+
+class CurveTest: public ScreenControllerTest, public testing::WithParamInterface<CurveCmd> {
+protected:
+    void SetUp() {
+        ScreenControllerTest::SetUp();
+        this->screen.x_size_pow = 11;
+        this->screen.y_size_pow = 11;
+        this->screen.x_centered = true;
+        this->screen.y_centered = true;
+        this->screen.speed      = 100;
+    }
+};
+
+TEST_P(CurveTest, push) {
+    CurveCmd cmd = GetParam();
+    ASSERT_TRUE(screen_push_curve(&this->screen, &this->pool, &cmd));
+
+    // Read motion from pool
+    CurveMotion* motion = (CurveMotion*)ring_peek(&this->pool);
+    ASSERT_EQ(RING_OK, this->pool.last_err);
+    if (cmd.order == 2) {
+        ASSERT_EQ(QUAD_MOTION_SIZE, (unsigned)ring_pop(&this->pool));
+        ASSERT_EQ(SM_Quad, motion->base.type);
+    }
+    else {
+        ASSERT_EQ(CUBIC_MOTION_SIZE, (unsigned)ring_pop(&this->pool));
+        ASSERT_EQ(SM_Cubic, motion->base.type);
+    }
+    for (int i = 0; i <= cmd.order; i++) {
+        EXPECT_EQ(cmd.x[i], motion->p[i][0]) << "Point " << i;
+        EXPECT_EQ(cmd.y[i], motion->p[i][1]) << "Point " << i;
+    }
+    EXPECT_LE(1, motion->steps);
+    EXPECT_GE(CURVE_MAX_STEPS, motion->steps);
+}
+
+TEST_P(CurveTest, draw) {
+    CurveCmd cmd = GetParam();
+    ASSERT_TRUE(screen_push_curve(&this->screen, &this->pool, &cmd));
+    const CurveMotion* motion = (const CurveMotion*)ring_peek(&this->pool);
+    uint32_t duration = motion->duration;
+    uint16_t steps    = motion->steps;
+
+    // Starts exactly on the first point
+    update_screen(0, &this->screen, &this->pool);
+    EXPECT_EQ(1,        this->screen.beam.a);
+    EXPECT_EQ(cmd.x[0], this->screen.beam.x);
+    EXPECT_EQ(cmd.y[0], this->screen.beam.y);
+
+    // Stays on the curve
+    for (uint32_t t = 1; t < duration; t += 7) {
+        ASSERT_TRUE(update_screen(t, &this->screen, &this->pool));
+        double x, y;
+        bezier(cmd, (double)(t * steps / duration) / steps, &x, &y);
+        ASSERT_NEAR(x, this->screen.beam.x, 1.0) << "Drifted off the curve at " << t << "us";
+        ASSERT_NEAR(y, this->screen.beam.y, 1.0) << "Drifted off the curve at " << t << "us";
+    }
+
+    // Lands exactly on the end
+    update_screen(duration, &this->screen, &this->pool);
+    EXPECT_EQ(1,                this->screen.beam.a);
+    EXPECT_EQ(cmd.x[cmd.order], this->screen.beam.x);
+    EXPECT_EQ(cmd.y[cmd.order], this->screen.beam.y);
+
+    // Past the end
+    update_screen(duration + 1, &this->screen, &this->pool);
+    EXPECT_EQ(0,                this->screen.beam.a);
+    EXPECT_EQ(cmd.x[cmd.order], this->screen.beam.x);
+    EXPECT_EQ(cmd.y[cmd.order], this->screen.beam.y);
+}
+
+TEST_P(CurveTest, speed) {
+    // Drawn at about the pushed speed
+    CurveCmd cmd = GetParam();
+    ASSERT_TRUE(screen_push_curve(&this->screen, &this->pool, &cmd));
+    const CurveMotion* motion = (const CurveMotion*)ring_peek(&this->pool);
+    double length = 0;
+    double last_x = cmd.x[0];
+    double last_y = cmd.y[0];
+    for (int i = 1; i <= 10000; i++) {
+        double x, y;
+        bezier(cmd, i / 10000.0, &x, &y);
+        length += hypot(x - last_x, y - last_y);
+        last_x = x;
+        last_y = y;
+    }
+    EXPECT_NEAR(length * 1000 / this->screen.speed, motion->duration, motion->duration * 0.1);
+}
+
+TEST_F(ScreenControllerTest, slowCurve) {
+    // Minutes long, far past where elapsed * steps fits in 32 bits
+    this->screen.x_size_pow = 16;
+    this->screen.y_size_pow = 16;
+    this->screen.x_centered = true;
+    this->screen.y_centered = true;
+    this->screen.speed      = 1;
+    CurveCmd cmd = {{}, 2, {-30000, 0, 30000}, {-30000, 30000, -30000}};
+    ASSERT_TRUE(screen_push_curve(&this->screen, &this->pool, &cmd));
+    const CurveMotion* motion = (const CurveMotion*)ring_peek(&this->pool);
+    uint32_t duration = motion->duration;
+    uint16_t steps    = motion->steps;
+    ASSERT_LT(UINT32_MAX / steps, duration);
+
+    for (uint32_t t = 0; t < duration; t += 99991) {
+        ASSERT_TRUE(update_screen(t, &this->screen, &this->pool));
+        double x, y;
+        bezier(cmd, (double)((uint64_t)t * steps / duration) / steps, &x, &y);
+        ASSERT_NEAR(x, this->screen.beam.x, 1.0) << "Drifted off the curve at " << t << "us";
+        ASSERT_NEAR(y, this->screen.beam.y, 1.0) << "Drifted off the curve at " << t << "us";
+    }
+    update_screen(duration, &this->screen, &this->pool);
+    EXPECT_EQ(cmd.x[2], this->screen.beam.x);
+    EXPECT_EQ(cmd.y[2], this->screen.beam.y);
+}
+
+INSTANTIATE_TEST_CASE_P(ScreenController, CurveTest, testing::Values(
+    CurveCmd{{}, 2, {0, 100, 200},          {0, 200, 0},          },
+    CurveCmd{{}, 2, {-900, 0, 900},         {-900, 900, -900},    },
+    CurveCmd{{}, 2, {5, 6, 8},              {-3, -2, 1},          },
+    CurveCmd{{}, 3, {0, 0, 300, 300},       {0, 300, 300, 0},     },
+    CurveCmd{{}, 3, {-1000, 1000, -1000, 1000}, {-1000, 1000, 1000, -1000}},
+    CurveCmd{{}, 3, {-500, 800, -800, 500}, {0, 900, 900, 0},     }
+));
+
+class ArcTest: public ScreenControllerTest, public testing::WithParamInterface<ArcCmd> {
+protected:
+    void SetUp() {
+        ScreenControllerTest::SetUp();
+        this->screen.x_size_pow = 14;
+        this->screen.y_size_pow = 14;
+        this->screen.x_centered = true;
+        this->screen.y_centered = true;
+        this->screen.speed      = 1000;
+    }
+};
+
+TEST_P(ArcTest, push) {
+    ArcCmd cmd = GetParam();
+    ASSERT_TRUE(screen_push_arc(&this->screen, &this->pool, &cmd));
+
+    // Read motion from pool
+    ArcMotion* motion = (ArcMotion*)ring_peek(&this->pool);
+    ASSERT_EQ(RING_OK, this->pool.last_err);
+    ASSERT_EQ(sizeof(ArcMotion), (unsigned)ring_pop(&this->pool));
+    ASSERT_EQ(SM_Arc, motion->base.type);
+    EXPECT_EQ(cmd.cx,    motion->cx);
+    EXPECT_EQ(cmd.cy,    motion->cy);
+    EXPECT_EQ(cmd.r,     motion->r);
+    EXPECT_EQ(cmd.start, motion->start);
+    EXPECT_EQ(cmd.end,   motion->end);
+
+    // Drawn at the pushed speed
+    double length = fabs(cmd.end - cmd.start) * M_PI / 180 * cmd.r;
+    EXPECT_NEAR(length * 1000 / this->screen.speed, motion->duration, 1.0);
+}
+
+TEST_P(ArcTest, draw) {
+    ArcCmd cmd = GetParam();
+    ASSERT_TRUE(screen_push_arc(&this->screen, &this->pool, &cmd));
+    const ArcMotion* motion = (const ArcMotion*)ring_peek(&this->pool);
+    uint32_t duration = motion->duration;
+    uint16_t steps    = motion->steps;
+    double start = cmd.start * M_PI / 180;
+    double end   = cmd.end * M_PI / 180;
+
+    // Starts on the first point
+    update_screen(0, &this->screen, &this->pool);
+    EXPECT_EQ(1, this->screen.beam.a);
+    EXPECT_NEAR(cmd.cx + cmd.r * cos(start), this->screen.beam.x, 0.5);
+    EXPECT_NEAR(cmd.cy + cmd.r * sin(start), this->screen.beam.y, 0.5);
+
+    // Stays on the circle
+    for (uint32_t t = 1; t < duration; t += 3) {
+        ASSERT_TRUE(update_screen(t, &this->screen, &this->pool));
+        double angle = start + (end - start) * (t * steps / duration) / steps;
+        ASSERT_NEAR(cmd.cx + cmd.r * cos(angle), this->screen.beam.x, 1.0) << "Drifted off the arc at " << t << "us";
+        ASSERT_NEAR(cmd.cy + cmd.r * sin(angle), this->screen.beam.y, 1.0) << "Drifted off the arc at " << t << "us";
+    }
+
+    // Lands on the end
+    update_screen(duration, &this->screen, &this->pool);
+    EXPECT_EQ(1, this->screen.beam.a);
+    EXPECT_NEAR(cmd.cx + cmd.r * cos(end), this->screen.beam.x, 0.5);
+    EXPECT_NEAR(cmd.cy + cmd.r * sin(end), this->screen.beam.y, 0.5);
+
+    // Past the end
+    int16_t end_x = this->screen.beam.x;
+    int16_t end_y = this->screen.beam.y;
+    update_screen(duration + 1, &this->screen, &this->pool);
+    EXPECT_EQ(0,     this->screen.beam.a);
+    EXPECT_EQ(end_x, this->screen.beam.x);
+    EXPECT_EQ(end_y, this->screen.beam.y);
+}
+
+TEST_F(ScreenControllerTest, slowArc) {
+    // Minutes long, far past where elapsed * steps fits in 32 bits
+    this->screen.x_size_pow = 16;
+    this->screen.y_size_pow = 16;
+    this->screen.x_centered = true;
+    this->screen.y_centered = true;
+    this->screen.speed      = 1;
+    ArcCmd cmd = {{}, 0, 0, 30000, 0, 360};
+    ASSERT_TRUE(screen_push_arc(&this->screen, &this->pool, &cmd));
+    const ArcMotion* motion = (const ArcMotion*)ring_peek(&this->pool);
+    uint32_t duration = motion->duration;
+    uint16_t steps    = motion->steps;
+    ASSERT_LT(UINT32_MAX / steps, duration);
+
+    for (uint32_t t = 0; t < duration; t += 99991) {
+        ASSERT_TRUE(update_screen(t, &this->screen, &this->pool));
+        double angle = 2 * M_PI * ((uint64_t)t * steps / duration) / steps;
+        ASSERT_NEAR(cmd.r * cos(angle), this->screen.beam.x, 2.0) << "Drifted off the arc at " << t << "us";
+        ASSERT_NEAR(cmd.r * sin(angle), this->screen.beam.y, 2.0) << "Drifted off the arc at " << t << "us";
+    }
+    update_screen(duration, &this->screen, &this->pool);
+    EXPECT_NEAR(cmd.r, this->screen.beam.x, 0.5);
+    EXPECT_NEAR(0,     this->screen.beam.y, 0.5);
+}
+
+INSTANTIATE_TEST_CASE_P(ScreenController, ArcTest, testing::Values(
+    ArcCmd{{}, 0,     0,    100,   0,   360},
+    ArcCmd{{}, 50,    -20,  7,     90,  180},
+    ArcCmd{{}, -100,  200,  1000,  270, -45},
+    ArcCmd{{}, 0,     0,    8000,  10,  370},
+    ArcCmd{{}, 1000,  -500, 7000,  -30, 30},
+    ArcCmd{{}, 0,     0,    0,     0,   360}
+));
@@ -0,0 +1,151 @@
+// slab_mem_pool_tests.cpp
+
+#include <string.h>
+
+#include <set>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "ring_mem_pool.h"
+#include "screen_controller.h"
+#include "slab_mem_pool.h"
+}
+
+#define ASSERT_NOT_NULL(exp) ASSERT_NE((void*)NULL, (void*)exp)
+
+static const uint8_t motion_sizes[]  = {sizeof(PointMotion), sizeof(LineMotion)};
+static const uint8_t motion_counts[] = {4, 6};
+
+TEST(SlabMemoryPool, init) {
+    char buf[256];
+    SlabMemPool slab;
+    ASSERT_TRUE(slab_init(&slab, buf, sizeof(buf), motion_sizes, motion_counts, 2));
+    EXPECT_EQ(SLAB_OK, slab.last_err);
+    EXPECT_EQ(2, slab.num_classes);
+    EXPECT_EQ(10, slab_available(&slab, sizeof(PointMotion)));
+    EXPECT_EQ(6,  slab_available(&slab, sizeof(LineMotion)));
+    EXPECT_EQ(0,  slab_available(&slab, sizeof(LineMotion) + __alignof__(int32_t)));
+    EXPECT_GE(slab.classes[0].size, sizeof(PointMotion));
+    EXPECT_EQ(0u, slab.classes[0].size % __alignof__(int32_t));
+
+    // Too small
+    EXPECT_FALSE(slab_init(&slab, buf, slab_footprint(motion_sizes, motion_counts, 2) - 1,
+                           motion_sizes, motion_counts, 2));
+    EXPECT_EQ(SLAB_OUT_OF_MEM, slab.last_err);
+}
+
+TEST(SlabMemoryPool, getUntilFull) {
+    char buf[256];
+    SlabMemPool slab;
+    ASSERT_TRUE(slab_init(&slab, buf, sizeof(buf), motion_sizes, motion_counts, 2));
+
+    // Every block is distinct and inside the memory
+    std::set<char*> blocks;
+    for (int i = 0; i < 6; i++) {
+        char* block = (char*)slab_get(&slab, sizeof(LineMotion));
+        ASSERT_NOT_NULL(block) << "Line " << i;
+        EXPECT_GE(block, buf);
+        EXPECT_LE(block + sizeof(LineMotion), buf + sizeof(buf));
+        memset(block, i, sizeof(LineMotion));
+        blocks.insert(block);
+    }
+    EXPECT_FALSE(slab_get(&slab, sizeof(LineMotion)));
+    EXPECT_EQ(SLAB_OUT_OF_MEM, slab.last_err);
+
+    // Points still have their own blocks
+    for (int i = 0; i < 4; i++) {
+        char* block = (char*)slab_get(&slab, sizeof(PointMotion));
+        ASSERT_NOT_NULL(block) << "Point " << i;
+        blocks.insert(block);
+    }
+    EXPECT_EQ(10u, blocks.size());
+    EXPECT_FALSE(slab_get(&slab, sizeof(PointMotion)));
+    EXPECT_EQ(0, slab_available(&slab, 1));
+}
+
+TEST(SlabMemoryPool, freeOutOfOrder) {
+    char buf[256];
+    SlabMemPool slab;
+    ASSERT_TRUE(slab_init(&slab, buf, sizeof(buf), motion_sizes, motion_counts, 2));
+    void* lines[6];
+    for (int i = 0; i < 6; i++) {
+        lines[i] = slab_get(&slab, sizeof(LineMotion));
+        ASSERT_NOT_NULL(lines[i]);
+        memset(lines[i], 'a' + i, sizeof(LineMotion));
+    }
+
+    // Free from the middle, the rest are untouched
+    ASSERT_TRUE(slab_free(&slab, lines[3]));
+    ASSERT_TRUE(slab_free(&slab, lines[1]));
+    EXPECT_EQ(2, slab_available(&slab, sizeof(LineMotion)));
+    for (int i : {0, 2, 4, 5}) {
+        for (unsigned n = 0; n < sizeof(LineMotion); n++) {
+            ASSERT_EQ('a' + i, ((char*)lines[i])[n]) << "Line " << i << " was corrupted";
+        }
+    }
+
+    // Freed blocks are reused, last freed first
+    EXPECT_EQ(lines[1], slab_get(&slab, sizeof(LineMotion)));
+    EXPECT_EQ(lines[3], slab_get(&slab, sizeof(LineMotion)));
+    EXPECT_FALSE(slab_get(&slab, sizeof(LineMotion)));
+
+    // Everything back
+    slab_reset(&slab);
+    EXPECT_EQ(6, slab_available(&slab, sizeof(LineMotion)));
+}
+
+TEST(SlabMemoryPool, spillToLargerClass) {
+    char buf[256];
+    SlabMemPool slab;
+    ASSERT_TRUE(slab_init(&slab, buf, sizeof(buf), motion_sizes, motion_counts, 2));
+    for (int i = 0; i < 4; i++) {
+        ASSERT_NOT_NULL(slab_get(&slab, sizeof(PointMotion)));
+    }
+
+    // Points use line blocks when their own run out
+    void* point = slab_get(&slab, sizeof(PointMotion));
+    ASSERT_NOT_NULL(point);
+    EXPECT_EQ(1, slab.classes[1].used);
+    ASSERT_TRUE(slab_free(&slab, point));
+    EXPECT_EQ(0, slab.classes[1].used);
+}
+
+TEST(SlabMemoryPool, badFree) {
+    char buf[256];
+    SlabMemPool slab;
+    ASSERT_TRUE(slab_init(&slab, buf, sizeof(buf), motion_sizes, motion_counts, 2));
+    char* block = (char*)slab_get(&slab, sizeof(LineMotion));
+    ASSERT_NOT_NULL(block);
+
+    // Not the start of a block
+    EXPECT_FALSE(slab_free(&slab, block + 1));
+    EXPECT_EQ(SLAB_BAD_FREE, slab.last_err);
+
+    // Outside of the pool
+    char other;
+    EXPECT_FALSE(slab_free(&slab, &other));
+    EXPECT_EQ(SLAB_BAD_FREE, slab.last_err);
+
+    // Nothing handed out from this class
+    EXPECT_FALSE(slab_free(&slab, slab.classes[0].start));
+    EXPECT_TRUE(slab_free(&slab, block));
+}
+
+TEST(SlabMemoryPool, capacity) {
+    // More lines fit than in a ring of the same size
+    char ring_buf[256];
+    RingMemPool ring;
+    ring_init(&ring, ring_buf, sizeof(ring_buf));
+    int ring_lines = 0;
+    while (ring_get(&ring, sizeof(LineMotion))) ring_lines++;
+
+    char slab_buf[256];
+    SlabMemPool slab;
+    const uint8_t sizes[]  = {sizeof(LineMotion)};
+    const uint8_t counts[] = {(uint8_t)(sizeof(slab_buf) / sizeof(LineMotion))};
+    ASSERT_TRUE(slab_init(&slab, slab_buf, sizeof(slab_buf), sizes, counts, 1));
+    int slab_lines = 0;
+    while (slab_get(&slab, sizeof(LineMotion))) slab_lines++;
+    EXPECT_GT(slab_lines, ring_lines);
+}